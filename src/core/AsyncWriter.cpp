@@ -0,0 +1,126 @@
+/*
+  Copyright (C) 2010,2011,2012,2013,2014,2015,2016 The ESPResSo project
+  Copyright (C) 2002,2003,2004,2005,2006,2007,2008,2009,2010
+    Max-Planck-Institute for Polymer Research, Theory Group
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "AsyncWriter.hpp"
+
+AsyncWriter::AsyncWriter(size_t max_frames)
+    : m_max_frames(max_frames > 0 ? max_frames : 1), m_stop(false) {
+  m_thread = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  m_thread.join();
+}
+
+void AsyncWriter::write(Frame &&frame) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  /* Back-pressure: the frame being written counts as pending. */
+  m_cond.wait(lock, [this]() { return m_queue.size() < m_max_frames; });
+  m_queue.push_back(std::move(frame));
+  lock.unlock();
+  m_cond.notify_all();
+}
+
+std::string AsyncWriter::flush() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this]() { return m_queue.empty(); });
+  std::string err;
+  std::swap(err, m_error);
+  return err;
+}
+
+std::string AsyncWriter::error() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_error;
+}
+
+bool AsyncWriter::pending(const std::string &filename) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto const &frame : m_queue)
+    for (auto const &b : frame)
+      if (b.filename == filename)
+        return true;
+  return false;
+}
+
+/** Write a block, return an error message or an empty string. */
+static std::string write_block(const AsyncWriter::Block &b) {
+  int fd = open(b.filename.c_str(), O_WRONLY);
+  if (fd < 0)
+    return "Could not open " + b.filename + ": " + strerror(errno);
+
+  const char *p = b.data.data();
+  size_t left = b.data.size();
+  off_t offset = b.offset;
+  while (left > 0) {
+    ssize_t n = pwrite(fd, p, left, offset);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      std::string err = "Could not write " + b.filename + ": " + strerror(errno);
+      close(fd);
+      return err;
+    }
+    p += n;
+    left -= n;
+    offset += n;
+  }
+  if (close(fd) != 0)
+    return "Could not close " + b.filename + ": " + strerror(errno);
+  return std::string();
+}
+
+void AsyncWriter::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_cond.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+    if (m_queue.empty())
+      return;
+
+    /* Appending to the queue does not invalidate the reference. */
+    Frame const &frame = m_queue.front();
+
+    /* Do the I/O without holding the lock. */
+    lock.unlock();
+    std::string err;
+    for (auto const &b : frame) {
+      err = write_block(b);
+      if (!err.empty())
+        break;
+    }
+    lock.lock();
+
+    if (m_error.empty())
+      m_error = err;
+    m_queue.pop_front();
+    m_cond.notify_all();
+  }
+}
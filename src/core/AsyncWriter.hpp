@@ -0,0 +1,96 @@
+/*
+  Copyright (C) 2010,2011,2012,2013,2014,2015,2016 The ESPResSo project
+  Copyright (C) 2002,2003,2004,2005,2006,2007,2008,2009,2010
+    Max-Planck-Institute for Polymer Research, Theory Group
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_ASYNC_WRITER_HPP
+#define CORE_ASYNC_WRITER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Writes staged data to files in a background thread.
+ *
+ * The data of one output step is collected into a frame of blocks,
+ * each of which is written to a file at a fixed byte offset. Frames are
+ * handed to the writer thread as a whole, the caller can immediately
+ * continue. At most max_frames frames are queued, further calls to
+ * write() block until the thread has caught up. The thread only does
+ * POSIX file I/O, so it does not need a thread-safe MPI. It does not
+ * create files, the caller has to do that, for example exclusively
+ * with MPI-IO.
+ */
+class AsyncWriter {
+public:
+  /** A piece of data and its destination. */
+  struct Block {
+    std::string filename;
+    size_t offset;
+    std::vector<char> data;
+  };
+  typedef std::vector<Block> Frame;
+
+  explicit AsyncWriter(size_t max_frames = 2);
+  /** Writes the remaining frames and stops the thread. */
+  ~AsyncWriter();
+
+  /**
+   * @brief Queue a frame for output.
+   *
+   * Blocks while max_frames frames are pending. The files have to
+   * exist, they are not truncated.
+   *
+   * @param frame The frame to write, it is moved from.
+   */
+  void write(Frame &&frame);
+
+  /**
+   * @brief Wait until all queued frames are written.
+   *
+   * @return The first error since the last flush, empty on success.
+   */
+  std::string flush();
+
+  /** The first error since the last flush, empty if there was none. */
+  std::string error() const;
+
+  /** Whether a queued frame, or the one being written, writes to
+      filename. */
+  bool pending(const std::string &filename) const;
+
+private:
+  void run();
+
+  size_t m_max_frames;
+  /** The pending frames. The front stays in the queue while the thread
+      writes it. */
+  std::deque<Frame> m_queue;
+  bool m_stop;
+  std::string m_error;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::thread m_thread;
+};
+
+#endif
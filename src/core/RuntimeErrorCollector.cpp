@@ -20,6 +20,7 @@
 #include <utility>
 
 #include <boost/mpi/collectives.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include "communication.hpp"
 
@@ -433,7 +433,7 @@ void place_vs_and_relate_to_particle(double* pos, int relate_to)
 	  #ifdef ROTATION_PER_PARTICLE
 	    (local_particles[relate_to])->p.rotation=14;
 	  #endif
-	  (local_particles[max_seen_particle])->p.type=collision_params.vs_particle_type;
+	  local_set_particle_type(local_particles[max_seen_particle], collision_params.vs_particle_type);
 }
 
 
@@ -468,7 +468,7 @@ void glue_to_surface_bind_vs_to_pp1(int i)
          bondG[0] = collision_params.bond_vs;
          bondG[1] = max_seen_particle;
          local_change_bond(collision_queue[i].pp1, bondG, 0);
-	 local_particles[collision_queue[i].pp1]->p.type=collision_params.part_type_after_glueing;
+	 local_set_particle_type(local_particles[collision_queue[i].pp1], collision_params.part_type_after_glueing);
 }
 
 #endif
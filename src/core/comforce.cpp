@@ -64,12 +64,12 @@ void calc_comforce()
     for (int t1=t0+1; t1<n_particle_types; t1++) {
       ia_params = get_ia_param(t0,t1);
       if (ia_params->COMFORCE_flag == 1) {
-        com0 = centerofmass(t0);
-        com1 = centerofmass(t1);
+        com0 = centerofmass(t0, true);
+        com1 = centerofmass(t1, true);
         for (int i = 0; i < 3; i++) {
           diff[i]=com1[i]-com0[i];
         }
-        momentofinertiamatrix(t0, MofImatrix);
+        momentofinertiamatrix(t0, MofImatrix, true);
         calc_eigenvalues_3x3(MofImatrix, eva);
         /* perpendicular force */
         if(ia_params->COMFORCE_dir == 1) {
@@ -21,6 +21,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <mpi.h>
 #ifdef OPEN_MPI
 #include <dlfcn.h>
@@ -40,6 +41,7 @@
 #include "actor/EwaldGPU.hpp"
 #include "buckingham.hpp"
 #include "cells.hpp"
+#include "ctraj.hpp"
 #include "cuda_interface.hpp"
 #include "elc.hpp"
 #include "energy.hpp"
@@ -79,6 +81,8 @@
 #include "statistics_correlation.hpp"
 #include "statistics_fluid.hpp"
 #include "statistics_observable.hpp"
+#include "statistics_parallel.hpp"
+#include "system_state.hpp"
 #include "tab.hpp"
 #include "topology.hpp"
 #include "virtual_sites.hpp"
@@ -179,7 +183,19 @@ static int terminated = 0;
   CB(mpi_gather_cuda_devices_slave)                                            \
   CB(mpi_thermalize_cpu_slave)                                                 \
   CB(mpi_scafacos_set_parameters_slave)                                        \
-  CB(mpi_mpiio_slave)
+  CB(mpi_mpiio_slave)                                                          \
+  CB(mpi_lb_mpiio_checkpoint_slave)                                            \
+  CB(mpi_lb_mpiio_vtk_slave)                                                   \
+  CB(mpi_place_particles_slave)                                                \
+  CB(mpi_get_particle_arrays_slave)                                            \
+  CB(mpi_mpiio_flush_slave)                                                    \
+  CB(mpi_ctraj_write_slave)                                                     \
+  CB(mpi_type_index_init_slave)                                                \
+  CB(mpi_gather_type_counts_slave)                                             \
+  CB(mpi_get_particle_of_type_slave)                                           \
+  CB(mpi_gather_type_ids_slave)                                                \
+  CB(mpi_parallel_analysis_slave)                                              \
+  CB(mpi_bcast_system_state_slave)
 
 // create the forward declarations
 #define CB(name) void name(int node, int param);
@@ -377,8 +393,7 @@ void mpi_who_has() {
   /* first collect number of particles on each node */
   MPI_Gather(&n_part, 1, MPI_INT, sizes, 1, MPI_INT, 0, comm_cart);
 
-  for (int i = 0; i <= max_seen_particle; i++)
-    particle_node[i] = -1;
+  particle_node.clear();
 
   /* then fetch particle locations */
   for (int pnode = 0; pnode < n_nodes; pnode++) {
@@ -509,6 +524,59 @@ void mpi_place_new_particle_slave(int pnode, int part) {
   on_particle_change();
 }
 
+/****************** REQ_PLACE_BULK ************/
+
+/** The MPI datatype of a \ref BulkParticle, so that the counts are in
+    particles rather than bytes and do not overflow. */
+static MPI_Datatype bulk_particle_type() {
+  static MPI_Datatype type = MPI_DATATYPE_NULL;
+  if (type == MPI_DATATYPE_NULL) {
+    MPI_Type_contiguous(sizeof(BulkParticle), MPI_BYTE, &type);
+    MPI_Type_commit(&type);
+  }
+  return type;
+}
+
+void mpi_place_particles(const BulkParticle *parts, const int *counts,
+                         int fields, int n_new, int max_part) {
+  int n_local;
+  int new_info[2] = {n_new, max_part};
+  std::vector<int> displs(n_nodes);
+
+  mpi_call(mpi_place_particles_slave, -1, fields);
+
+  MPI_Bcast(new_info, 2, MPI_INT, 0, comm_cart);
+  added_particles(n_new, max_part);
+
+  MPI_Scatter((void *)counts, 1, MPI_INT, &n_local, 1, MPI_INT, 0, comm_cart);
+  for (int i = 0, displ = 0; i < n_nodes; i++) {
+    displs[i] = displ;
+    displ += counts[i];
+  }
+  MPI_Scatterv((void *)parts, const_cast<int *>(counts), displs.data(),
+               bulk_particle_type(), MPI_IN_PLACE, 0, bulk_particle_type(), 0,
+               comm_cart);
+  local_place_particles(parts, n_local, fields);
+
+  on_particle_change();
+}
+
+void mpi_place_particles_slave(int pnode, int fields) {
+  int n_local;
+  int new_info[2];
+
+  MPI_Bcast(new_info, 2, MPI_INT, 0, comm_cart);
+  added_particles(new_info[0], new_info[1]);
+
+  MPI_Scatter(NULL, 1, MPI_INT, &n_local, 1, MPI_INT, 0, comm_cart);
+  std::vector<BulkParticle> parts(n_local);
+  MPI_Scatterv(NULL, NULL, NULL, bulk_particle_type(), parts.data(), n_local,
+               bulk_particle_type(), 0, comm_cart);
+  local_place_particles(parts.data(), n_local, fields);
+
+  on_particle_change();
+}
+
 /****************** REQ_SET_V ************/
 void mpi_send_v(int pnode, int part, double v[3]) {
   mpi_call(mpi_send_v_slave, pnode, part);
@@ -816,7 +884,7 @@ void mpi_send_type(int pnode, int part, int type) {
 
   if (pnode == this_node) {
     Particle *p = local_particles[part];
-    p->p.type = type;
+    local_set_particle_type(p, type);
   } else
     MPI_Send(&type, 1, MPI_INT, pnode, SOME_TAG, comm_cart);
 
@@ -826,12 +894,107 @@ void mpi_send_type(int pnode, int part, int type) {
 void mpi_send_type_slave(int pnode, int part) {
   if (pnode == this_node) {
     Particle *p = local_particles[part];
-    MPI_Recv(&p->p.type, 1, MPI_INT, 0, SOME_TAG, comm_cart, MPI_STATUS_IGNORE);
+    int type;
+    MPI_Recv(&type, 1, MPI_INT, 0, SOME_TAG, comm_cart, MPI_STATUS_IGNORE);
+    local_set_particle_type(p, type);
   }
 
   on_particle_change();
 }
 
+/********************* REQ_TYPE_INDEX ********/
+void mpi_type_index_init(int type) {
+  mpi_call(mpi_type_index_init_slave, -1, type);
+  local_type_index_init(type);
+}
+
+void mpi_type_index_init_slave(int, int type) { local_type_index_init(type); }
+
+void mpi_gather_type_counts(int type, int *counts) {
+  mpi_call(mpi_gather_type_counts_slave, -1, type);
+  int n = local_type_index_count(type);
+  MPI_Gather(&n, 1, MPI_INT, counts, 1, MPI_INT, 0, comm_cart);
+}
+
+void mpi_gather_type_counts_slave(int, int type) {
+  int n = local_type_index_count(type);
+  MPI_Gather(&n, 1, MPI_INT, NULL, 1, MPI_INT, 0, comm_cart);
+}
+
+int mpi_get_particle_of_type(int pnode, int type, int k) {
+  if (pnode == this_node)
+    return local_type_index_id(type, k);
+
+  int id;
+  mpi_call(mpi_get_particle_of_type_slave, pnode, type);
+  MPI_Send(&k, 1, MPI_INT, pnode, SOME_TAG, comm_cart);
+  MPI_Recv(&id, 1, MPI_INT, pnode, SOME_TAG, comm_cart, MPI_STATUS_IGNORE);
+  return id;
+}
+
+void mpi_get_particle_of_type_slave(int pnode, int type) {
+  if (pnode == this_node) {
+    int k, id;
+    MPI_Recv(&k, 1, MPI_INT, 0, SOME_TAG, comm_cart, MPI_STATUS_IGNORE);
+    id = local_type_index_id(type, k);
+    MPI_Send(&id, 1, MPI_INT, 0, SOME_TAG, comm_cart);
+  }
+}
+
+void mpi_gather_type_ids(int type, std::vector<int> &ids) {
+  mpi_call(mpi_gather_type_ids_slave, -1, type);
+
+  std::vector<int> counts(n_nodes), displs(n_nodes);
+  int n = local_type_index_count(type);
+  MPI_Gather(&n, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm_cart);
+  int total = 0;
+  for (int i = 0; i < n_nodes; i++) {
+    displs[i] = total;
+    total += counts[i];
+  }
+  ids.resize(total);
+  const std::vector<int> *local = local_type_index_ids(type);
+  MPI_Gatherv(local ? (void *)local->data() : NULL, n, MPI_INT, ids.data(),
+              counts.data(), displs.data(), MPI_INT, 0, comm_cart);
+}
+
+void mpi_gather_type_ids_slave(int, int type) {
+  int n = local_type_index_count(type);
+  MPI_Gather(&n, 1, MPI_INT, NULL, 1, MPI_INT, 0, comm_cart);
+  const std::vector<int> *local = local_type_index_ids(type);
+  MPI_Gatherv(local ? (void *)local->data() : NULL, n, MPI_INT, NULL, NULL,
+              NULL, MPI_INT, 0, comm_cart);
+}
+
+/********************* REQ_PARALLEL_ANALYSIS ********/
+std::vector<double> mpi_parallel_analysis(int id,
+                                          const std::vector<double> &params) {
+  int n = params.size();
+  mpi_call(mpi_parallel_analysis_slave, id, n);
+  MPI_Bcast(const_cast<double *>(params.data()), n, MPI_DOUBLE, 0, comm_cart);
+  return ParallelAnalysis::get(id).collective_to_master(params);
+}
+
+void mpi_parallel_analysis_slave(int id, int n) {
+  std::vector<double> params(n);
+  MPI_Bcast(params.data(), n, MPI_DOUBLE, 0, comm_cart);
+  ParallelAnalysis::get(id).collective_to_master(params);
+}
+
+/********************* REQ_BCAST_SYSTEM_STATE ********/
+void mpi_bcast_system_state(const std::vector<char> &blob) {
+  int size = blob.size();
+  mpi_call(mpi_bcast_system_state_slave, -1, size);
+  MPI_Bcast(const_cast<char *>(blob.data()), size, MPI_BYTE, 0, comm_cart);
+  system_state_unpack(blob);
+}
+
+void mpi_bcast_system_state_slave(int node, int size) {
+  std::vector<char> blob(size);
+  MPI_Bcast(blob.data(), size, MPI_BYTE, 0, comm_cart);
+  system_state_unpack(blob);
+}
+
 /********************* REQ_SET_MOLID ********/
 void mpi_send_mol_id(int pnode, int part, int mid) {
   mpi_call(mpi_send_mol_id_slave, pnode, part);
@@ -1576,10 +1739,18 @@ void mpi_local_stress_tensor(DoubleList *TensorInBin, int bins[3],
   PTENSOR_TRACE(fprintf(stderr, "%d: mpi_local_stress_tensor: Reduce local "
                                 "stress tensors with MPI_Reduce\n",
                         this_node));
-  for (i = 0; i < bins[0] * bins[1] * bins[2]; i++) {
-    MPI_Reduce(TensorInBin_[i].e, TensorInBin[i].e, 9, MPI_DOUBLE, MPI_SUM, 0,
-               comm_cart);
+  /* one reduction for all bins */
+  int n_bins = bins[0] * bins[1] * bins[2];
+  std::vector<double> local(9 * n_bins), total(9 * n_bins);
+  for (i = 0; i < n_bins; i++)
+    std::copy(TensorInBin_[i].e, TensorInBin_[i].e + 9, &local[9 * i]);
+  MPI_Reduce(local.data(), total.data(), 9 * n_bins, MPI_DOUBLE, MPI_SUM, 0,
+             comm_cart);
+  for (i = 0; i < n_bins; i++) {
+    std::copy(&total[9 * i], &total[9 * i] + 9, TensorInBin[i].e);
+    realloc_doublelist(&TensorInBin_[i], 0);
   }
+  free(TensorInBin_);
 }
 
 void mpi_local_stress_tensor_slave(int ana_num, int job) {
@@ -1607,16 +1778,12 @@ void mpi_local_stress_tensor_slave(int ana_num, int job) {
 
   local_stress_tensor_calc(TensorInBin, bins, periodic, range_start, range);
 
-  for (i = 0; i < bins[0] * bins[1] * bins[2]; i++) {
-    MPI_Reduce(TensorInBin[i].e, NULL, 9, MPI_DOUBLE, MPI_SUM, 0, comm_cart);
-    PTENSOR_TRACE(fprintf(
-        stderr, "%d: mpi_local_stress_tensor: Tensor sent in bin %d is {",
-        this_node, i));
-    for (j = 0; j < 9; j++) {
-      PTENSOR_TRACE(fprintf(stderr, "%f ", TensorInBin[i].e[j]));
-    }
-    PTENSOR_TRACE(fprintf(stderr, "}\n"));
-  }
+  int n_bins = bins[0] * bins[1] * bins[2];
+  std::vector<double> local(9 * n_bins);
+  for (i = 0; i < n_bins; i++)
+    std::copy(TensorInBin[i].e, TensorInBin[i].e + 9, &local[9 * i]);
+  MPI_Reduce(local.data(), NULL, 9 * n_bins, MPI_DOUBLE, MPI_SUM, 0,
+             comm_cart);
 
   for (i = 0; i < bins[0] * bins[1] * bins[2]; i++) {
     realloc_doublelist(&TensorInBin[i], 0);
@@ -1807,6 +1974,161 @@ void mpi_get_particles_slave(int pnode, int bi) {
   }
 }
 
+/****************** REQ_GET_PARTICLE_ARRAYS ************/
+
+/** Local part of \ref mpi_get_particle_arrays: pack the selected fields
+    of all local particles, in user units. */
+static void pack_particle_arrays(int fields, std::vector<int> &id,
+                                 std::vector<double> &pos,
+                                 std::vector<double> &v,
+                                 std::vector<double> &f,
+                                 std::vector<int> &type,
+                                 std::vector<double> &q) {
+  for (int c = 0; c < local_cells.n; c++) {
+    Cell *cell = local_cells.cell[c];
+    for (int i = 0; i < cell->n; i++) {
+      Particle *p = &cell->part[i];
+      double ppos[3], pv[3], v_scale = time_step, f_scale = 0.5 * time_step * time_step;
+      int img[3];
+
+      memmove(ppos, p->r.p, 3 * sizeof(double));
+      memmove(pv, p->m.v, 3 * sizeof(double));
+      memmove(img, p->l.i, 3 * sizeof(int));
+      unfold_position(ppos, pv, img);
+#ifdef MULTI_TIMESTEP
+      if (smaller_time_step > 0. && p->p.smaller_timestep)
+        v_scale = smaller_time_step;
+#endif
+#ifdef MASS
+      f_scale /= p->p.mass;
+#endif
+
+      id.push_back(p->p.identity);
+      for (int k = 0; k < 3; k++) {
+        if (fields & PART_BULK_POS)
+          pos.push_back(ppos[k]);
+        if (fields & PART_BULK_V)
+          v.push_back(pv[k] / v_scale);
+        if (fields & PART_BULK_F)
+          f.push_back(p->f.f[k] / f_scale);
+      }
+      if (fields & PART_BULK_TYPE)
+        type.push_back(p->p.type);
+#ifdef ELECTROSTATICS
+      if (fields & PART_BULK_Q)
+        q.push_back(p->p.q);
+#else
+      if (fields & PART_BULK_Q)
+        q.push_back(0.0);
+#endif
+    }
+  }
+}
+
+/** Gather one packed field of \ref mpi_get_particle_arrays on the master,
+    in node order. sizes is the number of particles per node and only
+    used on the master. */
+template <typename T>
+static void gather_particle_array(const std::vector<T> &local, T *result,
+                                  const int *sizes, int components,
+                                  MPI_Datatype type) {
+  std::vector<int> counts, displs;
+  if (this_node == 0) {
+    counts.resize(n_nodes);
+    displs.resize(n_nodes);
+    for (int i = 0, displ = 0; i < n_nodes; i++) {
+      counts[i] = components * sizes[i];
+      displs[i] = displ;
+      displ += counts[i];
+    }
+  }
+  MPI_Gatherv((void *)local.data(), local.size(), type, result, counts.data(),
+              displs.data(), type, 0, comm_cart);
+}
+
+void mpi_get_particle_arrays(int fields, int *id, double *pos, double *v,
+                             double *f, int *type, double *q) {
+  std::vector<int> l_id, l_type, sizes(n_nodes);
+  std::vector<double> l_pos, l_v, l_f, l_q;
+  int local_part, i, k;
+
+  mpi_call(mpi_get_particle_arrays_slave, -1, fields);
+
+  pack_particle_arrays(fields, l_id, l_pos, l_v, l_f, l_type, l_q);
+  local_part = l_id.size();
+  MPI_Gather(&local_part, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0, comm_cart);
+
+  /* gather in node order */
+  std::vector<int> g_id(n_part), g_type;
+  std::vector<double> g_pos, g_v, g_f, g_q;
+  gather_particle_array(l_id, g_id.data(), sizes.data(), 1, MPI_INT);
+  if (fields & PART_BULK_POS) {
+    g_pos.resize(3 * n_part);
+    gather_particle_array(l_pos, g_pos.data(), sizes.data(), 3, MPI_DOUBLE);
+  }
+  if (fields & PART_BULK_V) {
+    g_v.resize(3 * n_part);
+    gather_particle_array(l_v, g_v.data(), sizes.data(), 3, MPI_DOUBLE);
+  }
+  if (fields & PART_BULK_F) {
+    g_f.resize(3 * n_part);
+    gather_particle_array(l_f, g_f.data(), sizes.data(), 3, MPI_DOUBLE);
+  }
+  if (fields & PART_BULK_TYPE) {
+    g_type.resize(n_part);
+    gather_particle_array(l_type, g_type.data(), sizes.data(), 1, MPI_INT);
+  }
+  if (fields & PART_BULK_Q) {
+    g_q.resize(n_part);
+    gather_particle_array(l_q, g_q.data(), sizes.data(), 1, MPI_DOUBLE);
+  }
+
+  /* and sort by identity */
+  std::vector<int> index(n_part);
+  for (i = 0; i < n_part; i++)
+    index[i] = i;
+  std::sort(index.begin(), index.end(),
+            [&g_id](int a, int b) { return g_id[a] < g_id[b]; });
+  for (int n = 0; n < n_part; n++) {
+    i = index[n];
+    id[n] = g_id[i];
+    for (k = 0; k < 3; k++) {
+      if (fields & PART_BULK_POS)
+        pos[3 * n + k] = g_pos[3 * i + k];
+      if (fields & PART_BULK_V)
+        v[3 * n + k] = g_v[3 * i + k];
+      if (fields & PART_BULK_F)
+        f[3 * n + k] = g_f[3 * i + k];
+    }
+    if (fields & PART_BULK_TYPE)
+      type[n] = g_type[i];
+    if (fields & PART_BULK_Q)
+      q[n] = g_q[i];
+  }
+}
+
+void mpi_get_particle_arrays_slave(int pnode, int fields) {
+  std::vector<int> l_id, l_type;
+  std::vector<double> l_pos, l_v, l_f, l_q;
+  int local_part;
+
+  pack_particle_arrays(fields, l_id, l_pos, l_v, l_f, l_type, l_q);
+  local_part = l_id.size();
+  MPI_Gather(&local_part, 1, MPI_INT, NULL, 1, MPI_INT, 0, comm_cart);
+
+  gather_particle_array<int>(l_id, NULL, NULL, 1, MPI_INT);
+  if (fields & PART_BULK_POS)
+    gather_particle_array<double>(l_pos, NULL, NULL, 3, MPI_DOUBLE);
+  if (fields & PART_BULK_V)
+    gather_particle_array<double>(l_v, NULL, NULL, 3, MPI_DOUBLE);
+  if (fields & PART_BULK_F)
+    gather_particle_array<double>(l_f, NULL, NULL, 3, MPI_DOUBLE);
+  if (fields & PART_BULK_TYPE)
+    gather_particle_array<int>(l_type, NULL, NULL, 1, MPI_INT);
+  if (fields & PART_BULK_Q)
+    gather_particle_array<double>(l_q, NULL, NULL, 1, MPI_DOUBLE);
+}
+
 /*************** REQ_SET_TIME_STEP ************/
 void mpi_set_time_step(double time_s) {
   double old_ts = time_step;
@@ -3135,20 +3457,30 @@ void mpi_gather_cuda_devices_slave(int dummy1, int dummy2) {
 #endif
 }
 
-void mpi_mpiio(const char *filename, unsigned fields, int write) {
+int mpi_mpiio(const char *filename, unsigned fields, int write) {
   size_t flen = strlen(filename) + 1;
   if (flen + 5 > INT_MAX) {
     fprintf(stderr, "Seriously?\n");
     errexit();
   }
+  // Globals and random number generator states are handled by the
+  // master, before the particles are read with the restored time step
+  // and after the particle files were created.
+  if ((fields & MPIIO_OUT_GLB) && !write)
+    mpiio_read_globals(filename);
   mpi_call(mpi_mpiio_slave, -1, (int)flen);
   MPI_Bcast((void *)filename, (int)flen, MPI_CHAR, 0, MPI_COMM_WORLD);
   MPI_Bcast(&fields, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
   MPI_Bcast(&write, 1, MPI_INT, 0, MPI_COMM_WORLD);
-  if (write)
-    mpi_mpiio_common_write(filename, fields);
-  else
+  if (!write) {
     mpi_mpiio_common_read(filename, fields);
+    return ES_OK;
+  }
+  if (mpi_mpiio_common_write(filename, fields) != ES_OK)
+    return ES_ERROR;
+  if (fields & MPIIO_OUT_GLB)
+    mpiio_write_globals(filename);
+  return ES_OK;
 }
 
 void mpi_mpiio_slave(int dummy, int flen) {
@@ -3164,3 +3496,79 @@ void mpi_mpiio_slave(int dummy, int flen) {
     mpi_mpiio_common_read(filename, fields);
   delete[] filename;
 }
+
+void mpi_mpiio_flush() {
+  mpi_call(mpi_mpiio_flush_slave, -1, 0);
+  mpi_mpiio_common_flush();
+}
+
+void mpi_mpiio_flush_slave(int, int) { mpi_mpiio_common_flush(); }
+
+void mpi_ctraj_write(const char *filename, unsigned fields, double prec,
+                     double vprec) {
+  int flen = strlen(filename) + 1;
+  double precs[2] = {prec, vprec};
+  mpi_call(mpi_ctraj_write_slave, -1, flen);
+  MPI_Bcast((void *)filename, flen, MPI_CHAR, 0, comm_cart);
+  MPI_Bcast(&fields, 1, MPI_UNSIGNED, 0, comm_cart);
+  MPI_Bcast(precs, 2, MPI_DOUBLE, 0, comm_cart);
+  mpi_ctraj_common_write(filename, fields, prec, vprec);
+}
+
+void mpi_ctraj_write_slave(int, int flen) {
+  std::vector<char> filename(flen);
+  unsigned fields;
+  double precs[2];
+  MPI_Bcast(filename.data(), flen, MPI_CHAR, 0, comm_cart);
+  MPI_Bcast(&fields, 1, MPI_UNSIGNED, 0, comm_cart);
+  MPI_Bcast(precs, 2, MPI_DOUBLE, 0, comm_cart);
+  mpi_ctraj_common_write(filename.data(), fields, precs[0], precs[1]);
+}
+
+int mpi_lb_mpiio_checkpoint(const char *filename, int write) {
+#ifdef LB
+  int flen = strlen(filename) + 1;
+  mpi_call(mpi_lb_mpiio_checkpoint_slave, -1, flen);
+  MPI_Bcast((void *)filename, flen, MPI_CHAR, 0, comm_cart);
+  MPI_Bcast(&write, 1, MPI_INT, 0, comm_cart);
+  return lb_mpiio_checkpoint(filename, write);
+#else
+  return ES_ERROR;
+#endif
+}
+
+void mpi_lb_mpiio_checkpoint_slave(int dummy, int flen) {
+#ifdef LB
+  char *filename = new char[flen];
+  int write;
+  MPI_Bcast(filename, flen, MPI_CHAR, 0, comm_cart);
+  MPI_Bcast(&write, 1, MPI_INT, 0, comm_cart);
+  lb_mpiio_checkpoint(filename, write);
+  delete[] filename;
+#endif
+}
+
+int mpi_lb_mpiio_vtk(const char *filename, int field, int stride,
+                     int single_precision) {
+#ifdef LB
+  int flen = strlen(filename) + 1;
+  int params[3] = {field, stride, single_precision};
+  mpi_call(mpi_lb_mpiio_vtk_slave, -1, flen);
+  MPI_Bcast((void *)filename, flen, MPI_CHAR, 0, comm_cart);
+  MPI_Bcast(params, 3, MPI_INT, 0, comm_cart);
+  return lb_mpiio_vtk(filename, field, stride, single_precision);
+#else
+  return ES_ERROR;
+#endif
+}
+
+void mpi_lb_mpiio_vtk_slave(int dummy, int flen) {
+#ifdef LB
+  char *filename = new char[flen];
+  int params[3];
+  MPI_Bcast(filename, flen, MPI_CHAR, 0, comm_cart);
+  MPI_Bcast(params, 3, MPI_INT, 0, comm_cart);
+  lb_mpiio_vtk(filename, params[0], params[1], params[2]);
+  delete[] filename;
+#endif
+}
@@ -52,6 +52,7 @@
 
 #include <array>
 #include <mpi.h>
+#include <vector>
 
 #include <boost/mpi/communicator.hpp>
 
@@ -161,6 +162,24 @@ void mpi_place_particle(int node, int id, double pos[3]);
 */
 void mpi_place_new_particle(int node, int id, double pos[3]);
 
+/** Issue REQ_PLACE_BULK: place and create many particles at once. The
+    particle data is scattered to the nodes in a single call.
+    Also calls \ref on_particle_change.
+    \param parts    the particle data, sorted by destination node.
+    \param counts   the number of particles for each node.
+    \param fields   which optional fields of parts are valid (PART_BULK_*).
+    \param n_new    the number of particles that are created.
+    \param max_part the highest identity among the particles.
+*/
+void mpi_place_particles(const BulkParticle *parts, const int *counts,
+                         int fields, int n_new, int max_part);
+
+/** Issue REQ_GET_PARTICLE_ARRAYS: gather selected properties of all
+    particles, sorted by identity, see \ref get_particle_arrays.
+*/
+void mpi_get_particle_arrays(int fields, int *id, double *pos, double *v,
+                             double *f, int *type, double *q);
+
 /** Issue REQ_SET_V: send particle velocity.
     Also calls \ref on_particle_change.
     \param part the particle.
@@ -342,6 +361,47 @@ void mpi_send_configtemp_flag(int node, int part, int configtemp_flag);
 */
 void mpi_send_type(int node, int part, int type);
 
+/** Issue REQ_TYPE_INDEX: start indexing the particles of a type on all
+    nodes, see \ref local_type_index_init.
+    \param type the particle type
+*/
+void mpi_type_index_init(int type);
+
+/** Collect the number of particles of an indexed type on every node.
+    \param type the particle type
+    \param counts on the master, receives one number per node
+*/
+void mpi_gather_type_counts(int type, int *counts);
+
+/** Get the id of the k-th particle of an indexed type on a node.
+    \param pnode the node to ask
+    \param type the particle type
+    \param k index into the local particles of that type on pnode
+    \return the particle id, or -1 if there is no such particle
+*/
+int mpi_get_particle_of_type(int pnode, int type, int k);
+
+/** Collect the ids of all particles of an indexed type on the master.
+    \param type the particle type
+    \param ids receives the ids, ordered by node
+*/
+void mpi_gather_type_ids(int type, std::vector<int> &ids);
+
+/** Issue REQ_PARALLEL_ANALYSIS: run a distributed analysis on all nodes,
+    see \ref ParallelAnalysis.
+    \param id the number of the analysis
+    \param params its parameters
+    \return the reduced result
+*/
+std::vector<double> mpi_parallel_analysis(int id,
+                                          const std::vector<double> &params);
+
+/** Issue REQ_BCAST_SYSTEM_STATE: replace the system state of all nodes
+    in one message, see \ref system_state.hpp.
+    \param blob the state as written by \ref system_state_pack
+*/
+void mpi_bcast_system_state(const std::vector<char> &blob);
+
 /** Issue REQ_SET_MOL_ID: send molecule id.
     Also calls \ref on_particle_change.
     \param part the particle.
@@ -669,8 +729,39 @@ void mpi_thermalize_cpu(int temp);
  * null-terminated.
  *  \param fields Fields to dump (see mpiio_tcl.hpp).
  *  \param write 1 to write, 0 to read
+ *  \return ES_OK, or ES_ERROR with a runtime error if the files of an
+ *          asynchronous output could not be created
+ */
+int mpi_mpiio(const char *filename, unsigned fields, int write);
+
+/** Wait until the asynchronous MPI-IO output of all nodes is written,
+ *  see \ref mpi_mpiio_common_flush.
+ */
+void mpi_mpiio_flush();
+
+/** Append a frame to a compressed trajectory, see \ref
+ *  mpi_ctraj_common_write.
+ */
+void mpi_ctraj_write(const char *filename, unsigned fields, double prec,
+                     double vprec);
+
+/** Issue REQ_LB_MPIIO_CHECKPOINT: parallel checkpoint of the CPU LB
+ *  fluid, see \ref lb_mpiio_checkpoint.
+ *  \param filename Name of the checkpoint file. Must be null-terminated.
+ *  \param write 1 to write, 0 to read
+ *  \return ES_OK on success, ES_ERROR otherwise
+ */
+int mpi_lb_mpiio_checkpoint(const char *filename, int write);
+
+/** Issue REQ_LB_MPIIO_VTK: parallel output of an LB fluid field, see
+ *  \ref lb_mpiio_vtk.
+ *  \param filename Name of the VTK file. Must be null-terminated.
+ *  \param field    \ref LB_FIELD_DENSITY or \ref LB_FIELD_VELOCITY
+ *  \param stride   only every stride-th node in each direction is written
+ *  \param single_precision write single instead of double precision values
+ *  \return ES_OK on success, ES_ERROR otherwise
  */
-void mpi_mpiio(const char *filename, unsigned fields, int write);
+int mpi_lb_mpiio_vtk(const char *filename, int field, int stride, int single_precision);
 
 /*@}*/
 
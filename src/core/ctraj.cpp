@@ -0,0 +1,421 @@
+/*
+  Copyright (C) 2010,2011,2012,2013,2014,2015,2016 The ESPResSo project
+  Copyright (C) 2002,2003,2004,2005,2006,2007,2008,2009,2010
+    Max-Planck-Institute for Polymer Research, Theory Group
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file ctraj.cpp
+ *  Implementation of \ref ctraj.hpp.
+ *
+ *  Chunk encoding: the ids and then every component of the positions
+ *  (and velocities) are stored as separate streams. The ids are stored
+ *  as gaps to the previous id, the coordinates are quantized and
+ *  stored as differences to the previous particle, mapped to unsigned
+ *  values by zigzag coding. Each stream is split into groups of \ref
+ *  CTRAJ_GROUP values, every group starts at a byte boundary with its
+ *  bit width as one byte, followed by the values bit packed.
+ */
+
+#include "config.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mpi.h>
+
+#include "cells.hpp"
+#include "communication.hpp"
+#include "errorhandling.hpp"
+#include "grid.hpp"
+#include "integrate.hpp"
+#include "particle_data.hpp"
+#include "utils.hpp"
+#include "ctraj.hpp"
+
+static const char ctraj_magic[8] = {'E', 'S', 'P', 'C', 'T', 'R', 'J', '1'};
+
+/** Particle record used to sort the particles by id across the nodes. */
+struct CtrajRecord {
+  int id;
+  double pos[3];
+  double v[3];
+};
+
+static uint64_t zigzag(int64_t v) {
+  return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+  return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+/** Append n unsigned values in groups with a common bit width. */
+static void pack_stream(const uint64_t *v, int n, std::vector<char> &buf)
+{
+  for (int g = 0; g < n; g += CTRAJ_GROUP) {
+    int m = std::min(CTRAJ_GROUP, n - g);
+    uint64_t all = 0;
+    for (int i = 0; i < m; ++i)
+      all |= v[g + i];
+    int width = 0;
+    while (width < 64 && (all >> width) != 0)
+      ++width;
+    buf.push_back((char) width);
+
+    size_t start = buf.size();
+    buf.resize(start + (m * width + 7) / 8, 0);
+    unsigned char *out = (unsigned char *) &buf[start];
+    size_t bit = 0;
+    for (int i = 0; i < m; ++i) {
+      uint64_t x = v[g + i];
+      for (int left = width; left > 0;) {
+        int used = bit % 8;
+        int take = std::min(left, 8 - used);
+        out[bit / 8] |= (unsigned char) ((x & ((1u << take) - 1)) << used);
+        x >>= take;
+        left -= take;
+        bit += take;
+      }
+    }
+  }
+}
+
+/** Decode n values written by \ref pack_stream from [p, end), p is
+ *  advanced. Returns false if the data is truncated. */
+static bool unpack_stream(const char *&p, const char *end, int n,
+                          uint64_t *v)
+{
+  for (int g = 0; g < n; g += CTRAJ_GROUP) {
+    int m = std::min(CTRAJ_GROUP, n - g);
+    if (p >= end)
+      return false;
+    int width = (unsigned char) *p++;
+    size_t bytes = (m * width + 7) / 8;
+    if (width > 64 || end - p < (ptrdiff_t) bytes)
+      return false;
+
+    const unsigned char *in = (const unsigned char *) p;
+    size_t bit = 0;
+    for (int i = 0; i < m; ++i) {
+      uint64_t x = 0;
+      for (int got = 0; got < width;) {
+        int used = bit % 8;
+        int take = std::min(width - got, 8 - used);
+        x |= (uint64_t) ((in[bit / 8] >> used) & ((1u << take) - 1)) << got;
+        got += take;
+        bit += take;
+      }
+      v[g + i] = x;
+    }
+    p += bytes;
+  }
+  return true;
+}
+
+/** Quantize and delta code one component of n records. */
+static void pack_component(const CtrajRecord *r, int n, bool vel, int k,
+                           double prec, std::vector<char> &buf)
+{
+  std::vector<uint64_t> d(n);
+  int64_t last = 0;
+  for (int i = 0; i < n; ++i) {
+    int64_t q = llround((vel ? r[i].v[k] : r[i].pos[k]) / prec);
+    d[i] = zigzag(q - last);
+    last = q;
+  }
+  pack_stream(d.data(), n, buf);
+}
+
+/** Encode n records sorted by id into buf. */
+static void encode_chunk(const CtrajRecord *r, int n, unsigned fields,
+                         double prec, double vprec, std::vector<char> &buf)
+{
+  std::vector<uint64_t> gaps(n);
+  for (int i = 0; i < n; ++i)
+    gaps[i] = (i == 0) ? 0 : r[i].id - r[i - 1].id - 1;
+  pack_stream(gaps.data(), n, buf);
+
+  for (int k = 0; k < 3; ++k)
+    pack_component(r, n, false, k, prec, buf);
+  if (fields & CTRAJ_VEL)
+    for (int k = 0; k < 3; ++k)
+      pack_component(r, n, true, k, vprec, buf);
+}
+
+void mpi_ctraj_common_write(const char *filename, unsigned fields,
+                            double prec, double vprec)
+{
+  int rank, size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  // Collect the local particles
+  std::vector<CtrajRecord> local;
+  local.reserve(cells_get_n_particles());
+  int max_id = -1;
+  for (int c = 0; c < local_cells.n; ++c) {
+    Cell *cell = local_cells.cell[c];
+    for (int i = 0; i < cell->n; ++i) {
+      Particle *p = &cell->part[i];
+      CtrajRecord r;
+      double v_scale = time_step;
+      int img[3];
+      r.id = p->p.identity;
+      memmove(r.pos, p->r.p, 3 * sizeof(double));
+      memmove(r.v, p->m.v, 3 * sizeof(double));
+      memmove(img, p->l.i, 3 * sizeof(int));
+      unfold_position(r.pos, r.v, img);
+#ifdef MULTI_TIMESTEP
+      if (smaller_time_step > 0. && p->p.smaller_timestep)
+        v_scale = smaller_time_step;
+#endif
+      for (int k = 0; k < 3; ++k)
+        r.v[k] /= v_scale;
+      max_id = std::max(max_id, r.id);
+      local.push_back(r);
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &max_id, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+  // Send every particle to the node which encodes its id range
+  std::vector<int> scount(size, 0), rcount(size), sdispl(size), rdispl(size);
+  auto dest = [&](int id) {
+    return (int) ((long long) id * size / (max_id + 1));
+  };
+  for (auto const &r : local)
+    scount[dest(r.id)] += sizeof(CtrajRecord);
+  MPI_Alltoall(scount.data(), 1, MPI_INT, rcount.data(), 1, MPI_INT,
+               MPI_COMM_WORLD);
+  for (int i = 0, s = 0, r = 0; i < size; ++i) {
+    sdispl[i] = s;
+    rdispl[i] = r;
+    s += scount[i];
+    r += rcount[i];
+  }
+  std::vector<CtrajRecord> sorted(local.size());
+  {
+    std::vector<int> pos(sdispl);
+    for (auto const &r : local) {
+      int d = dest(r.id);
+      sorted[pos[d] / sizeof(CtrajRecord)] = r;
+      pos[d] += sizeof(CtrajRecord);
+    }
+  }
+  std::vector<CtrajRecord> recs((rdispl[size - 1] + rcount[size - 1])
+                                / sizeof(CtrajRecord));
+  MPI_Alltoallv(sorted.data(), scount.data(), sdispl.data(), MPI_BYTE,
+                recs.data(), rcount.data(), rdispl.data(), MPI_BYTE,
+                MPI_COMM_WORLD);
+  std::sort(recs.begin(), recs.end(),
+            [](const CtrajRecord &a, const CtrajRecord &b) {
+              return a.id < b.id;
+            });
+
+  // Encode the chunks
+  int n = recs.size();
+  int n_chunks = (n + CTRAJ_CHUNK - 1) / CTRAJ_CHUNK;
+  std::vector<CtrajChunk> index(n_chunks);
+  std::vector<char> data;
+  for (int c = 0; c < n_chunks; ++c) {
+    int first = c * CTRAJ_CHUNK, m = std::min(CTRAJ_CHUNK, n - first);
+    index[c].first_id = recs[first].id;
+    index[c].last_id = recs[first + m - 1].id;
+    index[c].n = m;
+    index[c].reserved = 0;
+    index[c].offset = data.size();
+    encode_chunk(&recs[first], m, fields, prec, vprec, data);
+    index[c].size = data.size() - index[c].offset;
+  }
+
+  // Layout of the frame
+  long long local_sizes[3] = { n_chunks, (long long) data.size(), n };
+  long long prefs[3] = { 0, 0, 0 }, totals[3];
+  MPI_Exscan(local_sizes, prefs, 3, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(local_sizes, totals, 3, MPI_LONG_LONG, MPI_SUM,
+                MPI_COMM_WORLD);
+  if (rank == 0)
+    prefs[0] = prefs[1] = 0;
+  uint64_t data_start = sizeof(CtrajFrameHeader)
+    + totals[0] * sizeof(CtrajChunk);
+  for (auto &c : index)
+    c.offset += data_start + prefs[1];
+
+  MPI_File f;
+  MPI_Offset frame_start;
+  int ret = MPI_File_open(MPI_COMM_WORLD, const_cast<char *>(filename),
+                          MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL,
+                          &f);
+  if (ret) {
+    fprintf(stderr, "Compressed trajectory Error: Could not open file \"%s\".\n",
+            filename);
+    errexit();
+  }
+  // Only the master determines the end of the file, the other nodes
+  // could already see the header written by a faster master.
+  ret = MPI_File_get_size(f, &frame_start);
+  MPI_Bcast(&frame_start, 1, MPI_OFFSET, 0, MPI_COMM_WORLD);
+
+  CtrajFrameHeader head;
+  memset(&head, 0, sizeof(head));
+  memcpy(head.magic, ctraj_magic, sizeof(ctraj_magic));
+  head.size = data_start + totals[1];
+  head.fields = fields | CTRAJ_POS;
+  head.n_part = totals[2];
+  head.n_chunks = totals[0];
+  head.time = sim_time;
+  memmove(head.box_l, box_l, 3 * sizeof(double));
+  head.prec = prec;
+  head.vprec = vprec;
+
+  ret |= MPI_File_write_at_all(f, frame_start, &head,
+                               rank == 0 ? sizeof(head) : 0, MPI_BYTE,
+                               MPI_STATUS_IGNORE);
+  ret |= MPI_File_write_at_all(f, frame_start + sizeof(CtrajFrameHeader)
+                               + prefs[0] * sizeof(CtrajChunk),
+                               index.data(), n_chunks * sizeof(CtrajChunk),
+                               MPI_BYTE, MPI_STATUS_IGNORE);
+  ret |= MPI_File_write_at_all(f, frame_start + data_start + prefs[1],
+                               data.data(), data.size(), MPI_BYTE,
+                               MPI_STATUS_IGNORE);
+  MPI_File_close(&f);
+  if (ret) {
+    fprintf(stderr, "Compressed trajectory Error: Could not write file \"%s\".\n",
+            filename);
+    errexit();
+  }
+}
+
+int CtrajReader::open(const std::string &filename)
+{
+  close();
+  m_filename = filename;
+  if (!(m_file = fopen(filename.c_str(), "rb"))) {
+    runtimeErrorMsg() << "could not open trajectory " << filename;
+    return ES_ERROR;
+  }
+
+  // Walk along the frame headers
+  CtrajFrameHeader head;
+  uint64_t offset = 0;
+  while (fseeko(m_file, offset, SEEK_SET) == 0
+         && fread(&head, sizeof(head), 1, m_file) == 1) {
+    if (memcmp(head.magic, ctraj_magic, sizeof(ctraj_magic)) != 0
+        || head.size < sizeof(head)) {
+      runtimeErrorMsg() << filename << " is not a compressed trajectory";
+      close();
+      return ES_ERROR;
+    }
+    m_offsets.push_back(offset);
+    m_headers.push_back(head);
+    offset += head.size;
+  }
+  return ES_OK;
+}
+
+void CtrajReader::close()
+{
+  if (m_file)
+    fclose(m_file);
+  m_file = NULL;
+  m_offsets.clear();
+  m_headers.clear();
+}
+
+int CtrajReader::read_frame(int frame, CtrajFrame &out,
+                            const std::vector<int> *ids)
+{
+  if (!m_file || frame < 0 || frame >= n_frames()) {
+    runtimeErrorMsg() << "trajectory frame " << frame << " does not exist";
+    return ES_ERROR;
+  }
+
+  CtrajFrameHeader head;
+  std::vector<CtrajChunk> index;
+  uint64_t start = m_offsets[frame];
+  bool ok = (fseeko(m_file, start, SEEK_SET) == 0)
+    && (fread(&head, sizeof(head), 1, m_file) == 1);
+  if (ok) {
+    index.resize(head.n_chunks);
+    ok = (fread(index.data(), sizeof(CtrajChunk), head.n_chunks, m_file)
+          == (size_t) head.n_chunks);
+  }
+  if (!ok) {
+    runtimeErrorMsg() << "could not read frame " << frame << " of "
+                      << m_filename;
+    return ES_ERROR;
+  }
+
+  std::vector<int> wanted;
+  if (ids) {
+    wanted = *ids;
+    std::sort(wanted.begin(), wanted.end());
+  }
+
+  out.time = head.time;
+  memmove(out.box_l, head.box_l, 3 * sizeof(double));
+  out.fields = head.fields;
+  out.id.clear();
+  out.pos.clear();
+  out.vel.clear();
+
+  int ncomp = (head.fields & CTRAJ_VEL) ? 6 : 3;
+  std::vector<char> buf;
+  std::vector<uint64_t> gaps;
+  std::vector<std::vector<uint64_t> > comp(ncomp);
+  for (auto const &c : index) {
+    auto lo = std::lower_bound(wanted.begin(), wanted.end(), c.first_id);
+    if (ids && (lo == wanted.end() || *lo > c.last_id))
+      continue;
+
+    buf.resize(c.size);
+    ok = (fseeko(m_file, start + c.offset, SEEK_SET) == 0)
+      && (fread(buf.data(), 1, c.size, m_file) == c.size);
+    const char *p = buf.data(), *end = buf.data() + buf.size();
+    gaps.resize(c.n);
+    ok = ok && unpack_stream(p, end, c.n, gaps.data());
+    for (int k = 0; k < ncomp; ++k) {
+      comp[k].resize(c.n);
+      ok = ok && unpack_stream(p, end, c.n, comp[k].data());
+    }
+    if (!ok) {
+      runtimeErrorMsg() << "corrupt frame " << frame << " in " << m_filename;
+      return ES_ERROR;
+    }
+
+    int id = c.first_id;
+    int64_t q[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < c.n; ++i) {
+      if (i > 0)
+        id += gaps[i] + 1;
+      for (int k = 0; k < ncomp; ++k)
+        q[k] += unzigzag(comp[k][i]);
+      if (ids) {
+        while (lo != wanted.end() && *lo < id)
+          ++lo;
+        if (lo == wanted.end() || *lo != id)
+          continue;
+      }
+      out.id.push_back(id);
+      for (int k = 0; k < 3; ++k)
+        out.pos.push_back(q[k] * head.prec);
+      if (ncomp == 6)
+        for (int k = 3; k < 6; ++k)
+          out.vel.push_back(q[k] * head.vprec);
+    }
+  }
+  return ES_OK;
+}
@@ -0,0 +1,139 @@
+/*
+  Copyright (C) 2010,2011,2012,2013,2014,2015,2016 The ESPResSo project
+  Copyright (C) 2002,2003,2004,2005,2006,2007,2008,2009,2010
+    Max-Planck-Institute for Polymer Research, Theory Group
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file ctraj.hpp
+ *  Compressed trajectories.
+ *
+ *  Every call of \ref mpi_ctraj_common_write appends a frame with the
+ *  unfolded positions (and optionally the velocities) of all particles
+ *  to a trajectory file. The coordinates are quantized to a fixed
+ *  precision and delta coded along the particle ids in chunks of \ref
+ *  CTRAJ_CHUNK particles, with a common bit width for every group of
+ *  \ref CTRAJ_GROUP values. The particles of a chunk have consecutive
+ *  ids, so single frames and subsets of particles can be decoded
+ *  without reading the rest of the file.
+ *
+ *  A frame consists of a \ref CtrajFrameHeader, the index of its chunks
+ *  (\ref CtrajChunk) and the chunk data.
+ */
+
+#ifndef _CTRAJ_HPP
+#define _CTRAJ_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/** Particles per chunk. */
+#define CTRAJ_CHUNK 4096
+/** Values per group with a common bit width. */
+#define CTRAJ_GROUP 64
+
+/** Fields stored in a frame. */
+enum CtrajFields {
+  CTRAJ_POS = 1,
+  CTRAJ_VEL = 2
+};
+
+/** Header of a frame, as stored in the file. */
+struct CtrajFrameHeader {
+  char magic[8];
+  /** Size of the frame including the header. */
+  uint64_t size;
+  uint32_t fields;
+  int32_t n_part;
+  int32_t n_chunks;
+  int32_t reserved;
+  double time;
+  double box_l[3];
+  /** Quantization step of the positions and velocities. */
+  double prec, vprec;
+};
+
+/** Index entry of a chunk, as stored in the file. */
+struct CtrajChunk {
+  int32_t first_id, last_id, n, reserved;
+  /** Position of the chunk data relative to the frame start. */
+  uint64_t offset, size;
+};
+
+/** A decoded frame. */
+struct CtrajFrame {
+  double time;
+  double box_l[3];
+  unsigned fields;
+  /** Particle ids in ascending order. */
+  std::vector<int> id;
+  /** Positions and velocities in the order of id, 3 per particle. */
+  std::vector<double> pos, vel;
+};
+
+/** Append the current configuration as a frame to filename. To be
+ *  called by all MPI processes, which each write the chunks of a range
+ *  of ids. Aborts ESPResSo on I/O errors.
+ *
+ * \param filename Name of the trajectory file, created if necessary.
+ * \param fields The fields to store, see \ref CtrajFields.
+ * \param prec Quantization step of the positions.
+ * \param vprec Quantization step of the velocities.
+ */
+void mpi_ctraj_common_write(const char *filename, unsigned fields,
+                            double prec, double vprec);
+
+/** Random access to the frames of a compressed trajectory. Errors are
+ *  reported as runtime errors.
+ */
+class CtrajReader {
+public:
+  CtrajReader() : m_file(NULL) {}
+  CtrajReader(const CtrajReader &) = delete;
+  CtrajReader &operator=(const CtrajReader &) = delete;
+  ~CtrajReader() { close(); }
+
+  /** Open filename and locate its frames.
+   *  \return ES_OK or ES_ERROR. */
+  int open(const std::string &filename);
+  void close();
+
+  int n_frames() const { return m_offsets.size(); }
+  /** The header of a frame, read by \ref open. */
+  const CtrajFrameHeader &header(int frame) const { return m_headers[frame]; }
+  const std::string &filename() const { return m_filename; }
+
+  /** Decode a frame.
+   *
+   * \param frame Index of the frame.
+   * \param out The decoded frame.
+   * \param ids If given, only the particles with these ids are decoded
+   *            and only the chunks containing them are read.
+   * \return ES_OK or ES_ERROR.
+   */
+  int read_frame(int frame, CtrajFrame &out,
+                 const std::vector<int> *ids = NULL);
+
+private:
+  std::string m_filename;
+  FILE *m_file;
+  std::vector<uint64_t> m_offsets;
+  std::vector<CtrajFrameHeader> m_headers;
+};
+
+#endif
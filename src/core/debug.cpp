@@ -31,6 +31,7 @@
 #include <cstring>
 #include <mpi.h>
 #include <unistd.h>
+#include <vector>
 
 #include "cells.hpp"
 #include "communication.hpp"
@@ -47,7 +48,7 @@ int check_id = ONEPART_DEBUG_ID;
 void check_particle_consistency() {
   Particle *part;
   Cell *cell;
-  int n, dir, c, p;
+  int dir, c, p;
   int cell_part_cnt = 0, ghost_part_cnt = 0, local_part_cnt = 0;
   int cell_err_cnt = 0;
 
@@ -78,7 +79,7 @@ void check_particle_consistency() {
                         "mismatch for part id %d: local: %p cell: %p in cell "
                         "%d\n",
                 this_node, part[n].p.identity,
-                local_particles[part[n].p.identity], &part[n], c);
+                (Particle *)local_particles[part[n].p.identity], &part[n], c);
         errexit();
       }
     }
@@ -97,17 +98,15 @@ void check_particle_consistency() {
                              "cells, %d particles in ghost_cells.\n",
                      this_node, cell_part_cnt, ghost_part_cnt));
   /* checks: local particle id */
-  for (n = 0; n < max_seen_particle + 1; n++) {
-    if (local_particles[n] != NULL) {
-      local_part_cnt++;
-      if (local_particles[n]->p.identity != n) {
-        fprintf(stderr, "%d: check_particle_consistency: ERROR: "
-                        "local_particles part %d has corrupted id %d\n",
-                this_node, n, local_particles[n]->p.identity);
-        errexit();
-      }
+  local_particles.for_each([&local_part_cnt](int n, Particle *p) {
+    local_part_cnt++;
+    if (p->p.identity != n) {
+      fprintf(stderr, "%d: check_particle_consistency: ERROR: "
+                      "local_particles part %d has corrupted id %d\n",
+              this_node, n, p->p.identity);
+      errexit();
     }
-  }
+  });
   CELL_TRACE(fprintf(
       stderr,
       "%d: check_particle_consistency: %d particles in local_particles.\n",
@@ -131,10 +130,9 @@ void check_particle_consistency() {
                 local_cells.cell[c]->part[p].p.identity, c);
     }
 
-    for (p = 0; p < n_part; p++)
-      if (local_particles[p])
-        fprintf(stderr, "%d: got particle %d in local_particles\n", this_node,
-                p);
+    local_particles.for_each([](int p, Particle *) {
+      fprintf(stderr, "%d: got particle %d in local_particles\n", this_node, p);
+    });
 
     if (ghost_part_cnt == 0)
       errexit();
@@ -149,9 +147,8 @@ void check_particle_consistency() {
 
 void check_particles() {
   Particle *part;
-  int *is_here;
   Cell *cell;
-  int n, dir, c, p;
+  int dir, c;
   int cell_part_cnt = 0, local_part_cnt = 0;
   int cell_err_cnt = 0;
   double skin2 = (skin != -1) ? skin / 2 : 0;
@@ -159,13 +156,20 @@ void check_particles() {
   CELL_TRACE(fprintf(stderr, "%d: entering check_particles\n", this_node));
 
   /* check the consistency of particle_nodes */
-  /* to this aim the array is broadcasted temporarily */
-  if (this_node != 0)
-    particle_node = (int *)Utils::malloc((max_seen_particle + 1) * sizeof(int));
-  is_here = (int *)Utils::malloc((max_seen_particle + 1) * sizeof(int));
-  memset(is_here, 0, (max_seen_particle + 1) * sizeof(int));
-
-  MPI_Bcast(particle_node, max_seen_particle + 1, MPI_INT, 0, comm_cart);
+  /* to this aim the mapping is broadcasted temporarily */
+  std::vector<int> node_map;
+  if (this_node == 0)
+    particle_node.for_each([&node_map](int id, int node) {
+      node_map.push_back(id);
+      node_map.push_back(node);
+    });
+  int map_size = node_map.size();
+  MPI_Bcast(&map_size, 1, MPI_INT, 0, comm_cart);
+  node_map.resize(map_size);
+  MPI_Bcast(node_map.data(), map_size, MPI_INT, 0, comm_cart);
+  Utils::IdIndex<int> nodes(-1), is_here(0);
+  for (int i = 0; i < map_size; i += 2)
+    nodes[node_map[i]] = node_map[i + 1];
 
   /* checks: part_id, part_pos, local_particles id */
   for (c = 0; c < local_cells.n; c++) {
@@ -196,10 +200,10 @@ void check_particles() {
         fprintf(stderr, "%d: check_particles: ERROR: address mismatch for part "
                         "id %d: local: %p cell: %p in cell %d\n",
                 this_node, part[n].p.identity,
-                local_particles[part[n].p.identity], &part[n], c);
+                (Particle *)local_particles[part[n].p.identity], &part[n], c);
         errexit();
       }
-      if (particle_node[part[n].p.identity] != this_node) {
+      if (nodes[part[n].p.identity] != this_node) {
         fprintf(stderr,
                 "%d: check_particles: ERROR: node for particle %d wrong\n",
                 this_node, part[n].p.identity);
@@ -212,17 +216,15 @@ void check_particles() {
                      this_node, cell_part_cnt));
 
   /* checks: local particle id */
-  for (n = 0; n <= max_seen_particle; n++) {
-    if (local_particles[n] != NULL) {
-      local_part_cnt++;
-      if (local_particles[n]->p.identity != n) {
-        fprintf(stderr, "%d: check_particles: ERROR: local_particles part %d "
-                        "has corrupted id %d\n",
-                this_node, n, local_particles[n]->p.identity);
-        errexit();
-      }
+  local_particles.for_each([&local_part_cnt](int n, Particle *p) {
+    local_part_cnt++;
+    if (p->p.identity != n) {
+      fprintf(stderr, "%d: check_particles: ERROR: local_particles part %d "
+                      "has corrupted id %d\n",
+              this_node, n, p->p.identity);
+      errexit();
     }
-  }
+  });
   CELL_TRACE(fprintf(stderr,
                      "%d: check_particles: %d particles in local_particles.\n",
                      this_node, local_part_cnt));
@@ -236,27 +238,17 @@ void check_particles() {
   }
 
   /* check whether the particles on my node are actually here */
-  for (p = 0; p <= max_seen_particle; p++) {
-    if (particle_node[p] == this_node) {
-      if (!is_here[p]) {
-        fprintf(stderr, "%d: check_particles: ERROR: particle %d on this node, "
-                        "but not in local cell\n",
-                this_node, p);
-      }
+  nodes.for_each([&is_here](int p, int node) {
+    if (node == this_node && !is_here[p]) {
+      fprintf(stderr, "%d: check_particles: ERROR: particle %d on this node, "
+                      "but not in local cell\n",
+              this_node, p);
     }
-  }
-
-  free(is_here);
+  });
 
-  if (this_node != 0) {
-    free(particle_node);
-    particle_node = NULL;
-  } else {
+  if (this_node == 0) {
     /* check whether the total count of particles is ok */
-    c = 0;
-    for (p = 0; p <= max_seen_particle; p++)
-      if (particle_node[p] != -1)
-        c++;
+    c = nodes.size();
     if (c != n_part) {
       fprintf(stderr,
               "%d: check_particles: #particles in particle_node inconsistent\n",
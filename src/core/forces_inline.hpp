@@ -54,6 +54,7 @@
 #include "hertzian.hpp"
 #include "hydrogen_bond.hpp"
 #include "lj.hpp"
+#include "local_stress.hpp"
 #include "ljangle.hpp"
 #include "ljcos.hpp"
 #include "ljcos2.hpp"
@@ -369,6 +370,8 @@ inline void add_non_bonded_pair_force(Particle *p1, Particle *p2, double d[3],
     if (integ_switch == INTEG_METHOD_NPT_ISO)
       nptiso.p_vir[j] += force[j] * d[j];
 #endif
+  if (local_stress_sampling)
+    local_stress_add_pair(p1->r.p, d, force);
 
 /***********************************************/
 /* semi-bonded multi-body potentials            */
@@ -821,6 +824,8 @@ inline void add_bonded_force(Particle *p1) {
           nptiso.p_vir[j] += force[j] * dx[j];
 #endif
       }
+      if (local_stress_sampling)
+        local_stress_add_pair(p1->r.p, dx, force);
       break;
     case 2:
       if (bond_broken) {
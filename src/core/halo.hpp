@@ -81,6 +81,8 @@ struct _Fieldtype {
 /** Predefined fieldtypes */
 extern struct _Fieldtype fieldtype_double;
 #define FIELDTYPE_DOUBLE (&fieldtype_double)
+extern struct _Fieldtype fieldtype_float;
+#define FIELDTYPE_FLOAT (&fieldtype_float)
 
 /** Structure describing a Halo region */
 typedef struct {
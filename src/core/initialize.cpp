@@ -632,6 +632,39 @@ void on_parameter_change(int field)
   }
 }
 
+void on_system_state_change(int cell_flags)
+{
+  EVENT_TRACE(fprintf(stderr, "%d: on_system_state_change\n", this_node));
+
+  grid_changed_box_l();
+#ifdef LB
+  if (lattice_switch & LATTICE_LB) {
+    lb_init();
+#ifdef LB_BOUNDARIES
+    lb_init_boundaries();
+#endif
+  }
+#endif
+
+  /* initializes the long range methods, recalculates the cutoffs and
+     updates the cell system */
+  on_coulomb_change();
+  if (cell_flags)
+    cells_on_geometry_change(cell_flags);
+
+  on_constraint_change();
+  on_temperature_change();
+  reinit_thermo = 1;
+#ifdef NPT
+  if (integ_switch != INTEG_METHOD_NPT_ISO)
+    nptiso.invalidate_p_vel = 1;
+#endif
+#ifdef LEES_EDWARDS
+  lees_edwards_step_boundaries();
+#endif
+  on_ghost_flags_change();
+}
+
 #ifdef LB
 void on_lb_params_change(int field) {
   EVENT_TRACE(fprintf(stderr, "%d: on_lb_params_change\n", this_node));
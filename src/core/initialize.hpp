@@ -97,6 +97,14 @@ void on_temperature_change();
 */
 void on_parameter_change(int parameter);
 
+/** called after the whole system state was restored at once, see \ref
+    system_state.hpp. Does the work of the other events for all
+    parameters in a single pass.
+    @param cell_flags flags for \ref cells_on_geometry_change, in
+    addition to the update caused by the new cutoffs.
+*/
+void on_system_state_change(int cell_flags);
+
 /** called every time the number of particle types has changed (increased) */
 void on_n_particle_types_change();
 
@@ -43,6 +43,7 @@
 #include "layered.hpp"
 #include "lb.hpp"
 #include "lees_edwards.hpp"
+#include "local_stress.hpp"
 #include "maggs.hpp"
 #include "minimize_energy.hpp"
 #include "nemd.hpp"
@@ -54,6 +55,7 @@
 #include "reaction.hpp"
 #include "rotation.hpp"
 #include "statistics_correlation.hpp"
+#include "statistics_profiles.hpp"
 #include "thermostat.hpp"
 #include "utils.hpp"
 #include "verlet.hpp"
@@ -460,6 +462,7 @@ void integrate_vv(int n_steps, int reuse_forces) {
     transfer_momentum_gpu = 1;
 #endif
 
+    local_stress_begin_step();
     force_calc();
 
 // IMMERSED_BOUNDARY
@@ -507,6 +510,8 @@ void integrate_vv(int n_steps, int reuse_forces) {
     if (check_runtime_errors())
       break;
 #endif
+    local_stress_end_step();
+    profiles_end_step();
 
 // progagate one-step functionalities
 #ifdef LB
@@ -585,6 +590,9 @@ void integrate_vv(int n_steps, int reuse_forces) {
   CALLGRIND_STOP_INSTRUMENTATION;
 #endif
 
+  /* a step aborted by an error is not sampled */
+  local_stress_sampling = false;
+
   /* verlet list statistics */
   if (n_verlet_updates > 0)
     verlet_reuse = n_steps / (double)n_verlet_updates;
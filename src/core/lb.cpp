@@ -28,8 +28,14 @@
  */
 
 #include <mpi.h>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 #include "utils.hpp"
 #include "communication.hpp"
 #include "grid.hpp"
@@ -53,6 +59,8 @@ int lb_components = LB_COMPONENTS;
 static void lb_check_halo_regions();
 #endif // ADDITIONAL_CHECKS
 
+static int lb_interpolate_velocity(double* p, double* v, int use_cache);
+
 /** Flag indicating momentum exchange between particles and fluid */
 int transfer_momentum = 0;
 
@@ -82,6 +90,8 @@ LB_Parameters lbpar = {
     // is_TRT
     false,
     // resend_halo
+    0,
+    // velocity_halo
     0
 };
 
@@ -103,7 +113,16 @@ LB_Model lbmodel = { 19, d3q19_lattice, d3q19_coefficients, d3q19_w, NULL, 1./3.
 Lattice lblattice;
 
 /** Pointer to the velocity populations of the fluid nodes */
-double **lbfluid[2] = { NULL, NULL };
+lbPopFloat **lbfluid[2] = { NULL, NULL };
+
+/** MPI and halo field types matching \ref lbPopFloat */
+#ifdef LB_SINGLE_PRECISION
+#define MPI_LB_POP MPI_FLOAT
+#define FIELDTYPE_LB_POP FIELDTYPE_FLOAT
+#else
+#define MPI_LB_POP MPI_DOUBLE
+#define FIELDTYPE_LB_POP FIELDTYPE_DOUBLE
+#endif
 
 /** Pointer to the hydrodynamic fields of the fluid nodes */
 LB_FluidNode *lbfields = NULL;
@@ -111,6 +130,13 @@ LB_FluidNode *lbfields = NULL;
 /** Communicator for halo exchange between processors */
 HaloCommunicator update_halo_comm = { 0, NULL };
 
+/** Communicator for the exchange of the coupling fields (density and
+ *  momentum) of the halo nodes, see \ref LB_Parameters::velocity_halo */
+static HaloCommunicator update_halo_fields_comm = { 0, NULL };
+
+/** Field layout of the coupling fields within \ref LB_FluidNode */
+static Fieldtype fieldtype_lb_fields = NULL;
+
 /** \name Derived parameters */
 /*@{*/
 /** Flag indicating whether fluctuations are present. */
@@ -410,6 +436,31 @@ int lb_lbfluid_set_couple_flag(int couple_flag) {
   return 0;
 }
 
+int lb_lbfluid_set_velocity_halo(int velocity_halo) {
+  if (lattice_switch & LATTICE_LB_GPU) {
+    return -1;
+  } else {
+#ifdef LB
+    lbpar.velocity_halo = velocity_halo ? 1 : 0;
+    /* the halo has to be exchanged again in the new mode */
+    lbpar.resend_halo = 1;
+    mpi_bcast_lb_params(LBPAR_VELOCITY_HALO);
+#endif // LB
+  }
+  return 0;
+}
+
+int lb_lbfluid_get_velocity_halo(int *p_velocity_halo) {
+  if (lattice_switch & LATTICE_LB_GPU) {
+    return -1;
+  } else {
+#ifdef LB
+    *p_velocity_halo = lbpar.velocity_halo;
+#endif // LB
+  }
+  return 0;
+}
+
 
 int lb_lbfluid_set_agrid(double p_agrid){
   if ( p_agrid <= 0)
@@ -1136,6 +1187,37 @@ int lb_lbfluid_load_checkpoint(char* filename, int binary) {
 }
 
 
+int lb_lbfluid_save_checkpoint_mpiio(char* filename) {
+    if (lattice_switch & LATTICE_LB_GPU) {
+        runtimeErrorMsg() <<"Parallel LB checkpoints are only implemented for the CPU LB.";
+        return ES_ERROR;
+    }
+    return mpi_lb_mpiio_checkpoint(filename, 1);
+}
+
+
+int lb_lbfluid_load_checkpoint_mpiio(char* filename) {
+    if (lattice_switch & LATTICE_LB_GPU) {
+        runtimeErrorMsg() <<"Parallel LB checkpoints are only implemented for the CPU LB.";
+        return ES_ERROR;
+    }
+    return mpi_lb_mpiio_checkpoint(filename, 0);
+}
+
+
+int lb_lbfluid_print_vtk_mpiio(char* filename, int field, int stride, int single_precision) {
+    if (lattice_switch & LATTICE_LB_GPU) {
+        runtimeErrorMsg() <<"Parallel VTK output is only implemented for the CPU LB.";
+        return ES_ERROR;
+    }
+    if (stride < 1) {
+        runtimeErrorMsg() <<"The stride of the LB field output has to be positive.";
+        return ES_ERROR;
+    }
+    return mpi_lb_mpiio_vtk(filename, field, stride, single_precision);
+}
+
+
 int lb_lbnode_get_rho(int* ind, double* p_rho){
     if (lattice_switch & LATTICE_LB_GPU) {
 #ifdef LB_GPU
@@ -1485,7 +1567,7 @@ static void halo_push_communication() {
     index_t index;
     int x, y, z, count;
     int rnode, snode;
-    double *buffer=NULL, *sbuf=NULL, *rbuf=NULL;
+    lbPopFloat *buffer=NULL, *sbuf=NULL, *rbuf=NULL;
     MPI_Status status;
 
     int yperiod = lblattice.halo_grid[0];
@@ -1495,8 +1577,8 @@ static void halo_push_communication() {
      * X direction *
      ***************/
     count = 5*lblattice.halo_grid[1]*lblattice.halo_grid[2];
-    sbuf = (double*) Utils::malloc(count*sizeof(double));
-    rbuf = (double*) Utils::malloc(count*sizeof(double));
+    sbuf = (lbPopFloat*) Utils::malloc(count*sizeof(lbPopFloat));
+    rbuf = (lbPopFloat*) Utils::malloc(count*sizeof(lbPopFloat));
 
     /* send to right, recv from left i = 1, 7, 9, 11, 13 */
     snode = node_neighbors[1];
@@ -1519,11 +1601,11 @@ static void halo_push_communication() {
     }
 
     if (node_grid[0] > 1) {
-        MPI_Sendrecv(sbuf, count, MPI_DOUBLE, snode, REQ_HALO_SPREAD,
-                     rbuf, count, MPI_DOUBLE, rnode, REQ_HALO_SPREAD,
+        MPI_Sendrecv(sbuf, count, MPI_LB_POP, snode, REQ_HALO_SPREAD,
+                     rbuf, count, MPI_LB_POP, rnode, REQ_HALO_SPREAD,
                      comm_cart, &status);
     } else {
-        memmove(rbuf,sbuf,count*sizeof(double));
+        memmove(rbuf,sbuf,count*sizeof(lbPopFloat));
     }
 
     buffer = rbuf;
@@ -1563,11 +1645,11 @@ static void halo_push_communication() {
     }
 
     if (node_grid[0] > 1) {
-        MPI_Sendrecv(sbuf, count, MPI_DOUBLE, snode, REQ_HALO_SPREAD,
-                     rbuf, count, MPI_DOUBLE, rnode, REQ_HALO_SPREAD,
+        MPI_Sendrecv(sbuf, count, MPI_LB_POP, snode, REQ_HALO_SPREAD,
+                     rbuf, count, MPI_LB_POP, rnode, REQ_HALO_SPREAD,
                      comm_cart, &status);
     } else {
-        memmove(rbuf,sbuf,count*sizeof(double));
+        memmove(rbuf,sbuf,count*sizeof(lbPopFloat));
     }
 
     buffer = rbuf;
@@ -1590,8 +1672,8 @@ static void halo_push_communication() {
      * Y direction *
      ***************/
     count = 5*lblattice.halo_grid[0]*lblattice.halo_grid[2];
-    sbuf = (double*) Utils::realloc(sbuf, count*sizeof(double));
-    rbuf = (double*) Utils::realloc(rbuf, count*sizeof(double));
+    sbuf = (lbPopFloat*) Utils::realloc(sbuf, count*sizeof(lbPopFloat));
+    rbuf = (lbPopFloat*) Utils::realloc(rbuf, count*sizeof(lbPopFloat));
 
     /* send to right, recv from left i = 3, 7, 10, 15, 17 */
     snode = node_neighbors[3];
@@ -1615,11 +1697,11 @@ static void halo_push_communication() {
     }
 
     if (node_grid[1] > 1) {
-        MPI_Sendrecv(sbuf, count, MPI_DOUBLE, snode, REQ_HALO_SPREAD,
-                     rbuf, count, MPI_DOUBLE, rnode, REQ_HALO_SPREAD,
+        MPI_Sendrecv(sbuf, count, MPI_LB_POP, snode, REQ_HALO_SPREAD,
+                     rbuf, count, MPI_LB_POP, rnode, REQ_HALO_SPREAD,
                      comm_cart, &status);
     } else {
-        memmove(rbuf,sbuf,count*sizeof(double));
+        memmove(rbuf,sbuf,count*sizeof(lbPopFloat));
     }
 
     buffer = rbuf;
@@ -1661,11 +1743,11 @@ static void halo_push_communication() {
     }
 
     if (node_grid[1] > 1) {
-        MPI_Sendrecv(sbuf, count, MPI_DOUBLE, snode, REQ_HALO_SPREAD,
-                     rbuf, count, MPI_DOUBLE, rnode, REQ_HALO_SPREAD,
+        MPI_Sendrecv(sbuf, count, MPI_LB_POP, snode, REQ_HALO_SPREAD,
+                     rbuf, count, MPI_LB_POP, rnode, REQ_HALO_SPREAD,
                      comm_cart, &status);
     } else {
-        memmove(rbuf,sbuf,count*sizeof(double));
+        memmove(rbuf,sbuf,count*sizeof(lbPopFloat));
     }
 
     buffer = rbuf;
@@ -1689,8 +1771,8 @@ static void halo_push_communication() {
      * Z direction *
      ***************/
     count = 5*lblattice.halo_grid[0]*lblattice.halo_grid[1];
-    sbuf = (double*) Utils::realloc(sbuf, count*sizeof(double));
-    rbuf = (double*) Utils::realloc(rbuf, count*sizeof(double));
+    sbuf = (lbPopFloat*) Utils::realloc(sbuf, count*sizeof(lbPopFloat));
+    rbuf = (lbPopFloat*) Utils::realloc(rbuf, count*sizeof(lbPopFloat));
 
     /* send to right, recv from left i = 5, 11, 14, 15, 18 */
     snode = node_neighbors[5];
@@ -1713,11 +1795,11 @@ static void halo_push_communication() {
     }
 
     if (node_grid[2] > 1) {
-        MPI_Sendrecv(sbuf, count, MPI_DOUBLE, snode, REQ_HALO_SPREAD,
-                     rbuf, count, MPI_DOUBLE, rnode, REQ_HALO_SPREAD,
+        MPI_Sendrecv(sbuf, count, MPI_LB_POP, snode, REQ_HALO_SPREAD,
+                     rbuf, count, MPI_LB_POP, rnode, REQ_HALO_SPREAD,
                      comm_cart, &status);
     } else {
-        memmove(rbuf,sbuf,count*sizeof(double));
+        memmove(rbuf,sbuf,count*sizeof(lbPopFloat));
     }
 
     buffer = rbuf;
@@ -1757,11 +1839,11 @@ static void halo_push_communication() {
     }
 
     if (node_grid[2] > 1) {
-        MPI_Sendrecv(sbuf, count, MPI_DOUBLE, snode, REQ_HALO_SPREAD,
-                     rbuf, count, MPI_DOUBLE, rnode, REQ_HALO_SPREAD,
+        MPI_Sendrecv(sbuf, count, MPI_LB_POP, snode, REQ_HALO_SPREAD,
+                     rbuf, count, MPI_LB_POP, rnode, REQ_HALO_SPREAD,
                      comm_cart, &status);
     } else {
-        memmove(rbuf,sbuf,count*sizeof(double));
+        memmove(rbuf,sbuf,count*sizeof(lbPopFloat));
     }
 
     buffer = rbuf;
@@ -1830,10 +1912,10 @@ int lb_sanity_checks() {
 
 /** (Pre-)allocate memory for data structures */
 void lb_pre_init() {
-    lbfluid[0]    = (double**) Utils::malloc(lbmodel.n_veloc*sizeof(double *));
-    lbfluid[0][0] = (double*) Utils::malloc(lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(double));
-    lbfluid[1]    = (double**) Utils::malloc(lbmodel.n_veloc*sizeof(double *));
-    lbfluid[1][0] = (double*) Utils::malloc(lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(double));
+    lbfluid[0]    = (lbPopFloat**) Utils::malloc(lbmodel.n_veloc*sizeof(lbPopFloat *));
+    lbfluid[0][0] = (lbPopFloat*) Utils::malloc(lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(lbPopFloat));
+    lbfluid[1]    = (lbPopFloat**) Utils::malloc(lbmodel.n_veloc*sizeof(lbPopFloat *));
+    lbfluid[1][0] = (lbPopFloat*) Utils::malloc(lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(lbPopFloat));
 }
 
 
@@ -1843,10 +1925,10 @@ static void lb_realloc_fluid() {
 
     LB_TRACE(printf("reallocating fluid\n"));
 
-    lbfluid[0]    = (double**) Utils::realloc(lbfluid[0],lbmodel.n_veloc*sizeof(double *));
-    lbfluid[1]    = (double**) Utils::realloc(lbfluid[1],lbmodel.n_veloc*sizeof(double *));
-    lbfluid[0][0] = (double*) Utils::realloc(lbfluid[0][0],lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(double));
-    lbfluid[1][0] = (double*) Utils::realloc(lbfluid[1][0],lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(double));
+    lbfluid[0]    = (lbPopFloat**) Utils::realloc(lbfluid[0],lbmodel.n_veloc*sizeof(lbPopFloat *));
+    lbfluid[1]    = (lbPopFloat**) Utils::realloc(lbfluid[1],lbmodel.n_veloc*sizeof(lbPopFloat *));
+    lbfluid[0][0] = (lbPopFloat*) Utils::realloc(lbfluid[0][0],lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(lbPopFloat));
+    lbfluid[1][0] = (lbPopFloat*) Utils::realloc(lbfluid[1][0],lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(lbPopFloat));
 
     for (i=0; i<lbmodel.n_veloc; ++i) {
         lbfluid[0][i] = lbfluid[0][0] + i*lblattice.halo_grid_volume;
@@ -1871,7 +1953,7 @@ static void lb_prepare_communication() {
      * datatypes */
 
     /* prepare the communication for a single velocity */
-    prepare_halo_communication(&comm, &lblattice, FIELDTYPE_DOUBLE, MPI_DOUBLE);
+    prepare_halo_communication(&comm, &lblattice, FIELDTYPE_LB_POP, MPI_LB_POP);
 
     update_halo_comm.num = comm.num;
     update_halo_comm.halo_info = (HaloInfo*) Utils::realloc(update_halo_comm.halo_info,comm.num*sizeof(HaloInfo));
@@ -1893,18 +1975,38 @@ static void lb_prepare_communication() {
 
         MPI_Aint lower;
         MPI_Aint extent;
-        MPI_Type_get_extent(MPI_DOUBLE, &lower, &extent);
+        MPI_Type_get_extent(MPI_LB_POP, &lower, &extent);
         MPI_Type_create_hvector(lbmodel.n_veloc, 1,
                                 lblattice.halo_grid_volume*extent,
                                 comm.halo_info[i].datatype, &hinfo->datatype);
         MPI_Type_commit(&hinfo->datatype);
 
         halo_create_field_hvector(lbmodel.n_veloc,1,
-                                  lblattice.halo_grid_volume*sizeof(double),
+                                  lblattice.halo_grid_volume*sizeof(lbPopFloat),
                                   comm.halo_info[i].fieldtype,&hinfo->fieldtype);
     }
 
     release_halo_communication(&comm);
+
+    /* the coupling fields rho[1] and j[3] are contiguous in the node
+     * structure, so one block of 4 doubles per node is exchanged */
+    int length = 4*sizeof(double);
+    int disp = offsetof(LB_FluidNode, rho);
+    if (!fieldtype_lb_fields)
+        halo_create_fieldtype(1, &length, &disp, sizeof(LB_FluidNode), &fieldtype_lb_fields);
+
+    MPI_Datatype fields_block, fields_datatype;
+    int blocklength = 4;
+    MPI_Aint displacement = offsetof(LB_FluidNode, rho);
+    MPI_Type_create_hindexed(1, &blocklength, &displacement, MPI_DOUBLE, &fields_block);
+    MPI_Type_create_resized(fields_block, 0, sizeof(LB_FluidNode), &fields_datatype);
+    MPI_Type_commit(&fields_datatype);
+
+    prepare_halo_communication(&update_halo_fields_comm, &lblattice,
+                               fieldtype_lb_fields, fields_datatype);
+
+    MPI_Type_free(&fields_datatype);
+    MPI_Type_free(&fields_block);
 }
 
 
@@ -2099,6 +2201,7 @@ void lb_release_fluid() {
 void lb_release() {
     lb_release_fluid();
     release_halo_communication(&update_halo_comm);
+    release_halo_communication(&update_halo_fields_comm);
 }
 
 /***********************************************************************/
@@ -2124,6 +2227,8 @@ void lb_calc_n_from_rho_j_pi(const index_t index,
 
     trace = local_pi[0] + local_pi[2] + local_pi[5];
 
+    lbfields[index].recalc_fields = 1;
+
 #ifdef D3Q19
     double rho_times_coeff;
     double tmp1,tmp2;
@@ -2195,27 +2300,31 @@ void lb_calc_n_from_rho_j_pi(const index_t index,
 void lb_calc_modes(index_t index, double *mode) 
 {
 #ifdef D3Q19
-    double n0, n1p, n1m, n2p, n2m, n3p, n3m, n4p, n4m, n5p, n5m, n6p, n6m, n7p, n7m, n8p, n8m, n9p, n9m;
-
-    n0  = lbfluid[0][0][index];
-    n1p = lbfluid[0][1][index] + lbfluid[0][2][index];
-    n1m = lbfluid[0][1][index] - lbfluid[0][2][index];
-    n2p = lbfluid[0][3][index] + lbfluid[0][4][index];
-    n2m = lbfluid[0][3][index] - lbfluid[0][4][index];
-    n3p = lbfluid[0][5][index] + lbfluid[0][6][index];
-    n3m = lbfluid[0][5][index] - lbfluid[0][6][index];
-    n4p = lbfluid[0][7][index] + lbfluid[0][8][index];
-    n4m = lbfluid[0][7][index] - lbfluid[0][8][index];
-    n5p = lbfluid[0][9][index] + lbfluid[0][10][index];
-    n5m = lbfluid[0][9][index] - lbfluid[0][10][index];
-    n6p = lbfluid[0][11][index] + lbfluid[0][12][index];
-    n6m = lbfluid[0][11][index] - lbfluid[0][12][index];
-    n7p = lbfluid[0][13][index] + lbfluid[0][14][index];
-    n7m = lbfluid[0][13][index] - lbfluid[0][14][index];
-    n8p = lbfluid[0][15][index] + lbfluid[0][16][index];
-    n8m = lbfluid[0][15][index] - lbfluid[0][16][index];
-    n9p = lbfluid[0][17][index] + lbfluid[0][18][index];
-    n9m = lbfluid[0][17][index] - lbfluid[0][18][index];
+    double n[19], n0, n1p, n1m, n2p, n2m, n3p, n3m, n4p, n4m, n5p, n5m, n6p, n6m, n7p, n7m, n8p, n8m, n9p, n9m;
+
+    /* load the populations in double precision */
+    for (int i = 0; i < 19; i++)
+        n[i] = lbfluid[0][i][index];
+
+    n0  = n[0];
+    n1p = n[1] + n[2];
+    n1m = n[1] - n[2];
+    n2p = n[3] + n[4];
+    n2m = n[3] - n[4];
+    n3p = n[5] + n[6];
+    n3m = n[5] - n[6];
+    n4p = n[7] + n[8];
+    n4m = n[7] - n[8];
+    n5p = n[9] + n[10];
+    n5m = n[9] - n[10];
+    n6p = n[11] + n[12];
+    n6m = n[11] - n[12];
+    n7p = n[13] + n[14];
+    n7m = n[13] - n[14];
+    n8p = n[15] + n[16];
+    n8m = n[15] - n[16];
+    n9p = n[17] + n[18];
+    n9m = n[17] - n[18];
 //  printf("n: ");
 //  for (i=0; i<19; i++)
 //    printf("%f ", lbfluid[1][i][index]);
@@ -2779,7 +2888,7 @@ inline void lb_collide_stream() {
 #endif // LB_BOUNDARIES
 
     /* swap the pointers for old and new population fields */
-    double **tmp;
+    lbPopFloat **tmp;
     tmp = lbfluid[0];
     lbfluid[0] = lbfluid[1];
     lbfluid[1] = tmp;
@@ -2845,7 +2954,7 @@ inline void lb_stream_collide() {
 
     /* swap the pointers for old and new population fields */
     //fprintf(stderr,"swapping pointers\n");
-    double **tmp = lbfluid[0];
+    lbPopFloat **tmp = lbfluid[0];
     lbfluid[0] = lbfluid[1];
     lbfluid[1] = tmp;
 
@@ -2935,7 +3044,7 @@ inline void lb_viscous_coupling(Particle *p, double force[3]) {
   /* calculate fluid velocity at particle's position
      this is done by linear interpolation
      (Eq. (11) Ahlrichs and Duenweg, JCP 111(17):8225 (1999)) */
-  lb_lbfluid_get_interpolated_velocity(p->r.p, interpolated_u);
+  lb_interpolate_velocity(p->r.p, interpolated_u, 1);
   
   ONEPART_TRACE(
                 if (p->p.identity==check_id) 
@@ -3053,7 +3162,7 @@ inline void lb_viscous_coupling(Particle *p, double force[3]) {
 
     // get lattice cell corresponding to source position and interpolate velocity
     lblattice.map_position_to_lattice(source_position,node_index,delta);
-    lb_lbfluid_get_interpolated_velocity(source_position, p->swim.v_source);
+    lb_interpolate_velocity(source_position, p->swim.v_source, 1);
 
     // calculate and set force at source position
     delta_j[0] = - p->swim.f_swim*p->r.quatu[0]*time_step*lbpar.tau/lbpar.agrid;
@@ -3077,7 +3186,69 @@ inline void lb_viscous_coupling(Particle *p, double force[3]) {
 }
 
 
-int lb_lbfluid_get_interpolated_velocity(double* p, double* v) {
+/** Returns the density and momentum of a local lattice site as used
+ *  by the particle coupling. The values are cached in \ref lbfields
+ *  and only recalculated when recalc_fields has been set, i.e. once
+ *  per fluid update instead of for every coupled particle.
+ * @param index  Index of the local lattice site (Input)
+ * @param rho    Local density of the fluid (Output)
+ * @param j      Local momentum of the fluid (Output)
+ */
+inline void lb_get_coupling_fields(index_t index, double *rho, double *j) {
+  LB_FluidNode *node = &lbfields[index];
+
+  if (node->recalc_fields) {
+    double modes[19];
+    lb_calc_modes(index, modes);
+    node->rho[0] = lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid + modes[0];
+    node->j[0] = modes[1];
+    node->j[1] = modes[2];
+    node->j[2] = modes[3];
+    node->recalc_fields = 0;
+  }
+
+  *rho = node->rho[0];
+  j[0] = node->j[0];
+  j[1] = node->j[1];
+  j[2] = node->j[2];
+}
+
+/** Calculates the coupling fields of all local lattice sites and
+ *  exchanges them with the halo nodes of the neighbouring processors.
+ *  This replaces the exchange of the populations if
+ *  \ref LB_Parameters::velocity_halo is set. */
+static void lb_calc_coupling_fields() {
+  double rho, j[3];
+  index_t index;
+  int x, y, z;
+
+  index = lblattice.halo_offset;
+  for (z = 1; z <= lblattice.grid[2]; z++) {
+    for (y = 1; y <= lblattice.grid[1]; y++) {
+      for (x = 1; x <= lblattice.grid[0]; x++) {
+        lbfields[index].recalc_fields = 1;
+        lb_get_coupling_fields(index, &rho, j);
+        ++index;
+      }
+      index += 2; /* skip halo region */
+    }
+    index += 2*lblattice.halo_grid[0]; /* skip halo region */
+  }
+
+  halo_communication(&update_halo_fields_comm, (char*)lbfields);
+
+  /* the fields of the halo nodes are valid now */
+  for (index = 0; index < lblattice.halo_grid_volume; ++index)
+    lbfields[index].recalc_fields = 0;
+}
+
+/** Interpolates the fluid velocity at a position on the local lattice.
+ * @param p          Position (Input)
+ * @param v          Interpolated velocity in MD units (Output)
+ * @param use_cache  Whether the node fields cached for the particle
+ *                   coupling may be used, see \ref lb_get_coupling_fields
+ */
+static int lb_interpolate_velocity(double* p, double* v, int use_cache) {
   index_t node_index[8], index;
   double delta[6];
   double local_rho, local_j[3], interpolated_u[3];
@@ -3134,6 +3305,8 @@ int lb_lbfluid_get_interpolated_velocity(double* p, double* v) {
           local_j[0] = lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid*lb_boundaries[lbfields[index].boundary-1].velocity[0];
           local_j[1] = lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid*lb_boundaries[lbfields[index].boundary-1].velocity[1];
           local_j[2] = lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid*lb_boundaries[lbfields[index].boundary-1].velocity[2];
+        } else if (use_cache) {
+          lb_get_coupling_fields(index, &local_rho, local_j);
         } else {
           lb_calc_modes(index, modes);
           local_rho = lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid + modes[0];
@@ -3142,11 +3315,15 @@ int lb_lbfluid_get_interpolated_velocity(double* p, double* v) {
           local_j[2] = modes[3];
         }
 #else // LB_BOUNDARIES
-        lb_calc_modes(index, modes);
-        local_rho = lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid + modes[0];
-        local_j[0] = modes[1];
-        local_j[1] = modes[2];
-        local_j[2] = modes[3];
+        if (use_cache) {
+          lb_get_coupling_fields(index, &local_rho, local_j);
+        } else {
+          lb_calc_modes(index, modes);
+          local_rho = lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid + modes[0];
+          local_j[0] = modes[1];
+          local_j[1] = modes[2];
+          local_j[2] = modes[3];
+        }
 #endif // LB_BOUNDARIES
         interpolated_u[0] += delta[3*x+0]*delta[3*y+1]*delta[3*z+2]*local_j[0]/(local_rho);
         interpolated_u[1] += delta[3*x+0]*delta[3*y+1]*delta[3*z+2]*local_j[1]/(local_rho);
@@ -3178,6 +3355,12 @@ int lb_lbfluid_get_interpolated_velocity(double* p, double* v) {
   return 0;
 }
 
+int lb_lbfluid_get_interpolated_velocity(double* p, double* v) {
+  /* with the velocity halo the halo populations are not exchanged,
+   * but the coupling fields are valid until the next fluid update */
+  return lb_interpolate_velocity(p, v, lbpar.velocity_halo && !lbpar.resend_halo);
+}
+
 
 /** Calculate particle lattice interactions.
  * So far, only viscous coupling with Stokesian friction is
@@ -3221,19 +3404,25 @@ void calc_particle_lattice_ia() {
   if (transfer_momentum) {
       
     if (lbpar.resend_halo) { /* first MD step after last LB update */
-        
-      /* exchange halo regions (for fluid-particle coupling) */
-      halo_communication(&update_halo_comm, (char*)**lbfluid);
+
+      if (lbpar.velocity_halo) {
+        /* calculate the coupling fields of the local nodes and only
+         * exchange these instead of the populations */
+        lb_calc_coupling_fields();
+      } else {
+        /* exchange halo regions (for fluid-particle coupling) */
+        halo_communication(&update_halo_comm, (char*)**lbfluid);
 #ifdef ADDITIONAL_CHECKS
-      lb_check_halo_regions();
+        lb_check_halo_regions();
 #endif // ADDITIONAL_CHECKS
-        
+
+        /* all fields have to be recalculated */
+        for (int i = 0; i < lblattice.halo_grid_volume; ++i) 
+            lbfields[i].recalc_fields = 1;
+      }
+
       /* halo is valid now */
       lbpar.resend_halo = 0;
-        
-      /* all fields have to be recalculated */
-      for (int i = 0; i < lblattice.halo_grid_volume; ++i) 
-          lbfields[i].recalc_fields = 1;
     }
 
     /* draw random numbers for local particles */
@@ -3381,6 +3570,435 @@ void lb_calc_average_rho() {
 
 /*@}*/
 
+/***********************************************************************/
+/** \name Parallel checkpointing via MPI-IO */
+/***********************************************************************/
+/*@{*/
+
+/** Fields contained in a parallel LB checkpoint */
+#define LB_CHECKPOINT_POP      1 /**< populations */
+#define LB_CHECKPOINT_FORCE    2 /**< force densities */
+#define LB_CHECKPOINT_BOUNDARY 4 /**< boundary flags */
+
+/** Version of the parallel checkpoint format */
+#define LB_CHECKPOINT_VERSION 1
+
+/** Header of a parallel LB checkpoint. It is written by the master
+ *  node at the beginning of the file. The node data follows in blocks
+ *  (populations, force densities, boundary flags), each of them
+ *  ordered by global lattice index with x slowest and z fastest, i.e.
+ *  in the same order as the serial checkpoint. */
+typedef struct {
+  char magic[8];
+  int version;
+  int global_grid[3];
+  int n_veloc;
+  int fields;
+  double agrid;
+} LB_CheckpointHeader;
+
+static const char lb_checkpoint_magic[8] = "ESPLBCP";
+
+/** Sets the file view of a checkpoint block. The local lattice
+ *  (without halo) is described as subarray of the global lattice,
+ *  each node consisting of \p count elements of type \p MPI_T.
+ *
+ * \param f        the checkpoint file
+ * \param disp     byte displacement of the block in the file
+ * \param count    number of elements per lattice node
+ * \param MPI_T    MPI datatype of the elements
+ * \param filetype the created filetype, to be freed by the caller
+ * \return         nonzero on error
+ */
+static int lb_mpiio_set_view(MPI_File f, MPI_Offset disp, int count,
+                             MPI_Datatype MPI_T, MPI_Datatype *filetype) {
+  MPI_Datatype elemtype;
+  int sizes[3], subsizes[3], starts[3];
+
+  for (int d = 0; d < 3; d++) {
+    sizes[d] = lblattice.global_grid[d];
+    subsizes[d] = lblattice.grid[d];
+    starts[d] = node_pos[d]*lblattice.grid[d];
+  }
+
+  MPI_Type_contiguous(count, MPI_T, &elemtype);
+  MPI_Type_commit(&elemtype);
+  MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C,
+                           elemtype, filetype);
+  MPI_Type_commit(filetype);
+
+  int ret = MPI_File_set_view(f, disp, elemtype, *filetype,
+                              const_cast<char *>("native"), MPI_INFO_NULL);
+  MPI_Type_free(&elemtype);
+  return ret;
+}
+
+/** Writes or reads one block of the checkpoint collectively.
+ *
+ * \param f      the checkpoint file
+ * \param disp   byte displacement of the block in the file
+ * \param buf    local data, \p count elements per local lattice node
+ * \param count  number of elements per lattice node
+ * \param MPI_T  MPI datatype of the elements
+ * \param write  1 to write, 0 to read
+ * \return       nonzero on error
+ */
+static int lb_mpiio_block(MPI_File f, MPI_Offset disp, void *buf, int count,
+                          MPI_Datatype MPI_T, int write) {
+  MPI_Datatype filetype;
+  int ret = lb_mpiio_set_view(f, disp, count, MPI_T, &filetype);
+  int n = count*lblattice.grid_volume;
+
+  if (write)
+    ret |= MPI_File_write_all(f, buf, n, MPI_T, MPI_STATUS_IGNORE);
+  else
+    ret |= MPI_File_read_all(f, buf, n, MPI_T, MPI_STATUS_IGNORE);
+
+  MPI_Type_free(&filetype);
+  return ret;
+}
+
+/** Collectively writes or reads a parallel checkpoint of the CPU
+ *  fluid. Has to be called on all nodes, see \ref mpi_lb_mpiio_checkpoint.
+ *  Since the data is stored in global lattice order, the checkpoint
+ *  can be read back on any node grid.
+ *
+ * \param filename name of the checkpoint file
+ * \param write    1 to write, 0 to read the checkpoint
+ * \return         ES_OK on success, ES_ERROR otherwise
+ */
+int lb_mpiio_checkpoint(const char *filename, int write) {
+  MPI_File f;
+  LB_CheckpointHeader head;
+  int ret;
+
+  if (!(lattice_switch & LATTICE_LB)) {
+    runtimeErrorMsg() << "To use an LB checkpoint one needs to have already initialized the CPU LB fluid.";
+    return check_runtime_errors() ? ES_ERROR : ES_OK;
+  }
+
+  int fields = LB_CHECKPOINT_POP | LB_CHECKPOINT_FORCE;
+#ifdef LB_BOUNDARIES
+  fields |= LB_CHECKPOINT_BOUNDARY;
+#endif // LB_BOUNDARIES
+
+  ret = MPI_File_open(comm_cart, const_cast<char *>(filename),
+                      write ? (MPI_MODE_WRONLY | MPI_MODE_CREATE) : MPI_MODE_RDONLY,
+                      MPI_INFO_NULL, &f);
+  if (ret) {
+    char buf[MPI_MAX_ERROR_STRING];
+    int len;
+    MPI_Error_string(ret, buf, &len);
+    buf[len] = '\0';
+    runtimeErrorMsg() << "Could not open LB checkpoint \"" << filename << "\": " << buf;
+    return check_runtime_errors() ? ES_ERROR : ES_OK;
+  }
+
+  if (write) {
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, lb_checkpoint_magic, sizeof(head.magic));
+    head.version = LB_CHECKPOINT_VERSION;
+    for (int d = 0; d < 3; d++)
+      head.global_grid[d] = lblattice.global_grid[d];
+    head.n_veloc = lbmodel.n_veloc;
+    head.fields = fields;
+    head.agrid = lbpar.agrid;
+
+    /* the file might exist and be larger than the new checkpoint */
+    ret = MPI_File_set_size(f, 0);
+    if (this_node == 0)
+      ret |= MPI_File_write_at(f, 0, &head, sizeof(head), MPI_BYTE,
+                               MPI_STATUS_IGNORE);
+  } else {
+    ret = MPI_File_read_at_all(f, 0, &head, sizeof(head), MPI_BYTE,
+                               MPI_STATUS_IGNORE);
+    if (!ret) {
+      if (memcmp(head.magic, lb_checkpoint_magic, sizeof(head.magic))
+          || head.version != LB_CHECKPOINT_VERSION) {
+        runtimeErrorMsg() << "\"" << filename << "\" is not a parallel LB checkpoint.";
+      } else if (head.global_grid[0] != lblattice.global_grid[0]
+                 || head.global_grid[1] != lblattice.global_grid[1]
+                 || head.global_grid[2] != lblattice.global_grid[2]
+                 || head.n_veloc != lbmodel.n_veloc) {
+        runtimeErrorMsg() << "LB checkpoint \"" << filename << "\" was written for a lattice of "
+                          << head.global_grid[0] << "x" << head.global_grid[1] << "x" << head.global_grid[2]
+                          << " nodes, but the current lattice has "
+                          << lblattice.global_grid[0] << "x" << lblattice.global_grid[1] << "x"
+                          << lblattice.global_grid[2] << " nodes.";
+      }
+    }
+  }
+
+  if (ret) {
+    runtimeErrorMsg() << "Could not " << (write ? "write" : "read")
+                      << " the header of LB checkpoint \"" << filename << "\".";
+  }
+  if (check_runtime_errors()) {
+    MPI_File_close(&f);
+    return ES_ERROR;
+  }
+
+  index_t index;
+  int x, y, z;
+  MPI_Offset disp = sizeof(head);
+  std::vector<double> pop(lbmodel.n_veloc*lblattice.grid_volume);
+  std::vector<double> force(3*lblattice.grid_volume);
+
+  /* pack the local nodes in global lattice order (z fastest) */
+  if (write) {
+    double *p = pop.data(), *fp = force.data();
+    for (x = 1; x <= lblattice.grid[0]; x++) {
+      for (y = 1; y <= lblattice.grid[1]; y++) {
+        for (z = 1; z <= lblattice.grid[2]; z++) {
+          index = get_linear_index(x, y, z, lblattice.halo_grid);
+          lb_get_populations(index, p);
+          fp[0] = lbfields[index].force[0];
+          fp[1] = lbfields[index].force[1];
+          fp[2] = lbfields[index].force[2];
+          p += lbmodel.n_veloc;
+          fp += 3;
+        }
+      }
+    }
+  }
+
+  ret = lb_mpiio_block(f, disp, pop.data(), lbmodel.n_veloc, MPI_DOUBLE, write);
+  disp += sizeof(double)*lbmodel.n_veloc*lblattice.global_grid[0]
+    *lblattice.global_grid[1]*lblattice.global_grid[2];
+  ret |= lb_mpiio_block(f, disp, force.data(), 3, MPI_DOUBLE, write);
+  disp += sizeof(double)*3*lblattice.global_grid[0]
+    *lblattice.global_grid[1]*lblattice.global_grid[2];
+
+#ifdef LB_BOUNDARIES
+  std::vector<int> boundary(lblattice.grid_volume);
+  if (write) {
+    int *bp = boundary.data();
+    for (x = 1; x <= lblattice.grid[0]; x++)
+      for (y = 1; y <= lblattice.grid[1]; y++)
+        for (z = 1; z <= lblattice.grid[2]; z++)
+          *bp++ = lbfields[get_linear_index(x, y, z, lblattice.halo_grid)].boundary;
+  }
+  if (head.fields & LB_CHECKPOINT_BOUNDARY)
+    ret |= lb_mpiio_block(f, disp, boundary.data(), 1, MPI_INT, write);
+#endif // LB_BOUNDARIES
+
+  MPI_File_close(&f);
+
+  if (ret) {
+    runtimeErrorMsg() << "Could not " << (write ? "write" : "read")
+                      << " LB checkpoint \"" << filename << "\".";
+  } else if (!write) {
+    double *p = pop.data(), *fp = force.data();
+#ifdef LB_BOUNDARIES
+    int *bp = boundary.data();
+    int boundary_mismatch = 0;
+#endif // LB_BOUNDARIES
+    for (x = 1; x <= lblattice.grid[0]; x++) {
+      for (y = 1; y <= lblattice.grid[1]; y++) {
+        for (z = 1; z <= lblattice.grid[2]; z++) {
+          index = get_linear_index(x, y, z, lblattice.halo_grid);
+          lb_set_populations(index, p);
+          lbfields[index].force[0] = fp[0];
+          lbfields[index].force[1] = fp[1];
+          lbfields[index].force[2] = fp[2];
+#ifdef LB_BOUNDARIES
+          /* the boundaries are set up from the lbboundary geometry,
+             which has to be restored before the fluid */
+          if ((head.fields & LB_CHECKPOINT_BOUNDARY)
+              && *bp++ != lbfields[index].boundary)
+            boundary_mismatch = 1;
+#endif // LB_BOUNDARIES
+          p += lbmodel.n_veloc;
+          fp += 3;
+        }
+      }
+    }
+#ifdef LB_BOUNDARIES
+    if (boundary_mismatch)
+      runtimeErrorMsg() << "The LB boundaries stored in checkpoint \"" << filename
+                        << "\" differ from the current boundary setup.";
+#endif // LB_BOUNDARIES
+
+    /* the halo has to be updated before the next coupling step */
+    lbpar.resend_halo = 1;
+    for (index = 0; index < lblattice.halo_grid_volume; index++)
+      lbfields[index].recalc_fields = 1;
+  }
+
+  return check_runtime_errors() ? ES_ERROR : ES_OK;
+}
+
+/*@}*/
+
+/***********************************************************************/
+/** \name Parallel output of the fluid fields via MPI-IO */
+/***********************************************************************/
+/*@{*/
+
+/** Determines the part of the sub-sampled global lattice that is
+ *  located on this node.
+ *
+ * \param stride  only every stride-th node in each direction is written
+ * \param n_glob  size of the sub-sampled global lattice (Output)
+ * \param n_loc   size of the local part (Output)
+ * \param start   start of the local part in the sub-sampled lattice (Output)
+ * \param offset  local lattice index (without halo) of the first
+ *                written node (Output)
+ */
+static void lb_sampled_lattice(int stride, int *n_glob, int *n_loc,
+                               int *start, int *offset) {
+  for (int d = 0; d < 3; d++) {
+    int first = node_pos[d]*lblattice.grid[d];
+    int last = first + lblattice.grid[d] - 1;
+    /* first sampled node at or after the local lattice start */
+    int s = ((first + stride - 1)/stride)*stride;
+
+    n_glob[d] = (lblattice.global_grid[d] + stride - 1)/stride;
+    n_loc[d] = (s <= last) ? (last - s)/stride + 1 : 0;
+    start[d] = s/stride;
+    offset[d] = s - first;
+  }
+}
+
+/** Collectively writes a fluid field of the CPU LB as VTK image data
+ *  with raw appended binary data. Every node writes its part of the
+ *  lattice directly into the file. Has to be called on all nodes, see
+ *  \ref mpi_lb_mpiio_vtk.
+ *
+ * \param filename          name of the VTK file
+ * \param field             \ref LB_FIELD_DENSITY or \ref LB_FIELD_VELOCITY
+ * \param stride            only every stride-th node in each direction is written
+ * \param single_precision  write single instead of double precision values
+ * \return                  ES_OK on success, ES_ERROR otherwise
+ */
+int lb_mpiio_vtk(const char *filename, int field, int stride, int single_precision) {
+  MPI_File f;
+  int n_glob[3], n_loc[3], start[3], offset[3];
+  int ret;
+
+  if (!(lattice_switch & LATTICE_LB)) {
+    runtimeErrorMsg() << "To write the LB fields one needs to have already initialized the CPU LB fluid.";
+    return check_runtime_errors() ? ES_ERROR : ES_OK;
+  }
+
+  lb_sampled_lattice(stride, n_glob, n_loc, start, offset);
+
+  const int n_comp = (field == LB_FIELD_VELOCITY) ? 3 : 1;
+  const char *name = (field == LB_FIELD_VELOCITY) ? "velocity" : "density";
+  const int elem_size = single_precision ? sizeof(float) : sizeof(double);
+  const uint64_t n_bytes = uint64_t(elem_size)*n_comp*n_glob[0]*n_glob[1]*n_glob[2];
+  const int one = 1;
+
+  /* the header is generated on all nodes, since they need its size */
+  std::ostringstream header;
+  header << "<?xml version=\"1.0\"?>\n"
+         << "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\""
+         << (*(const char *)&one ? "LittleEndian" : "BigEndian")
+         << "\" header_type=\"UInt64\">\n"
+         << "  <ImageData WholeExtent=\"0 " << n_glob[0]-1 << " 0 " << n_glob[1]-1
+         << " 0 " << n_glob[2]-1 << "\" Origin=\"" << 0.5*lbpar.agrid << " "
+         << 0.5*lbpar.agrid << " " << 0.5*lbpar.agrid << "\" Spacing=\""
+         << stride*lbpar.agrid << " " << stride*lbpar.agrid << " "
+         << stride*lbpar.agrid << "\">\n"
+         << "    <Piece Extent=\"0 " << n_glob[0]-1 << " 0 " << n_glob[1]-1
+         << " 0 " << n_glob[2]-1 << "\">\n"
+         << "      <PointData " << (n_comp == 3 ? "Vectors" : "Scalars")
+         << "=\"" << name << "\">\n"
+         << "        <DataArray type=\"" << (single_precision ? "Float32" : "Float64")
+         << "\" Name=\"" << name << "\" NumberOfComponents=\"" << n_comp
+         << "\" format=\"appended\" offset=\"0\"/>\n"
+         << "      </PointData>\n"
+         << "    </Piece>\n"
+         << "  </ImageData>\n"
+         << "  <AppendedData encoding=\"raw\">\n   _";
+  const std::string head = header.str();
+  const std::string foot = "\n  </AppendedData>\n</VTKFile>\n";
+
+  ret = MPI_File_open(comm_cart, const_cast<char *>(filename),
+                      MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &f);
+  if (ret) {
+    runtimeErrorMsg() << "Could not open \"" << filename << "\" for writing.";
+    return check_runtime_errors() ? ES_ERROR : ES_OK;
+  }
+
+  ret = MPI_File_set_size(f, 0);
+  if (this_node == 0) {
+    MPI_Offset disp = head.size();
+    ret |= MPI_File_write_at(f, 0, const_cast<char *>(head.data()), head.size(),
+                             MPI_CHAR, MPI_STATUS_IGNORE);
+    ret |= MPI_File_write_at(f, disp, const_cast<uint64_t *>(&n_bytes), sizeof(n_bytes),
+                             MPI_BYTE, MPI_STATUS_IGNORE);
+    disp += sizeof(n_bytes) + n_bytes;
+    ret |= MPI_File_write_at(f, disp, const_cast<char *>(foot.data()), foot.size(),
+                             MPI_CHAR, MPI_STATUS_IGNORE);
+  }
+
+  /* pack the local nodes in VTK order (x fastest) */
+  const int n_local = n_loc[0]*n_loc[1]*n_loc[2];
+  std::vector<double> data(n_comp*n_local);
+  double rho, j[3], *dp = data.data();
+
+  for (int z = 0; z < n_loc[2]; z++) {
+    for (int y = 0; y < n_loc[1]; y++) {
+      for (int x = 0; x < n_loc[0]; x++) {
+        index_t index = get_linear_index(offset[0] + x*stride + 1,
+                                         offset[1] + y*stride + 1,
+                                         offset[2] + z*stride + 1,
+                                         lblattice.halo_grid);
+        lb_calc_local_fields(index, &rho, j, NULL);
+        if (n_comp == 3) {
+          /* unit conversion */
+          *dp++ = j[0]/rho*lbpar.agrid/lbpar.tau;
+          *dp++ = j[1]/rho*lbpar.agrid/lbpar.tau;
+          *dp++ = j[2]/rho*lbpar.agrid/lbpar.tau;
+        } else {
+          *dp++ = rho/lbpar.agrid/lbpar.agrid/lbpar.agrid;
+        }
+      }
+    }
+  }
+
+  std::vector<float> data_single;
+  void *buf = data.data();
+  MPI_Datatype MPI_T = MPI_DOUBLE;
+  if (single_precision) {
+    data_single.assign(data.begin(), data.end());
+    buf = data_single.data();
+    MPI_T = MPI_FLOAT;
+  }
+
+  /* the local part is a subarray of the global lattice, with x
+     being the fastest index */
+  MPI_Datatype elemtype, filetype;
+  MPI_Type_contiguous(n_comp, MPI_T, &elemtype);
+  MPI_Type_commit(&elemtype);
+  if (n_local > 0) {
+    int sizes[3] = { n_glob[2], n_glob[1], n_glob[0] };
+    int subsizes[3] = { n_loc[2], n_loc[1], n_loc[0] };
+    int starts[3] = { start[2], start[1], start[0] };
+    MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C,
+                             elemtype, &filetype);
+  } else {
+    MPI_Type_contiguous(1, elemtype, &filetype);
+  }
+  MPI_Type_commit(&filetype);
+
+  ret |= MPI_File_set_view(f, head.size() + sizeof(n_bytes), elemtype, filetype,
+                           const_cast<char *>("native"), MPI_INFO_NULL);
+  ret |= MPI_File_write_all(f, buf, n_comp*n_local, MPI_T, MPI_STATUS_IGNORE);
+
+  MPI_Type_free(&filetype);
+  MPI_Type_free(&elemtype);
+  MPI_File_close(&f);
+
+  if (ret)
+    runtimeErrorMsg() << "Could not write the LB " << name << " to \"" << filename << "\".";
+
+  return check_runtime_errors() ? ES_ERROR : ES_OK;
+}
+
+/*@}*/
+
 #ifdef ADDITIONAL_CHECKS
 static int compare_buffers(double *buf1, double *buf2, int size) {
     int ret;
@@ -52,6 +52,7 @@ extern int lb_components ; // global variable holding the number of fluid compon
 #define LBPAR_FRICTION  4 /**< friction coefficient for viscous coupling between particles and fluid */
 #define LBPAR_EXTFORCE  5 /**< external force acting on the fluid */
 #define LBPAR_BULKVISC  6 /**< fluid bulk viscosity */
+#define LBPAR_VELOCITY_HALO 10 /**< coupling halo mode */
 
 /** Note these are used for binary logic so should be powers of 2 */
 #define LB_COUPLE_NULL        1
@@ -177,6 +178,10 @@ typedef struct {
   bool is_TRT;
 
   int resend_halo;
+
+  /** Flag determining whether the coupling halo only exchanges the
+   *  density and momentum of the nodes instead of the populations */
+  int velocity_halo;
           
 } LB_Parameters;
 
@@ -189,10 +194,20 @@ extern LB_Parameters lbpar;
 /** The underlying lattice */
 extern Lattice lblattice;
 
+/** Floating point type of the stored velocity populations. With
+ * LB_SINGLE_PRECISION the populations are kept in single precision to
+ * halve the memory and bandwidth of the fluid update, while the modes
+ * are still calculated in double precision. */
+#ifdef LB_SINGLE_PRECISION
+typedef float lbPopFloat;
+#else
+typedef double lbPopFloat;
+#endif
+
 /** Pointer to the velocity populations of the fluid.
  * lbfluid[0] contains pre-collision populations, lbfluid[1]
  * contains post-collision populations*/
-extern double **lbfluid[2];
+extern lbPopFloat **lbfluid[2];
 
 /** Pointer to the hydrodynamic fields of the fluid */
 extern LB_FluidNode *lbfields;
@@ -245,6 +260,26 @@ void lb_reinit_forces();
 /** Checks if all LB parameters are meaningful */
 int lb_sanity_checks();
 
+/** Collectively writes or reads a parallel binary checkpoint of the
+ *  fluid populations, force densities and boundary flags using
+ *  MPI-IO. Has to be called on all nodes.
+ * @param filename name of the checkpoint file
+ * @param write    1 to write, 0 to read the checkpoint
+ * @return         ES_OK on success, ES_ERROR otherwise
+ */
+int lb_mpiio_checkpoint(const char *filename, int write);
+
+/** Collectively writes the fluid density or velocity as VTK image
+ *  data file with binary appended data using MPI-IO. Has to be called
+ *  on all nodes.
+ * @param filename          name of the VTK file
+ * @param field             \ref LB_FIELD_DENSITY or \ref LB_FIELD_VELOCITY
+ * @param stride            only every stride-th node in each direction is written
+ * @param single_precision  write single instead of double precision values
+ * @return                  ES_OK on success, ES_ERROR otherwise
+ */
+int lb_mpiio_vtk(const char *filename, int field, int stride, int single_precision);
+
 /** Sets the density and momentum on a local lattice site.
  * @param node  Pointer to the Node of the lattice site within the local domain (Input)
  * @param rho   Local density of the fluid (Input)
@@ -349,17 +384,17 @@ inline void lb_calc_local_j(index_t index, double *j) {
     return;
   }
 
-  j[0] =   lbfluid[0][1][index]  - lbfluid[0][2][index]
+  j[0] = (double)lbfluid[0][1][index]  - lbfluid[0][2][index]
          + lbfluid[0][7][index]  - lbfluid[0][8][index]  
          + lbfluid[0][9][index]  - lbfluid[0][10][index] 
          + lbfluid[0][11][index] - lbfluid[0][12][index] 
          + lbfluid[0][13][index] - lbfluid[0][14][index];
-  j[1] =   lbfluid[0][3][index]  - lbfluid[0][4][index]
+  j[1] = (double)lbfluid[0][3][index]  - lbfluid[0][4][index]
          + lbfluid[0][7][index]  - lbfluid[0][8][index]  
          - lbfluid[0][9][index]  + lbfluid[0][10][index]
          + lbfluid[0][15][index] - lbfluid[0][16][index] 
          + lbfluid[0][17][index] - lbfluid[0][18][index]; 
-  j[2] =   lbfluid[0][5][index]  - lbfluid[0][6][index]  
+  j[2] = (double)lbfluid[0][5][index]  - lbfluid[0][6][index]  
          + lbfluid[0][11][index] - lbfluid[0][12][index] 
          - lbfluid[0][13][index] + lbfluid[0][14][index]
          + lbfluid[0][15][index] - lbfluid[0][16][index] 
@@ -503,6 +538,7 @@ inline void lb_set_populations(index_t index, double* pop) {
   for (i=0; i<19*LB_COMPONENTS; i++) {
     lbfluid[0][i][index]=pop[i]-lbmodel.coeff[i%19][0]*lbpar.rho[i/19];
   }
+  lbfields[index].recalc_fields = 1;
 }
 #endif
 
@@ -518,6 +554,8 @@ int lb_lbfluid_set_gamma_odd(double * p_gamma_odd);
 int lb_lbfluid_set_gamma_even(double * p_gamma_even);
 int lb_lbfluid_set_friction(double * p_friction);
 int lb_lbfluid_set_couple_flag(int couple_flag);
+int lb_lbfluid_set_velocity_halo(int velocity_halo);
+int lb_lbfluid_get_velocity_halo(int *p_velocity_halo);
 int lb_lbfluid_set_agrid(double p_agrid);
 int lb_lbfluid_set_ext_force(int component, double p_fx, double p_fy, double p_fz);
 int lb_lbfluid_set_tau(double p_tau);
@@ -535,15 +573,24 @@ int lb_lbfluid_set_mobility(double * p_mobility);
 int lb_set_lattice_switch(int py_switch);
 int lb_get_lattice_switch(int* py_switch);
 
+/** \name Fields of the parallel VTK output */
+/*@{*/
+#define LB_FIELD_DENSITY  0 /**< fluid density */
+#define LB_FIELD_VELOCITY 1 /**< fluid velocity */
+/*@}*/
+
 /* IO routines */
 int lb_lbfluid_print_vtk_boundary(char* filename);
 int lb_lbfluid_print_vtk_velocity(char* filename, std::vector<int> = {-1, -1, -1}, std::vector<int> = {-1, -1, -1});
 int lb_lbfluid_print_vtk_density(char** filename);
 int lb_lbfluid_print_boundary(char* filename);
 int lb_lbfluid_print_velocity(char* filename);
+int lb_lbfluid_print_vtk_mpiio(char* filename, int field, int stride, int single_precision);
 
 int lb_lbfluid_save_checkpoint(char* filename, int binary); 
 int lb_lbfluid_load_checkpoint(char* filename, int binary);
+int lb_lbfluid_save_checkpoint_mpiio(char* filename);
+int lb_lbfluid_load_checkpoint_mpiio(char* filename);
 
 int lb_lbnode_get_rho(int* ind, double* p_rho);
 int lb_lbnode_get_u(int* ind, double* u);
@@ -0,0 +1,216 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file local_stress.cpp
+    Implementation of \ref local_stress.hpp "local_stress.hpp".
+*/
+#include "local_stress.hpp"
+#include "errorhandling.hpp"
+#include "grid.hpp"
+#include "integrate.hpp"
+#include "statistics_parallel.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cmath>
+
+LocalStressGrid::LocalStressGrid() {
+  for (int d = 0; d < 3; d++) {
+    m_centre[d] = m_range[d] = m_scale[d] = 0.0;
+    m_bins[d] = 0;
+    m_spans[d] = false;
+  }
+}
+
+LocalStressGrid::LocalStressGrid(const int periodic[3],
+                                 const double range_start[3],
+                                 const double range[3], const int bins[3])
+    : m_tensors(9 * bins[0] * bins[1] * bins[2], 0.0) {
+  for (int d = 0; d < 3; d++) {
+    m_spans[d] = periodic[d];
+    m_range[d] = m_spans[d] ? box_l[d] : range[d];
+    m_centre[d] = m_spans[d] ? 0.5 * box_l[d] : range_start[d] + 0.5 * range[d];
+    m_bins[d] = bins[d];
+    m_scale[d] = bins[d] / m_range[d];
+  }
+}
+
+double LocalStressGrid::bin_volume() const {
+  return m_range[0] * m_range[1] * m_range[2] / n_bins();
+}
+
+int LocalStressGrid::bin_of(const double u[3]) const {
+  int b[3];
+  for (int d = 0; d < 3; d++) {
+    b[d] = (int)std::floor(u[d]);
+    if (m_spans[d])
+      b[d] = ((b[d] % m_bins[d]) + m_bins[d]) % m_bins[d];
+    else if (b[d] < 0 || b[d] >= m_bins[d])
+      return -1;
+  }
+  return (b[0] * m_bins[1] + b[1]) * m_bins[2] + b[2];
+}
+
+void LocalStressGrid::add_pair(const double pos[3], const double d[3],
+                               const double force[3]) {
+  /* the line in reduced coordinates, where the bins have unit size, from
+     the image of the first particle closest to the centre of the cuboid */
+  double u0[3], du[3];
+  for (int i = 0; i < 3; i++) {
+    double rel = pos[i] - m_centre[i];
+    if (PERIODIC(i))
+      rel -= dround(rel / box_l[i]) * box_l[i];
+    u0[i] = (rel + 0.5 * m_range[i]) * m_scale[i];
+    du[i] = -d[i] * m_scale[i];
+  }
+
+  /* cut the line at the bin boundaries, the pieces are inside one bin */
+  m_cuts.assign({0.0, 1.0});
+  for (int i = 0; i < 3; i++) {
+    if (du[i] == 0.0)
+      continue;
+    double lo = std::min(u0[i], u0[i] + du[i]),
+           hi = std::max(u0[i], u0[i] + du[i]);
+    for (double k = std::floor(lo) + 1.0; k < hi; k += 1.0)
+      m_cuts.push_back((k - u0[i]) / du[i]);
+  }
+  std::sort(m_cuts.begin(), m_cuts.end());
+
+  for (size_t c = 0; c + 1 < m_cuts.size(); c++) {
+    double fraction = m_cuts[c + 1] - m_cuts[c];
+    if (fraction <= 0.0)
+      continue;
+    double t = 0.5 * (m_cuts[c] + m_cuts[c + 1]);
+    double u[3] = {u0[0] + t * du[0], u0[1] + t * du[1], u0[2] + t * du[2]};
+    int bin = bin_of(u);
+    if (bin < 0)
+      continue;
+    double *tensor = &m_tensors[9 * bin];
+    for (int k = 0; k < 3; k++)
+      for (int l = 0; l < 3; l++)
+        tensor[3 * k + l] += fraction * force[k] * d[l];
+  }
+}
+
+void LocalStressGrid::add_kinetic(const Particle &p) {
+  double u[3];
+  for (int i = 0; i < 3; i++) {
+    double rel = p.r.p[i] - m_centre[i];
+    if (PERIODIC(i))
+      rel -= dround(rel / box_l[i]) * box_l[i];
+    u[i] = (rel + 0.5 * m_range[i]) * m_scale[i];
+  }
+  int bin = bin_of(u);
+  if (bin < 0)
+    return;
+  double *tensor = &m_tensors[9 * bin];
+  for (int k = 0; k < 3; k++)
+    for (int l = 0; l < 3; l++)
+      tensor[3 * k + l] +=
+          p.m.v[k] * p.m.v[l] * p.p.mass / (time_step * time_step);
+}
+
+/************************************************************/
+
+bool local_stress_sampling = false;
+
+/** The accumulated local stress of this node and the number of steps. */
+static LocalStressGrid accumulated;
+static bool accumulating = false;
+static int n_accumulated = 0;
+
+void local_stress_add_pair(const double pos[3], const double d[3],
+                           const double force[3]) {
+  accumulated.add_pair(pos, d, force);
+}
+
+void local_stress_begin_step() { local_stress_sampling = accumulating; }
+
+void local_stress_end_step() {
+  if (!local_stress_sampling)
+    return;
+  for_each_local_particle([](const Particle &p) { accumulated.add_kinetic(p); });
+  n_accumulated++;
+  local_stress_sampling = false;
+}
+
+/* the parameters are periodic, range_start, range and bins, or empty to
+   stop the accumulation */
+static void local_accumulation(const std::vector<double> &params,
+                               std::vector<double> &) {
+  if (params.empty()) {
+    accumulating = false;
+    return;
+  }
+  int periodic[3], bins[3];
+  double range_start[3], range[3];
+  for (int d = 0; d < 3; d++) {
+    periodic[d] = params[d];
+    range_start[d] = params[3 + d];
+    range[d] = params[6 + d];
+    bins[d] = params[9 + d];
+  }
+  accumulated = LocalStressGrid(periodic, range_start, range, bins);
+  accumulating = true;
+  n_accumulated = 0;
+}
+
+static ParallelAnalysis accumulation_job(local_accumulation, ANALYSIS_SUM);
+
+/* the bins of this node, followed by the number of steps on the master */
+static void local_accumulated(const std::vector<double> &,
+                              std::vector<double> &result) {
+  result = accumulated.tensors();
+  result.push_back(this_node == 0 ? n_accumulated : 0);
+}
+
+static ParallelAnalysis accumulated_job(local_accumulated, ANALYSIS_SUM);
+
+int local_stress_start(const int periodic[3], const double range_start[3],
+                       const double range[3], const int bins[3]) {
+  std::vector<double> params;
+  for (int d = 0; d < 3; d++)
+    if (bins[d] < 1 ||
+        (!periodic[d] && (range[d] <= 0.0 || range[d] > box_l[d]))) {
+      runtimeErrorMsg() << "local stress: the bins and range have to be positive, and the range not larger than the box";
+      return ES_ERROR;
+    }
+  params.insert(params.end(), periodic, periodic + 3);
+  params.insert(params.end(), range_start, range_start + 3);
+  params.insert(params.end(), range, range + 3);
+  params.insert(params.end(), bins, bins + 3);
+  accumulation_job(params);
+  return ES_OK;
+}
+
+void local_stress_stop() { accumulation_job({}); }
+
+int local_stress_get(std::vector<double> &tensors, int bins[3],
+                     int *n_samples) {
+  if (accumulated.n_bins() == 0) {
+    runtimeErrorMsg() << "local stress: no accumulation was started";
+    return ES_ERROR;
+  }
+  tensors = accumulated_job({});
+  *n_samples = tensors.back();
+  tensors.pop_back();
+  double norm = accumulated.bin_volume() * std::max(*n_samples, 1);
+  for (double &t : tensors)
+    t /= norm;
+  std::copy(accumulated.bins(), accumulated.bins() + 3, bins);
+  return ES_OK;
+}
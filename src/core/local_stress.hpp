@@ -0,0 +1,121 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _LOCAL_STRESS_H
+#define _LOCAL_STRESS_H
+/** \file local_stress.hpp
+    Spatially resolved stress tensor after Irving and Kirkwood.
+
+    A pair force contributes to the bins crossed by the straight line
+    between the two particles, in proportion to the fraction of the line
+    inside each bin. The kinetic contribution of a particle goes to the
+    bin it is in. Every node bins the pairs it computes, so the bins are
+    only reduced when they are read.
+
+    Besides the instantaneous analysis \ref local_stress_tensor_calc, the
+    local stress can be accumulated during the integration: the pair
+    forces of the force calculation of every step and the kinetic
+    contribution after the velocity update are added until the
+    accumulation is stopped, see \ref local_stress_start.
+*/
+
+#include "particle_data.hpp"
+#include <vector>
+
+/** A cuboid divided into bins, each with a stress tensor. */
+class LocalStressGrid {
+public:
+  LocalStressGrid();
+  /** The cuboid from range_start with the edge lengths range, divided
+      into bins. In the directions where periodic is set, the cuboid spans
+      the box instead, and a bin is only restricted in the other
+      directions, e.g. for slabs. */
+  LocalStressGrid(const int periodic[3], const double range_start[3],
+                  const double range[3], const int bins[3]);
+
+  /** Add a pair force. pos is the position of the first particle, d the
+      vector from the second particle to the first one and force the force
+      on the first particle. */
+  void add_pair(const double pos[3], const double d[3],
+                const double force[3]);
+  /** Add the kinetic contribution of a particle, with the velocity in the
+      internal units of the integrator. */
+  void add_kinetic(const Particle &p);
+
+  const int *bins() const { return m_bins; }
+  int n_bins() const { return m_bins[0] * m_bins[1] * m_bins[2]; }
+  double bin_volume() const;
+  /** The sums of the bins, 9 per bin, with the bin (i, j, k) at
+      (i*bins[1] + j)*bins[2] + k. Not divided by the bin volume. */
+  std::vector<double> &tensors() { return m_tensors; }
+
+private:
+  /** The bin at the reduced coordinates u, or -1 outside of the cuboid. */
+  int bin_of(const double u[3]) const;
+
+  double m_centre[3], m_range[3];
+  /** bins per length */
+  double m_scale[3];
+  int m_bins[3];
+  bool m_spans[3];
+  std::vector<double> m_tensors;
+  /** the parameters of the bin boundaries along a line */
+  std::vector<double> m_cuts;
+};
+
+/** Whether the force calculation adds the pair forces to the accumulated
+    local stress, see \ref local_stress_begin_step. */
+extern bool local_stress_sampling;
+
+/** Add a pair force to the accumulated local stress of this node, see
+    \ref LocalStressGrid::add_pair. */
+void local_stress_add_pair(const double pos[3], const double d[3],
+                           const double force[3]);
+
+/** Called by the integrator on all nodes before the force calculation
+    of a step. */
+void local_stress_begin_step();
+
+/** Called by the integrator on all nodes after the velocity update of a
+    step. Adds the kinetic contributions and counts the sample. */
+void local_stress_end_step();
+
+/** Start the accumulation of the local stress on the grid
+    LocalStressGrid(periodic, range_start, range, bins), discarding the
+    previous one. Call only on the master.
+    \return ES_OK, or ES_ERROR for an invalid grid
+*/
+int local_stress_start(const int periodic[3], const double range_start[3],
+                       const double range[3], const int bins[3]);
+
+/** Stop the accumulation, keeping the accumulated local stress. Call only
+    on the master. */
+void local_stress_stop();
+
+/** The accumulated local stress, averaged over the steps. Call only on
+    the master.
+    @param tensors the stress tensors of the bins, 9 per bin, in the order
+                   of \ref LocalStressGrid::tensors
+    @param bins the number of bins in each direction
+    @param n_samples the number of steps
+    \return ES_OK, or ES_ERROR if no accumulation was started
+*/
+int local_stress_get(std::vector<double> &tensors, int bins[3],
+                     int *n_samples);
+
+#endif
@@ -46,11 +46,29 @@
  *   id[i]. The iteration indices for local part of 1.bonds are:
  *   subarray[i] : subarray[i+1]
  * - Take a look at the bond input code. It's easy to understand.
+ * - Exclusions are dumped in the same way as 1.eoff and 1.excl.
+ *
+ * The complete particle properties and the dynamic state (position
+ * including the image box, orientation, velocities and forces) are
+ * dumped as raw records into 1.prop and 1.state. Their sizes depend on
+ * the compiled features and are recorded in 1.head, so that a checkpoint
+ * can only be restored into a build with the same feature set.
+ *
+ * Reading does not depend on the number of processes at the time of
+ * writing: every process reads an equally sized slice of the global
+ * particle ordering and the particles are sorted into the cells
+ * afterwards.
+ *
+ * The global parameters and the random number generator states are
+ * written by the master node only, into 1.glob.
  */
 
 #include "config.hpp"
 
 #include <string>
+#include <sstream>
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <errno.h>
 #include <unistd.h>
@@ -61,11 +79,64 @@
 #include "interaction_data.hpp"
 #include "integrate.hpp"
 #include "cells.hpp"
+#include "grid.hpp"
 #include "utils.hpp"
+#include "global.hpp"
+#include "communication.hpp"
+#include "errorhandling.hpp"
+#include "random.hpp"
+#include "AsyncWriter.hpp"
 #include "mpiio.hpp"
 
 #include <mpi.h>
 
+/** Per-particle record of the properties dumped with \ref MPIIO_OUT_PRP. */
+struct MpiioProperties {
+  ParticleProperties p;
+#ifdef ENGINE
+  ParticleParametersSwimming swim;
+#endif
+};
+
+/** Per-particle record of the dynamic state dumped with \ref
+ *  MPIIO_OUT_STA. Velocities and forces are stored in simulation units,
+ *  not in the internal ones scaled by the time step.
+ */
+struct MpiioState {
+  ParticlePosition r;
+  ParticleMomentum m;
+  ParticleForce f;
+  int i[3];
+};
+
+/** Global parameters which are restored from 1.glob. */
+static const int mpiio_global_fields[] = {
+  FIELD_BOXL, FIELD_PERIODIC, FIELD_SKIN, FIELD_MIN_GLOBAL_CUT,
+  FIELD_TIMESTEP, FIELD_SIMTIME, FIELD_TEMPERATURE, FIELD_THERMO_SWITCH,
+  FIELD_LANGEVIN_GAMMA, FIELD_LANGEVIN_GAMMA_ROTATION,
+  FIELD_NPTISO_G0, FIELD_NPTISO_GV, FIELD_LEES_EDWARDS_OFFSET,
+  FIELD_DPD_GAMMA, FIELD_DPD_RCUT, FIELD_DPD_TGAMMA, FIELD_DPD_TRCUT,
+  FIELD_DPD_WF, FIELD_DPD_TWF
+};
+
+/** Returns a committed MPI datatype for a raw record of sz bytes. */
+static MPI_Datatype mpiio_record_type(size_t sz)
+{
+  MPI_Datatype t;
+  MPI_Type_contiguous(sz, MPI_BYTE, &t);
+  MPI_Type_commit(&t);
+  return t;
+}
+
+/** The writer thread of this process for asynchronous output, started
+ *  on first use. */
+static std::unique_ptr<AsyncWriter> async_writer;
+
+/** If set, \ref mpiio_dump_array stages the data in \ref async_frame
+ *  instead of writing it. */
+static bool async_staging = false;
+static AsyncWriter::Frame async_frame;
+
 /** Dumps arr of size len starting from prefix pref of type T using
  * MPI_T as MPI datatype. Beware, that T and MPI_T have to match!
  *
@@ -82,6 +153,16 @@ static void mpiio_dump_array(std::string fn, T* arr, size_t len,
   MPI_File f;
   int ret;
 
+  if (async_staging) {
+    // Copy the data, the caller reuses its buffers.
+    AsyncWriter::Block b;
+    b.filename = fn;
+    b.offset = pref * sizeof(T);
+    b.data.assign((char *) arr, (char *) (arr + len));
+    async_frame.push_back(std::move(b));
+    return;
+  }
+
   ret = MPI_File_open(MPI_COMM_WORLD, const_cast<char *>(fn.c_str()),
                       // MPI_MODE_EXCL: Prohibit overwriting
                       MPI_MODE_WRONLY | MPI_MODE_CREATE | MPI_MODE_EXCL,
@@ -138,6 +219,9 @@ static void dump_info(std::string fn, unsigned fields)
   success = success && (fwrite(&n_bonded_ia, sizeof(int), 1, f) == 1);
   success = success && (fwrite(npartners.data(), sizeof(int),
                                n_bonded_ia, f) == n_bonded_ia);
+  // The record sizes identify the feature set of the raw dumps.
+  int sizes[2] = { (int) sizeof(MpiioProperties), (int) sizeof(MpiioState) };
+  success = success && (fwrite(sizes, sizeof(int), 2, f) == 2);
   fclose(f);
   if (!success) {
     fprintf(stderr, "MPI-IO Error: Failed to write %s.\n", fn.c_str());
@@ -146,17 +230,169 @@ static void dump_info(std::string fn, unsigned fields)
 }
 
 
-void mpi_mpiio_common_write(const char *filename, unsigned fields)
+/** Dumps the integer lists (bonds or exclusions) of the local particles
+ *  as an offset and a data file, see the file comment for the layout.
+ *
+ * \param fnoff File name of the offset file
+ * \param fndata File name of the data file
+ * \param list The list member of \ref Particle to dump
+ * \param nlocalpart The number of local particles
+ * \param pref The particle prefix of this process
+ * \param rank The rank of this process in MPI_COMM_WORLD
+ */
+static void mpiio_dump_lists(std::string fnoff, std::string fndata,
+                             IntList Particle::*list, int nlocalpart,
+                             int pref, int rank)
+{
+  static std::vector<int> off, data;
+  int ndata, dpref = 0;
+  Cell *cell;
+
+  if (nlocalpart + 1 > off.size())
+    off.resize(nlocalpart + 1);
+
+  // List lengths converted to prefixes
+  int i = 0;
+  off[0] = 0;
+  for (int c = 0; c < local_cells.n; ++c) {
+    cell = local_cells.cell[c];
+    for (int j = 0; j < cell->n; ++j, ++i)
+      off[i + 1] = off[i] + (cell->part[j].*list).n;
+  }
+  ndata = off[nlocalpart];
+
+  if (ndata > data.size())
+    data.resize(ndata);
+
+  i = 0;
+  for (int c = 0; c < local_cells.n; ++c) {
+    cell = local_cells.cell[c];
+    for (int j = 0; j < cell->n; ++j) {
+      IntList *il = &(cell->part[j].*list);
+      for (int k = 0; k < il->n; ++k)
+        data[i++] = il->e[k];
+    }
+  }
+
+  MPI_Exscan(&ndata, &dpref, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  mpiio_dump_array<int>(fnoff, off.data(), nlocalpart + 1, pref + rank,
+                        MPI_INT);
+  mpiio_dump_array<int>(fndata, data.data(), ndata, dpref, MPI_INT);
+}
+
+/** The files written for the given fields, including 1.head. */
+static std::vector<std::string> mpiio_output_files(std::string fnam,
+                                                   unsigned fields)
+{
+  std::vector<std::string> fns = { fnam + ".head", fnam + ".pref",
+                                   fnam + ".id" };
+  if (fields & MPIIO_OUT_POS)
+    fns.push_back(fnam + ".pos");
+  if (fields & MPIIO_OUT_VEL)
+    fns.push_back(fnam + ".vel");
+  if (fields & MPIIO_OUT_TYP)
+    fns.push_back(fnam + ".type");
+  if (fields & MPIIO_OUT_PRP)
+    fns.push_back(fnam + ".prop");
+  if (fields & MPIIO_OUT_STA)
+    fns.push_back(fnam + ".state");
+  if (fields & MPIIO_OUT_BND) {
+    fns.push_back(fnam + ".boff");
+    fns.push_back(fnam + ".bond");
+  }
+#ifdef EXCLUSIONS
+  if (fields & MPIIO_OUT_EXC) {
+    fns.push_back(fnam + ".eoff");
+    fns.push_back(fnam + ".excl");
+  }
+#endif
+  return fns;
+}
+
+/** Prepares the files of an asynchronous output step. The writer
+ *  threads do not create files, so they are created here collectively
+ *  and exclusively, like \ref mpiio_dump_array does for the synchronous
+ *  output. Fails if a file exists or is still to be written by a
+ *  pending step.
+ *
+ * \param fnam The file name prefix
+ * \param fields The dumped fields
+ * \param rank The rank of this process in MPI_COMM_WORLD
+ * \return ES_OK on all processes, or ES_ERROR on all processes with a
+ *         runtime error on the master
+ */
+static int mpiio_create_files(std::string fnam, unsigned fields, int rank)
+{
+  std::vector<std::string> fns = mpiio_output_files(fnam, fields);
+  int pending = 0;
+  for (auto const &fn : fns)
+    if (async_writer && async_writer->pending(fn))
+      pending = 1;
+  MPI_Allreduce(MPI_IN_PLACE, &pending, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (pending) {
+    if (rank == 0)
+      runtimeErrorMsg() << "MPI-IO: \"" << fnam
+                        << "\" is still being written.";
+    return ES_ERROR;
+  }
+
+  for (size_t i = 0; i < fns.size(); ++i) {
+    const std::string &fn = fns[i];
+    MPI_File f;
+    int ret = MPI_File_open(MPI_COMM_WORLD, const_cast<char *>(fn.c_str()),
+                            MPI_MODE_WRONLY | MPI_MODE_CREATE | MPI_MODE_EXCL,
+                            MPI_INFO_NULL, &f);
+    if (ret == MPI_SUCCESS)
+      MPI_File_close(&f);
+    int failed = (ret != MPI_SUCCESS);
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX,
+                  MPI_COMM_WORLD);
+    if (failed) {
+      if (rank == 0) {
+        char buf[MPI_MAX_ERROR_STRING];
+        int len = 0;
+        if (ret != MPI_SUCCESS)
+          MPI_Error_string(ret, buf, &len);
+        buf[len] = '\0';
+        runtimeErrorMsg() << "MPI-IO: Could not create file \"" << fn
+                          << "\": " << buf;
+        // Do not leave an incomplete set of files behind.
+        for (size_t j = 0; j < i; ++j)
+          MPI_File_delete(const_cast<char *>(fns[j].c_str()), MPI_INFO_NULL);
+      }
+      return ES_ERROR;
+    }
+  }
+  return ES_OK;
+}
+
+int mpi_mpiio_common_write(const char *filename, unsigned fields)
 {
   std::string fnam(filename);
-  int nlocalpart = cells_get_n_particles(), pref = 0, bpref = 0;
-  int rank, ret;
+  int nlocalpart = cells_get_n_particles(), pref = 0;
+  int rank;
   // Keep static buffers in order not having to allocate them on every
   // function call
   static std::vector<double>pos, vel;
-  static std::vector<int>id, type, boff, bond;
+  static std::vector<int>id, type;
+  static std::vector<MpiioProperties> prop;
+  static std::vector<MpiioState> state;
   Cell *cell;
 
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#ifndef EXCLUSIONS
+  fields &= ~MPIIO_OUT_EXC;
+#endif
+  if (fields & MPIIO_ASYNC) {
+    // The files are written by several threads without MPI-IO, so
+    // create them here.
+    if (mpiio_create_files(fnam, fields, rank) != ES_OK)
+      return ES_ERROR;
+    async_staging = true;
+  } else {
+    mpi_mpiio_common_flush();
+  }
+
   // Nlocalpart prefixes
   // Prefixes based for arrays: 3 * pref for vel, pos.
   MPI_Exscan(&nlocalpart, &pref, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
@@ -170,8 +406,10 @@ void mpi_mpiio_common_write(const char *filename, unsigned fields)
     vel.resize(3 * nlocalpart);
   if (fields & MPIIO_OUT_TYP && nlocalpart > type.size())
     type.resize(nlocalpart);
-  if (fields & MPIIO_OUT_BND && nlocalpart + 1 > boff.size())
-    boff.resize(nlocalpart + 1);
+  if (fields & MPIIO_OUT_PRP && nlocalpart > prop.size())
+    prop.resize(nlocalpart);
+  if (fields & MPIIO_OUT_STA && nlocalpart > state.size())
+    state.resize(nlocalpart);
 
   // Pack the necessary information
   // Esp. rescale the velocities.
@@ -179,31 +417,45 @@ void mpi_mpiio_common_write(const char *filename, unsigned fields)
   for (int c = 0; c < local_cells.n; ++c) {
     cell = local_cells.cell[c];
     for (int j = 0; j < cell->n; ++j) {
-      id[i1] = cell->part[j].p.identity;
+      Particle *p = &cell->part[j];
+      id[i1] = p->p.identity;
       if (fields & MPIIO_OUT_POS) {
-        pos[i3] = cell->part[j].r.p[0];
-        pos[i3 + 1] = cell->part[j].r.p[1];
-        pos[i3 + 2] = cell->part[j].r.p[2];
+        pos[i3] = p->r.p[0];
+        pos[i3 + 1] = p->r.p[1];
+        pos[i3 + 2] = p->r.p[2];
       }
       if (fields & MPIIO_OUT_VEL) {
-        vel[i3] = cell->part[j].m.v[0] / time_step;
-        vel[i3 + 1] = cell->part[j].m.v[1] / time_step;
-        vel[i3 + 2] = cell->part[j].m.v[2] / time_step;
+        vel[i3] = p->m.v[0] / time_step;
+        vel[i3 + 1] = p->m.v[1] / time_step;
+        vel[i3 + 2] = p->m.v[2] / time_step;
       }
       if (fields & MPIIO_OUT_TYP) {
-        type[i1] = cell->part[j].p.type;
+        type[i1] = p->p.type;
+      }
+      if (fields & MPIIO_OUT_PRP) {
+        prop[i1].p = p->p;
+#ifdef ENGINE
+        prop[i1].swim = p->swim;
+#endif
       }
-      if (fields & MPIIO_OUT_BND) {
-        boff[i1 + 1] = cell->part[j].bl.n;
+      if (fields & MPIIO_OUT_STA) {
+        MpiioState *s = &state[i1];
+        s->r = p->r;
+        s->m = p->m;
+        s->f = p->f;
+        for (int k = 0; k < 3; ++k) {
+          s->m.v[k] /= time_step;
+          s->f.f[k] *= p->p.mass / (0.5 * time_step * time_step);
+          s->i[k] = p->l.i[k];
+        }
       }
       i1++;
       i3 += 3;
     }
   }
 
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
   if (rank == 0)
-    dump_info(fnam + ".head", fields);
+    dump_info(fnam + ".head", fields & ~MPIIO_ASYNC);
   mpiio_dump_array<int>(fnam + ".pref", &pref, 1, rank, MPI_INT);
   mpiio_dump_array<int>(fnam + ".id", id.data(), nlocalpart, pref,
                         MPI_INT);
@@ -216,35 +468,48 @@ void mpi_mpiio_common_write(const char *filename, unsigned fields)
   if (fields & MPIIO_OUT_TYP)
     mpiio_dump_array<int>(fnam + ".type", type.data(), nlocalpart, pref,
                           MPI_INT);
+  if (fields & MPIIO_OUT_PRP) {
+    MPI_Datatype t = mpiio_record_type(sizeof(MpiioProperties));
+    mpiio_dump_array<MpiioProperties>(fnam + ".prop", prop.data(),
+                                      nlocalpart, pref, t);
+    MPI_Type_free(&t);
+  }
+  if (fields & MPIIO_OUT_STA) {
+    MPI_Datatype t = mpiio_record_type(sizeof(MpiioState));
+    mpiio_dump_array<MpiioState>(fnam + ".state", state.data(), nlocalpart,
+                                 pref, t);
+    MPI_Type_free(&t);
+  }
+  if (fields & MPIIO_OUT_BND)
+    mpiio_dump_lists(fnam + ".boff", fnam + ".bond", &Particle::bl,
+                     nlocalpart, pref, rank);
+#ifdef EXCLUSIONS
+  if (fields & MPIIO_OUT_EXC)
+    mpiio_dump_lists(fnam + ".eoff", fnam + ".excl", &Particle::el,
+                     nlocalpart, pref, rank);
+#endif
+
+  if (async_staging) {
+    // Blocks if the writer is still busy with the last but one frame.
+    if (!async_writer)
+      async_writer.reset(new AsyncWriter());
+    async_writer->write(std::move(async_frame));
+    async_frame.clear();
+    async_staging = false;
+  }
+  return ES_OK;
+}
 
-  if (fields & MPIIO_OUT_BND) {
-    // Convert the bond counts to bond prefixes
-    boff[0] = 0;
-    for (int i = 1; i <= nlocalpart; ++i)
-      boff[i] += boff[i - 1];
-    int numbonds = boff[nlocalpart];
-
-    // Realloc bond buffer if necessary
-    if (numbonds > bond.size())
-      bond.resize(numbonds);
-
-    // Pack the bond information
-    int i = 0;
-    for (int c = 0; c < local_cells.n; ++c) {
-      cell = local_cells.cell[c];
-      for (int j = 0; j < cell->n; ++j) {
-        for (int k = 0; k < cell->part[j].bl.n; ++k)
-          bond[i++] = cell->part[j].bl.e[k];
-      }
-    }
-
-    // Determine the prefixes in the bond file
-    MPI_Exscan(&numbonds, &bpref, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
-    mpiio_dump_array<int>(fnam + ".boff", boff.data(), nlocalpart + 1,
-                          pref + rank, MPI_INT);
-    mpiio_dump_array<int>(fnam + ".bond", bond.data(), numbonds, bpref,
-                          MPI_INT);
+void mpi_mpiio_common_flush()
+{
+  std::string err = async_writer ? async_writer->flush() : std::string();
+  if (!err.empty()) {
+    fprintf(stderr, "MPI-IO Error: Asynchronous output failed: %s\n",
+            err.c_str());
+    errexit();
   }
+  // All data has to be on disk before anybody reads it.
+  MPI_Barrier(MPI_COMM_WORLD);
 }
 
 
@@ -311,10 +576,14 @@ static void mpiio_read_array(std::string fn, T* arr, size_t len,
  * \param fn Filename of the head file
  * \param rank The rank of the current process in MPI_COMM_WORLD
  * \param file Pointer to store the fields to
+ * \param sizes Array of two ints to store the record sizes of 1.prop
+ *              and 1.state to (0 for files without this information)
  */
-static void read_head(std::string fn, int rank, unsigned *fields)
+static void read_head(std::string fn, int rank, unsigned *fields,
+                      int *sizes)
 {
   FILE *f;
+  int nbia;
   if (rank == 0) {
     if (!(f = fopen(fn.c_str(), "rb"))) {
       fprintf(stderr, "MPI-IO: Could not open %s.head.\n", fn.c_str());
@@ -324,43 +593,110 @@ static void read_head(std::string fn, int rank, unsigned *fields)
       fprintf(stderr, "MPI-IO: Read on %s.head failed.\n", fn.c_str());
       errexit();
     }
-    MPI_Bcast(fields, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
-  } else {
-    MPI_Bcast(fields, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    if (fread(&nbia, sizeof(int), 1, f) != 1
+        || fseek(f, nbia * sizeof(int), SEEK_CUR) != 0
+        || fread(sizes, sizeof(int), 2, f) != 2)
+      sizes[0] = sizes[1] = 0;
+    fclose(f);
   }
+  MPI_Bcast(fields, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+  MPI_Bcast(sizes, 2, MPI_INT, 0, MPI_COMM_WORLD);
 }
 
-/** Reads the pref file and fills pref and nlocalpart with their
- *  corresponding values. Needs to be called by all processes.
+/** Reads the integer lists written by \ref mpiio_dump_lists for the
+ *  particles [pref, pref + nlocalpart) of the global ordering. The files
+ *  may have been written by any number of processes. Needs to be called
+ *  by all processes.
  *
- * \param fn The file name of the prefs file
- * \param rank The rank of the current process in MPI_COMM_WORLD
- * \param size The size of MPI_COMM_WORLD
- * \param nglobalpart The global amount of particles
- * \param prefs Pointer to store the prefix to
- * \param nlocalpart Pointer to store the amount of local particles to
+ * \param fnoff File name of the offset file
+ * \param fndata File name of the data file
+ * \param list The list member of \ref Particle to fill
+ * \param wpref The particle prefixes of all writing processes, followed
+ *              by the global number of particles
+ * \param pref The first particle of this process
+ * \param nlocalpart The number of particles of this process
+ * \param parts The particles of this process
  */
-static void read_prefs(std::string fn, int rank, int size,
-                       int nglobalpart, int *pref, int *nlocalpart)
+static void mpiio_read_lists(std::string fnoff, std::string fndata,
+                             IntList Particle::*list,
+                             const std::vector<int> &wpref, int pref,
+                             int nlocalpart, std::vector<Particle> &parts)
 {
-  mpiio_read_array<int>(fn, pref, 1, rank, MPI_INT);
-  if (rank > 0)
-    MPI_Send(pref, 1, MPI_INT, rank - 1, 0, MPI_COMM_WORLD);
-  if (rank < size - 1)
-    MPI_Recv(nlocalpart, 1, MPI_INT, rank + 1, MPI_ANY_TAG,
-             MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-  else
-    *nlocalpart = nglobalpart;
-  *nlocalpart -= *pref;
+  int nproc = wpref.size() - 1;
+  int rank;
+  std::vector<int> wdpref(nproc + 1, 0);
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  // The last offset of every writer is its number of list entries.
+  // Accumulate them to the data prefixes of the writers.
+  if (rank == 0) {
+    FILE *f = fopen(fnoff.c_str(), "rb");
+    int success = (f != NULL);
+    for (int r = 0; success && r < nproc; ++r) {
+      success = (fseek(f, (long) (wpref[r + 1] + r) * sizeof(int),
+                       SEEK_SET) == 0)
+        && (fread(&wdpref[r + 1], sizeof(int), 1, f) == 1);
+      wdpref[r + 1] += wdpref[r];
+    }
+    if (f)
+      fclose(f);
+    if (!success) {
+      fprintf(stderr, "MPI-IO Error: Could not read file \"%s\".\n",
+              fnoff.c_str());
+      errexit();
+    }
+  }
+  MPI_Bcast(wdpref.data(), nproc + 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  // Writer of every local particle
+  std::vector<int> writer(nlocalpart);
+  for (int i = 0, r = 0; i < nlocalpart; ++i) {
+    while (wpref[r + 1] <= pref + i)
+      ++r;
+    writer[i] = r;
+  }
+
+  // The offsets of the local particles are contiguous in the file, as
+  // are their list entries.
+  int ofirst = 0, noff = 0;
+  if (nlocalpart > 0) {
+    ofirst = pref + writer[0];
+    noff = pref + nlocalpart + writer[nlocalpart - 1] + 1 - ofirst;
+  }
+  std::vector<int> off(noff);
+  mpiio_read_array<int>(fnoff, off.data(), noff, ofirst, MPI_INT);
+
+  int dfirst = 0, ndata = 0;
+  if (nlocalpart > 0) {
+    int last = nlocalpart - 1;
+    dfirst = wdpref[writer[0]] + off[0];
+    ndata = wdpref[writer[last]]
+      + off[pref + last + writer[last] + 1 - ofirst] - dfirst;
+  }
+  std::vector<int> data(ndata);
+  mpiio_read_array<int>(fndata, data.data(), ndata, dfirst, MPI_INT);
+
+  for (int i = 0; i < nlocalpart; ++i) {
+    int o = pref + i + writer[i] - ofirst;
+    int begin = wdpref[writer[i]] + off[o] - dfirst;
+    int len = off[o + 1] - off[o];
+    IntList *il = &(parts[i].*list);
+    realloc_intlist(il, len);
+    memcpy(il->e, &data[begin], len * sizeof(int));
+    il->n = len;
+  }
 }
 
 void mpi_mpiio_common_read(const char *filename, unsigned fields)
 {
   std::string fnam(filename);
   int size, rank;
-  int nproc, nglobalpart, pref, nlocalpart, nlocalbond, bpref;
+  int nproc, nglobalpart, pref, nlocalpart;
   unsigned avail_fields;
+  int sizes[2];
 
+  mpi_mpiio_common_flush();
   local_remove_all_particles();
 
   MPI_Comm_size(MPI_COMM_WORLD, &size);
@@ -368,34 +704,29 @@ void mpi_mpiio_common_read(const char *filename, unsigned fields)
   nproc = get_num_elem(fnam + ".pref", sizeof(int));
   nglobalpart = get_num_elem(fnam + ".id", sizeof(int));
 
-  if (rank == 0 && nproc != size) {
-    fprintf(stderr,
-            "MPI-IO Error: Trying to read a file with a different COMM size than at point of writing.\n");
-    errexit();
-  }
-
   // 1.head on master node:
   // Read head to determine fields at time of writing.
   // Compare this var to the current fields.
-  read_head(fnam + ".head", rank, &avail_fields);
+  read_head(fnam + ".head", rank, &avail_fields, sizes);
   if (rank == 0 && (fields & avail_fields) != fields) {
     fprintf(stderr, "MPI-IO Error: Requesting to read fields which were not dumped.\n");
     errexit();
   }
+  if (rank == 0
+      && (((fields & MPIIO_OUT_PRP) && sizes[0] != sizeof(MpiioProperties))
+          || ((fields & MPIIO_OUT_STA) && sizes[1] != sizeof(MpiioState)))) {
+    fprintf(stderr, "MPI-IO Error: The particle data was written with a different feature set.\n");
+    errexit();
+  }
 
   // 1.pref on all nodes:
-  // Read own prefix (1 int at prefix rank).
-  // Communicate own prefix to rank-1
-  // Determine nlocalpart (prefix of rank+1 - own prefix) on every node.
-  read_prefs(fnam + ".pref", rank, size, nglobalpart, &pref, &nlocalpart);
-
-  // Prepare ESPResSo data structures
-  local_particles = (Particle **) Utils::realloc(local_particles,
-                                                 sizeof(Particle *) * nglobalpart);
-  for (int i = 0; i < nglobalpart; ++i)
-    local_particles[i] = NULL;
-  n_part = nglobalpart;
-  max_seen_particle = nglobalpart;
+  // The particle prefixes of the writing processes. The particles are
+  // redistributed evenly, independent of the number of writers.
+  std::vector<int> wpref(nproc + 1);
+  mpiio_read_array<int>(fnam + ".pref", wpref.data(), nproc, 0, MPI_INT);
+  wpref[nproc] = nglobalpart;
+  pref = (long long) nglobalpart * rank / size;
+  nlocalpart = (long long) nglobalpart * (rank + 1) / size - pref;
 
   // 1.id on all nodes:
   // Read nlocalpart ints at defined prefix.
@@ -403,6 +734,36 @@ void mpi_mpiio_common_read(const char *filename, unsigned fields)
   mpiio_read_array<int>(fnam + ".id", id.data(), nlocalpart, pref,
                         MPI_INT);
 
+  // Prepare ESPResSo data structures
+  int max_id = -1, max_type = -1;
+  for (int i = 0; i < nlocalpart; ++i)
+    max_id = std::max(max_id, id[i]);
+  MPI_Allreduce(MPI_IN_PLACE, &max_id, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  added_particles(nglobalpart, max_id);
+
+  std::vector<Particle> parts(nlocalpart);
+  for (int i = 0; i < nlocalpart; ++i) {
+    init_particle(&parts[i]);
+    parts[i].p.identity = id[i];
+  }
+
+  if (fields & MPIIO_OUT_PRP) {
+    // 1.prop on all nodes:
+    // Read nlocalpart raw records at defined prefix.
+    std::vector<MpiioProperties> prop(nlocalpart);
+    MPI_Datatype t = mpiio_record_type(sizeof(MpiioProperties));
+    mpiio_read_array<MpiioProperties>(fnam + ".prop", prop.data(),
+                                      nlocalpart, pref, t);
+    MPI_Type_free(&t);
+
+    for (int i = 0; i < nlocalpart; ++i) {
+      parts[i].p = prop[i].p;
+#ifdef ENGINE
+      parts[i].swim = prop[i].swim;
+#endif
+    }
+  }
+
   if (fields & MPIIO_OUT_POS) {
     // 1.pos on all nodes:
     // Read nlocalpart * 3 doubles at defined prefix * 3
@@ -410,9 +771,9 @@ void mpi_mpiio_common_read(const char *filename, unsigned fields)
     mpiio_read_array<double>(fnam + ".pos", pos.data(), 3 * nlocalpart,
                              3 * pref, MPI_DOUBLE);
 
-    for (int i = 0; i < nlocalpart; ++i) {
-      local_place_particle(id[i], &pos[3 * i], 1);
-    }
+    for (int i = 0; i < nlocalpart; ++i)
+      for (int k = 0; k < 3; ++k)
+        parts[i].r.p[k] = pos[3 * i + k];
   }
 
   if (fields & MPIIO_OUT_TYP) {
@@ -423,7 +784,7 @@ void mpi_mpiio_common_read(const char *filename, unsigned fields)
                           MPI_INT);
 
     for (int i = 0; i < nlocalpart; ++i)
-      local_particles[id[i]]->p.type = type[i];
+      parts[i].p.type = type[i];
   }
 
   if (fields & MPIIO_OUT_VEL) {
@@ -435,39 +796,177 @@ void mpi_mpiio_common_read(const char *filename, unsigned fields)
 
     for (int i = 0; i < nlocalpart; ++i)
       for (int k = 0; k < 3; ++k)
-        local_particles[id[i]]->m.v[k] = vel[3*i+k] * time_step;
+        parts[i].m.v[k] = vel[3 * i + k] * time_step;
   }
 
-  if (fields & MPIIO_OUT_BND) {
-    // 1.boff
-    // nlocalpart + 1 ints per process
-    std::vector<int> boff(nlocalpart + 1);
-    mpiio_read_array<int>(fnam + ".boff", boff.data(), nlocalpart + 1,
-                          pref + rank, MPI_INT);
-
-    nlocalbond = boff[nlocalpart];
-    // Determine the bond prefixes
-    bpref = 0;
-    MPI_Exscan(&nlocalbond, &bpref, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
-
-    // 1.bond
-    // nlocalbonds ints per process
-    std::vector<int> bond(nlocalbond);
-    mpiio_read_array<int>(fnam + ".bond", bond.data(), nlocalbond, bpref,
-                          MPI_INT);
+  if (fields & MPIIO_OUT_STA) {
+    // 1.state on all nodes:
+    // Read nlocalpart raw records at defined prefix.
+    std::vector<MpiioState> state(nlocalpart);
+    MPI_Datatype t = mpiio_record_type(sizeof(MpiioState));
+    mpiio_read_array<MpiioState>(fnam + ".state", state.data(), nlocalpart,
+                                 pref, t);
+    MPI_Type_free(&t);
 
     for (int i = 0; i < nlocalpart; ++i) {
-      int blen = boff[i+1] - boff[i];
-      IntList *il = &local_particles[id[i]]->bl;
-      realloc_intlist(il, blen);
-      memcpy(il->e, &bond[boff[i]], blen * sizeof(int));
-      il->n = blen;
+      Particle *p = &parts[i];
+      p->r = state[i].r;
+      p->m = state[i].m;
+      p->f = state[i].f;
+      for (int k = 0; k < 3; ++k) {
+        p->m.v[k] *= time_step;
+        p->f.f[k] *= 0.5 * time_step * time_step / p->p.mass;
+        p->l.i[k] = state[i].i[k];
+      }
     }
   }
 
+  if (fields & MPIIO_OUT_BND)
+    mpiio_read_lists(fnam + ".boff", fnam + ".bond", &Particle::bl, wpref,
+                     pref, nlocalpart, parts);
+#ifdef EXCLUSIONS
+  if (fields & MPIIO_OUT_EXC)
+    mpiio_read_lists(fnam + ".eoff", fnam + ".excl", &Particle::el, wpref,
+                     pref, nlocalpart, parts);
+#endif
+
+  // The particle types have to exist on all nodes.
+  for (int i = 0; i < nlocalpart; ++i)
+    max_type = std::max(max_type, parts[i].p.type);
+  MPI_Allreduce(MPI_IN_PLACE, &max_type, 1, MPI_INT, MPI_MAX,
+                MPI_COMM_WORLD);
+  realloc_ia_params(max_type + 1);
+
+  // Hand the particles over to the cell system, which sends them to
+  // their nodes.
+  for (int i = 0; i < nlocalpart; ++i) {
+    fold_position(parts[i].r.p, parts[i].l.i);
+    memcpy(parts[i].l.p_old, parts[i].r.p, 3 * sizeof(double));
+    local_type_index_add(
+        append_indexed_particle(local_cells.cell[0], &parts[i]));
+  }
+  cells_resort_particles(CELL_GLOBAL_EXCHANGE);
+
   if (rank == 0)
     build_particle_node();
   rebuild_verletlist = 1;
   on_particle_change();
 }
 
+void mpiio_write_globals(const char *filename)
+{
+  std::string fn = std::string(filename) + ".glob";
+  std::string rng = Random::mpi_random_get_stat();
+  int success;
+  FILE *f = fopen(fn.c_str(), "wb");
+  if (!f) {
+    fprintf(stderr, "MPI-IO Error: Could not open %s for writing.\n",
+            fn.c_str());
+    errexit();
+  }
+
+  int nfields = sizeof(mpiio_global_fields) / sizeof(*mpiio_global_fields);
+  success = (fwrite(&n_nodes, sizeof(int), 1, f) == 1);
+  success = success && (fwrite(&nfields, sizeof(int), 1, f) == 1);
+  // Every field is stored as name, type, dimension and values.
+  for (int i = 0; i < nfields; ++i) {
+    const Datafield *d = &fields[mpiio_global_fields[i]];
+    int len = strlen(d->name);
+    int n = (d->type == TYPE_BOOL) ? 1 : d->dimension;
+    size_t sz = (d->type == TYPE_DOUBLE) ? sizeof(double) : sizeof(int);
+    success = success && (fwrite(&len, sizeof(int), 1, f) == 1)
+      && (fwrite(d->name, 1, len, f) == len)
+      && (fwrite(&d->type, sizeof(int), 1, f) == 1)
+      && (fwrite(&d->dimension, sizeof(int), 1, f) == 1)
+      && (fwrite(d->data, sz, n, f) == n);
+  }
+  int len = rng.size();
+  success = success && (fwrite(&len, sizeof(int), 1, f) == 1)
+    && (fwrite(rng.data(), 1, len, f) == len);
+  fclose(f);
+  if (!success) {
+    fprintf(stderr, "MPI-IO Error: Failed to write %s.\n", fn.c_str());
+    errexit();
+  }
+}
+
+void mpiio_read_globals(const char *filename)
+{
+  std::string fn = std::string(filename) + ".glob";
+  int nnodes, nfields, len, type, dim;
+  std::string name;
+  std::vector<char> buf;
+  FILE *f = fopen(fn.c_str(), "rb");
+  if (!f) {
+    fprintf(stderr, "MPI-IO Error: Could not open %s.\n", fn.c_str());
+    errexit();
+  }
+
+  int success = (fread(&nnodes, sizeof(int), 1, f) == 1)
+    && (fread(&nfields, sizeof(int), 1, f) == 1);
+  for (int i = 0; success && i < nfields; ++i) {
+    success = (fread(&len, sizeof(int), 1, f) == 1);
+    if (!success)
+      break;
+    name.resize(len);
+    success = (fread(&name[0], 1, len, f) == len)
+      && (fread(&type, sizeof(int), 1, f) == 1)
+      && (fread(&dim, sizeof(int), 1, f) == 1);
+    if (!success)
+      break;
+    int n = (type == TYPE_BOOL) ? 1 : dim;
+    size_t sz = (type == TYPE_DOUBLE) ? sizeof(double) : sizeof(int);
+    buf.resize(n * sz);
+    success = (fread(buf.data(), sz, n, f) == n);
+
+    // Look up the field by name, the indices depend on the build.
+    int j;
+    for (j = 0; fields[j].name; ++j)
+      if (name == fields[j].name)
+        break;
+    if (!fields[j].name || fields[j].type != type
+        || fields[j].dimension != dim) {
+      fprintf(stderr, "MPI-IO Warning: Ignoring incompatible global parameter %s.\n",
+              name.c_str());
+      continue;
+    }
+    if (j == FIELD_TIMESTEP) {
+      mpi_set_time_step(*(double *) buf.data());
+    } else {
+      memcpy(fields[j].data, buf.data(), n * sz);
+      mpi_bcast_parameter(j);
+    }
+  }
+
+  std::string rng;
+  success = success && (fread(&len, sizeof(int), 1, f) == 1);
+  if (success) {
+    rng.resize(len);
+    success = (fread(&rng[0], 1, len, f) == len);
+  }
+  fclose(f);
+  if (!success) {
+    fprintf(stderr, "MPI-IO Error: Read on %s failed.\n", fn.c_str());
+    errexit();
+  }
+
+  // The generator states are per node and can only be restored on the
+  // same number of nodes.
+  if (nnodes != n_nodes) {
+    fprintf(stderr, "MPI-IO Warning: %s was written on %d nodes, not restoring the random number generator states.\n",
+            fn.c_str(), nnodes);
+    return;
+  }
+  std::vector<std::string> states(n_nodes);
+  std::istringstream iss(rng);
+  int state_size = Random::get_state_size_of_generator() + 1;
+  for (int node = 0; node < n_nodes; ++node) {
+    std::string tmp;
+    for (int i = 0; i < state_size && iss >> tmp; ++i) {
+      if (i > 0)
+        states[node].append(" ");
+      states[node].append(tmp);
+    }
+  }
+  Random::mpi_random_set_stat(states);
+}
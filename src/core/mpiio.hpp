@@ -34,15 +34,30 @@ enum MPIIOOutputFields {
   MPIIO_OUT_VEL = 2,
   MPIIO_OUT_TYP = 4,
   MPIIO_OUT_BND = 8,
+  /** All particle properties (charge, mass, ...) as raw records. */
+  MPIIO_OUT_PRP = 16,
+  /** Position with image box, orientation, velocities and forces. */
+  MPIIO_OUT_STA = 32,
+  /** Exclusions, written only with EXCLUSIONS. */
+  MPIIO_OUT_EXC = 64,
+  /** Global parameters and random number generator states. */
+  MPIIO_OUT_GLB = 128,
+  MPIIO_OUT_ALL = 255,
+  /** Not a field: stage the data and write it in the background. */
+  MPIIO_ASYNC = 256,
 };
 
 /** Parallel binary output using MPI-IO. To be called by all MPI
- * processes. Aborts ESPResSo if an error occurs.
+ * processes. Aborts ESPResSo if an error occurs, except if the files of
+ * an asynchronous output cannot be created.
  *
  * \param filename A null-terminated filename prefix.
  * \param fields Output specifier which fields to dump.
+ * \return ES_OK, or ES_ERROR on all processes with a runtime error on
+ *         the master if the files of an asynchronous output exist or are
+ *         still being written
  */
-void mpi_mpiio_common_write(const char *filename, unsigned fields);
+int mpi_mpiio_common_write(const char *filename, unsigned fields);
 
 /** Parallel binary input using MPI-IO. To be called by all MPI
  * processes. Aborts ESPResSo if an error occurs.
@@ -52,4 +67,25 @@ void mpi_mpiio_common_write(const char *filename, unsigned fields);
  */
 void mpi_mpiio_common_read(const char *filename, unsigned fields);
 
+/** Wait until the asynchronous output of all processes is on disk. To
+ * be called by all MPI processes. Aborts ESPResSo if a write failed.
+ */
+void mpi_mpiio_common_flush();
+
+/** Write the restorable global parameters and the random number
+ * generator states of all nodes to filename.glob. To be called by the
+ * master node only, outside of the collective output.
+ *
+ * \param filename A null-terminated filename prefix.
+ */
+void mpiio_write_globals(const char *filename);
+
+/** Restore the global parameters and, if the number of nodes did not
+ * change, the random number generator states from filename.glob. To be
+ * called by the master node only, before the particles are read.
+ *
+ * \param filename A null-terminated filename prefix.
+ */
+void mpiio_read_globals(const char *filename);
+
 #endif
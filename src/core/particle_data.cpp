@@ -31,6 +31,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <map>
 #include <mpi.h>
 #include "utils.hpp"
 #include "particle_data.hpp"
@@ -56,22 +59,18 @@
 /************************************************
  * variables
  ************************************************/
-// List of particles for grandcanonical simulations
-TypeOfIndex Type; 
-IndexOfType Index; 
-TypeList *type_array;
-int number_of_type_lists;
+// flags for grandcanonical simulations
 int GC_init;
 int Type_array_init;
 
 int max_seen_particle = -1;
 int n_part = 0;
-int max_particle_node = 0;
-int *particle_node = NULL;
-int max_local_particles = 0;
-Particle **local_particles = NULL;
+Utils::IdIndex<int> particle_node(-1);
+bool particle_node_valid = false;
+Utils::IdIndex<Particle *> local_particles(NULL);
 Particle *partCfg = NULL;
 int partCfgSorted = 0;
+int partCfgVersion = 0;
 
 /** bondlist for partCfg, if bonds are needed */
 IntList partCfg_bl = { NULL, 0, 0 };
@@ -89,6 +88,12 @@ void try_delete_exclusion(Particle *part, int part2);
 /** Insert an exclusion if not already set */
 void try_add_exclusion(Particle *part, int part2);
 
+/** Remove a particle whose node is already known */
+static int remove_particle_from_node(int part, int pnode);
+
+/** Remove all local particles from the type index */
+static void local_type_index_clear();
+
 /** Automatically add the next \<distance\> neighbors in each molecule to the exclusion list.
     This uses the bond topology obtained directly from the particles, since only this contains
     the full topology, in contrast to \ref topology::topology. To easily setup the bonds, all data
@@ -394,50 +399,23 @@ int sortPartCfg()
 
 void freePartCfg()
 {
+  partCfgVersion++;
   free(partCfg);
   partCfg = NULL;
   realloc_intlist(&partCfg_bl, 0);
 }
 
-/** resize \ref local_particles.
-    \param part the highest existing particle
-*/
-void realloc_local_particles(int part)
-{
-  if (part >= max_local_particles) {
-    /* round up part + 1 in granularity PART_INCREMENT */
-    max_local_particles = PART_INCREMENT*((part + PART_INCREMENT)/PART_INCREMENT);
-    local_particles = (Particle **)Utils::realloc(local_particles, sizeof(Particle *)*max_local_particles);
-  }
-}
-
-/** resize \ref particle_node.
-    This procedure is only used on the master node in Tcl mode.
-    \param part the highest existing particle
-*/
-static void realloc_particle_node(int part)
-{
-  if (part >= max_particle_node) {
-    /* round up part + 1 in granularity PART_INCREMENT */
-    max_particle_node = PART_INCREMENT*((part + PART_INCREMENT)/PART_INCREMENT);
-    particle_node = (int *)Utils::realloc(particle_node, sizeof(int)*max_particle_node);
-  }
-}
-
 void particle_invalidate_part_node()
 {
   /* invalidate particle->node data */
-  if (particle_node) {
-    free(particle_node);
-    particle_node = NULL;
-    max_particle_node = 0;
-  }
+  particle_node.clear();
+  particle_node_valid = false;
 }
 
 void build_particle_node()
 {
-  realloc_particle_node(max_seen_particle);
   mpi_who_has();
+  particle_node_valid = true;
 }
 
 void init_particlelist(ParticleList *pList)
@@ -568,7 +546,7 @@ Particle *move_indexed_particle(ParticleList *dl, ParticleList *sl, int i)
 int get_particle_data(int part, Particle *data)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -583,13 +561,12 @@ int get_particle_data(int part, Particle *data)
 
 int place_particle(int part, double p[3])
 {
-  int i;
   int pnode, retcode = ES_PART_OK;
 
   if (part < 0)
     return ES_PART_ERROR;
 
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   pnode = (part <= max_seen_particle) ? particle_node[part] : -1;
@@ -598,13 +575,8 @@ int place_particle(int part, double p[3])
     pnode = cell_structure.position_to_node(p);
 
     /* master node specific stuff */
-    realloc_particle_node(part);
     particle_node[part] = pnode;
 
-    /* fill up possible gap */
-    for (i = max_seen_particle + 1; i < part; i++)
-      particle_node[i] = -1;
-
     retcode = ES_PART_CREATED;
 
     mpi_place_new_particle(pnode, part, p);
@@ -616,10 +588,91 @@ int place_particle(int part, double p[3])
   return retcode;
 }
 
+int place_particles(int n, const int *ids, const double *pos,
+                    const int *type, const double *v, const double *q)
+{
+  int i, k, pnode, max_part = -1, max_type = -1, n_new = 0;
+
+  if (n <= 0)
+    return ES_PART_OK;
+
+  if (!particle_node_valid)
+    build_particle_node();
+
+  /* check the ids */
+  for (i = 0; i < n; i++) {
+    if (ids[i] < 0)
+      return ES_PART_ERROR;
+    if (ids[i] > max_part)
+      max_part = ids[i];
+  }
+  std::vector<int> sorted_ids(ids, ids + n);
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+  if (std::adjacent_find(sorted_ids.begin(), sorted_ids.end()) !=
+      sorted_ids.end())
+    return ES_PART_ERROR;
+
+  if (type) {
+    for (i = 0; i < n; i++)
+      if (type[i] > max_type)
+        max_type = type[i];
+    make_particle_type_exist(max_type);
+  }
+
+  /* master node specific stuff: assign the new particles to nodes by
+     their spatial position, existing ones stay where they are */
+  std::vector<int> dest(n);
+  std::vector<char> is_new(n, 0);
+  std::vector<int> counts(n_nodes, 0);
+  for (i = 0; i < n; i++) {
+    pnode = particle_node[ids[i]];
+    if (pnode == -1) {
+      double pp[3] = {pos[3*i], pos[3*i + 1], pos[3*i + 2]};
+      pnode = cell_structure.position_to_node(pp);
+      particle_node[ids[i]] = pnode;
+      is_new[i] = 1;
+      n_new++;
+    }
+    dest[i] = pnode;
+    counts[pnode]++;
+  }
+
+  /* sort the particles by destination node */
+  std::vector<int> offset(n_nodes, 0);
+  for (k = 1; k < n_nodes; k++)
+    offset[k] = offset[k - 1] + counts[k - 1];
+
+  std::vector<BulkParticle> parts(n);
+  for (i = 0; i < n; i++) {
+    BulkParticle *bp = &parts[offset[dest[i]]++];
+    bp->identity = ids[i];
+    bp->is_new = is_new[i];
+    bp->type = type ? type[i] : 0;
+    for (k = 0; k < 3; k++) {
+      bp->p[k] = pos[3*i + k];
+      bp->v[k] = v ? v[3*i + k] : 0.0;
+    }
+    bp->q = q ? q[i] : 0.0;
+  }
+
+  mpi_place_particles(parts.data(), counts.data(),
+                      (type ? PART_BULK_TYPE : 0) | (v ? PART_BULK_V : 0) |
+                      (q ? PART_BULK_Q : 0),
+                      n_new, max_part);
+
+  return ES_PART_OK;
+}
+
+void get_particle_arrays(int fields, int *id, double *pos, double *v,
+                         double *f, int *type, double *q)
+{
+  mpi_get_particle_arrays(fields, id, pos, v, f, type, q);
+}
+
 int set_particle_v(int part, double v[3])
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -636,7 +689,7 @@ int set_particle_v(int part, double v[3])
 int set_particle_swimming(int part, ParticleParametersSwimming swim)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -653,7 +706,7 @@ int set_particle_swimming(int part, ParticleParametersSwimming swim)
 int set_particle_f(int part, double F[3])
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -670,7 +723,7 @@ int set_particle_f(int part, double F[3])
 int set_particle_solvation(int part, double * solvation)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -690,7 +743,7 @@ int set_particle_solvation(int part, double * solvation)
 int set_particle_mass(int part, double mass)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -708,7 +761,7 @@ int set_particle_mass(int part, double mass)
 int set_particle_rotational_inertia(int part, double rinertia[3])
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -727,7 +780,7 @@ int set_particle_rotational_inertia(int part, double rinertia[3])
 int set_particle_rotation(int part, int rot)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -745,7 +798,7 @@ int set_particle_rotation(int part, int rot)
 int set_particle_affinity(int part, double bond_site[3])
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -763,7 +816,7 @@ int set_particle_affinity(int part, double bond_site[3])
 int set_particle_out_direction(int part, double out_direction[3])
 {
     int pnode;
-    if (!particle_node)
+    if (!particle_node_valid)
         build_particle_node();
     
     if (part < 0 || part > max_seen_particle)
@@ -781,7 +834,7 @@ int set_particle_out_direction(int part, double out_direction[3])
 int set_particle_dipm(int part, double dipm)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -798,7 +851,7 @@ int set_particle_dip(int part, double dip[3])
 {
   int pnode;
   
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -818,7 +871,7 @@ int set_particle_dip(int part, double dip[3])
 int set_particle_virtual(int part, int isVirtual)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -837,7 +890,7 @@ int set_particle_vs_relative(int part, int vs_relative_to, double vs_distance, d
 {
   // Find out, on what node the particle is
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -857,7 +910,7 @@ int set_particle_vs_relative(int part, int vs_relative_to, double vs_distance, d
 int set_particle_smaller_timestep(int part, int smaller_timestep)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -875,7 +928,7 @@ int set_particle_smaller_timestep(int part, int smaller_timestep)
 int set_particle_configtemp(int part, int configtemp)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -892,7 +945,7 @@ int set_particle_configtemp(int part, int configtemp)
 int set_particle_q(int part, double q)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -909,7 +962,7 @@ int set_particle_q(int part, double q)
 int set_particle_mu_E(int part, double mu_E[3])
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -929,7 +982,7 @@ int set_particle_type(int part, int type)
   int pnode;
   make_particle_type_exist(type);
 
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -939,26 +992,6 @@ int set_particle_type(int part, int type)
   if (pnode == -1)
     return ES_ERROR;
 
-  if ( Type_array_init ) {
-	// check if the particle exists already and the type is changed, then remove it from the list which contains it
-	  Particle *cur_par = (Particle *) Utils::malloc( sizeof(Particle) );
-	  if ( cur_par != (Particle *) 0 ) {
-		  if ( get_particle_data(part, cur_par) != ES_ERROR ) {
-			  int prev_type = cur_par->p.type;
-			  if ( prev_type != type ) {
-			  // particle existed before so delete it from the list
-			  remove_id_type_array(part, prev_type);
-			  }
-		  }
-	  }
-	  free(cur_par);
-
-	  if ( add_particle_to_list(part, type) ==  ES_ERROR ){
-		  //Tcl_AppendResult(interp, "gc particle add failed", (char *) NULL);
-		  return ES_ERROR;
-	  }
-  }
-
   mpi_send_type(pnode, part, type);
 
   return ES_OK;
@@ -968,7 +1001,7 @@ int set_particle_mol_id(int part, int mid)
 {
   int pnode;
 
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -985,7 +1018,7 @@ int set_particle_mol_id(int part, int mid)
 int set_particle_quat(int part, double quat[4])
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1001,7 +1034,7 @@ int set_particle_quat(int part, double quat[4])
 int set_particle_omega_lab(int part, double omega_lab[3])
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1035,7 +1068,7 @@ int set_particle_omega_body(int part, double omega[3])
      are already in the proper frame */
 
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1051,7 +1084,7 @@ int set_particle_omega_body(int part, double omega[3])
 int set_particle_torque_lab(int part, double torque_lab[3])
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1085,7 +1118,7 @@ int set_particle_torque_body(int part, double torque[3])
      are already in the proper frame */
 
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1104,7 +1137,7 @@ int set_particle_torque_body(int part, double torque[3])
 int set_particle_temperature(int part, double T)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1123,7 +1156,7 @@ int set_particle_gamma(int part, double gamma)
 {
   int pnode;
   
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1146,7 +1179,7 @@ int set_particle_gamma_rot(int part, double gamma_rot[3])
 {
   int pnode;
 
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1168,7 +1201,7 @@ int set_particle_gamma_rot(int part, double gamma_rot[3])
     int set_particle_ext_torque(int part, int flag, double torque[3])
     {
       int pnode;
-      if (!particle_node)
+      if (!particle_node_valid)
         build_particle_node();
 
       if (part < 0 || part > max_seen_particle)
@@ -1186,7 +1219,7 @@ int set_particle_gamma_rot(int part, double gamma_rot[3])
 int set_particle_ext_force(int part, int flag, double force[3])
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1203,7 +1236,7 @@ int set_particle_ext_force(int part, int flag, double force[3])
 int set_particle_fix(int part,  int flag)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1221,7 +1254,7 @@ int set_particle_fix(int part,  int flag)
 int change_particle_bond(int part, int *bond, int _delete)
 {
   int pnode;
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part < 0 || part > max_seen_particle)
@@ -1245,38 +1278,47 @@ int change_particle_bond(int part, int *bond, int _delete)
 void remove_all_particles()
 {
   mpi_remove_particle(-1, -1);
-  realloc_particle_node(0);
+  particle_node.clear();
 }
 
 int remove_particle(int part)
 {
   int pnode;
 
-  Particle *cur_par = (Particle *) Utils::malloc (sizeof(Particle));
-  if (get_particle_data(part, cur_par) == ES_ERROR )
-	  return ES_ERROR;
-  int type = cur_par->p.type;
-  free(cur_par);
-  if (remove_id_type_array(part, type) == ES_ERROR )
-	  return ES_ERROR;
-
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
-  if (part > max_seen_particle)
+  if (part < 0 || part > max_seen_particle)
     return ES_ERROR;
 
   pnode = particle_node[part];
   if (pnode == -1)
     return ES_ERROR;
 
+  return remove_particle_from_node(part, pnode);
+}
+
+static int remove_particle_from_node(int part, int pnode)
+{
   particle_node[part] = -1;
 
   mpi_remove_particle(pnode, part);
 
   if (part == max_seen_particle) {
-    while (max_seen_particle >= 0 && particle_node[max_seen_particle] == -1)
-      max_seen_particle--;
+    if (!particle_node_valid)
+      build_particle_node();
+    /* step down over small gaps, scan for sparse ids */
+    int max_part = max_seen_particle;
+    while (max_part >= 0 && max_part > max_seen_particle - 64 &&
+           particle_node[max_part] == -1)
+      max_part--;
+    if (max_part >= 0 && particle_node[max_part] == -1) {
+      max_part = -1;
+      particle_node.for_each([&max_part](int id, int) {
+          max_part = std::max(max_part, id);
+        });
+    }
+    max_seen_particle = max_part;
     mpi_bcast_parameter(FIELD_MAXPART);
   }
   return ES_OK;
@@ -1305,6 +1347,7 @@ void local_remove_particle(int part)
     errexit();
   }
 
+  local_type_index_remove(p);
   free_particle(p);
 
   /* remove local_particles entry */
@@ -1354,6 +1397,7 @@ void local_place_particle(int part, double p[3], int _new)
       update_local_particles(cell);
     else
       local_particles[pt->p.identity] = pt;
+    local_type_index_add(pt);
   }
   else
     pt = local_particles[part];
@@ -1374,12 +1418,41 @@ void local_place_particle(int part, double p[3], int _new)
 #endif
 }
 
+void local_place_particles(const BulkParticle *parts, int n, int fields)
+{
+  for (int i = 0; i < n; i++) {
+    const BulkParticle *bp = &parts[i];
+    double pp[3] = {bp->p[0], bp->p[1], bp->p[2]};
+    local_place_particle(bp->identity, pp, bp->is_new);
+
+    Particle *p = local_particles[bp->identity];
+    if (fields & PART_BULK_TYPE)
+      local_set_particle_type(p, bp->type);
+    if (fields & PART_BULK_V) {
+      memmove(p->m.v, bp->v, 3*sizeof(double));
+#ifdef MULTI_TIMESTEP
+      if (smaller_time_step > 0. && p->p.smaller_timestep) {
+        p->m.v[0] *= smaller_time_step / time_step;
+        p->m.v[1] *= smaller_time_step / time_step;
+        p->m.v[2] *= smaller_time_step / time_step;
+      }
+#endif
+    }
+#ifdef ELECTROSTATICS
+    if (fields & PART_BULK_Q)
+      p->p.q = bp->q;
+#endif
+  }
+}
+
 void local_remove_all_particles()
 {
   Cell *cell;
   int c;
   n_part = 0;
   max_seen_particle = -1;
+  local_particles.clear();
+  local_type_index_clear();
   for (c = 0; c < local_cells.n; c++) {
     Particle *p;
     int i,   np;
@@ -1416,17 +1489,18 @@ void local_rescale_particles(int dir, double scale) {
 
 void added_particle(int part)
 {
-  int i;
-
   n_part++;
 
-  if (part > max_seen_particle) {
-    realloc_local_particles(part);
-    /* fill up possible gap. Part itself is ESSENTIAL!!!  */
-    for (i = max_seen_particle + 1; i <= part; i++)
-      local_particles[i] = NULL;
+  if (part > max_seen_particle)
     max_seen_particle = part;
-  }
+}
+
+void added_particles(int n_new, int max_part)
+{
+  n_part += n_new;
+
+  if (max_part > max_seen_particle)
+    max_seen_particle = max_part;
 }
 
 int local_change_bond(int part, int *bond, int _delete)
@@ -1630,6 +1704,7 @@ void send_particles(ParticleList *particles, int node)
 
   /* remove particles from this nodes local list and free data */
   for (pc = 0; pc < particles->n; pc++) {
+    local_type_index_remove(&particles->part[pc]);
     local_particles[particles->part[pc].p.identity] = NULL;
     free_particle(&particles->part[pc]);
   }
@@ -1672,6 +1747,8 @@ void recv_particles(ParticleList *particles, int node)
   }
 
   update_local_particles(particles);
+  for (pc = particles->n - transfer; pc < particles->n; pc++)
+    local_type_index_add(&particles->part[pc]);
 
   PART_TRACE(fprintf(stderr, "%d: recv_particles expecting %d bond ints\n", this_node, local_dyn.n));
   if (local_dyn.n > 0) {
@@ -1719,7 +1796,7 @@ void add_partner(IntList *il, int i, int j, int distance)
 
 int change_exclusion(int part1, int part2, int _delete)
 {
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   if (part1 < 0 || part1 > max_seen_particle ||
@@ -1744,18 +1821,25 @@ void auto_exclusion(int distance)
   int count, p, i, j, p1, p2, p3, dist1, dist2;
   Bonded_ia_parameters *ia_params;
   Particle *part1;
+  IntList *partners1, *partners2;
   /* partners is a list containing the currently found excluded particles for each particle,
-     and their distance, as a interleaved list */
-  IntList *partners;
+     and their distance, as a interleaved list. Since the identities may be sparse, the
+     lists are stored in the order of their creation and found via the index. */
+  std::vector<IntList> partners;
+  Utils::IdIndex<int> index(-1);
+  auto partners_of = [&](int id) {
+    int k = index.find(id);
+    if (k == -1) {
+      k = partners.size();
+      index.set(id, k);
+      partners.emplace_back();
+      init_intlist(&partners.back());
+    }
+    return &partners[k];
+  };
 
   updatePartCfg(WITH_BONDS);
 
-  /* setup bond partners and distance list. Since we need to identify particles via their identity,
-     we use a full sized array */
-  partners    = (IntList*)Utils::malloc((max_seen_particle + 1)*sizeof(IntList));
-  for (p = 0; p <= max_seen_particle; p++)
-    init_intlist(&partners[p]);
-
   /* determine initial connectivity */
   for (p = 0; p < n_part; p++) {
     part1 = &partCfg[p];
@@ -1766,8 +1850,8 @@ void auto_exclusion(int distance)
 	p2 = part1->bl.e[i++];
 	/* you never know what the user does, may bond a particle to itself...? */
 	if (p2 != p1) {
-	  add_partner(&partners[p1], p1, p2, 1);
-	  add_partner(&partners[p2], p2, p1, 1);
+	  add_partner(partners_of(p1), p1, p2, 1);
+	  add_partner(partners_of(p2), p2, p1, 1);
 	}
       }
       else
@@ -1775,22 +1859,29 @@ void auto_exclusion(int distance)
     }
   }
 
+  /* All particles with partners have a list now, so that the lists do
+     not move anymore. Visit them in the order of their identities. */
+  std::vector<int> ids = index.ids();
+
   /* calculate transient connectivity. For each of the current neighbors,
      also exclude their close enough neighbors.
   */
   for (count = 1; count < distance; count++) {
-    for (p1 = 0; p1 <= max_seen_particle; p1++) {
-      for (i = 0; i < partners[p1].n; i += 2) {
-	p2 = partners[p1].e[i];
-	dist1 = partners[p1].e[i + 1];
+    for (p = 0; p < (int) ids.size(); p++) {
+      p1 = ids[p];
+      partners1 = partners_of(p1);
+      for (i = 0; i < partners1->n; i += 2) {
+	p2 = partners1->e[i];
+	dist1 = partners1->e[i + 1];
 	if (dist1 > distance) continue;
 	/* loop over all partners of the partner */
-	for (j = 0; j < partners[p2].n; j += 2) {
-	  p3 = partners[p2].e[j];
-	  dist2 = dist1 + partners[p2].e[j + 1];
+	partners2 = partners_of(p2);
+	for (j = 0; j < partners2->n; j += 2) {
+	  p3 = partners2->e[j];
+	  dist2 = dist1 + partners2->e[j + 1];
 	  if (dist2 > distance) continue;
-	  add_partner(&partners[p1], p1, p3, dist2);
-	  add_partner(&partners[p3], p3, p1, dist2);
+	  add_partner(partners1, p1, p3, dist2);
+	  add_partner(partners_of(p3), p3, p1, dist2);
 	}
       }
     }
@@ -1802,341 +1893,211 @@ void auto_exclusion(int distance)
      is only done once and the overhead is as much as for setting the bonds, which
      the user apparently accepted.
   */
-  for (p = 0; p <= max_seen_particle; p++) {
-    for (j = 0; j < partners[p].n; j++)
-      if (p < partners[p].e[j]) change_exclusion(p, partners[p].e[j], 0);
-    realloc_intlist(&partners[p], 0);
+  for (p = 0; p < (int) ids.size(); p++) {
+    p1 = ids[p];
+    partners1 = partners_of(p1);
+    for (j = 0; j < partners1->n; j++)
+      if (p1 < partners1->e[j]) change_exclusion(p1, partners1->e[j], 0);
+    realloc_intlist(partners1, 0);
   }
-  free(partners);
 }
 
 #endif
 
 
-int init_gc(void){
-	if ( type_array == (TypeList *) NULL) {
-	//stores the number of currently available type_list's 
-	number_of_type_lists=10;
-
-	Type.max_entry = 0;
-	Index.max_entry = 0;
+/************************************************
+ * distributed type index
+ ************************************************/
 
-	type_array = (TypeList *) Utils::malloc(sizeof(TypeList) * number_of_type_lists);
-	if ( type_array == (TypeList *) 0 )
-		return ES_ERROR;
+/* The ids of the local particles of the indexed types, and the position
+   of each indexed particle in the list of its type. */
+static std::map<int, std::vector<int>> local_type_ids;
+static Utils::IdIndex<int> local_type_pos(-1);
 
-	GC_init = 1;
-	Type_array_init = 0;
-	}
-	return ES_OK;
+void local_type_index_add(Particle *p)
+{
+  auto it = local_type_ids.find(p->p.type);
+  if (it == local_type_ids.end() || local_type_pos[p->p.identity] != -1)
+    return;
+  local_type_pos[p->p.identity] = it->second.size();
+  it->second.push_back(p->p.identity);
 }
 
-int init_type_array(int type){
-	if (init_gc() == ES_ERROR)
-		return ES_ERROR;
-
-
-for ( int i = 0; i<Index.max_entry; i++ )
-	if (type == Type.index[i]) {
-		// already indexed
-		return ES_OK;
-	}
-
-	updatePartCfg(WITHOUT_BONDS);
-
-	if (!partCfg)
-		return ES_ERROR;
-
-	int type_index=-1;
-	type_index= (Type.max_entry++);
-	if ( type_index == number_of_type_lists ) {
-		reallocate_global_type_list(number_of_type_lists*2);
-	}
-
-	Type.index = (int *) Utils::realloc ( (void *) Type.index, sizeof(int)*Type.max_entry);
-
-	//reallocate the array that holds the particle type and points to the type index used for the type_list
-	
-	if ( type >= Index.max_entry ) { 
-		Index.type= (int * ) Utils::realloc( (void *) Index.type, (type+1)*sizeof(int));
-		Index.max_entry = type + 1;
-	}
-	for (int i=0; i<Type.max_entry; i++) 
-		Index.type[i]=-1;
+void local_type_index_remove(Particle *p)
+{
+  auto it = local_type_ids.find(p->p.type);
+  if (it == local_type_ids.end())
+    return;
+  std::vector<int> &ids = it->second;
+  int id = p->p.identity;
+  int pos = local_type_pos[id];
+  if (pos == -1 || pos >= (int)ids.size() || ids[pos] != id)
+    return;
+  /* fill the gap with the last entry */
+  ids[pos] = ids.back();
+  local_type_pos[ids[pos]] = pos;
+  ids.pop_back();
+  local_type_pos[id] = -1;
+}
 
-	if (Type.index == (int *) 0 || Index.type == (int *) 0)
-		return ES_ERROR;
+void local_set_particle_type(Particle *p, int type)
+{
+#ifdef GHOST_FLAG
+  /* collision detection can change the type of a ghost, which is not in
+     the type index */
+  if (p->l.ghost) {
+    p->p.type = type;
+    return;
+  }
+#endif
+  local_type_index_remove(p);
+  p->p.type = type;
+  local_type_index_add(p);
+}
 
-	//allocates a list for ids for as many entries as there are particles right now
-	if ( !(partCfg) ||  type < 0 ) { 
-		return ES_ERROR;
-	}
-	Type.index[type_index]=type;
-	//fill in array type_index_of_type
-	for (int i=0; i<Type.max_entry; i++ ) {
-		Index.type[Type.index[i]] = i;
-	}
+void local_type_index_init(int type)
+{
+  if (local_type_ids.count(type))
+    return;
+  local_type_ids[type];
+  for (int c = 0; c < local_cells.n; c++) {
+    Cell *cell = local_cells.cell[c];
+    for (int i = 0; i < cell->n; i++)
+      if (cell->part[i].p.type == type)
+        local_type_index_add(&cell->part[i]);
+  }
+}
 
-	int t_c = 0; //index
-	type_array[Index.type[type]].id_list = (int *) Utils::malloc (sizeof (int) * n_part);
-	for (int i=0; i<n_part; i++) {
-		if ( partCfg[i].p.type==type ) 
-			type_array[Index.type[type]].id_list[t_c++]=partCfg[i].p.identity;
-	}
-	int max_size=n_part;
-	if ( t_c != 0 ) { 
-		while ( t_c < (double) max_size/4.0) { 
-			max_size= floor( (double ) max_size/2.0);
-		}
-		// now the array is shrinked to at least 4 times the highest entry
-		type_array[Index.type[type]].id_list= (int *) Utils::realloc( (void *) type_array[Index.type[type]].id_list, sizeof(int)*2*max_size);
-		type_array[Index.type[type]].max_entry = t_c;
-		type_array[Index.type[type]].cur_size = max_size*2;
-	} else {
-		//no particles of the given type were found, so leave array size fixed at a reasonable start entry 64 ints in this case
-		type_array[Index.type[type]].id_list= (int *) Utils::realloc( (void *) type_array[Index.type[type]].id_list, sizeof(int)*64);
-		type_array[Index.type[type]].max_entry = t_c;
-		type_array[Index.type[type]].cur_size = 64;
-	}
-	//fill remaining entries with -1
-	for (int i=type_array[Index.type[type]].max_entry; i<type_array[Index.type[type]].cur_size; i++) {
-		type_array[Index.type[type]].id_list[i] = -1;
-	}
-	Type_array_init = 1;
-	return ES_OK;
+static void local_type_index_clear()
+{
+  for (auto &t : local_type_ids)
+    t.second.clear();
+  local_type_pos.clear();
 }
 
-int reallocate_type_array(int type){
-	type_array[Index.type[type]].id_list = (int *) Utils::realloc ( (void *) type_array[Index.type[type]].id_list, sizeof (int) * type_array[Index.type[type]].cur_size * 2);	
-	if (type_array[Index.type[type]].id_list == (int *) 0) {
-		return ES_ERROR;
-	}
-	type_array[Index.type[type]].cur_size = type_array[Index.type[type]].cur_size*2;
-	return ES_OK;
+int local_type_index_count(int type)
+{
+  auto it = local_type_ids.find(type);
+  return (it == local_type_ids.end()) ? 0 : it->second.size();
 }
 
-int remove_id_type_array(int part_id, int type){
+int local_type_index_id(int type, int k)
+{
+  auto it = local_type_ids.find(type);
+  if (it == local_type_ids.end() || k < 0 || k >= (int)it->second.size())
+    return -1;
+  return it->second[k];
+}
 
-	int l_err = 1;
-	for ( int j = 0; j<Type.max_entry; j++){
-		if ( Type.index[j] == type ) {
-			l_err = 0;
-			break;
-		}
-	}
-	if ( l_err ) { 
-		//there is no list which contains this type
-		return ES_OK;
-	}
-	int in_type = Index.type[type];
-	int temp_id = -1;
-	int max = type_array[in_type].max_entry;
-	for (int i=0; i<max; i++){
-		if ( type_array[in_type].id_list[i] == part_id ) {
-			temp_id = i;
-			break;
-		}
-	}
-	if ( temp_id == -1 ){
-		//particle is not in the list
-		return ES_OK;
-	}
-	if ( temp_id == max - 1 ) { 
-		type_array[in_type].id_list[temp_id] = -1;
-	} else {
-		int temp=type_array[in_type].id_list[max-1]; 
-		type_array[in_type].id_list[max-1] = -1;
-		type_array[in_type].id_list[temp_id]=temp;
-	}
-	type_array[in_type].max_entry--;
-	return ES_OK;
+const std::vector<int> *local_type_index_ids(int type)
+{
+  auto it = local_type_ids.find(type);
+  return (it == local_type_ids.end()) ? NULL : &it->second;
 }
 
-int update_particle_array(int type) {
-	updatePartCfg(WITHOUT_BONDS);
-	if (!partCfg) 
-		return ES_ERROR;
-
-	int t_c = 0;
-	for (int i=0; i<n_part; i++) {
-		if (partCfg[i].p.type == type ) {
-			type_array[Index.type[type]].id_list[t_c++] = partCfg[i].p.identity;
-		}	
-		if ( t_c > (double) type_array[Index.type[type]].cur_size/2.0 ) {
-			if ( reallocate_type_array(type) == ES_ERROR ) 
-				return ES_ERROR;
-		}
-	}
-	type_array[Index.type[type]].max_entry = t_c;
-	for ( int i = t_c; i<type_array[Index.type[type]].cur_size; i++)
-		type_array[Index.type[type]].id_list[i] = -1;
+/** the indexed types, as known to the master */
+static std::vector<int> indexed_types;
 
-	return ES_OK;
+static bool type_is_indexed(int type)
+{
+  return std::find(indexed_types.begin(), indexed_types.end(), type) !=
+         indexed_types.end();
 }
 
-int reallocate_global_type_list(int size){
-	if (size <= 0 ) 
-		return ES_ERROR;
-	type_array = (TypeList *) Utils::realloc( (void *) type_array, sizeof(TypeList)*size);
-	number_of_type_lists=size;
-	if ( type_array == (TypeList *) 0)
-		return ES_ERROR;
-
-	return ES_OK;
+int init_gc(void)
+{
+  GC_init = 1;
+  return ES_OK;
 }
 
-int find_particle_type(int type, int *id){ 
-	int l_err=1;
-	// type i not indexed, so no list for this particle exists
-	for (int i = 0; i<Type.max_entry; i++){
-		if ( Type.index[i] == type ){
-			l_err=0;
-			break;
-		}
-	}
-	if ( l_err ) {
-		return ES_ERROR;
-	}
-	if ( type_array[Index.type[type]].max_entry == 0 ){ 
-		return ES_ERROR;
-	}
-	int rand_index = i_random ( type_array[Index.type[type]].max_entry );
-	*id = type_array[Index.type[type]].id_list[rand_index];
+int init_type_array(int type)
+{
+  if (type < 0)
+    return ES_ERROR;
+  init_gc();
+  if (type_is_indexed(type))
+    return ES_OK;
 
-	return ES_OK;
+  mpi_type_index_init(type);
+  indexed_types.push_back(type);
+  Type_array_init = 1;
+  return ES_OK;
 }
 
-int find_particle_type_id(int type, int *id, int *in_id ){
-	int l_err=1;
-	// type i not indexed, so no list for this particle exists
-	for (int i = 0; i<Type.max_entry; i++){
-		if ( Type.index[i] == type ){
-			l_err=0;
-			break;
-		}
-	}
-	if ( l_err ) {
-		return ES_ERROR;
-	}
-	if ( type_array[Index.type[type]].max_entry == 0 )
-		return ES_ERROR;
-
-	int rand_index = i_random ( type_array[Index.type[type]].max_entry );
-	if (id == (int *) 0 && in_id == (int *) 0) 
-		return ES_ERROR;
-	else {
-		*in_id = rand_index;
-		*id = type_array[Index.type[type]].id_list[*in_id];
-		return ES_OK;
-	}
-}
+/** choose a random particle of an indexed type and return its id and
+    node. Only the particle numbers per node are collected. */
+static int find_particle_type_node(int type, int *id, int *node)
+{
+  if (!type_is_indexed(type))
+    return ES_ERROR;
 
-int delete_particle_of_type(int type) { 
-	int *p_id, *index_id;
-	p_id=(int *) Utils::malloc (sizeof(int));
-	index_id=(int *) Utils::malloc (sizeof(int));
-	if (find_particle_type_id(type, p_id, index_id) == ES_ERROR )
-		return ES_ERROR;
+  std::vector<int> counts(n_nodes);
+  mpi_gather_type_counts(type, counts.data());
+  int total = 0;
+  for (int n : counts)
+    total += n;
+  if (total == 0)
+    return ES_ERROR;
 
-	int in_type = Index.type[type];
-	// maximal possible index id
-	int max = type_array[in_type].max_entry - 1;
-	if ( max < 0 ) 
-		return ES_ERROR;
+  int k = i_random(total);
+  int pnode = 0;
+  while (k >= counts[pnode])
+    k -= counts[pnode++];
 
-	if ( remove_particle(*p_id) == ES_ERROR ) {
-		// takes also care of removing the index from the array
-		return ES_ERROR;
-	}
-	return ES_OK;
+  *id = mpi_get_particle_of_type(pnode, type, k);
+  *node = pnode;
+  return (*id == -1) ? ES_ERROR : ES_OK;
 }
 
-int add_particle_to_list(int part_id, int type){
-	int l_err=1;
-	int already_in = 0;
-//	int already_in_other_list = 0;
-	// type i not indexed, so no list for this particle exists
-	for (int i = 0; i<Type.max_entry; i++){
-		if ( Type.index[i] == type ){
-			l_err=0;
-			break;
-		}
-	}
-	if ( l_err ) {
-		return NOT_INDEXED;
-	}
-
-	int in_type = Index.type[type];
-	int max = type_array[in_type].max_entry;
-	for ( int i=0; i<max; i++ ) {
-		if ( type_array[in_type].id_list[i] == part_id ) {
-			already_in = 1;
-			break;
-		}
-	}
-	if ( already_in ) { 
-		return ES_OK;
-	}
+int find_particle_type(int type, int *id)
+{
+  int pnode;
+  return find_particle_type_node(type, id, &pnode);
+}
 
-	if ( max >= (double ) type_array[in_type].cur_size/2.0 )
-		if (reallocate_type_array(type)== ES_ERROR)
-			return ES_ERROR;
+int delete_particle_of_type(int type)
+{
+  int id, pnode;
+  if (find_particle_type_node(type, &id, &pnode) == ES_ERROR)
+    return ES_ERROR;
 
-	//add particle id to list:
-	type_array[in_type].id_list[max]=part_id;
-	type_array[in_type].max_entry++;
-	return ES_OK;
+  /* the node is already known, so the particle node table does not have
+     to be rebuilt for the removal */
+  return remove_particle_from_node(id, pnode);
 }
 
-int gc_status(int type){
-	int l_err=1;
-	// type i not indexed, so no list for this particle exists
-	for (int i = 0; i<Type.max_entry; i++){
-		if ( Type.index[i] == type ){
-			l_err=0;
-			break;
-		}
-	}
-	if ( l_err ) {
-		return ES_ERROR;
-	}
-	int in_type = Index.type[type];
-	for (int i = 0; i<type_array[in_type].max_entry; i++) {
-		printf("%d\n", type_array[in_type].id_list[i]);
-	}
-	return ES_OK;
+int get_particles_of_type(int type, std::vector<int> &ids)
+{
+  if (!type_is_indexed(type))
+    return NOT_INDEXED;
+  mpi_gather_type_ids(type, ids);
+  return ES_OK;
 }
 
-int free_particle_lists(void){
-	if (type_array == (TypeList *) 0 || Type.index == (int *) 0){
-		return ES_OK;
-	}
-	for (int i=0; i<Type.max_entry; i++){
-		free(type_array[i].id_list);
-	}
-	free(type_array);
-	free(Type.index);
-	free(Index.type);
-	return ES_OK;
+int gc_status(int type)
+{
+  std::vector<int> ids;
+  if (get_particles_of_type(type, ids) != ES_OK)
+    return ES_ERROR;
+  for (int id : ids)
+    printf("%d\n", id);
+  return ES_OK;
 }
 
+int number_of_particles_with_type(int type, int *number)
+{
+  if (!GC_init)
+    init_type_array(type);
 
-int number_of_particles_with_type(int type, int *number){
-	int indexed=0;
-	if ( type_array == (TypeList *) 0 ) 
-		init_type_array(type);
+  if (!type_is_indexed(type))
+    return NOT_INDEXED;
 
-	for ( int i = 0; i<Type.max_entry; i++) {
-		if ( type == Type.index[i] ){
-			indexed=1;
-			break;
-		}
-	}
-	if ( indexed ) {
-		*number = type_array[Index.type[type]].max_entry;
-		return ES_OK;
-	}
-	return NOT_INDEXED;
+  std::vector<int> counts(n_nodes);
+  mpi_gather_type_counts(type, counts.data());
+  *number = 0;
+  for (int n : counts)
+    *number += n;
+  return ES_OK;
 }
 
 
@@ -2294,7 +2255,7 @@ void pointer_to_rotational_inertia(Particle *p, double*& res)
 #endif
 
 bool particle_exists(int part) {
-    if (!particle_node)
+    if (!particle_node_valid)
         build_particle_node();
     
     if (part < 0 || part > max_seen_particle)
@@ -27,6 +27,8 @@
 
 #include "config.hpp"
 #include "utils.hpp"
+#include "utils/IdIndex.hpp"
+#include <vector>
 
 /************************************************
  * defines
@@ -39,6 +41,17 @@
 /// ok code for \ref place_particle, particle is new
 #define ES_PART_CREATED 1
 
+/** \ref place_particles / \ref get_particle_arrays field flag: types */
+#define PART_BULK_TYPE 1
+/** \ref place_particles / \ref get_particle_arrays field flag: velocities */
+#define PART_BULK_V 2
+/** \ref place_particles / \ref get_particle_arrays field flag: charges */
+#define PART_BULK_Q 4
+/** \ref get_particle_arrays field flag: positions */
+#define PART_BULK_POS 8
+/** \ref get_particle_arrays field flag: forces */
+#define PART_BULK_F 16
+
 /**  bonds_flag "bonds_flag" value for updating particle config without bonding
  * information */
 #define WITHOUT_BONDS 0
@@ -354,6 +367,24 @@ typedef struct {
 #endif
 } ParticleList;
 
+/** Packed particle data as shipped by \ref mpi_place_particles. Which
+    of the optional fields are valid is determined by the PART_BULK_*
+    field flags of the call. */
+typedef struct {
+  /** unique identifier */
+  int identity;
+  /** if true, the particle is created on the receiving node */
+  int is_new;
+  /** particle type */
+  int type;
+  /** position */
+  double p[3];
+  /** velocity, in internal units (times the time step) */
+  double v[3];
+  /** charge */
+  double q;
+} BulkParticle;
+
 /************************************************
  * exported variables
  ************************************************/
@@ -368,19 +399,28 @@ extern int max_seen_particle;
 /** total number of particles on all nodes. */
 extern int n_part;
 
-/** Capacity of the \ref particle_node / \ref local_particles. */
-extern int max_particle_node;
-/** Used only on master node: particle->node mapping. */
-extern int *particle_node;
-/** id->particle mapping on all nodes. This is used to find partners
-    of bonded interactions. */
-extern Particle **local_particles;
+/** Used only on master node: particle->node mapping, -1 for ids
+    without particle. Only valid if \ref particle_node_valid is set. */
+extern Utils::IdIndex<int> particle_node;
+/** Whether \ref particle_node is up to date, see \ref
+    build_particle_node. */
+extern bool particle_node_valid;
+/** id->particle mapping on all nodes, NULL for ids without local or
+    ghost particle. This is used to find partners of bonded
+    interactions. */
+extern Utils::IdIndex<Particle *> local_particles;
 
 /** Particles' current configuration. Before using that
     call \ref updatePartCfg or \ref sortPartCfg to allocate
     the data if necessary (which is decided by \ref updatePartCfg). */
 extern Particle *partCfg;
 
+/** incremented whenever \ref partCfg is invalidated, i.e. on every
+    change of the particles and every integration. Lets code that caches
+    particle data, such as the results of \ref get_particle_arrays,
+    detect that it became stale. */
+extern int partCfgVersion;
+
 /** if non zero, \ref partCfg is sorted by particle order, and
     the particles are stored consecutively starting with 0. */
 extern int partCfgSorted;
@@ -494,9 +534,6 @@ void build_particle_node();
 */
 void particle_invalidate_part_node();
 
-/** Realloc \ref local_particles. */
-void realloc_local_particles();
-
 /** Get particle data. Note that the bond intlist is
     allocated so that you are responsible to free it later.
     @param part the identity of the particle to fetch
@@ -515,6 +552,39 @@ int get_particle_data(int part, Particle *data);
 */
 int place_particle(int part, double p[3]);
 
+/** Call only on the master node.
+    Move many particles at once, creating the ones that do not exist
+    yet, and optionally set their type, velocity and charge. In contrast
+    to calling \ref place_particle and the setters for every particle,
+    the data is sorted by destination node and sent in a single scatter.
+    @param n    number of particles
+    @param ids  the identities of the particles, must be unique
+    @param pos  3*n positions
+    @param type n particle types or NULL
+    @param v    3*n velocities in internal units (times the time step) or NULL
+    @param q    n charges or NULL, ignored without ELECTROSTATICS
+    @return ES_PART_OK, or ES_PART_ERROR if an id is illegal or appears twice
+*/
+int place_particles(int n, const int *ids, const double *pos,
+                    const int *type, const double *v, const double *q);
+
+/** Call only on the master node.
+    Get selected properties of all particles in one collective gather,
+    sorted by particle identity. The values are the ones reported by
+    part print: positions are unfolded, velocities and forces are in
+    user units. Each array has to hold n_part entries, three per
+    particle for the vectors.
+    @param fields which arrays to fill, see PART_BULK_*
+    @param id   the particle identities
+    @param pos  positions, used with PART_BULK_POS
+    @param v    velocities, used with PART_BULK_V
+    @param f    forces, used with PART_BULK_F
+    @param type types, used with PART_BULK_TYPE
+    @param q    charges, used with PART_BULK_Q, zero without ELECTROSTATICS
+*/
+void get_particle_arrays(int fields, int *id, double *pos, double *v,
+                         double *f, int *type, double *q);
+
 /** Call only on the master node: set particle velocity.
     @param part the particle.
     @param v its new velocity.
@@ -802,6 +872,8 @@ void remove_all_bonds_to(int part);
     instead.  This function is lazy. If you would like the bonding
     information in \ref partCfg to be valid you should set the value
     of  to \ref WITH_BONDS.
+    New analyses should be written as a \ref ParallelAnalysis instead,
+    which works on the particles where they are stored.
 */
 int updatePartCfg(int bonds_flag);
 
@@ -829,12 +901,27 @@ int sortPartCfg();
 */
 void local_place_particle(int part, double p[3], int _new);
 
+/** Used by \ref mpi_place_particles, should not be used elsewhere.
+    Place particles that belong to this node and set their properties.
+    @param parts  the particle data
+    @param n      number of particles
+    @param fields which optional fields of parts are valid (PART_BULK_*)
+*/
+void local_place_particles(const BulkParticle *parts, int n, int fields);
+
 /** Used by \ref mpi_place_particle, should not be used elsewhere.
     Called if on a different node a new particle was added.
     @param part the identity of the particle added
 */
 void added_particle(int part);
 
+/** Used by \ref mpi_place_particles, should not be used elsewhere.
+    Called on all nodes if particles were added anywhere.
+    @param n_new    the number of particles added
+    @param max_part the highest identity among them
+*/
+void added_particles(int n_new, int max_part);
+
 /** Used by \ref mpi_send_bond, should not be used elsewhere.
     Modify a bond.
     @param part the identity of the particle to change
@@ -922,72 +1009,55 @@ void add_partner(IntList *il, int i, int j, int distance);
 // value that is returned in the case there was no error, but the type was not
 // yet indexed
 #define NOT_INDEXED -3
-// struct that associates the index used for the type_list and the real particle
-// type
-typedef struct {
-  int max_entry;
-  int *type;
-} IndexOfType;
-
-// and the other way round
-typedef struct {
-  int max_entry;
-  int *index;
-} TypeOfIndex;
-
-typedef struct {
-  int max_entry;
-  int cur_size;
-  int *id_list;
-} TypeList;
-
-// undefined array size
-extern TypeList *type_array;
-extern int number_of_type_lists;
 
-extern TypeOfIndex Type;
-extern IndexOfType Index;
+/* The particles of the types used in grand canonical and reaction moves
+   are indexed by type. The index is distributed: every node keeps the ids
+   of its own particles of the indexed types, and updates them whenever a
+   particle is created, removed, changes its type or migrates, so that the
+   master never has to collect the particle configuration for a move. */
 
 // flag indicating init_gc was called
 extern int GC_init;
 
-// flag that indicates that the function init_type_array was called already
+// flag that indicates that at least one type is indexed
 extern int Type_array_init;
 
 int init_gc(void);
 
-/** init particle lists		*/
+/** index the particles of the given type on all nodes */
 int init_type_array(int type);
 
-/** resize the array for the list of ids for a certain type */
-int reallocate_type_array(int type);
-
-/** make more type_arrays available */
-int reallocate_global_type_list(int size);
-
-/** free particle lists		*/
-int free_particle_lists(void);
-
-// update particle list
-int update_particle_array(int type);
-
 /* find a particle of given type and return its id */
 int find_particle_type(int type, int *id);
 
-/** return an array with real particle id and the corresponding index of
- * typelist */
-int find_particle_type_id(int type, int *id, int *in_id);
-
 /** delete one randomly chosen particle of given type
  * returns ES_OK if succesful or else ES_ERROR		*/
 int delete_particle_of_type(int type);
 
-int remove_id_type_array(int part_id, int type);
-int add_particle_to_list(int part_id, int type);
 // print out a list of currently indexed ids
 int gc_status(int type);
 int number_of_particles_with_type(int type, int *number);
 
+/** collect the ids of all particles of an indexed type on the master.
+ * returns NOT_INDEXED if the type is not indexed */
+int get_particles_of_type(int type, std::vector<int> &ids);
+
+/** add a local particle to the index of its type on this node */
+void local_type_index_add(Particle *p);
+/** remove a local particle from the index of its type on this node */
+void local_type_index_remove(Particle *p);
+/** change the type of a particle on this node, keeping the type index up
+ * to date. Ghosts are not indexed. */
+void local_set_particle_type(Particle *p, int type);
+/** start indexing a type on this node */
+void local_type_index_init(int type);
+/** number of local particles of an indexed type, or 0 */
+int local_type_index_count(int type);
+/** id of the k-th local particle of an indexed type */
+int local_type_index_id(int type, int k);
+/** ids of the local particles of an indexed type, or NULL */
+const std::vector<int> *local_type_index_ids(int type);
+
 // The following functions are used by the python interface to obtain
 // properties of a particle, which are only compiled in in some configurations
 // This is needed, because cython does not support conditional compilation
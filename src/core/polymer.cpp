@@ -30,11 +30,13 @@
        Based upon 'polymer.tcl' by BAM (20.02.2003).
 */
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 #include "communication.hpp"
 #include "constraint.hpp"
@@ -44,6 +46,7 @@
 #include "integrate.hpp"
 #include "interaction_data.hpp"
 #include "polymer.hpp"
+#include "position_index.hpp"
 #include "random.hpp"
 #include "utils.hpp"
 
@@ -52,87 +55,9 @@
  * ---------                                                 *
  *************************************************************/
 
-int mindist3(int part_id, double r_catch, int *ids) {
-  Particle *partCfgMD;
-  double dx, dy, dz;
-  int i, me, caught = 0;
-
-  partCfgMD = (Particle *)Utils::malloc(n_part * sizeof(Particle));
-  mpi_get_particles(partCfgMD, NULL);
-  me = -1; /* Since 'mpi_get_particles' returns the particles unsorted, it's
-              most likely that 'partCfgMD[i].p.identity != i'
-              --> prevent that! */
-  for (i = 0; i < n_part; i++)
-    if (partCfgMD[i].p.identity == part_id)
-      me = i;
-  if (me == -1) {
-    runtimeErrorMsg() << "failed to find desired particle " << part_id;
-    return 0;
-  }
-  for (i = 0; i < n_part; i++) {
-    if (i != me) {
-      dx = partCfgMD[me].r.p[0] - partCfgMD[i].r.p[0];
-      dx -= dround(dx / box_l[0]) * box_l[0];
-      dy = partCfgMD[me].r.p[1] - partCfgMD[i].r.p[1];
-      dy -= dround(dy / box_l[1]) * box_l[1];
-      dz = partCfgMD[me].r.p[2] - partCfgMD[i].r.p[2];
-      dz -= dround(dz / box_l[2]) * box_l[2];
-      if (sqrt(SQR(dx) + SQR(dy) + SQR(dz)) < r_catch)
-        ids[caught++] = partCfgMD[i].p.identity;
-    }
-  }
-  free(partCfgMD);
-  return (caught);
-}
-
-double mindist4(double pos[3]) {
-  Particle *partCfgMD;
-  double mindist = 30000.0, dx, dy, dz;
-  int i;
-
-  if (n_part == 0)
-    return (std::min(std::min(box_l[0], box_l[1]), box_l[2]));
-  partCfgMD = (Particle *)Utils::malloc(n_part * sizeof(Particle));
-  mpi_get_particles(partCfgMD, NULL);
-  for (i = 0; i < n_part; i++) {
-    dx = pos[0] - partCfgMD[i].r.p[0];
-    dx -= dround(dx / box_l[0]) * box_l[0];
-    dy = pos[1] - partCfgMD[i].r.p[1];
-    dy -= dround(dy / box_l[1]) * box_l[1];
-    dz = pos[2] - partCfgMD[i].r.p[2];
-    dz -= dround(dz / box_l[2]) * box_l[2];
-    mindist = std::min(mindist, SQR(dx) + SQR(dy) + SQR(dz));
-  }
-  free(partCfgMD);
-  if (mindist < 30000.0)
-    return (sqrt(mindist));
-  return (-1.0);
-}
-
-double buf_mindist4(double pos[3], int n_add, double *add) {
-  double mindist = 30000.0, dx, dy, dz;
-  int i;
-
-  if (n_add == 0)
-    return (std::min(std::min(box_l[0], box_l[1]), box_l[2]));
-  for (i = 0; i < n_add; i++) {
-    dx = pos[0] - add[3 * i + 0];
-    dx -= dround(dx / box_l[0]) * box_l[0];
-    dy = pos[1] - add[3 * i + 1];
-    dy -= dround(dy / box_l[1]) * box_l[1];
-    dz = pos[2] - add[3 * i + 2];
-    dz -= dround(dz / box_l[2]) * box_l[2];
-    mindist = std::min(mindist, SQR(dx) + SQR(dy) + SQR(dz));
-  }
-  if (mindist < 30000.0)
-    return (sqrt(mindist));
-  return (-1.0);
-}
-
-int collision(double pos[3], double shield, int n_add, double *add) {
-  if (mindist4(pos) > shield && buf_mindist4(pos, n_add, add) > shield)
-    return (0);
-  return (1);
+int collision(const PositionIndex &particles, const PositionIndex &chain,
+              double pos[3], double shield) {
+  return particles.any_within(pos, shield) || chain.any_within(pos, shield);
 }
 
 #ifdef CONSTRAINTS
@@ -206,9 +131,19 @@ int polymerC(int N_P, int MPC, double bond_length, int part_id, double *posed,
   bond = (int *)Utils::malloc(sizeof(int) * (bond_size + 1));
   bond[0] = type_bond;
 
+  /* the particles placed so far and the monomers of the current chain,
+     for the collision checks */
+  PositionIndex particles(shield, (mode == 1) ? 0 : n_part + N_P * MPC);
+  PositionIndex chain(shield, (mode == 1) ? 0 : MPC);
+  if (mode != 1)
+    index_particles(particles);
+  std::vector<int> ids(MPC), types(MPC);
+  std::vector<double> charges(MPC);
+
   cnt1 = cnt2 = max_cnt = 0;
   for (p = 0; p < N_P; p++) {
     for (cnt2 = 0; cnt2 < max_try; cnt2++) {
+      chain.clear();
       /* place start monomer */
       if (posed != NULL) {
         /* if position of 1st monomer is given */
@@ -226,7 +161,7 @@ int polymerC(int N_P, int MPC, double bond_length, int part_id, double *posed,
           pos[0] = box_l[0] * d_random();
           pos[1] = box_l[1] * d_random();
           pos[2] = box_l[2] * d_random();
-          if ((mode == 1) || (collision(pos, shield, 0, NULL) == 0))
+          if ((mode == 1) || (collision(particles, chain, pos, shield) == 0))
             break;
           POLY_TRACE(printf("s"); fflush(NULL));
         }
@@ -238,6 +173,7 @@ int polymerC(int N_P, int MPC, double bond_length, int part_id, double *posed,
       poly[0] = pos[0];
       poly[1] = pos[1];
       poly[2] = pos[2];
+      chain.add(pos, 0);
       max_cnt = std::max(cnt1, max_cnt);
       POLY_TRACE(printf("S"); fflush(NULL));
 
@@ -274,7 +210,7 @@ int polymerC(int N_P, int MPC, double bond_length, int part_id, double *posed,
               constraint_collision(pos, poly + 3 * (n - 1)) == 0) {
 #endif
 
-            if (mode == 1 || collision(pos, shield, n, poly) == 0)
+            if (mode == 1 || collision(particles, chain, pos, shield) == 0)
               break;
             if (mode == 0) {
               cnt1 = -1;
@@ -303,6 +239,7 @@ int polymerC(int N_P, int MPC, double bond_length, int part_id, double *posed,
       poly[3 * n] = pos[0];
       poly[3 * n + 1] = pos[1];
       poly[3 * n + 2] = pos[2];
+      chain.add(pos, n);
       max_cnt = std::max(cnt1, max_cnt);
       POLY_TRACE(printf("M"); fflush(NULL));
 
@@ -388,7 +325,7 @@ int polymerC(int N_P, int MPC, double bond_length, int part_id, double *posed,
           if (constr == 0 ||
               constraint_collision(pos, poly + 3 * (n - 1)) == 0) {
 #endif
-            if (mode == 1 || collision(pos, shield, n, poly) == 0)
+            if (mode == 1 || collision(particles, chain, pos, shield) == 0)
               break;
             if (mode == 0) {
               cnt1 = -2;
@@ -413,6 +350,7 @@ int polymerC(int N_P, int MPC, double bond_length, int part_id, double *posed,
         poly[3 * n] = pos[0];
         poly[3 * n + 1] = pos[1];
         poly[3 * n + 2] = pos[2];
+        chain.add(pos, n);
         max_cnt = std::max(cnt1, max_cnt);
         POLY_TRACE(printf("M"); fflush(NULL));
       }
@@ -426,22 +364,21 @@ int polymerC(int N_P, int MPC, double bond_length, int part_id, double *posed,
     } else
       max_cnt = std::max(max_cnt, std::max(cnt1, cnt2));
 
-    /* actually creating current polymer in ESPResSo */
+    /* actually creating current polymer in ESPResSo, all monomers at once */
     for (n = 0; n < MPC; n++) {
+      ids[n] = part_id + n;
+      charges[n] = (n % cM_dist == 0) ? val_cM : 0.0;
+      types[n] = (n % cM_dist == 0) ? type_cM : type_nM;
+      if (mode != 1)
+        particles.add(poly + 3 * n, part_id + n);
+    }
+    if (place_particles(MPC, ids.data(), poly, types.data(), NULL,
+                        charges.data()) == ES_PART_ERROR) {
+      free(poly);
+      return (-3);
+    }
 
-      pos[0] = poly[3 * n];
-      pos[1] = poly[3 * n + 1];
-      pos[2] = poly[3 * n + 2];
-      if (place_particle(part_id, pos) == ES_PART_ERROR ||
-          (set_particle_q(part_id, ((n % cM_dist == 0) ? val_cM : 0.0)) ==
-           ES_ERROR) ||
-          (set_particle_type(part_id,
-                             ((n % cM_dist == 0) ? type_cM : type_nM)) ==
-           ES_ERROR)) {
-        free(poly);
-        return (-3);
-      }
-
+    for (n = 0; n < MPC; n++) {
       if (n >= bond_size) {
         bond[1] = part_id - bond_size;
         for (i = 2; i <= bond_size; i++) {
@@ -467,18 +404,26 @@ int counterionsC(int N_CI, int part_id, int mode, double shield, int max_try,
   int n, cnt1, max_cnt;
   double pos[3];
 
+  /* the particles placed so far, for the collision checks */
+  PositionIndex particles(shield, (mode != 0) ? 0 : n_part + N_CI);
+  PositionIndex none(shield, 0);
+  if (mode == 0)
+    index_particles(particles);
+
   cnt1 = max_cnt = 0;
   for (n = 0; n < N_CI; n++) {
     for (cnt1 = 0; cnt1 < max_try; cnt1++) {
       pos[0] = box_l[0] * d_random();
       pos[1] = box_l[1] * d_random();
       pos[2] = box_l[2] * d_random();
-      if ((mode != 0) || (collision(pos, shield, 0, NULL) == 0))
+      if ((mode != 0) || (collision(particles, none, pos, shield) == 0))
         break;
       POLY_TRACE(printf("c"); fflush(NULL));
     }
     if (cnt1 >= max_try)
       return (-1);
+    if (mode == 0)
+      particles.add(pos, part_id);
     if (place_particle(part_id, pos) == ES_PART_ERROR)
       return (-3);
     if (set_particle_q(part_id, val_CI) == ES_ERROR)
@@ -500,6 +445,12 @@ int saltC(int N_pS, int N_nS, int part_id, int mode, double shield, int max_try,
   int n, cnt1, max_cnt;
   double pos[3], dis2;
 
+  /* the particles placed so far, for the collision checks */
+  PositionIndex particles(shield, (mode != 0) ? 0 : n_part + N_pS + N_nS);
+  PositionIndex none(shield, 0);
+  if (mode == 0)
+    index_particles(particles);
+
   cnt1 = max_cnt = 0;
 
   /* Place positive salt ions */
@@ -513,20 +464,22 @@ int saltC(int N_pS, int N_nS, int part_id, int mode, double shield, int max_try,
         pos[0] += box_l[0] * 0.5;
         pos[1] += box_l[1] * 0.5;
         pos[2] += box_l[2] * 0.5;
-        if (((mode != 0) || (collision(pos, shield, 0, NULL) == 0)) &&
+        if (((mode != 0) || (collision(particles, none, pos, shield) == 0)) &&
             (dis2 < (rad * rad)))
           break;
       } else {
         pos[0] = box_l[0] * d_random();
         pos[1] = box_l[1] * d_random();
         pos[2] = box_l[2] * d_random();
-        if ((mode != 0) || (collision(pos, shield, 0, NULL) == 0))
+        if ((mode != 0) || (collision(particles, none, pos, shield) == 0))
           break;
       }
       POLY_TRACE(printf("p"); fflush(NULL));
     }
     if (cnt1 >= max_try)
       return (-1);
+    if (mode == 0)
+      particles.add(pos, part_id);
     if (place_particle(part_id, pos) == ES_PART_ERROR)
       return (-3);
     if (set_particle_q(part_id, val_pS) == ES_ERROR)
@@ -552,20 +505,22 @@ int saltC(int N_pS, int N_nS, int part_id, int mode, double shield, int max_try,
         pos[0] += box_l[0] * 0.5;
         pos[1] += box_l[1] * 0.5;
         pos[2] += box_l[2] * 0.5;
-        if (((mode != 0) || (collision(pos, shield, 0, NULL) == 0)) &&
+        if (((mode != 0) || (collision(particles, none, pos, shield) == 0)) &&
             (dis2 < (rad * rad)))
           break;
       } else {
         pos[0] = box_l[0] * d_random();
         pos[1] = box_l[1] * d_random();
         pos[2] = box_l[2] * d_random();
-        if ((mode != 0) || (collision(pos, shield, 0, NULL) == 0))
+        if ((mode != 0) || (collision(particles, none, pos, shield) == 0))
           break;
       }
       POLY_TRACE(printf("n"); fflush(NULL));
     }
     if (cnt1 >= max_try)
       return (-1);
+    if (mode == 0)
+      particles.add(pos, part_id);
     if (place_particle(part_id, pos) == ES_PART_ERROR)
       return (-3);
     if (set_particle_q(part_id, val_nS) == ES_ERROR)
@@ -780,14 +735,30 @@ int crosslinkC(int N_P, int MPC, int part_id, double r_catch, int link_dist,
 
   /* Find all possible binding partners in the neighbourhood of the unconnected
    * ending monomers. */
+  std::vector<int> ids(n_part);
+  std::vector<double> positions(3 * n_part);
+  get_particle_arrays(PART_BULK_POS, ids.data(), positions.data(), NULL, NULL,
+                      NULL, NULL);
+  PositionIndex index(r_catch, n_part);
+  for (i = 0; i < n_part; i++)
+    index.add(&positions[3 * i], ids[i]);
   link = (int *)Utils::malloc(2 * N_P * sizeof(int));
   links = (int **)Utils::malloc(2 * N_P * sizeof(int *));
   for (i = 0; i < N_P; i++) {
     for (k = 0; k < 2; k++) {
       if (bond[i * MPC + k * (MPC - 1)] == 1) {
+        int me = i * MPC + k * (MPC - 1) + part_id;
+        int slot = std::lower_bound(ids.begin(), ids.end(), me) - ids.begin();
         links[2 * i + k] = (int *)Utils::malloc(n_part * sizeof(int));
-        link[2 * i + k] = mindist3(i * MPC + k * (MPC - 1) + part_id, r_catch,
-                                   links[2 * i + k]);
+        link[2 * i + k] = 0;
+        if (slot == n_part || ids[slot] != me)
+          runtimeErrorMsg() << "failed to find desired particle " << me;
+        else
+          index.for_each_within(&positions[3 * slot], r_catch,
+                                [&](int id, double) {
+                                  if (id != me)
+                                    links[2 * i + k][link[2 * i + k]++] = id;
+                                });
         links[2 * i + k] = (int *)Utils::realloc(links[2 * i + k],
                                                  link[2 * i + k] * sizeof(int));
       } else if (bond[i * MPC + k * (MPC - 1)] == 2)
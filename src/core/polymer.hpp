@@ -31,6 +31,7 @@
 */
 
 #include "particle_data.hpp"
+#include "position_index.hpp"
 
 /************************************************************* 
  * Functions                                                 *
@@ -38,25 +39,15 @@
  *************************************************************/
 
 
-/** C implementation of 'mindist \<posx\> \<posy\> \<posz\>',<br>
-    which returns the minimum distance of all current particles
-    to position (\<posx\>, \<posy\>, \<posz\>) as a double.<br>
-    If it fails, return value equals -1. */
-double mindist4(double pos[3]);
-
-/** C implementation of 'mindist \<part_id\> \<r_catch\>',<br>
-    which returns the size of an array \<ids\> of indices of particles which are 
-    less than \<r_catch\> away from the position of the particle \<part_id\>. */
-int mindist3(int part_id, double r_catch, int *ids);
-
 /** Checks whether a particle at coordinates (\<posx\>, \<posy\>, \<posz\>) collides
     with any other particle due to a minimum image distance smaller than \<shield\>. 
+    @param particles the positions of the particles already placed
+    @param chain the positions of the monomers of the current chain
     @param pos coordinates of particle to check
     @param shield minimum distance before it is defined as collision
-    @param n_add number of additional coordinates to check
-    @param add additional coordinates to check
     @return Returns '1' if there is a collision, '0' otherwise. */
-int collision(double pos[3], double shield, int n_add, double *add);
+int collision(const PositionIndex &particles, const PositionIndex &chain,
+              double pos[3], double shield);
 
 /** Function used by polymerC to determine wether a constraint has been violated while setting up a polymer. Currently only "wall", "sphere" and "cylinder" constraints are respected.
     @param p1           = position of first particle given as double-array of lenght 3
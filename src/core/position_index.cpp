@@ -0,0 +1,112 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file position_index.cpp
+    Implementation of \ref position_index.hpp "position_index.hpp".
+*/
+#include "position_index.hpp"
+#include "particle_data.hpp"
+
+PositionIndex::PositionIndex(double cell_size, int expected_points) {
+  for (int d = 0; d < 3; d++)
+    m_n_cells[d] =
+        cell_size > 0.0
+            ? std::max(1, (int)std::min(box_l[d] / cell_size, 1e3))
+            : 1000;
+  while ((double)m_n_cells[0] * m_n_cells[1] * m_n_cells[2] >
+         2.0 * expected_points + 27) {
+    int d = std::max_element(m_n_cells, m_n_cells + 3) - m_n_cells;
+    m_n_cells[d] = (m_n_cells[d] + 1) / 2;
+  }
+  for (int d = 0; d < 3; d++)
+    m_cell_size[d] = box_l[d] / m_n_cells[d];
+  m_head.assign(m_n_cells[0] * m_n_cells[1] * m_n_cells[2], -1);
+}
+
+void PositionIndex::add(const double pos[3], int tag) {
+  int c[3];
+  for (int d = 0; d < 3; d++) {
+    double x = fold(pos[d], d);
+    m_pos.push_back(x);
+    c[d] = std::floor(x / m_cell_size[d]);
+    if (!PERIODIC(d))
+      c[d] = std::min(std::max(c[d], 0), m_n_cells[d] - 1);
+  }
+  int cell = cell_index(c[0], c[1], c[2]);
+  m_next.push_back(m_head[cell]);
+  m_head[cell] = m_tags.size();
+  m_cell.push_back(cell);
+  m_tags.push_back(tag);
+}
+
+void PositionIndex::clear() {
+  for (int cell : m_cell)
+    m_head[cell] = -1;
+  m_next.clear();
+  m_cell.clear();
+  m_pos.clear();
+  m_tags.clear();
+}
+
+bool PositionIndex::any_within(const double pos[3], double r,
+                               int exclude) const {
+  double r2 = r * r;
+  bool found = false;
+  visit(pos, r, [&](int k, double dist2) {
+    found = dist2 < r2 && m_tags[k] != exclude;
+    return found;
+  });
+  return found;
+}
+
+double PositionIndex::nearest(const double pos[3], int exclude,
+                              int *tag) const {
+  /* search growing spheres, until the nearest point found is inside the
+     sphere, so that no unvisited point can be closer */
+  if (m_tags.empty())
+    return -1.0;
+  double best2 = HUGE_VAL;
+  int best = -1;
+  double r = *std::min_element(m_cell_size, m_cell_size + 3);
+  for (;;) {
+    bool all = visit(pos, r, [&](int k, double dist2) {
+      if (dist2 < best2 && m_tags[k] != exclude) {
+        best2 = dist2;
+        best = k;
+      }
+      return false;
+    });
+    if (all || best2 <= r * r)
+      break;
+    r *= 2.0;
+  }
+  if (best == -1)
+    return -1.0;
+  if (tag)
+    *tag = m_tags[best];
+  return std::sqrt(best2);
+}
+
+void index_particles(PositionIndex &index) {
+  std::vector<int> id(n_part);
+  std::vector<double> pos(3 * n_part);
+  get_particle_arrays(PART_BULK_POS, id.data(), pos.data(), NULL, NULL, NULL,
+                      NULL);
+  for (int i = 0; i < n_part; i++)
+    index.add(&pos[3 * i], id[i]);
+}
@@ -0,0 +1,151 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _POSITION_INDEX_H
+#define _POSITION_INDEX_H
+/** \file position_index.hpp
+    A cell grid over the simulation box for radius and nearest neighbour
+    queries on a set of positions, independent of the cell system. Points
+    can be added one by one, so that the setup routines of \ref
+    polymer.cpp keep the index up to date while placing particles
+    instead of collecting all particles for every trial position.
+
+    \code
+    PositionIndex index(shield, n_part);
+    index_particles(index);
+    if (!index.any_within(pos, shield))
+      index.add(pos, id);
+    \endcode
+*/
+
+#include "grid.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+class PositionIndex {
+public:
+  /** An empty index with cells of at least cell_size, but not many more
+      cells than the expected number of points. */
+  PositionIndex(double cell_size, int expected_points);
+
+  /** Add a point. The position does not need to be folded. */
+  void add(const double pos[3], int tag);
+
+  /** Remove all points, keeping the grid. */
+  void clear();
+
+  int size() const { return m_tags.size(); }
+
+  /** Call f(tag, dist2) for all points with a minimum image distance
+      below r from pos, with dist2 the square of the distance. */
+  template <typename F>
+  void for_each_within(const double pos[3], double r, F f) const {
+    double r2 = r * r;
+    visit(pos, r, [&](int k, double dist2) {
+      if (dist2 < r2)
+        f(m_tags[k], dist2);
+      return false;
+    });
+  }
+
+  /** Whether any point other than exclude is closer than r to pos. */
+  bool any_within(const double pos[3], double r, int exclude = -1) const;
+
+  /** The minimum image distance from pos to the nearest point with a
+      tag other than exclude, or -1 if there is none.
+      \param tag if not NULL, receives the tag of the nearest point */
+  double nearest(const double pos[3], int exclude = -1,
+                 int *tag = NULL) const;
+
+private:
+  /** Call f(k, dist2) for the points k in all cells within r of pos,
+      until f returns true.
+      \return whether all cells were visited, so that no point is
+              further away than the visited ones */
+  template <typename F> bool visit(const double pos[3], double r, F f) const {
+    double p[3];
+    int lo[3], hi[3];
+    bool all = true;
+    for (int d = 0; d < 3; d++) {
+      p[d] = fold(pos[d], d);
+      lo[d] = std::floor((p[d] - r) / m_cell_size[d]);
+      hi[d] = std::floor((p[d] + r) / m_cell_size[d]);
+      if (PERIODIC(d) && hi[d] - lo[d] + 1 >= m_n_cells[d]) {
+        lo[d] = 0;
+        hi[d] = m_n_cells[d] - 1;
+      } else if (!PERIODIC(d)) {
+        /* points outside of the box are stored in the edge cells, see
+           add() */
+        lo[d] = std::min(std::max(lo[d], 0), m_n_cells[d] - 1);
+        hi[d] = std::min(std::max(hi[d], 0), m_n_cells[d] - 1);
+      }
+      if (lo[d] > 0 || hi[d] < m_n_cells[d] - 1)
+        all = false;
+    }
+    for (int z = lo[2]; z <= hi[2]; z++)
+      for (int y = lo[1]; y <= hi[1]; y++)
+        for (int x = lo[0]; x <= hi[0]; x++) {
+          int c = cell_index(x, y, z);
+          for (int k = m_head[c]; k != -1; k = m_next[k]) {
+            double dist2 = 0.0;
+            for (int d = 0; d < 3; d++) {
+              double dx = p[d] - m_pos[3 * k + d];
+              if (PERIODIC(d))
+                dx -= dround(dx * box_l_i[d]) * box_l[d];
+              dist2 += dx * dx;
+            }
+            if (f(k, dist2))
+              return all;
+          }
+        }
+    return all;
+  }
+
+  /** Fold a coordinate into the box in the periodic directions. */
+  double fold(double x, int d) const {
+    return PERIODIC(d) ? x - std::floor(x * box_l_i[d]) * box_l[d] : x;
+  }
+
+  /** The cell of the cell coordinates, wrapped in the periodic
+      directions. */
+  int cell_index(int x, int y, int z) const {
+    int c[3] = {x, y, z};
+    for (int d = 0; d < 3; d++)
+      if (PERIODIC(d))
+        c[d] = ((c[d] % m_n_cells[d]) + m_n_cells[d]) % m_n_cells[d];
+    return (c[2] * m_n_cells[1] + c[1]) * m_n_cells[0] + c[0];
+  }
+
+  int m_n_cells[3];
+  double m_cell_size[3];
+  /** the first point of every cell, the next point of the same cell and
+      the cell of every point */
+  std::vector<int> m_head, m_next, m_cell;
+  /** the folded positions and the tags of the points */
+  std::vector<double> m_pos;
+  std::vector<int> m_tags;
+};
+
+/** Call only on the master node. Add the positions of all particles to
+    an index, tagged with their identities, gathered in one collective
+    call. */
+void index_particles(PositionIndex &index);
+
+#endif
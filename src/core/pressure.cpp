@@ -22,6 +22,7 @@
     Implementation of \ref pressure.hpp "pressure.h".
 */
 #include "pressure.hpp"
+#include "local_stress.hpp"
 #include "cells.hpp"
 #include "integrate.hpp"
 #include "initialize.hpp"
@@ -355,468 +356,6 @@ void master_pressure_calc(int v_comp) {
 /* Routines for Local Stress Tensor                  */
 /*****************************************************/
 
-int getintersection(double pos1[3], double pos2[3],int given, int get, double value, double *answer, double box_size[3])
-{
-  /*pos1 and pos2 are two particle positions.                                                  */
-  /*given and get are integers from 0 to 2. 0 = x direction. 1 = y direction. 2 = z direction  */
-  /*there is a point on the line between the two particles p1 and p2 such that r[given]=value  */
-  /*this procedure returns the value of r[get] at that point                                   */
-
-  double p2r[3];
-  int i;
-
-  for (i=0;i<3;i++) {
-    p2r[i] = drem_down((pos2[i]-pos1[i])+box_size[i]/2.0,box_size[i])-box_size[i]/2.0;
-  }
-  value = drem_down((value-pos1[given])+box_size[given]/2.0,box_size[given])-box_size[given]/2.0;
-  //PTENSOR_TRACE(fprintf(stderr,"%d: getintersection: p1 is %f %f %f p2 is %f %f %f p2r is %f %f %f newvalue is %f\n",this_node,pos1[0],pos1[1],pos1[2],pos2[0],pos2[1],pos2[2],p2r[0],p2r[1],p2r[2],value););
-  
-  if ((value)*(p2r[given]) < -0.0001) {
-      runtimeErrorMsg() <<"analyze stress_profile: getintersection: intersection is not between the two given particles - " << value << " is not between " << 0.0 << " and " << p2r[given] << " and box size is " << box_size[given] << ", given is " << given << "\n";
-    return 0; 
-  } else if (given == get) {
-    *answer =  drem_down(value + pos1[given],box_size[given]);;
-  } else if (0==p2r[given]) {
-      runtimeErrorMsg() <<"analyze stress_profile: getintersection: intersection is a line, not a point - value is " << value << " same as " << 0.0 << " and " << p2r[given] << "\n";
-    return 0;   
-  } else {
-    *answer =  drem_down(pos1[get]+p2r[get]/p2r[given]*value,box_size[get]);
-  }
-  return 1;
-}
-
-int getlength(double pos1[3], double pos2[3], int d1, double val1, int d2, double val2, int l, double *answer)
-{
-  /*p1 and p2 are two particles positions                                                          
-    d1 and d2 are integers between 0 and 2 denoting an axis (x, y, or z)                        
-    l and k are integers between 0 and 2 denoting an axis (x, y, or z)                          
-    two points on the line connecting these particles are defined by r[d1]=val1 and r[d2]=val2  
-    call these two points p3 and p4 (not program variables)                                     
-    this program returns the distance between p3 and p4 in the l direction
-  */
-  
-  double intersect1, intersect2;
-
-  *answer = 0;
-  
-  if  (! getintersection(pos1,pos2,d2,l,val2,&intersect1,box_l) || ! getintersection(pos1,pos2,d1,l,val1,&intersect2,box_l)) {
-    return 0;
-  } else {
-    *answer = drem_down(intersect2 - intersect1 + box_l[l]/2.0, box_l[l]) - box_l[l]/2.0;
-    return 1;
-  }
-}
-
-int does_line_go_through_cube(double pos1[3], double pos2[3], double range_start[3], double range[3], int sign[3], double entry[3], double exit[3],int *facein, int *faceout)
-     /* p1 and p2 are two particle positions
-        there is a cube in the simulation box with one vertex at range_start and the opposite vertex at range_start + range
-        this routine calculates where the line connecting p1 and p2 enters and exits this cube
-	these points are returned in the variables entry and exit
-	the function returns a 0 if the line does not pass through the cube and 1 if it does
-     */
-{
-
-  double centre[3];             /* centre of the cube */
-  double vect2centre1[3];       /* vectors from centre of cube to pos1 and pos2 */
-  double vect2centre2[3];
-  int i;
-
-  int doesntenter = 0;          /* boolean that indicates whether we have already determined that the line does not enter the cube at all */
-  double intersection1 = 0.0, intersection2 = 0.0;
-  int found_entry = 0;          /* boolean that indicates whether we have determined where the line enters */
-  int found_exit = 0;           /* boolean that indicates whether we have determined where the line exits */
-  int i1, i2;
-  int inside1, inside2;
-
-   /* find centre of analyzed cube */
-  for (i=0;i<3;i++) {
-    centre[i] = range_start[i] + range[i]/2.0;
-  }
-
-  /* find vectors connecting two particles to centre */
-  get_mi_vector(vect2centre1,pos1,centre);
-  get_mi_vector(vect2centre2,pos2,centre);
-
-  *facein = -1;
-  *faceout = -1;
-
-  /* check if particles are inside cube */
-  inside1 = 1;
-  inside2 = 1;
-  for (i=0;i<3;i++) {
-    if (fabs(vect2centre1[i])>range[i]/2.0) inside1 = 0;
-    if (fabs(vect2centre2[i])>range[i]/2.0) inside2 = 0;
-  }
-  PTENSOR_TRACE(fprintf(stderr,"%d: does_line_go_through_cube: Particle1 inside cube = %d Particle2 inside cube = %d \n",this_node,inside1,inside2););
-
-  /* work out which face connecting line enters through */
-  if (! inside1) {
-    for (i=0;i<3;i++) {
-      i1 = (i+1)%3;
-      i2 = (i+2)%3;
-      /*does the line start outside the cube in direction i?*/
-      if ( (! doesntenter ) && (! found_entry) && fabs(vect2centre1[i])>range[i]/2.0 ) { 
-	 /*does the bond heads away from the cube or is part2 is before the cube in direction i? */
-	if ((vect2centre1[i] * sign[i] > 0) ||  (vect2centre2[i]*sign[i] < -range[i]/2.0)) {
-	  doesntenter = 1;
-	} else {
-	  getintersection(vect2centre1, vect2centre2, i, i1, -range[i]/2.0*sign[i],&intersection1,box_l);
-	  if (intersection1 > box_l[i1]/2) intersection1 -= box_l[i1];
-	  if (fabs(intersection1) < range[i1]/2.0) {
-	    getintersection(vect2centre1, vect2centre2, i, i2, -range[i]/2.0*sign[i],&intersection2,box_l);
-	    if (intersection2 > box_l[i2]/2) intersection2 -= box_l[i2];
-	    if (fabs(intersection2) < range[i2]/2.0) {
-	      found_entry = 1;
-	      entry[i] = centre[i] -range[i]/2.0*sign[i];
-	      entry[i1] = centre[i1] + intersection1;
-	      entry[i2] = centre[i2] + intersection2;
-	      *facein = i; 
-	    }
-	  }
-	}
-      }
-    }
-  } else {
-    entry[0] = pos1[0];
-    entry[1] = pos1[1];
-    entry[2] = pos1[2];
-  }
-  if (! (found_entry) && ! (inside1)) {
-    PTENSOR_TRACE(fprintf(stderr,"%d: does_line_go_through_cube: Line does not pass through cube \n",this_node););
-    return 0;
-  } else {
-    PTENSOR_TRACE(fprintf(stderr,"%d: does_line_go_through_cube: Entry is %f %f %f \n",this_node,entry[0], entry[1], entry[2]););
-    if (! inside2) {
-      /*check which outside faces of box the line exits through */
-      for (i=0;i<3;i++) {
-	i1 = (i+1)%3;
-	i2 = (i+2)%3;
-	/* does it enter into the box through the i face */
-	if ((found_exit == 0) && (fabs(vect2centre2[i]) > range[i]/2.0)) {  /*starts outside cube in i direction */
-	  getintersection(vect2centre1, vect2centre2, i, i1, range[i]/2.0*sign[i],&intersection1,box_l);
-	  if (intersection1 > box_l[i1]/2) intersection1 -= box_l[i1];
-	  if (fabs(intersection1) < range[i1]/2.0) {
-	    getintersection(vect2centre1, vect2centre2, i, i2, range[i]/2.0*sign[i],&intersection2,box_l);
-	    if (intersection2 > box_l[i2]/2) intersection2 -= box_l[i2];
-	    if (fabs(intersection2) < range[i2]/2.0) {
-	      found_exit = 1;
-	      exit[i] = centre[i]   + range[i]/2.0*sign[i];
-	      exit[i1] = centre[i1] + intersection1;
-	      exit[i2] = centre[i2] + intersection2;
-	      *faceout = i; 
-	    }
-	  }
-	}
-      }
-    } else {
-      exit[0] = pos2[0];
-      exit[1] = pos2[1];
-      exit[2] = pos2[2];
-    }
-    PTENSOR_TRACE(fprintf(stderr,"%d: does_line_go_through_cube: Exit is %f %f %f\n",this_node,exit[0], exit[1], exit[2]););
-  }
-    PTENSOR_TRACE(fprintf(stderr,"%d: does_line_go_through_cube: facein is %d faceout is %d\n",this_node,*facein,*faceout););
-  return 1;
-}
-
-int distribute_tensors(DoubleList *TensorInBin, double *force, int bins[3], double range_start[3], double range[3], double pos1[3], double pos2[3])
-{
-  /*calculates how to distribute a force tensor between two particles between various bins
-    the amount distributed to a bin is proportional to the length of the line between the
-      two particles p1 and p2 that passes through the bin volume
-    we consider a cube of space starting with a corner at {x_range_start, y_range_start, z_range_start} extending to 
-      {x_range_start+x_range, y_range_start+y_range, z_range_start+z_range}
-    this cube is split into x_bins bins in the x direction - we refer to these as x-bins
-    each x-bin into y_bins bins in the y direction - we refer to these as y-bins
-    each y_bin into z_bins bins in the z direction - we refer to these as z-bins
-  */
-
-  int sign[3],sign10[3];    /* indicates whether the line goes in the positive or negative direction in each dimension */
-  double entry[3], exit[3]; /* the positions at which the line enters and exits the cube */
-  int startx, endx;         /* x-bins in which the line starts and ends in */
-  int occupiedxbins;        /* number of x-bins occuped by the line */
-  int *starty;              /* y-bins in which the line starts in for each x-bin.  This array has dimension occupiedxbins+1. */
-  int totoccupiedybins;     /* total number of y-bins through which the line passes  */
-  int *occupiedybins;       /* number of occupied y-bins for each x-bin */
-  int *occupiedzbins;       /* number of occupied z-bins for each y-bin */
-  int *startz;              /* z-bins in which the line starts in for each y_bin.  This array has dimension totaloccupiedybins. */
-  int xbin, ybin, zbin;     /* counters to keep track of bins x_bin goes from 0 to x_bins-1, y_bins from 0 to y_bins-1, z_bins from 0 to Z-bins-1 */
-  int i ,k, l;    
-  int counter;              /* keeps track of where we are in the startz array */
-  int zi;                           
-  double length;            /* length of line between the two points */
-  int d1,d2;                /* for each z-bin d1 and d2 are calculated.  they indicate through which faces of the bin the line enters and leaves the bin.  i.e. if the line enters through the face corresponding to y = 0.34 then d1 = 1 (y-direction) and val1 = 0.34 */
-  double val1, val2;
-  double intersect;
-  double segment,segment2;
-  double calclength;        
-  int xa, ya, za;           /* counters for bins */
-  double temp[3];
-  double redentry[3], redexit[3];  /* like entry and exit but using a coordinate system where range_start corresponds to (0,0,0) and the length scale in each direction is the bin width */
-  double redbox_l[3];       /* box size is reduced units */
-  int facein,faceout;
-
-  PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: Distributing tensors for particle p1 %f %f %f and p2 %f %f %f\n",this_node,pos1[0],pos1[1],pos1[2],pos2[0],pos2[1],pos2[2]););
-  PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: range_start is %f %f %f range is %f %f %f bins is %d %d %d\n",this_node,range_start[0],range_start[1],range_start[2],range[0],range[1],range[2],bins[0],bins[1],bins[2]););
-  /* work out what direction the line joining the particles goes in */
-  length = 0;
-  get_mi_vector(temp, pos2, pos1);
-  for (i=0;i<3;i++) {
-    sign[i] = (temp[i] > 0)*2-1;
-    sign10[i]  = (sign[i]+1)/2.0;
-  }
-  PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: sign is %d %d %d\n",this_node,sign[0],sign[1],sign[2]););
-  
-  calclength = 0;
-
-  /* check if the line passes through the cube and if so where it enters and exits it */
-  if (does_line_go_through_cube(pos1, pos2, range_start, range, sign, entry, exit,&facein,&faceout)) {
-    
-    /* calculate reduced coordinates */
-    /* range_start becomes (0,0,0) and range_start + range becomes (bins[0],bins[1],bins[2]) */
-    get_mi_vector(redentry, entry, range_start);
-    get_mi_vector(redexit, exit, range_start);
-    for (i=0;i<3;i++) {
-      redentry[i] = drem_down(redentry[i]+box_l[i],box_l[i]);
-      redexit[i] = drem_down(redexit[i]+box_l[i],box_l[i]);
-    }
-    length = 0;
-    get_mi_vector(temp, exit, entry);
-    for (i=0;i<3;i++) {
-      redentry[i] = redentry[i]/range[i]*bins[i];
-      redexit[i] = redexit[i]/range[i]*bins[i];
-      length += pow(temp[i],2);
-    }
-    length = pow(length,0.5);
-    PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: Reduced Entry is %f %f %f Reduced Exit is %f %f %f \n",this_node,redentry[0],redentry[1],redentry[2],redexit[0], redexit[1], redexit[2]););
-
-    for (i=0;i<3;i++) {
-      redbox_l[i] = box_l[i]/range[i]*bins[i];
-    }
-   
-    /* find in which x-bins the line starts and stops */ 
-    if (facein == 0) {
-      startx = dround(redentry[0]) - 1 + sign10[0];
-    } else {
-      startx = floor(redentry[0]);
-    }
-    if ((startx < 0) && (range[0]==box_l[0])) startx += bins[0];
-    if (faceout == 0) {
-      endx = dround(redexit[0] - sign10[0]);
-    } else {
-      endx = floor(redexit[0]);
-    }
-    if ((endx < 0) && (range[0]==box_l[0])) startx += bins[0];
-    occupiedxbins = (sign[0]*(endx-startx) + bins[0])%bins[0] +1;
-  
-    PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: x goes from %d to %d\n",this_node,startx, endx);)
-    /* Initialise starty array */
-    starty = (int *)Utils::malloc(sizeof(int)*(occupiedxbins+1));
-    occupiedybins = (int *)Utils::malloc(sizeof(int)*occupiedxbins);
-
-    /* find in which y-bins the line starts and stops for each x-bin */
-    /* in xbin the line starts in y-bin number starty[xbin-startx] and ends in starty[xbin-startx+1] */
-    totoccupiedybins = 0;
-    if (facein == 1) {
-      starty[0] = dround(redentry[1]) - 1 + sign10[1];
-    } else {
-      starty[0] = floor(redentry[1]);
-    }
-    if ((starty[0] < 0) && (range[1]==box_l[1])) starty[0] += bins[1];
-    for (xa=0; xa < occupiedxbins; xa++) {
-      xbin = (startx + xa*sign[0]+bins[0])%bins[0];
-      if (xbin == endx) {
-	intersect  = redexit[1];
-	if (faceout == 1) intersect -= sign10[1];
-	if (( intersect < 0) && (range[1]==box_l[1])) intersect += bins[1];
-      } else {
-	if (getintersection(redentry,redexit,0,1,xbin+sign10[0],&intersect,redbox_l) != 1) return 0;
-      }
-      starty[xa+1]=floor(intersect);
-      occupiedybins[xa] = ((starty[xa+1]-starty[xa])*sign[1]+bins[1])%bins[1]+1;
-      totoccupiedybins += occupiedybins[xa];
-      PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: in xbin %d y goes from %d to %d\n",this_node, xbin, starty[xa],starty[xa+1]););
-    }
-
-    /* Initialise startz array */
-    occupiedzbins = (int *)Utils::malloc(sizeof(int)*totoccupiedybins);
-    startz = (int *)Utils::malloc(sizeof(int)*(totoccupiedybins+1));
-    /* find in which z-bins the line starts and stops for each y-bin*/
-    counter = 0;
-    if (facein == 2) {
-      zi = dround(redentry[2]) - 1 + sign10[2];
-    } else {
-      zi = floor(redentry[2]);
-    }
-    if (( zi < 0) && (range[2]==box_l[2])) zi += bins[2];
-    startz[counter] = zi;
-
-    for (xa=0; xa < occupiedxbins; xa++) {
-      xbin = (startx + xa*sign[0]+bins[0])%bins[0];
-      for (ya = 0; ya < occupiedybins[xa]-1; ya++) {
-	ybin = (starty[xa] + ya*sign[1] + bins[1])%bins[1];
-	PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: xbin is %d ya is %d, occupiedybins[xa] is %d, ybin is %d\n",this_node,xbin,ya,occupiedybins[xa],ybin););
-	if (getintersection(redentry,redexit,1,2,ybin+sign10[1],&intersect,redbox_l) != 1) return 0;
-	zi = floor(intersect);
-	startz[counter+1] = zi;
-	occupiedzbins[counter]= (sign[2]*(startz[counter+1]-startz[counter]) + bins[2])%bins[2] +1;
-	PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: in xbin %d ybin %d zbin goes from %d to %d\n",this_node,xbin,ybin,startz[counter],startz[counter+1]););
-	counter ++;
-      }
-      ybin = starty[xa+1];
-      if (xbin == endx) {
-	if (faceout == 2) {
-	  zi = dround(redexit[2] -sign10[2]);
-	} else {
-	  zi = floor(redexit[2]);
-	}
-	if (( zi < 0) && (range[2]==box_l[2])) zi += bins[2];
-      
-      } else {
-	if (getintersection(redentry,redexit,0,2,xbin+sign10[0], &intersect, redbox_l) != 1) return 0;
-	zi = floor(intersect);
-      }
-      startz[counter+1]=zi;
-      occupiedzbins[counter]= (sign[2]*(startz[counter+1]-startz[counter]) + bins[2])%bins[2] +1;
-      PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: in xbin %d ybin %d zbin goes from %d to %d\n",this_node,xbin,ybin,startz[counter],startz[counter+1]););
-      counter ++;
-    }
-    PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: occupiedxbins is %d,occupiedybins[0] is %d, occupiedzbins[0] is %d\n",this_node,occupiedxbins,occupiedybins[0],occupiedzbins[0]););
-
-    /* find out what length of the line passes through each z-bin */
-    counter = 0;
-    for (xa = 0; xa < occupiedxbins; xa ++) {
-      xbin = (startx + xa*sign[0]+bins[0])%bins[0];
-      for (ya = 0; ya < occupiedybins[xa]; ya++) {
-	ybin = (starty[xa] + ya*sign[1] + bins[1])%bins[1];
-	for (za = 0; za < occupiedzbins[counter]; za++) {
-	  zbin = (startz[counter] + za*sign[2] +bins[2])%bins[2];
-	  if (zbin == startz[counter]) {
-	    if (ybin == starty[xa]) {
-	      if (xbin == startx) {
-		if (entry[0]-exit[0] != 0) {
-		  d1 = 0;
-		  val1 = redentry[0];
-		} else if (entry[1]-exit[1] != 0){
-		  d1 = 1;
-		  val1 = redentry[1];
-		} else {
-		  d1 = 2;
-		  val1 = redentry[2];
-		}                                                        
-		PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: %d %d %d line starts at point p1 inside bin\n",this_node,xbin,ybin,zbin););
-	      } else {
-		d1 = 0;
-		val1  = xbin+1-sign10[0];
-		PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: %d %d %d line enters through x = %e face of box\n",this_node,xbin,ybin,zbin,val1););
-	      }  
-	    } else {
-	      d1 = 1;
-	      val1 = ybin+1-sign10[1];        
-	      PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: %d %d %d line enters through y = %e face of box\n",this_node,xbin,ybin,zbin,val1););
-	    }
-	  } else {
-	    d1 = 2;
-	    val1 = zbin+1-sign10[2]; 
-	    PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: %d %d %d line enters through z = %e face of box zbin is %d\n",this_node,xbin,ybin,zbin,val1,zbin););
-	  }
-	  if (zbin == startz[counter+1]) {
-	    if (ybin == starty[xa+1]) {
-	      if (xbin == endx) {
-		if (entry[0]-exit[0] != 0) {
-		  d2 = 0;
-		  val2 = redexit[0];
-		} else if (entry[1]-exit[1]!= 0){
-		  d2 = 1;
-		  val2 = redexit[1];
-		} else {
-		  d2 = 2;
-		  val2 = redexit[2];
-		}                                                      
-		PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: %d %d %d line ends at p2 inside bin\n",this_node,xbin,ybin,zbin););
-	      }
-	      else {
-		d2 = 0;
-		val2 = xbin+sign10[0];
-		PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: %d %d %d line leaves through x = %e face of box\n",this_node,xbin,ybin,zbin,val2););
-	      }
-	    }
-	    else {
-	      d2 = 1;
-	      val2 = ybin+sign10[1]; 
-	      PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: %d %d %d line leaves through y = %e face of box direction %d\n",this_node,xbin,ybin,zbin,val2,sign[1]););
-	    }
-	  }
-        else {
-          d2= 2;
-          val2 = zbin+sign10[2];
-	  PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: %d %d %d line leaves through z = %e face of box\n",this_node,xbin,ybin,zbin,val2););
-        }
-	  segment2 = 0;
-	    PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: entry %f %f %f exit %f %f %f d1 %d val1 %f d2 %d val2 %f\n",this_node,entry[0],entry[1],entry[2],exit[0],exit[1],exit[2],d1,range_start[d1]+val1*range[d1]/(double)bins[d1],d2,range_start[d2]+val2*range[d2]/(double)bins[d2]););
-	  for (l=0;l<3;l++) {
-	    if (getlength(entry,exit,d1,range_start[d1]+val1*range[d1]/(double)bins[d1],d2,range_start[d2]+val2*range[d2]/(double)bins[d2],l,&segment) != 1) return 0;
-	    segment2 += pow(segment,2);
-	    for (k=0;k<3;k++) {
-	      TensorInBin[xbin*bins[1]*bins[2]+ybin*bins[2]+zbin].e[3*k+l] += force[k] * segment;
-	    }
-	  }
-	  calclength += pow(segment2,0.5);
-	}
-	counter ++;
-      }
-    }
-    PTENSOR_TRACE(fprintf(stderr,"%d: distribute_tensors: calclength is %e and length is %e\n}",this_node,calclength,length););
-    
-    if (calclength - length >0.0000000001) {
-        runtimeErrorMsg() << this_node << ": analyze stress_profile: bug in distribute tensor code - calclength is " << calclength << " and length is " << length;
-      return 0;
-    }
-    free(occupiedzbins);
-    free(occupiedybins);
-    free(starty);
-    free(startz);
-  }
-  return 1;
-} 
-
-int reducepos(double pos[3], int bins[3], double centre[3], double range[3], int reducedpos[3]) {
-  int i;
-  double working[3];
-  get_mi_vector(working, pos, centre);
-  for (i=0;i<3;i++) {
-    reducedpos[i] = floor((working[i]+range[i]/2.0)*(double)bins[i]/range[i]);
-  }
-  return 1; 
-}
-
-int incubewithskin(double pos[3], double centre[3], double range[3])
-{
-  double working[3];
-  int i;
-  get_mi_vector(working, pos, centre);
-  for (i=0; i <3; i++) {
-    if (fabs(working[i]) > range[i]/2.0 + skin+max_cut) return 0;
-  }
-  return 1; 
-}
-
-int whichbin(double pos[3], int bins[3], double centre[3], double range[3], int *bin)
-/*calculates which bin a particle is in for local_stress_tensor */
-{
-  int reducedpos[3];
-  int i;
-  reducepos(pos, bins, centre, range, reducedpos);
-  for (i=0;i<3;i++) {
-    if ((reducedpos[i] < 0) || (reducedpos[i] >= bins[i])) {
-      *bin = -1;
-      return 1;
-    }
-  }
-  *bin = reducedpos[0]*bins[1]*bins[2] + reducedpos[1]*bins[2] + reducedpos[2];
-  return 1;
-}
-
 int get_nonbonded_interaction(Particle *p1, Particle *p2, double *force)
 {
   /* returns the non_bonded interaction between two particles */
@@ -902,53 +441,37 @@ int get_nonbonded_interaction(Particle *p1, Particle *p2, double *force)
 int local_stress_tensor_calc(DoubleList *TensorInBin, int bins[3], int periodic[3], double range_start[3], double range[3])
 {
   /*calculates local stress tensors in cuboid bins
-    uses Irving Kirkwood method
+    uses Irving Kirkwood method, see LocalStressGrid
     we consider a cube of space starting with a corner at position range_start extending to 
       range_start + range
     if the variable periodic is set to 1 in dimension i then the cube is assumed to span the periodic box
     this cube is divided into bins[0] bins in the x direction bins[1] in the y direction, and bins[2] in the z direction
+    the pairs of this node are binned here, mpi_local_stress_tensor sums up the nodes
   */
 
-  int i,j;                       /*counter for dimension */
-  double binvolume;
-  int c, np, n, bin;
-  double centre[3];
+  int i,j;
+  int c, np, n;
   Cell *cell;
   Particle *p1, *p2, **pairs;
   Particle *particles;
   double force[3];
-  int k,l;
   int type_num;
   Bonded_ia_parameters *iaparams;
   double dx[3];
 
-  
-  for (i = 0; i < 3; i ++) {
-    if (periodic[i]) {
-      range[i] = box_l[i];
-      range_start[i] = 0;
-    }
-  }
-
-  /* find centre of analyzed cube */
   for (i=0;i<3;i++) {
-    centre[i] = range_start[i] + range[i]/2.0;
-  }
-
-  /* We consider all particles that are within a certain distance of the cube. The skin is used as this distance.  If the
-     skin from on opposite sides of the box overlaps then we produce an error message.  To code dround this would be
-     creating unnecessary work since I can't imagine when we might want that */
-
-  for (i=0;i<3;i++) {
-    if ((! periodic[i]) && (range[i] + 2*skin +2*max_cut > box_l[i])) {
-        runtimeErrorMsg() <<"analyze stress_profile: Analyzed box (" << range[i] << ") with skin+max_cut(" << skin+max_cut << ") is larger than simulation box (" << box_l[i] << ").\n";
+    if ((! periodic[i]) && (range[i] > box_l[i])) {
+        runtimeErrorMsg() <<"analyze stress_profile: Analyzed box (" << range[i] << ") is larger than simulation box (" << box_l[i] << ").\n";
       return 0;
     }
-    range_start[i] = drem_down(range_start[i],box_l[i]);
   }
   PTENSOR_TRACE(fprintf(stderr,"%d: Running stress_profile\n",this_node));
 
-  binvolume = range[0]*range[1]*range[2]/(double)bins[0]/(double)bins[1]/(double)bins[2];
+  LocalStressGrid grid(periodic, range_start, range, bins);
+
+  on_observable_calc();
+  if (rebuild_verletlist)
+    build_verlet_lists();
 
   /* this next bit loops over all pair of particles, calculates the force between them, and distributes it amongst the tensors */
 
@@ -960,20 +483,8 @@ int local_stress_tensor_calc(DoubleList *TensorInBin, int bins[3], int periodic[
     // loop over all particles in this cell
     for(i = 0; i < np; i++)  {
       p1 = &(particles[i]);
-      whichbin(p1->r.p,bins,centre, range, &bin); 
-      if (bin >= 0) {
-	PTENSOR_TRACE(fprintf(stderr,"%d:Got particle number %d i is %d pos is %f %f %f \n",this_node,p1->p.identity,i,p1->r.p[0],p1->r.p[1],p1->r.p[2]));
-	PTENSOR_TRACE(fprintf(stderr,"%d:Ideal gas component is {",this_node));
-	for(k=0;k<3;k++) {
-	  for(l=0;l<3;l++) {
-	    TensorInBin[bin].e[k*3 + l] += (p1->m.v[k])*(p1->m.v[l])*(*p1).p.mass/time_step/time_step;
-	    PTENSOR_TRACE(fprintf(stderr,"%f ",(p1->m.v[k])*(p1->m.v[l])*(*p1).p.mass/time_step/time_step));
-	  }
-	}
+      grid.add_kinetic(*p1);
 
-	PTENSOR_TRACE(fprintf(stderr,"}\n"));
-      }
-      
       /* bonded contributions */
       j = 0;
       while(j < p1->bl.n) {
@@ -985,9 +496,7 @@ int local_stress_tensor_calc(DoubleList *TensorInBin, int bins[3], int periodic[
 	get_mi_vector(dx, p1->r.p, p2->r.p);
 	calc_bonded_force(p1,p2,iaparams,&j,dx,force);
 	PTENSOR_TRACE(fprintf(stderr,"%d: Bonded to particle %d with force %f %f %f\n",this_node,p2->p.identity,force[0],force[1],force[2]));
-	if ((pow(force[0],2)+pow(force[1],2)+pow(force[2],2)) > 0) {
-	  if (distribute_tensors(TensorInBin,force,bins,range_start,range,p1->r.p, p2->r.p) != 1) return 0;
-	}
+	grid.add_pair(p1->r.p, dx, force);
       }
     }
 
@@ -1000,22 +509,18 @@ int local_stress_tensor_calc(DoubleList *TensorInBin, int bins[3], int periodic[
       for(i=0; i<2*np; i+=2) {
 	p1 = pairs[i];                    // pointer to particle 1
 	p2 = pairs[i+1];                  // pointer to particle 2
-	if ((incubewithskin(p1->r.p,centre,range)) && (incubewithskin(p2->r.p,centre,range))) {
-	  get_nonbonded_interaction(p1,p2, force);
-	  PTENSOR_TRACE(fprintf(stderr,"%d:Looking at pair %d %d force is %f %f %f\n",this_node,p1->p.identity, p2->p.identity,force[0],force[1], force[2]));
-	  if ((pow(force[0],2)+pow(force[1],2)+pow(force[2],2)) > 0) {
-	    if (distribute_tensors(TensorInBin,force,bins,range_start,range,p1->r.p, p2->r.p) != 1) return 0;
-	  }
-	} else {
-	  // PTENSOR_TRACE(fprintf(stderr,"%d:Looking at pair %d %d not in cube with skin\n",this_node,p1->p.identity, p2->p.identity));
-	}
+	get_nonbonded_interaction(p1,p2, force);
+	PTENSOR_TRACE(fprintf(stderr,"%d:Looking at pair %d %d force is %f %f %f\n",this_node,p1->p.identity, p2->p.identity,force[0],force[1], force[2]));
+	get_mi_vector(dx, p1->r.p, p2->r.p);
+	grid.add_pair(p1->r.p, dx, force);
       }
     }
   }
 
+  double binvolume = grid.bin_volume();
   for (i=0;i<bins[0]*bins[1]*bins[2];i++) {
     for (j=0;j<9;j++) {
-	TensorInBin[i].e[j] /= binvolume;
+	TensorInBin[i].e[j] = grid.tensors()[9*i + j]/binvolume;
     }
   }
 
@@ -165,7 +165,7 @@ void integrate_reaction_noswap() {
               bernoulli = pow(ct_ratexp, p1[i].p.catalyzer_count);
 
               if(rand > bernoulli) {
-                p1[i].p.type = reaction.product_type; }
+                local_set_particle_type(&p1[i], reaction.product_type); }
             
             }
             else /* We only consider each reactant once */
@@ -173,7 +173,7 @@ void integrate_reaction_noswap() {
               rand = d_random();
 
               if(rand > ct_ratexp) {
-                p1[i].p.type = reaction.product_type; }
+                local_set_particle_type(&p1[i], reaction.product_type); }
             }
             
             p1[i].p.catalyzer_count = 0;
@@ -201,14 +201,14 @@ void integrate_reaction_noswap() {
             rand = d_random();
             
             if(rand > eq_ratexp) {
-              p1[i].p.type=reaction.reactant_type;
+              local_set_particle_type(&p1[i], reaction.reactant_type);
             }
           }
           else if(p1[i].p.type == reaction.reactant_type) {
             rand = d_random();
             
             if(rand > eq_ratexp) {
-              p1[i].p.type=reaction.product_type;
+              local_set_particle_type(&p1[i], reaction.product_type);
             }
           }
 
@@ -395,9 +395,9 @@ void integrate_reaction_swap()
           
           // Flip type
           if ( p_local[i].p.type == reaction.reactant_type )
-            p_local[i].p.type = reaction.product_type;
+            local_set_particle_type(&p_local[i], reaction.product_type);
           else
-            p_local[i].p.type = reaction.reactant_type;
+            local_set_particle_type(&p_local[i], reaction.reactant_type);
 
           // Reset the tag for the next step
           p_local[i].p.catalyzer_count = 0;
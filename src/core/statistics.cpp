@@ -30,6 +30,7 @@
 #include "statistics_molecule.hpp"
 #include "statistics_cluster.hpp"
 #include "statistics_fluid.hpp"
+#include "statistics_parallel.hpp"
 //#include "statistics_correlation.hpp"
 #include "energy.hpp"
 #include "modes.hpp"
@@ -43,10 +44,17 @@
 #include "lb.hpp"
 #include "virtual_sites.hpp"
 #include "initialize.hpp"
+#include "ctraj.hpp"
+#include "position_index.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <complex>
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include <cstdio>
 
 /** Previous particle configurations (needed for offline analysis and
     correlation analysis in \ref tclcommand_analyze) */
@@ -68,38 +76,82 @@ double min_distance2(double pos1[3], double pos2[3])
  *                                 basic observables calculation
  ****************************************************************************************/
 
-double mindist(IntList *set1, IntList *set2)
+/** Append a type list to the parameters of an analysis, as its length
+    followed by the types. A missing list, meaning all types, has length -1. */
+static void encode_type_set(IntList *set, std::vector<double> &params)
 {
-  double mindist, pt[3];
-  int i, j, in_set;
+  if (!set) {
+    params.push_back(-1);
+    return;
+  }
+  params.push_back(set->n);
+  for (int i = 0; i < set->n; i++)
+    params.push_back(set->e[i]);
+}
 
-  mindist = SQR(box_l[0] + box_l[1] + box_l[2]);
+/** Check whether a type is in a type list encoded at params[pos], and
+    advance pos behind the list. */
+static bool decode_type_set(const std::vector<double> &params, size_t &pos,
+                            int type)
+{
+  int n = params[pos++];
+  bool found = (n == -1);
+  for (int i = 0; i < n; i++)
+    if (params[pos + i] == type)
+      found = true;
+  pos += std::max(n, 0);
+  return found;
+}
 
-  updatePartCfg(WITHOUT_BONDS);
-  for (j=0; j<n_part-1; j++) {
-    pt[0] = partCfg[j].r.p[0];
-    pt[1] = partCfg[j].r.p[1];
-    pt[2] = partCfg[j].r.p[2];
-    /* check which sets particle j belongs to
-       bit 0: set1, bit1: set2
-    */
-    in_set = 0;
-    if (!set1 || intlist_contains(set1, partCfg[j].p.type))
-      in_set = 1;
-    if (!set2 || intlist_contains(set2, partCfg[j].p.type))
-      in_set |= 2;
-    if (in_set == 0)
+static void local_mindist(const std::vector<double> &params,
+                          std::vector<double> &result)
+{
+  /* positions of the particles in any of the sets, followed by the set
+     bits: bit 0: set1, bit1: set2 */
+  std::vector<double> mine;
+  for_each_local_particle([&](const Particle &p) {
+      size_t pos = 0;
+      int in_set = 0;
+      if (decode_type_set(params, pos, p.p.type))
+        in_set = 1;
+      if (decode_type_set(params, pos, p.p.type))
+        in_set |= 2;
+      if (in_set) {
+        mine.insert(mine.end(), p.r.p, p.r.p + 3);
+        mine.push_back(in_set);
+      }
+    });
+
+  int offset;
+  std::vector<double> all = allgather_analysis_data(mine, &offset);
+  int first = offset/4, last = (offset + mine.size())/4, n = all.size()/4;
+
+  /* every node looks up the nearest set2 point of its own set1 points,
+     tagged with their index to exclude the point itself */
+  PositionIndex set2(0.0, n);
+  for (int j = 0; j < n; j++)
+    if (int(all[4*j + 3]) & 2)
+      set2.add(&all[4*j], j);
+
+  double mind2 = SQR(box_l[0] + box_l[1] + box_l[2]);
+  for (int i = first; i < last; i++) {
+    if (!(int(all[4*i + 3]) & 1))
       continue;
-
-    for (i=j+1; i<n_part; i++)
-      /* accept a pair if particle j is in set1 and particle i in set2 or vice versa. */
-      if (((in_set & 1) && (!set2 || intlist_contains(set2, partCfg[i].p.type))) ||
-          ((in_set & 2) && (!set1 || intlist_contains(set1, partCfg[i].p.type))))
-        mindist = std::min(mindist, min_distance2(pt, partCfg[i].r.p));
+    double d = set2.nearest(&all[4*i], i);
+    if (d >= 0.0)
+      mind2 = std::min(mind2, d*d);
   }
-  mindist = std::sqrt(mindist);
+  result.assign(1, mind2);
+}
 
-  return mindist;
+static ParallelAnalysis mindist_job(local_mindist, ANALYSIS_MIN);
+
+double mindist(IntList *set1, IntList *set2)
+{
+  std::vector<double> params;
+  encode_type_set(set1, params);
+  encode_type_set(set2, params);
+  return std::sqrt(mindist_job(params)[0]);
 }
 
 void merge_aggregate_lists(int *head_list, int *agg_id_list, int p1molid, int p2molid, int *link_list)
@@ -274,94 +326,144 @@ std::vector<double> calc_linear_momentum(int include_particles, int include_lbfl
 }
 
 
-std::vector<double> centerofmass(int type)
+/** Run an analysis from the master, or collectively during the
+    integration. */
+static std::vector<double> run_analysis(const ParallelAnalysis &job,
+                                        const std::vector<double> &params,
+                                        bool collective)
 {
-    std::vector<double> com (3);
-    double mass = 0.0;
-    
-    updatePartCfg(WITHOUT_BONDS);
-    for (int i=0; i<n_part; i++) {
-        if ((partCfg[i].p.type == type) || (type == -1)) {
-            for (int j=0; j<3; j++) {
-                com[j] += partCfg[i].r.p[j]*(partCfg[i]).p.mass;
-            }
-            mass += (partCfg[i]).p.mass;
+  return collective ? job.collective(params) : job(params);
+}
+
+static void local_centerofmass(const std::vector<double> &params,
+                               std::vector<double> &result)
+{
+  int type = params[0];
+  result.assign(4, 0.0);
+  for_each_local_particle([&](const Particle &p) {
+      if ((p.p.type == type) || (type == -1)) {
+        double pos[3];
+        get_unfolded_position(p, pos);
+        for (int j=0; j<3; j++) {
+          result[j] += pos[j]*p.p.mass;
         }
-    }
-    for (int j=0; j<3; j++) com[j] /= mass;
+        result[3] += p.p.mass;
+      }
+    });
+}
+
+static ParallelAnalysis centerofmass_job(local_centerofmass, ANALYSIS_SUM);
+
+std::vector<double> centerofmass(int type, bool collective)
+{
+    std::vector<double> sums =
+      run_analysis(centerofmass_job, {double(type)}, collective);
+    std::vector<double> com (3);
+    for (int j=0; j<3; j++) com[j] = sums[j]/sums[3];
     return com;
 }
 
+static void local_centerofmass_vel(const std::vector<double> &params,
+                                   std::vector<double> &result)
+{
+  int type = params[0];
+  result.assign(4, 0.0);
+  for_each_local_particle([&](const Particle &p) {
+      if (type == p.p.type) {
+        for (int i=0; i<3; i++) {
+          result[i] += p.m.v[i];
+        }
+        result[3] += 1.0;
+      }
+    });
+}
+
+static ParallelAnalysis centerofmass_vel_job(local_centerofmass_vel,
+                                             ANALYSIS_SUM);
 
 std::vector<double> centerofmass_vel(int type)
 {
     /*center of mass velocity scaled with time_step*/
+    std::vector<double> sums = centerofmass_vel_job({double(type)});
     std::vector<double> com_vel (3);
-    int i, j;
-    int count = 0;
-
-    updatePartCfg(WITHOUT_BONDS);
-    for (j=0; j<n_part; j++) {
-        if (type == partCfg[j].p.type) {
-            for (i=0; i<3; i++) {
-            	com_vel[i] += partCfg[j].m.v[i];
-            }
-            count++;
-        }
-    }
-
-    for (i=0; i<3; i++) {
-        com_vel[i] /= count;
+    for (int i=0; i<3; i++) {
+        com_vel[i] = sums[i]/sums[3];
     }
     return com_vel;
 }
 
+static void local_angularmomentum(const std::vector<double> &params,
+                                  std::vector<double> &result)
+{
+  int type = params[0];
+  result.assign(3, 0.0);
+  for_each_local_particle([&](const Particle &p) {
+      if (type == p.p.type) {
+        double pos[3], v[3], tmp[3];
+        get_unfolded_position(p, pos);
+        for (int i=0; i<3; i++)
+          v[i] = p.m.v[i];
+        vector_product(pos,v,tmp);
+        for (int i=0; i<3; i++) {
+          result[i] += tmp[i]*p.p.mass;
+        }
+      }
+    });
+}
+
+static ParallelAnalysis angularmomentum_job(local_angularmomentum,
+                                            ANALYSIS_SUM);
+
 void angularmomentum(int type, double *com)
 {
-  int i, j;
-  double tmp[3];
-  double pre_factor;
-  com[0]=com[1]=com[2]=0.;
+  std::vector<double> sums = angularmomentum_job({double(type)});
+  for (int i=0; i<3; i++)
+    com[i] = sums[i];
+}
 
-  updatePartCfg(WITHOUT_BONDS);
-  for (j=0; j<n_part; j++) 
-  {
-    if (type == partCfg[j].p.type) 
-    {
-      vector_product(partCfg[j].r.p,partCfg[j].m.v,tmp);
-      pre_factor=(partCfg[j]).p.mass;
-      for (i=0; i<3; i++) {
-        com[i] += tmp[i]*pre_factor;
+/** Second moments of the particles of a type around a center, as
+    xx, xy, xz, yy, yz, zz, followed by the total mass and the number
+    of particles. Parameters: type, center. */
+static void local_second_moments(const std::vector<double> &params,
+                                 std::vector<double> &result)
+{
+  int type = params[0];
+  bool weighted = params[4];
+  result.assign(8, 0.0);
+  for_each_local_particle([&](const Particle &p) {
+      if ((p.p.type == type) || (type == -1)) {
+        double p1[3];
+        get_unfolded_position(p, p1);
+        for (int i=0; i<3; i++)
+          p1[i] -= params[1 + i];
+        double w = weighted ? p.p.mass : 1.0;
+        result[0] += w * p1[0]*p1[0];
+        result[1] += w * p1[0]*p1[1];
+        result[2] += w * p1[0]*p1[2];
+        result[3] += w * p1[1]*p1[1];
+        result[4] += w * p1[1]*p1[2];
+        result[5] += w * p1[2]*p1[2];
+        result[6] += p.p.mass;
+        result[7] += 1.0;
       }
-    }
-  }
-  return;
+    });
 }
 
-void momentofinertiamatrix(int type, double* MofImatrix)
+static ParallelAnalysis second_moments_job(local_second_moments,
+                                           ANALYSIS_SUM);
+
+void momentofinertiamatrix(int type, double* MofImatrix, bool collective)
 {
-  int i,j,count;
-  double p1[3],massi;
-  std::vector<double> com (3);
-  count=0;
-  updatePartCfg(WITHOUT_BONDS);
-  for(i=0;i<9;i++) MofImatrix[i]=0.;
-  com = centerofmass(type);
-  for (j=0; j<n_part; j++) {
-    if (type == partCfg[j].p.type) {
-      count ++;
-      for (i=0; i<3; i++) {
-      	p1[i] = partCfg[j].r.p[i] - com[i];
-      }
-      massi= (partCfg[j]).p.mass;
-      MofImatrix[0] += massi * (p1[1] * p1[1] + p1[2] * p1[2]) ; 
-      MofImatrix[4] += massi * (p1[0] * p1[0] + p1[2] * p1[2]);
-      MofImatrix[8] += massi * (p1[0] * p1[0] + p1[1] * p1[1]);
-      MofImatrix[1] -= massi * (p1[0] * p1[1]);
-      MofImatrix[2] -= massi * (p1[0] * p1[2]); 
-      MofImatrix[5] -= massi * (p1[1] * p1[2]);
-    }
-  }
+  std::vector<double> com = centerofmass(type, collective);
+  std::vector<double> m =
+    run_analysis(second_moments_job,
+                 {double(type), com[0], com[1], com[2], 1.0}, collective);
+  MofImatrix[0] = m[3] + m[5];
+  MofImatrix[4] = m[0] + m[5];
+  MofImatrix[8] = m[0] + m[3];
+  MofImatrix[1] = -m[1];
+  MofImatrix[2] = -m[2];
+  MofImatrix[5] = -m[4];
   /* use symmetry */
   MofImatrix[3] = MofImatrix[1]; 
   MofImatrix[6] = MofImatrix[2]; 
@@ -371,43 +473,33 @@ void momentofinertiamatrix(int type, double* MofImatrix)
 
 void calc_gyration_tensor(int type, std::vector<double>& gt)
 {
-  int i, j, count;
+  int i, j;
   std::vector<double> com (3);
   double eva[3],eve0[3],eve1[3],eve2[3];
   double tmp;
-  double Smatrix[9],p1[3];
+  double Smatrix[9];
 
-  for (i=0; i<9; i++) Smatrix[i] = 0;
   /* 3*ev, rg, b, c, kappa, eve0[3], eve1[3], eve2[3]*/
   gt.resize(16);
 
-  updatePartCfg(WITHOUT_BONDS);
-
   /* Calculate the position of COM */
   com = centerofmass(type);
 
   /* Calculate the gyration tensor Smatrix */
-  count=0;
-  for (i=0;i<n_part;i++) {
-    if ((partCfg[i].p.type == type) || (type == -1)) {
-      for ( j=0; j<3 ; j++ ) { 
-        p1[j] = partCfg[i].r.p[j] - com[j];
-      }
-      count ++;
-      Smatrix[0] += p1[0]*p1[0];
-      Smatrix[1] += p1[0]*p1[1];
-      Smatrix[2] += p1[0]*p1[2];
-      Smatrix[4] += p1[1]*p1[1];
-      Smatrix[5] += p1[1]*p1[2];
-      Smatrix[8] += p1[2]*p1[2];
-    }
-  }
+  std::vector<double> m =
+    second_moments_job({double(type), com[0], com[1], com[2], 0.0});
+  Smatrix[0] = m[0];
+  Smatrix[1] = m[1];
+  Smatrix[2] = m[2];
+  Smatrix[4] = m[3];
+  Smatrix[5] = m[4];
+  Smatrix[8] = m[5];
   /* use symmetry */
   Smatrix[3]=Smatrix[1];
   Smatrix[6]=Smatrix[2];
   Smatrix[7]=Smatrix[5];
   for (i=0;i<9;i++){
-    Smatrix[i] /= count;
+    Smatrix[i] /= m[7];
   }
 
   /* Calculate the eigenvalues of Smatrix */
@@ -435,53 +527,166 @@ void calc_gyration_tensor(int type, std::vector<double>& gt)
 }
 
 
-void nbhood(double pt[3], double r, IntList *il, int planedims[3] )
+/** An index of the particles of this node. Its grid spans the whole box,
+    so the number of cells is scaled to the number of particles of all
+    nodes, which are spread over the domains. */
+static void index_local_particles(PositionIndex &index)
 {
-  double d[3];
-  int i,j;
-  double r2;
-
-  r2 = r*r;
+  for_each_local_particle([&](const Particle &p) {
+      index.add(p.r.p, p.p.identity);
+    });
+}
 
-  init_intlist(il);
- 
-  updatePartCfg(WITHOUT_BONDS);
+static void local_nbhood(const std::vector<double> &params,
+                         std::vector<double> &result)
+{
+  /* parameters: r, the plane dimensions and the points. The result are
+     pairs of the number of the point and the particle identity */
+  double r = params[0], r2 = r*r;
+  int planedims[3] = {int(params[1]), int(params[2]), int(params[3])};
+  int n = (params.size() - 4)/3;
+  result.clear();
+
+  if ( (planedims[0] + planedims[1] + planedims[2]) == 3 ) {
+    PositionIndex index(r, cells_get_n_particles()*n_nodes);
+    index_local_particles(index);
+    for (int i = 0; i < n; i++)
+      index.for_each_within(&params[4 + 3*i], r, [&](int id, double) {
+          result.push_back(i);
+          result.push_back(id);
+        });
+    return;
+  }
 
-  for (i = 0; i<n_part; i++) {
-    if ( (planedims[0] + planedims[1] + planedims[2]) == 3 ) {
-      get_mi_vector(d, pt, partCfg[i].r.p);
-    } else {
+  for_each_local_particle([&](const Particle &p) {
       /* Calculate the in plane distance */
-      for ( j= 0 ; j < 3 ; j++ ) {
-	d[j] = planedims[j]*(partCfg[i].r.p[j]-pt[j]);
+      double pos[3];
+      get_unfolded_position(p, pos);
+      for (int i = 0; i < n; i++) {
+        double d[3];
+        for (int j= 0 ; j < 3 ; j++ ) {
+          d[j] = planedims[j]*(pos[j]-params[4 + 3*i + j]);
+        }
+        if (sqrlen(d) < r2) {
+          result.push_back(i);
+          result.push_back(p.p.identity);
+        }
       }
-    }
+    });
+}
 
-    if (sqrlen(d) < r2) {
-      realloc_intlist(il, il->n + 1);
-      il->e[il->n] = partCfg[i].p.identity;
-      il->n++;
-    }
-  }
+static ParallelAnalysis nbhood_job(local_nbhood, ANALYSIS_CONCAT);
+
+void nbhood(const std::vector<double> &points, double r, int planedims[3],
+            std::vector<std::vector<int> > &ids)
+{
+  std::vector<double> params = {r, double(planedims[0]),
+                                double(planedims[1]), double(planedims[2])};
+  params.insert(params.end(), points.begin(), points.end());
+  std::vector<double> pairs = nbhood_job(params);
+
+  ids.assign(points.size()/3, std::vector<int>());
+  for (size_t k = 0; k < pairs.size(); k += 2)
+    ids[int(pairs[k])].push_back(pairs[k + 1]);
 }
 
-double distto(double p[3], int pid)
+void nbhood(double pt[3], double r, IntList *il, int planedims[3] )
 {
-  int i;
-  double d[3];
-  double mindist;
+  std::vector<std::vector<int> > ids;
+  nbhood(std::vector<double>(pt, pt + 3), r, planedims, ids);
 
-  updatePartCfg(WITHOUT_BONDS);
+  init_intlist(il);
+  realloc_intlist(il, ids[0].size());
+  for (int id : ids[0])
+    il->e[il->n++] = id;
+}
+
+static void local_distto(const std::vector<double> &params,
+                         std::vector<double> &result)
+{
+  /* parameters: the points, each followed by the excluded identity */
+  int n = params.size()/4;
+
+  PositionIndex index(0.0, cells_get_n_particles()*n_nodes);
+  index_local_particles(index);
 
   /* larger than possible */
-  mindist=SQR(box_l[0] + box_l[1] + box_l[2]);
-  for (i=0; i<n_part; i++) {
-    if (pid != partCfg[i].p.identity) {
-      get_mi_vector(d, p, partCfg[i].r.p);
-      mindist = std::min(mindist, sqrlen(d));
-    }
+  result.assign(n, SQR(box_l[0] + box_l[1] + box_l[2]));
+  for (int i = 0; i < n; i++) {
+    double d = index.nearest(&params[4*i], params[4*i + 3]);
+    if (d >= 0.0)
+      result[i] = d*d;
   }
-  return std::sqrt(mindist);
+}
+
+static ParallelAnalysis distto_job(local_distto, ANALYSIS_MIN);
+
+std::vector<double> distto(const std::vector<double> &points,
+                           const std::vector<int> &pids)
+{
+  std::vector<double> params;
+  for (size_t i = 0; i < pids.size(); i++) {
+    params.insert(params.end(), &points[3*i], &points[3*i] + 3);
+    params.push_back(pids[i]);
+  }
+  std::vector<double> dist = distto_job(params);
+  for (double &d : dist)
+    d = std::sqrt(d);
+  return dist;
+}
+
+double distto(double p[3], int pid)
+{
+  return distto(std::vector<double>(p, p + 3), std::vector<int>(1, pid))[0];
+}
+
+static void local_energy_kinetic(const std::vector<double> &params,
+                                 std::vector<double> &result)
+{
+  int type = params[0];
+  result.assign(1, 0.0);
+  for_each_local_particle([&](const Particle &p) {
+      if (p.p.type == type) {
+#ifdef MULTI_TIMESTEP
+        if (smaller_time_step > 0.)
+          result[0] += p.p.mass * SQR(time_step/smaller_time_step) * sqrlen(const_cast<double *>(p.m.v));
+        else
+#endif
+          result[0] += p.p.mass * sqrlen(const_cast<double *>(p.m.v));
+      }
+    });
+}
+
+static ParallelAnalysis energy_kinetic_job(local_energy_kinetic, ANALYSIS_SUM);
+
+double calc_energy_kinetic(int type)
+{
+  return 0.5 * energy_kinetic_job({double(type)})[0] / time_step / time_step;
+}
+
+static void local_dipole_moment(const std::vector<double> &,
+                                std::vector<double> &result)
+{
+  result.assign(4, 0.0);
+#ifdef ELECTROSTATICS
+  for_each_local_particle([&](const Particle &p) {
+      double pos[3];
+      get_unfolded_position(p, pos);
+      for (int k = 0; k < 3; k++)
+        result[k] += pos[k] * p.p.q;
+      result[3] += p.p.q;
+    });
+#endif
+}
+
+static ParallelAnalysis dipole_moment_job(local_dipole_moment, ANALYSIS_SUM);
+
+void calc_dipole_moment(double dipole[3], double *total_q)
+{
+  std::vector<double> sums = dipole_moment_job({});
+  for (int k = 0; k < 3; k++)
+    dipole[k] = sums[k];
+  *total_q = sums[3];
 }
 
 void calc_cell_gpb(double xi_m, double Rc, double ro, double gacc, int maxtry, double *result) {
@@ -638,6 +843,180 @@ void calc_part_distribution(int *p1_types, int n_p1, int *p2_types, int n_p2,
   for(i=0;i<r_bins;i++) dist[i] /= (double)cnt;
 }
 
+/* The pairs of the RDF are binned in parallel: the particles of the
+   requested types are moved to the node whose domain contains them, every
+   node receives the particles within r_max of its domain as a halo and
+   bins the pairs of its own particles with the ones within r_max, which
+   it finds with a cell grid of cell size r_max. A pair is counted for
+   the periodic image with the minimum distance, as in min_distance(). */
+
+/** Doubles per point of the RDF: the folded position, the weights of the
+    particle in the two type lists and its molecule. The weight is the
+    number of times the type of the particle occurs in the list. */
+static const int RDF_POINT = 6;
+
+/** Encode the parameters of the RDF analyses: r_min, r_max, r_bins,
+    whether the type lists differ, whether only pairs of different
+    molecules count, followed by the two type lists. */
+static std::vector<double> encode_rdf_params(int *p1_types, int n_p1,
+                                             int *p2_types, int n_p2,
+                                             double r_min, double r_max,
+                                             int r_bins, bool intermol)
+{
+  bool mixed = (n_p1 != n_p2);
+  for (int i = 0; i < n_p1 && !mixed; i++)
+    if (p1_types[i] != p2_types[i])
+      mixed = true;
+
+  std::vector<double> params{r_min, r_max, double(r_bins), double(mixed),
+                             double(intermol), double(n_p1)};
+  params.insert(params.end(), p1_types, p1_types + n_p1);
+  params.push_back(n_p2);
+  params.insert(params.end(), p2_types, p2_types + n_p2);
+  return params;
+}
+
+/** The weights of a type in the two type lists of the RDF parameters. */
+static void rdf_weights(const std::vector<double> &params, int type,
+                        double w[2])
+{
+  size_t pos = 5;
+  for (int l = 0; l < 2; l++) {
+    int n = params[pos++];
+    w[l] = 0.0;
+    for (int i = 0; i < n; i++)
+      if (params[pos + i] == type)
+        w[l] += 1.0;
+    pos += n;
+  }
+}
+
+static void add_rdf_point(const double pos[3], const double w[2], int mol,
+                          std::vector<double> &points)
+{
+  double f_pos[3] = {pos[0], pos[1], pos[2]};
+  int image[3] = {0, 0, 0};
+  fold_position(f_pos, image);
+  points.insert(points.end(), f_pos, f_pos + 3);
+  points.push_back(w[0]);
+  points.push_back(w[1]);
+  points.push_back(mol);
+}
+
+/** Bin the pairs of the first n_local RDF points with all points. The
+    remaining points are the halo. */
+static void bin_rdf_pairs(const std::vector<double> &params,
+                          const std::vector<double> &points, int n_local,
+                          const double halo[3], std::vector<double> &hist)
+{
+  double r_min = params[0], r_max = params[1];
+  int r_bins = params[2];
+  bool intermol = params[4];
+  double inv_bin_width = r_bins / (r_max - r_min);
+
+  PointGrid grid(points, RDF_POINT, halo, r_max);
+  grid.for_each_pair(n_local, [&](int i, int j, const double *, double dist2) {
+      const double *pi = &points[RDF_POINT * i];
+      const double *pj = &points[RDF_POINT * j];
+      if (pi[3] == 0.0 || pj[4] == 0.0 || (intermol && pj[5] == pi[5]))
+        return;
+      double dist = std::sqrt(dist2);
+      if (dist > r_min) {
+        int ind = (dist - r_min) * inv_bin_width;
+        if (ind < r_bins)
+          hist[ind] += pi[3] * pj[4];
+      }
+    });
+}
+
+/** The RDF histogram of the points of all nodes, which may be stored on
+    any node. The result are the r_bins bins, followed by the sums of the
+    weights of the two lists and of their products. Collective. */
+static void rdf_histogram(const std::vector<double> &params,
+                          std::vector<double> &points,
+                          std::vector<double> &result)
+{
+  double r_max = params[1];
+  int r_bins = params[2];
+  bool mixed = params[3];
+
+  distribute_points(points, RDF_POINT);
+  int n_local = points.size() / RDF_POINT;
+
+  result.assign(r_bins + 3, 0.0);
+  for (int i = 0; i < n_local; i++) {
+    result[r_bins] += points[RDF_POINT * i + 3];
+    result[r_bins + 1] += points[RDF_POINT * i + 4];
+    result[r_bins + 2] +=
+        points[RDF_POINT * i + 3] * points[RDF_POINT * i + 4];
+  }
+
+  /* the minimum image is never further than half a box length */
+  double halo[3];
+  for (int d = 0; d < 3; d++)
+    halo[d] = PERIODIC(d) ? std::min(r_max, 0.5 * box_l[d]) : r_max;
+  add_point_halo(points, RDF_POINT, halo);
+  bin_rdf_pairs(params, points, n_local, halo, result);
+
+  /* identical lists count every pair from both particles */
+  if (!mixed)
+    for (int i = 0; i < r_bins; i++)
+      result[i] *= 0.5;
+}
+
+static void local_rdf(const std::vector<double> &params,
+                      std::vector<double> &result)
+{
+  std::vector<double> points;
+  for_each_local_particle([&](const Particle &p) {
+      double w[2];
+      rdf_weights(params, p.p.type, w);
+      if (w[0] != 0.0 || w[1] != 0.0)
+        add_rdf_point(p.r.p, w, p.p.mol_id, points);
+    });
+  rdf_histogram(params, points, result);
+}
+
+static ParallelAnalysis rdf_job(local_rdf, ANALYSIS_SUM);
+
+/** The points of a stored configuration, set on the master before
+    running \ref rdf_config_job. */
+static std::vector<double> rdf_config_points;
+
+static void local_rdf_config(const std::vector<double> &params,
+                             std::vector<double> &result)
+{
+  std::vector<double> points;
+  points.swap(rdf_config_points);
+  rdf_histogram(params, points, result);
+}
+
+static ParallelAnalysis rdf_config_job(local_rdf_config, ANALYSIS_SUM);
+
+/** The number of pairs of the RDF. excluded is the sum over the groups of
+    particles whose pairs do not count, the particles themselves for
+    identical lists or the molecules, of the product of the weights. */
+static double rdf_pair_count(bool mixed, double w1, double w2,
+                             double excluded)
+{
+  return mixed ? w1 * w2 - excluded : 0.5 * (w1 * w2 - excluded);
+}
+
+/** Normalize a histogram of cnt pairs to the ideal gas. */
+static void normalize_rdf(double r_min, double r_max, int r_bins, double cnt,
+                          double *rdf)
+{
+  double bin_width = (r_max - r_min) / (double)r_bins;
+  double volume = box_l[0] * box_l[1] * box_l[2];
+  for (int i = 0; i < r_bins; i++) {
+    double r_in = i * bin_width + r_min;
+    double r_out = r_in + bin_width;
+    double bin_volume =
+        (4.0 / 3.0) * PI * ((r_out * r_out * r_out) - (r_in * r_in * r_in));
+    rdf[i] *= volume / (bin_volume * cnt);
+  }
+}
+
 void calc_rdf(std::vector<int> & p1_types, std::vector<int> & p2_types,
 	      double r_min, double r_max, int r_bins, std::vector<double> & rdf)
 {
@@ -648,56 +1027,65 @@ void calc_rdf(std::vector<int> & p1_types, std::vector<int> & p2_types,
 void calc_rdf(int *p1_types, int n_p1, int *p2_types, int n_p2, 
 	      double r_min, double r_max, int r_bins, double *rdf)
 {
-  long int cnt=0;
-  int i,j,t1,t2,ind;
-  int mixed_flag=0,start;
-  double inv_bin_width=0.0,bin_width=0.0, dist;
-  double volume, bin_volume, r_in, r_out;
+  std::vector<double> params = encode_rdf_params(p1_types, n_p1, p2_types, n_p2,
+                                                 r_min, r_max, r_bins, false);
+  std::vector<double> result = rdf_job(params);
+
+  bool mixed = params[3];
+  double cnt = rdf_pair_count(mixed, result[r_bins], result[r_bins + 1],
+                              mixed ? 0.0 : result[r_bins + 2]);
+  std::copy(result.begin(), result.begin() + r_bins, rdf);
+  normalize_rdf(r_min, r_max, r_bins, cnt, rdf);
+}
 
-  if(n_p1 == n_p2) {
-    for(i=0;i<n_p1;i++) 
-      if( p1_types[i] != p2_types[i] ) mixed_flag=1;
+/** The RDF averaged over the last n_conf stored configurations. The
+    configurations are only stored on the master, which distributes each
+    one over the nodes for the binning. */
+static void calc_rdf_configs(int *p1_types, int n_p1, int *p2_types, int n_p2,
+                             double r_min, double r_max, int r_bins,
+                             double *rdf, int n_conf, bool intermol)
+{
+  std::vector<double> params = encode_rdf_params(p1_types, n_p1, p2_types, n_p2,
+                                                 r_min, r_max, r_bins, intermol);
+  bool mixed = params[3];
+
+  /* the types and molecules are the same in all configurations */
+  double w1 = 0.0, w2 = 0.0, excluded = 0.0;
+  std::map<int, std::pair<double, double>> mol_weights;
+  for (int i = 0; i < n_part; i++) {
+    double w[2];
+    rdf_weights(params, partCfg[i].p.type, w);
+    w1 += w[0];
+    w2 += w[1];
+    if (intermol) {
+      mol_weights[partCfg[i].p.mol_id].first += w[0];
+      mol_weights[partCfg[i].p.mol_id].second += w[1];
+    } else if (!mixed)
+      excluded += w[0] * w[1];
   }
-  else mixed_flag=1;
-
-  bin_width     = (r_max-r_min) / (double)r_bins;
-  inv_bin_width = 1.0 / bin_width;
-  for(i=0;i<r_bins;i++) rdf[i] = 0.0;
-  /* particle loop: p1_types*/
-  for(i=0; i<n_part; i++) {
-    for(t1=0; t1<n_p1; t1++) {
-      if(partCfg[i].p.type == p1_types[t1]) {
-	/* distinguish mixed and identical rdf's */
-	if(mixed_flag == 1) start = 0;
-	else                start = (i+1);
-	/* particle loop: p2_types*/
-	for(j=start; j<n_part; j++) {
-	  for(t2=0; t2<n_p2; t2++) {
-	    if(partCfg[j].p.type == p2_types[t2]) {
-	      dist = min_distance(partCfg[i].r.p, partCfg[j].r.p);
-	      if(dist > r_min && dist < r_max) {
-		ind = (int) ( (dist - r_min)*inv_bin_width );
-		rdf[ind]++;
-	      }
-	      cnt++;
-	    }
-	  }
-	}
-      }
+  for (auto const &mol : mol_weights)
+    excluded += mol.second.first * mol.second.second;
+  double cnt = rdf_pair_count(mixed, w1, w2, excluded);
+
+  for (int i = 0; i < r_bins; i++)
+    rdf[i] = 0.0;
+  for (int cnt_conf = 1; cnt_conf <= n_conf; cnt_conf++) {
+    int k = n_configs - cnt_conf;
+    rdf_config_points.clear();
+    for (int i = 0; i < n_part; i++) {
+      double w[2];
+      rdf_weights(params, partCfg[i].p.type, w);
+      if (w[0] != 0.0 || w[1] != 0.0)
+        add_rdf_point(&get_config(k)[3 * i], w, partCfg[i].p.mol_id,
+                      rdf_config_points);
     }
+    std::vector<double> result = rdf_config_job(params);
+    for (int i = 0; i < r_bins; i++)
+      rdf[i] += result[i];
   }
-
-  /* normalization */
-  volume = box_l[0]*box_l[1]*box_l[2];
-  for(i=0; i<r_bins; i++) {
-    r_in       = i*bin_width + r_min; 
-    r_out      = r_in + bin_width;
-    bin_volume = (4.0/3.0) * PI * ((r_out*r_out*r_out) - (r_in*r_in*r_in));
-    rdf[i] *= volume / (bin_volume * cnt);
-  }
+  normalize_rdf(r_min, r_max, r_bins, cnt * n_conf, rdf);
 }
 
-
 void calc_rdf_av(std::vector<int> & p1_types, std::vector<int> & p2_types,
                  double r_min, double r_max, int r_bins, std::vector<double> & rdf, int n_conf)
 {
@@ -708,69 +1096,8 @@ void calc_rdf_av(std::vector<int> & p1_types, std::vector<int> & p2_types,
 void calc_rdf_av(int *p1_types, int n_p1, int *p2_types, int n_p2,
 		 double r_min, double r_max, int r_bins, double *rdf, int n_conf)
 {
-  long int cnt=0;
-  int i,j,k,l,t1,t2,ind,cnt_conf=1;
-  int mixed_flag=0,start;
-  double inv_bin_width=0.0,bin_width=0.0, dist;
-  double volume, bin_volume, r_in, r_out;
-  double *rdf_tmp, p1[3],p2[3];
-
-  rdf_tmp = (double*)Utils::malloc(r_bins*sizeof(double));
-
-  if(n_p1 == n_p2) {
-    for(i=0;i<n_p1;i++)
-      if( p1_types[i] != p2_types[i] ) mixed_flag=1;
-  }
-  else mixed_flag=1;
-  bin_width     = (r_max-r_min) / (double)r_bins;
-  inv_bin_width = 1.0 / bin_width;
-  volume = box_l[0]*box_l[1]*box_l[2];
-  for(l=0;l<r_bins;l++) rdf_tmp[l]=rdf[l] = 0.0;
-
-  while(cnt_conf<=n_conf) {
-    for(l=0;l<r_bins;l++) rdf_tmp[l]=0.0;
-    cnt=0;
-    k=n_configs-cnt_conf;
-    for(i=0; i<n_part; i++) {
-      for(t1=0; t1<n_p1; t1++) {
-	if(partCfg[i].p.type == p1_types[t1]) {
-	  // distinguish mixed and identical rdf's
-	  if(mixed_flag == 1) start = 0;
-	  else                start = (i+1);
-	  //particle loop: p2_types
-	  for(j=start; j<n_part; j++) {
-	    for(t2=0; t2<n_p2; t2++) {
-	      if(partCfg[j].p.type == p2_types[t2]) {
-		p1[0]=configs[k][3*i  ];p1[1]=configs[k][3*i+1];p1[2]=configs[k][3*i+2];
-		p2[0]=configs[k][3*j  ];p2[1]=configs[k][3*j+1];p2[2]=configs[k][3*j+2];
-		dist =min_distance(p1, p2);
-		if(dist > r_min && dist < r_max) {
-		  ind = (int) ( (dist - r_min)*inv_bin_width );
-		  rdf_tmp[ind]++;
-		}
-		cnt++;
-	      }
-	    }
-	  }
-	}
-      }
-    }
-    // normalization
-  
-    for(i=0; i<r_bins; i++) {
-      r_in       = i*bin_width + r_min;
-      r_out      = r_in + bin_width;
-      bin_volume = (4.0/3.0) * PI * ((r_out*r_out*r_out) - (r_in*r_in*r_in));
-      rdf[i] += rdf_tmp[i]*volume / (bin_volume * cnt);
-    }
-
-    cnt_conf++;
-  } //cnt_conf loop
-  for(i=0; i<r_bins; i++) {
-    rdf[i] /= (cnt_conf-1);
-  }
-  free(rdf_tmp);
-
+  calc_rdf_configs(p1_types, n_p1, p2_types, n_p2, r_min, r_max, r_bins, rdf,
+                   n_conf, false);
 }
 
 void calc_rdf_intermol_av(std::vector<int> & p1_types, std::vector<int> & p2_types,
@@ -783,118 +1110,232 @@ void calc_rdf_intermol_av(std::vector<int> & p1_types, std::vector<int> & p2_typ
 void calc_rdf_intermol_av(int *p1_types, int n_p1, int *p2_types, int n_p2,
 			  double r_min, double r_max, int r_bins, double *rdf, int n_conf)
 {
-  int i,j,k,l,t1,t2,ind,cnt=0,cnt_conf=1;
-  int mixed_flag=0,start;
-  double inv_bin_width=0.0,bin_width=0.0, dist;
-  double volume, bin_volume, r_in, r_out;
-  double *rdf_tmp, p1[3],p2[3];
-
-  rdf_tmp = (double*)Utils::malloc(r_bins*sizeof(double));
+  calc_rdf_configs(p1_types, n_p1, p2_types, n_p2, r_min, r_max, r_bins, rdf,
+                   n_conf, true);
+}
 
-  if(n_p1 == n_p2) {
-    for(i=0;i<n_p1;i++)
-      if( p1_types[i] != p2_types[i] ) mixed_flag=1;
-  }
-  else mixed_flag=1;
-  bin_width     = (r_max-r_min) / (double)r_bins;
-  inv_bin_width = 1.0 / bin_width;
-  volume = box_l[0]*box_l[1]*box_l[2];
-  for(l=0;l<r_bins;l++) rdf_tmp[l]=rdf[l] = 0.0;
-
-  while(cnt_conf<=n_conf) {
-    for(l=0;l<r_bins;l++) rdf_tmp[l]=0.0;
-    cnt=0;
-    k=n_configs-cnt_conf;
-    for(i=0; i<n_part; i++) {
-      for(t1=0; t1<n_p1; t1++) {
-	if(partCfg[i].p.type == p1_types[t1]) {
-	  // distinguish mixed and identical rdf's
-	  if(mixed_flag == 1) start = 0;
-	  else                start = (i+1);
-	  //particle loop: p2_types
-	  for(j=start; j<n_part; j++) {
-	    for(t2=0; t2<n_p2; t2++) {
-	      if(partCfg[j].p.type == p2_types[t2]) {
-		/*see if particles i and j belong to different molecules*/
-		if(partCfg[i].p.mol_id!=partCfg[j].p.mol_id) {
-		  p1[0]=configs[k][3*i  ];p1[1]=configs[k][3*i+1];p1[2]=configs[k][3*i+2];
-		  p2[0]=configs[k][3*j  ];p2[1]=configs[k][3*j+1];p2[2]=configs[k][3*j+2];
-		  dist =min_distance(p1, p2);
-		  if(dist > r_min && dist < r_max) {
-		    ind = (int) ( (dist - r_min)*inv_bin_width );
-		    rdf_tmp[ind]++;
-		  }
-		  cnt++;
-		}
-	      }
-	    }
-	  }
-	}
-      }
-    }
-    // normalization
+/* The structure factor is a distributed analysis. The exact variant
+   sums the phase factors exp(i q r) of every q vector over the local
+   particles, which are calculated by recurrence from the ones of the
+   smallest q vector along each axis, so that every q vector costs one
+   complex multiplication instead of a sine and a cosine. The mesh
+   variant assigns the particles to a density mesh with B-splines of
+   order cao, whose Fourier transform is divided by the one of the
+   assignment function. */
+
+/** The number of times a type occurs in the type list encoded at
+    params[pos] as its length followed by the types. */
+static int type_multiplicity(const std::vector<double> &params, size_t pos,
+                             int type)
+{
+  int n = params[pos], w = 0;
+  for (int i = 0; i < n; i++)
+    if (params[pos + 1 + i] == type)
+      w++;
+  return w;
+}
 
-    for(i=0; i<r_bins; i++) {
-      r_in       = i*bin_width + r_min;
-      r_out      = r_in + bin_width;
-      bin_volume = (4.0/3.0) * PI * ((r_out*r_out*r_out) - (r_in*r_in*r_in));
-      rdf[i] += rdf_tmp[i]*volume / (bin_volume * cnt);
-    }
+/** The parameters of the structure factor analyses: the order or the
+    mesh, the charge assignment order, and the type list. */
+static std::vector<double> encode_sf_params(int *p_types, int n_types,
+                                            int size, int cao)
+{
+  std::vector<double> params{double(size), double(cao), double(n_types)};
+  params.insert(params.end(), p_types, p_types + n_types);
+  return params;
+}
 
-    cnt_conf++;
-  } //cnt_conf loop
-  for(i=0; i<r_bins; i++) {
-    rdf[i] /= (cnt_conf-1);
-  }
-  free(rdf_tmp);
+/** The sum over the q vectors of the structure factor, ordered by their
+    squared length, as described in \ref calc_structurefactor. rho(q)
+    returns the density of the q vector in units of 2PI/L. */
+template <typename F>
+static void bin_structurefactor(int order, double n_particles, F rho,
+                                double *ff)
+{
+  int order2 = order * order;
+  for (int qi = 0; qi < 2 * order2; qi++)
+    ff[qi] = 0.0;
+  for (int i = 0; i <= order; i++)
+    for (int j = -order; j <= order; j++)
+      for (int k = -order; k <= order; k++) {
+        int n = i * i + j * j + k * k;
+        if ((n <= order2) && (n >= 1)) {
+          ff[2 * n - 2] += std::norm(rho(i, j, k));
+          ff[2 * n - 1]++;
+        }
+      }
+  for (int qi = 0; qi < order2; qi++)
+    if (ff[2 * qi + 1] != 0)
+      ff[2 * qi] /= n_particles * ff[2 * qi + 1];
+}
 
+static void local_structurefactor(const std::vector<double> &params,
+                                  std::vector<double> &result)
+{
+  int order = params[0], order2 = order * order, n_q = 2 * order + 1;
+  double twoPI_L = 2 * PI / box_l[0];
+
+  /* real and imaginary part of rho(q) for 0 <= i <= order and
+     -order <= j, k <= order, followed by the number of particles */
+  result.assign(2 * (order + 1) * n_q * n_q + 1, 0.0);
+  std::vector<std::complex<double>> phase[3];
+  for (int d = 0; d < 3; d++)
+    phase[d].resize(n_q);
+
+  for_each_local_particle([&](const Particle &p) {
+      int w = type_multiplicity(params, 2, p.p.type);
+      if (w == 0)
+        return;
+      double pos[3];
+      get_unfolded_position(p, pos);
+      /* phase[d][order + n] = exp(i n 2PI/L pos[d]) */
+      for (int d = 0; d < 3; d++) {
+        std::complex<double> e = std::polar(1.0, twoPI_L * pos[d]);
+        phase[d][order] = 1.0;
+        for (int n = 1; n <= order; n++) {
+          phase[d][order + n] = phase[d][order + n - 1] * e;
+          phase[d][order - n] = std::conj(phase[d][order + n]);
+        }
+      }
+      for (int i = 0; i <= order; i++)
+        for (int j = -order; j <= order; j++) {
+          if (i * i + j * j > order2)
+            continue;
+          int k_max = std::sqrt(double(order2 - i * i - j * j));
+          std::complex<double> e_ij =
+              double(w) * phase[0][order + i] * phase[1][order + j];
+          double *rho = &result[2 * (i * n_q + j + order) * n_q];
+          for (int k = -k_max; k <= k_max; k++) {
+            std::complex<double> e = e_ij * phase[2][order + k];
+            rho[2 * (k + order)] += e.real();
+            rho[2 * (k + order) + 1] += e.imag();
+          }
+        }
+      result.back() += w;
+    });
 }
 
+static ParallelAnalysis structurefactor_job(local_structurefactor,
+                                            ANALYSIS_SUM);
+
 void calc_structurefactor(int *p_types, int n_types, int order, double **_ff) {
-  int i, j, k, n, qi, p, t, order2;
-  double qr, twoPI_L, C_sum, S_sum, *ff=NULL;
-  
-  order2 = order*order;
-  *_ff = ff = (double*)Utils::realloc(ff,2*order2*sizeof(double));
-  twoPI_L = 2*PI/box_l[0];
-  
+  double *ff;
+  *_ff = ff = (double*)Utils::malloc(2*order*order*sizeof(double));
+
   if ((n_types < 0) || (n_types > n_particle_types)) { fprintf(stderr,"WARNING: Wrong number of particle types!"); fflush(NULL); errexit(); }
   else if (order < 1) { fprintf(stderr,"WARNING: parameter \"order\" has to be a whole positive number"); fflush(NULL); errexit(); }
   else {
-    for(qi=0; qi<2*order2; qi++) {
-      ff[qi] = 0.0;
-    }
-    for(i=0; i<=order; i++) {
-      for(j=-order; j<=order; j++) {
-        for(k=-order; k<=order; k++) {
-	  n = i*i + j*j + k*k;
-	  if ((n<=order2) && (n>=1)) {
-	    C_sum = S_sum = 0.0;
-	    for(p=0; p<n_part; p++) {
-	      for(t=0; t<n_types; t++) {
-		if (partCfg[p].p.type == p_types[t]) {
-		  qr = twoPI_L * ( i*partCfg[p].r.p[0] + j*partCfg[p].r.p[1] + k*partCfg[p].r.p[2] );
-		  C_sum+= cos(qr);
-		  S_sum+= sin(qr);
-		}
-              }
-	    }
-	    ff[2*n-2]+= C_sum*C_sum + S_sum*S_sum;
-	    ff[2*n-1]++;
-	  }
-	}
+    std::vector<double> rho =
+      structurefactor_job(encode_sf_params(p_types, n_types, order, 0));
+    int n_q = 2 * order + 1;
+    bin_structurefactor(order, rho.back(), [&](int i, int j, int k) {
+        size_t q = (i * n_q + j + order) * n_q + k + order;
+        return std::complex<double>(rho[2 * q], rho[2 * q + 1]);
+      }, ff);
+  }
+}
+
+#ifdef FFTW
+/** The weights of the mesh points for the cardinal B-spline of order
+    cao: w[j] = M(t + j) with M the B-spline on [0, cao] and 0 <= t < 1. */
+static void bspline_weights(int cao, double t, double *w)
+{
+  w[0] = 1.0;
+  for (int n = 2; n <= cao; n++) {
+    w[n - 1] = 0.0;
+    for (int j = n - 1; j >= 0; j--)
+      w[j] = ((t + j) * w[j] + (j > 0 ? (n - t - j) * w[j - 1] : 0.0)) /
+             (n - 1);
+  }
+}
+
+static void local_structurefactor_mesh(const std::vector<double> &params,
+                                       std::vector<double> &result)
+{
+  int mesh = params[0], cao = params[1];
+
+  /* the density mesh, followed by the number of particles */
+  result.assign(mesh * mesh * mesh + 1, 0.0);
+  std::vector<double> w(3 * cao);
+  int first[3];
+
+  for_each_local_particle([&](const Particle &p) {
+      int n = type_multiplicity(params, 2, p.p.type);
+      if (n == 0)
+        return;
+      double pos[3] = {p.r.p[0], p.r.p[1], p.r.p[2]};
+      int image[3] = {0, 0, 0};
+      fold_position(pos, image);
+      /* the mesh point m gets the weight M(pos/h - m + cao/2) */
+      for (int d = 0; d < 3; d++) {
+        double u = pos[d] * box_l_i[d] * mesh + 0.5 * cao;
+        first[d] = std::floor(u);
+        bspline_weights(cao, u - first[d], &w[d * cao]);
       }
-    }
-    n = 0;
-    for(p=0; p<n_part; p++) {
-      for(t=0; t<n_types; t++) {
-        if (partCfg[p].p.type == p_types[t]) n++;
+      for (int a = 0; a < cao; a++) {
+        int x = ((first[0] - a) % mesh + mesh) % mesh;
+        for (int b = 0; b < cao; b++) {
+          int y = ((first[1] - b) % mesh + mesh) % mesh;
+          double w_ab = n * w[a] * w[cao + b];
+          double *row = &result[(x * mesh + y) * mesh];
+          for (int c = 0; c < cao; c++)
+            row[((first[2] - c) % mesh + mesh) % mesh] +=
+                w_ab * w[2 * cao + c];
+        }
       }
-    }
-    for(qi=0; qi<order2; qi++) 
-      if (ff[2*qi+1]!=0) ff[2*qi]/= n*ff[2*qi+1];
+      result.back() += n;
+    });
+}
+
+static ParallelAnalysis structurefactor_mesh_job(local_structurefactor_mesh,
+                                                 ANALYSIS_SUM);
+
+int calc_structurefactor_mesh(int *p_types, int n_types, int order, int mesh,
+                              int cao, double **sf)
+{
+  if (mesh <= 2 * order || cao < 1 || cao > 7) {
+    runtimeErrorMsg() << "structure factor mesh has to be larger than twice "
+                         "the order, and the assignment order between 1 and 7";
+    return ES_ERROR;
+  }
+  *sf = (double *)Utils::malloc(2 * order * order * sizeof(double));
+
+  std::vector<double> rho = structurefactor_mesh_job(
+      encode_sf_params(p_types, n_types, mesh, cao));
+
+  int n_z = mesh / 2 + 1;
+  fftw_complex *rho_q =
+      (fftw_complex *)fftw_malloc(mesh * mesh * n_z * sizeof(fftw_complex));
+  fftw_plan plan = fftw_plan_dft_r2c_3d(mesh, mesh, mesh, rho.data(), rho_q,
+                                        FFTW_ESTIMATE);
+  fftw_execute(plan);
+  fftw_destroy_plan(plan);
+
+  /* Fourier transform of the assignment function along one axis */
+  std::vector<double> caf_q(mesh);
+  for (int k = 0; k < mesh; k++) {
+    int kk = (k <= mesh / 2) ? k : k - mesh;
+    double x = PI * kk / mesh;
+    caf_q[k] = (kk == 0) ? 1.0 : std::pow(std::sin(x) / x, cao);
   }
+
+  bin_structurefactor(order, rho.back(), [&](int i, int j, int k) {
+      /* only k >= 0 is stored, and rho(-q) is the conjugate of rho(q) */
+      if (k < 0) {
+        i = -i;
+        j = -j;
+        k = -k;
+      }
+      int x = (i + mesh) % mesh, y = (j + mesh) % mesh;
+      const fftw_complex &r = rho_q[(x * mesh + y) * n_z + k];
+      return std::complex<double>(FFTW_REAL(r), FFTW_IMAG(r)) /
+             (caf_q[x] * caf_q[y] * caf_q[k]);
+    }, *sf);
+
+  fftw_free(rho_q);
+  return ES_OK;
 }
+#endif
 
 std::vector< std::vector<double> > modify_stucturefactor( int order, double *sf)
 {
@@ -956,7 +1397,7 @@ void density_profile_av(int n_conf, int n_bin, double density, int dir, double *
 	//com particles
 	if(partCfg[i].p.type == type) {
 	  for(m=0; m<3; m++) {
-	    pos[m] = configs[k][3*i+m];
+	    pos[m] = get_config(k)[3*i+m];
 	    image_box[m] = 0;
 	  }
 	  fold_coordinate(pos, image_box, dir);
@@ -1002,9 +1443,9 @@ void calc_diffusion_profile(int dir, double xmin, double xmax, int nbins, int n_
     
     for (i=0;i<n_part;i++) {
       if(partCfg[i].p.type == type) {
-	tpos[0] = configs[t][3*i];
-	tpos[1] = configs[t][3*i+1];
-	tpos[2] = configs[t][3*i+2];
+	tpos[0] = get_config(t)[3*i];
+	tpos[1] = get_config(t)[3*i+1];
+	tpos[2] = get_config(t)[3*i+2];
 	fold_coordinate(tpos, img_box,dir);
 	xpos = tpos[dir];
 	if(xpos > xmin && xpos < xmax) {
@@ -1018,9 +1459,9 @@ void calc_diffusion_profile(int dir, double xmin, double xmax, int nbins, int n_
     /* check at time 'time' */
     for (i=0;i<n_part;i++) {
       if (label[i]>0) {
-	tpos[0] = configs[t+time][3*label[i]];
-	tpos[1] = configs[t+time][3*label[i]+1];
-	tpos[2] = configs[t+time][3*label[i]+2];
+	tpos[0] = get_config(t+time)[3*label[i]];
+	tpos[1] = get_config(t+time)[3*label[i]+1];
+	tpos[2] = get_config(t+time)[3*label[i]+2];
 	fold_coordinate(tpos, img_box,dir);
 	xpos = tpos[dir];
 	
@@ -1316,8 +1757,8 @@ double calc_vanhove(int ptype, double rmin, double rmax, int rbins, int tmax, do
     c3_max=(c1+tmax+1)>n_configs ? n_configs : c1+tmax+1;
     for(c3=(c1+1); c3<c3_max; c3++) { 
       for(i=0; i<p.n; i++) {
-	p1[0]=configs[c1][3*p.e[i] ]; p1[1]=configs[c1][3*p.e[i]+1]; p1[2]=configs[c1][3*p.e[i]+2];
-	p2[0]=configs[c3][3*p.e[i]  ]; p2[1]=configs[c3][3*p.e[i]+1]; p2[2]=configs[c3][3*p.e[i]+2];
+	p1[0]=get_config(c1)[3*p.e[i] ]; p1[1]=get_config(c1)[3*p.e[i]+1]; p1[2]=get_config(c1)[3*p.e[i]+2];
+	p2[0]=get_config(c3)[3*p.e[i]  ]; p2[1]=get_config(c3)[3*p.e[i]+1]; p2[2]=get_config(c3)[3*p.e[i]+2];
 	dist = distance(p1, p2);
 	if(dist > rmin && dist < rmax) {
 	  ind = (int) ( (dist - rmin)*inv_bin_width );
@@ -1342,6 +1783,158 @@ double calc_vanhove(int ptype, double rmin, double rmax, int rbins, int tmax, do
  *                                 config storage functions
  ****************************************************************************************/
 
+/** Where a stored configuration comes from, in the order of \ref configs. */
+struct ConfigSource {
+  /** the trajectory of a frame mapped by \ref analyze_map_configs, shared
+      by all its frames, or NULL for configurations stored in memory */
+  std::shared_ptr<CtrajReader> traj;
+  int frame;
+  /** the last access of a mapped frame, for the window */
+  unsigned long used;
+};
+
+static std::vector<ConfigSource> config_sources;
+/** the mapped frames that are currently decoded */
+static std::vector<int> config_window_entries;
+static unsigned long config_clock = 0;
+/** the size of the window in frames, 0 to derive it from \ref
+    config_window_bytes */
+static int config_window_size = 0;
+static const size_t config_window_bytes = 256 << 20;
+static const int config_window_min = 4;
+
+int n_mapped_configs = 0;
+
+int config_window_frames()
+{
+  if (config_window_size > 0) return config_window_size;
+  size_t frame_bytes = 3*sizeof(double)*std::max(n_part_conf, 1);
+  return std::max<size_t>(config_window_min, config_window_bytes / frame_bytes);
+}
+
+/** removes a decoded frame from the window and frees it */
+static void evict_config(std::vector<int>::iterator entry)
+{
+  free(configs[*entry]);
+  configs[*entry] = NULL;
+  config_window_entries.erase(entry);
+}
+
+void set_config_window(int frames)
+{
+  config_window_size = frames > 0 ? std::max(frames, config_window_min) : 0;
+  while ((int)config_window_entries.size() > config_window_frames())
+    evict_config(config_window_entries.begin());
+}
+
+double *load_config(int ind)
+{
+  ConfigSource &src = config_sources[ind];
+  src.used = ++config_clock;
+  if (configs[ind] || !src.traj) return configs[ind];
+
+  /* reuse the least recently used frame once the window is full */
+  double *config;
+  if ((int)config_window_entries.size() < config_window_frames())
+    config = (double *) Utils::malloc(3*n_part_conf*sizeof(double));
+  else {
+    auto lru = std::min_element(config_window_entries.begin(), config_window_entries.end(),
+                                [](int a, int b) { return config_sources[a].used < config_sources[b].used; });
+    config = configs[*lru];
+    configs[*lru] = NULL;
+    config_window_entries.erase(lru);
+  }
+  config_window_entries.push_back(ind);
+  configs[ind] = config;
+
+  static CtrajFrame frame;
+  if (src.traj->read_frame(src.frame, frame) == ES_OK) {
+    int n = frame.id.size();
+    if ((frame.fields & CTRAJ_POS) && n == n_part_conf && frame.id[n - 1] == n - 1) {
+      std::copy(frame.pos.begin(), frame.pos.end(), config);
+      return config;
+    }
+    runtimeErrorMsg() << "frame " << src.frame << " of " << src.traj->filename()
+                      << " does not contain the particles 0 to " << n_part_conf - 1;
+  }
+  std::fill(config, config + 3*n_part_conf, 0.0);
+  return config;
+}
+
+/** releases a stored configuration, allocated or mapped, and turns its
+    entry into one stored in memory */
+static void free_config(int ind)
+{
+  ConfigSource &src = config_sources[ind];
+  if (src.traj) {
+    auto entry = std::find(config_window_entries.begin(), config_window_entries.end(), ind);
+    if (entry != config_window_entries.end()) evict_config(entry);
+    src.traj.reset();
+    n_mapped_configs--;
+  }
+  else
+    free(configs[ind]);
+  configs[ind] = NULL;
+}
+
+/** removes the entry of configs[ind] after it was freed */
+static void erase_config(int ind)
+{
+  for (int i = ind; i < n_configs - 1; i++) configs[i] = configs[i + 1];
+  config_sources.erase(config_sources.begin() + ind);
+  for (int &entry : config_window_entries)
+    if (entry > ind) entry--;
+}
+
+int analyze_map_configs(const char *filename)
+{
+  std::shared_ptr<CtrajReader> reader = std::make_shared<CtrajReader>();
+  if (reader->open(filename) == ES_ERROR) return ES_ERROR;
+  int frames = reader->n_frames();
+  if (frames == 0) {
+    runtimeErrorMsg() << filename << " contains no frames";
+    return ES_ERROR;
+  }
+
+  /* only the headers are checked here, the particle ids of the other
+     frames are checked when they are decoded */
+  int n_part_traj = reader->header(0).n_part;
+  for (int i = 0; i < frames; i++) {
+    const CtrajFrameHeader &head = reader->header(i);
+    const char *problem = NULL;
+    if (!(head.fields & CTRAJ_POS))
+      problem = "contains no positions";
+    else if (head.n_part != n_part_traj)
+      problem = "has a different number of particles than the first frame";
+    if (problem) {
+      runtimeErrorMsg() << "frame " << i << " of " << filename << " " << problem;
+      return ES_ERROR;
+    }
+  }
+  CtrajFrame first;
+  if (reader->read_frame(0, first) == ES_ERROR) return ES_ERROR;
+  if (n_part_traj == 0 || first.id[n_part_traj - 1] != n_part_traj - 1) {
+    runtimeErrorMsg() << filename << " does not contain consecutive particle ids starting with 0";
+    return ES_ERROR;
+  }
+  if (n_configs > 0 && n_part_conf != n_part_traj) {
+    runtimeErrorMsg() << "All configurations stored must have the same length (previously: "
+                      << n_part_conf << ", now: " << n_part_traj << ")";
+    return ES_ERROR;
+  }
+
+  n_part_conf = n_part_traj;
+  configs = (double**)Utils::realloc(configs,(n_configs+frames)*sizeof(double *));
+  for (int i = 0; i < frames; i++) {
+    configs[n_configs + i] = NULL;
+    config_sources.push_back({reader, i, 0});
+  }
+  n_configs += frames;
+  n_mapped_configs += frames;
+
+  return ES_OK;
+}
+
 void analyze_append() {
   int i;
   n_part_conf = n_part;
@@ -1352,16 +1945,16 @@ void analyze_append() {
     configs[n_configs][3*i+1] = partCfg[i].r.p[1];
     configs[n_configs][3*i+2] = partCfg[i].r.p[2];
   }
+  config_sources.push_back(ConfigSource());
   n_configs++;
 }
 
 void analyze_push() {
   int i;
   n_part_conf = n_part;
-  free(configs[0]);
-  for(i=0; i<n_configs-1; i++) {
-    configs[i]=configs[i+1];
-  }
+  free_config(0);
+  erase_config(0);
+  config_sources.push_back(ConfigSource());
   configs[n_configs-1] = (double *) Utils::malloc(3*n_part_conf*sizeof(double));
   for(i=0; i<n_part_conf; i++) {
     configs[n_configs-1][3*i]   = partCfg[i].r.p[0];
@@ -1373,6 +1966,11 @@ void analyze_push() {
 void analyze_replace(int ind) {
   int i;
   n_part_conf = n_part;
+  /* mapped configurations are read-only */
+  if (config_sources[ind].traj) {
+    free_config(ind);
+    configs[ind] = (double *) Utils::malloc(3*n_part_conf*sizeof(double));
+  }
   for(i=0; i<n_part_conf; i++) {
     configs[ind][3*i]   = partCfg[i].r.p[0];
     configs[ind][3*i+1] = partCfg[i].r.p[1];
@@ -1381,11 +1979,8 @@ void analyze_replace(int ind) {
 }
 
 void analyze_remove(int ind) {
-  int i;
-  free(configs[ind]);
-  for(i=ind; i<n_configs-1; i++) {
-    configs[i]=configs[i+1];
-  }
+  free_config(ind);
+  erase_config(ind);
   n_configs--;
   configs = (double**)Utils::realloc(configs,n_configs*sizeof(double *));
   if (n_configs == 0) n_part_conf = 0;
@@ -1401,18 +1996,20 @@ void analyze_configs(double *tmp_config, int count) {
     configs[n_configs][3*i+1] = tmp_config[3*i+1];
     configs[n_configs][3*i+2] = tmp_config[3*i+2];
   }
+  config_sources.push_back(ConfigSource());
   n_configs++;
 }
 
 void analyze_activate(int ind) {
   int i;
   double pos[3];
+  const double *config = get_config(ind);
   n_part_conf = n_part;
 
   for(i=0; i<n_part_conf; i++) {
-    pos[0] = configs[ind][3*i];
-    pos[1] = configs[ind][3*i+1];
-    pos[2] = configs[ind][3*i+2];
+    pos[0] = config[3*i];
+    pos[1] = config[3*i+1];
+    pos[2] = config[3*i+2];
     if (place_particle(i, pos)==ES_ERROR) {
         runtimeErrorMsg() <<"failed upon replacing particle " << i << "  in Espresso";
     }
@@ -1475,20 +2072,6 @@ void invalidate_obs()
 }
 
 
-  //subfunction: mark all neighbors of a particle and their neighbors (recursiv!)
-void mark_neighbours(int type,int pa_nr,double dist,int *list){
-  int k;
-  for (k=0;k<n_part;k++){
-     //only unmarked and particles with right distance
-     if ( (partCfg[k].p.type == type) && (list[k] == 0) && (min_distance(partCfg[pa_nr].r.p,partCfg[k].r.p) < dist) ){
-        //mark particle with same number as calling particle
-        list[k]=list[pa_nr];
-        mark_neighbours(type,k,dist,list);
-     }
-  }
-}
-
-
 void centermass_conf(int k, int type_1, double *com)
 {
   int i, j;
@@ -1500,7 +2083,7 @@ void centermass_conf(int k, int type_1, double *com)
     {
       for (i=0; i<3; i++)
       {
-         com[i] += configs[k][3*j+i]*(partCfg[j]).p.mass;
+         com[i] += get_config(k)[3*j+i]*(partCfg[j]).p.mass;
       }
       M += (partCfg[j]).p.mass;
     }
@@ -108,8 +108,26 @@ typedef struct {
 extern double **configs;
 extern int n_configs;
 extern int n_part_conf;
+/** the number of entries of \ref #configs that are frames of mapped
+    trajectories, see \ref analyze_map_configs */
+extern int n_mapped_configs;
 /*@}*/
 
+/** decodes configs[ind] if it is a mapped frame that is not in the
+    window, see \ref get_config */
+double *load_config(int ind);
+
+/** the positions of configs[ind]. Analyses read the stored
+    configurations through this, since frames of mapped trajectories are
+    only decoded on access, into a window of the least recently used
+    frames. The pointer stays valid until \ref config_window_frames
+    other frames have been decoded.
+    @param ind the entry in \ref #configs */
+inline double *get_config(int ind)
+{
+  return n_mapped_configs == 0 ? configs[ind] : load_config(ind);
+}
+
 /** \name Exported Functions */
 /************************************************************/
 /*@{*/
@@ -147,6 +165,16 @@ int aggregation(double dist_criteria2, int min_contact, int s_mol_id, int f_mol_
 */
 void nbhood(double pos[3], double r_catch, IntList *il, int planedims[3]);
 
+/** returns the particles within a given radius r_catch around each of a
+    batch of positions, in one pass over the particles.
+    @param points the positions, 3 coordinates each
+    @param r_catch the radius around the positions
+    @param planedims orientation of coordinate system
+    @param ids receives the particle identities for every position
+*/
+void nbhood(const std::vector<double> &points, double r_catch,
+            int planedims[3], std::vector<std::vector<int> > &ids);
+
 /** minimal distance to point.
     @param pos point
     @param pid  if a valid particle id, this particle is omitted from minimization
@@ -154,6 +182,27 @@ void nbhood(double pos[3], double r_catch, IntList *il, int planedims[3]);
     @return the minimal distance of a particle to coordinates (\<posx\>, \<posy\>, \<posz\>). */
 double distto(double pos[3], int pid);
 
+/** minimal distances to a batch of points, in one pass over the particles.
+    @param points the points, 3 coordinates each
+    @param pids for every point the particle omitted from its minimization,
+                or -1
+    @return the minimal distances of a particle to the points */
+std::vector<double> distto(const std::vector<double> &points,
+                           const std::vector<int> &pids);
+
+/** calculate the kinetic energy of the particles of a type.
+    @param type the particle type
+    @return the kinetic energy
+*/
+double calc_energy_kinetic(int type);
+
+/** calculate the dipole moment and total charge of all particles,
+    using the unfolded positions.
+    @param dipole returns the dipole moment
+    @param total_q returns the total charge
+*/
+void calc_dipole_moment(double dipole[3], double *total_q);
+
 /** numerical solution for the integration constant \f$\gamma\f$ in the cell model, determined by 
     \f[\gamma\,\ln\frac{R}{r_0}=\arctan\frac{1}{\gamma}+\arctan\frac{\xi_M-1}{\gamma}\f]
     from which the second integration constant, the Manning radius \f$R_M\f$, follows to
@@ -194,6 +243,25 @@ void analyze_replace(int ind);
     @param ind the entry in \ref #configs to be removed */
 void analyze_remove(int ind);
 
+/** appends all frames of a compressed trajectory (see \ref ctraj.hpp) to
+    configs without decoding them. \ref get_config decodes a frame when
+    an analysis accesses it, so that only the window of recently used
+    frames is kept in memory. Only the frame headers and the first frame
+    are checked here; the trajectory stays open as long as any of its
+    frames is stored.
+    @param filename the trajectory
+    @return ES_OK or ES_ERROR, errors are reported as runtime errors */
+int analyze_map_configs(const char *filename);
+
+/** sets the number of decoded frames of mapped trajectories kept in
+    memory, which is at least 4.
+    @param frames the number of frames, or 0 for as many as fit into
+                  256 MB */
+void set_config_window(int frames);
+
+/** the number of decoded frames of mapped trajectories kept in memory */
+int config_window_frames();
+
 /** Calculates the distribution of particles around others. 
     Calculates the distance distribution of particles with types given
     in the p1_types list around particles with types given in the
@@ -311,8 +379,9 @@ double calc_vanhove(int ptype, double rmin, double rmax, int rbins, int tmax, do
 
     Calculates the spherically averaged structure factor of particles of a
     given type. The possible wave vectors are given by q = 2PI/L sqrt(nx^2 + ny^2 + nz^2).
-    The S(q) is calculated up to a given length measured in 2PI/L (the recommended order of
-    the wave vector is less than 20).
+    The S(q) is calculated up to a given length measured in 2PI/L. The
+    calculation is distributed over the nodes and costs O(order^3 N),
+    for large orders see \ref calc_structurefactor_mesh.
     The data is stored starting with q=1, and contains alternatingly S(q-1) and the number
     of wave vectors l with l^2=q. Only if the second number is nonzero, the first is meaningful.
     This means the q=1 entries are sf[0]=S(1) and sf[1]=1. For q=7, there are no possible wave vectors,
@@ -326,6 +395,28 @@ double calc_vanhove(int ptype, double rmin, double rmax, int rbins, int tmax, do
 
 void calc_structurefactor(int *p_types, int n_types, int order, double **sf);
 
+#ifdef FFTW
+/** Calculates the spherically averaged structure factor from the Fourier
+    transform of a density mesh, in O(N + mesh^3 log mesh).
+
+    The particles are assigned to the mesh with B-splines of order cao,
+    and the transform is divided by the one of the assignment function.
+    The result is stored as for \ref calc_structurefactor, the remaining
+    error is the aliasing of the wave vectors beyond mesh/2, so that the
+    mesh should be several times larger than 2*order.
+
+    @param p_types   list with types of particles to be analyzed
+    @param n_types   length of p_types
+    @param order     the maximum wave vector length in 2PI/L
+    @param mesh      the number of mesh points per direction, larger than 2*order
+    @param cao       the order of the assignment function, 1 to 7
+    @param sf        pointer to hold the base of the array containing the result (size: 2*order^2).
+    @return ES_OK, or ES_ERROR and a runtime error for invalid parameters
+*/
+int calc_structurefactor_mesh(int *p_types, int n_types, int order, int mesh,
+                              int cao, double **sf);
+#endif
+
 std::vector< std::vector<double> > modify_stucturefactor( int order, double *sf);
 
 /** Calculates the density profile in dir direction */
@@ -358,9 +449,11 @@ inline double min_distance(double pos1[3], double pos2[3]) {
 
 /** calculate the center of mass of a special type of the current configuration
  *  \param type  type of the particle
- *  \param com   center of mass position
+ *  \param collective  if true, called on all nodes at the same time
+ *                     instead of on the master only
+ *  \return center of mass position
  */
-std::vector<double> centerofmass(int part_type);
+std::vector<double> centerofmass(int part_type, bool collective = false);
 
 
 /** Docs missing
@@ -384,7 +477,11 @@ void angularmomentum(int type, double *com);
 void centermass_conf(int k, int type_1, double *com);
 
 
-void momentofinertiamatrix(int type, double* MofImatrix);
+/** calculate the moment of inertia tensor of a special type of the current
+ *  configuration, see \ref centerofmass for the parameters.
+ */
+void momentofinertiamatrix(int type, double* MofImatrix,
+                           bool collective = false);
 void calc_gyration_tensor(int type, std::vector<double>& gt);
 void calculate_verlet_neighbors();
 
@@ -441,11 +538,6 @@ inline double *obsstat_nonbonded_inter(Observable_stat_non_bonded *stat, int p1,
 
 void invalidate_obs();
 
-/** Docs missing
-\todo Docs missing
-*/
-void mark_neighbours(int type,int pa_nr,double dist,int *list);
-
 void obsstat_realloc_and_clear(Observable_stat *stat, int n_pre, int n_bonded, int n_non_bonded,
 			       int n_coulomb, int n_dipolar, int n_vsr, int chunk_size);
 
@@ -27,10 +27,18 @@
 #include "communication.hpp"
 #include "cells.hpp"
 #include "grid.hpp"
+#include "errorhandling.hpp"
+#include "statistics_chain.hpp"
+#include "statistics_parallel.hpp"
 
-/** Particles' initial positions (needed for g1(t), g2(t), g3(t) in \ref tclcommand_analyze) */
+#include <algorithm>
+#include <array>
+#include <map>
+#include <vector>
+
+/** Number of chain particles and chains at the initial configuration
+    of g1(t), g2(t), g3(t) in \ref tclcommand_analyze */
 /*@{*/
-float *partCoord_g=NULL, *partCM_g=NULL;
 int n_part_g = 0, n_chains_g = 0;
 /*@}*/
 
@@ -58,31 +66,471 @@ void update_mol_ids_setchains() {
 
 
 
-void calc_re(double **_re)
+/****************************************************************************************
+ *                                 distributed chain analyses
+ ****************************************************************************************/
+
+/** The chains evaluated by this node, chain c on node c % n_nodes, with
+    the beads of every chain sorted by identity. The coordinates are
+    stored as separate arrays, so that the pair loops vectorize. */
+struct LocalChains {
+  /** the number of every chain */
+  std::vector<int> key;
+  /** the first bead of every chain, and the end */
+  std::vector<int> start;
+  /** identity, unfolded position and mass of the beads */
+  std::vector<int> id;
+  std::vector<double> x, y, z, mass;
+
+  int size() const { return key.size(); }
+  int length(int c) const { return start[c + 1] - start[c]; }
+};
+
+/** Parameters of the distributed chain analyses: whether the chains are
+    the molecules, the chain structure, and the parameters of the
+    analysis. */
+static std::vector<double> chain_params(bool molecules,
+                                        std::vector<double> extra = {})
 {
-  int i;
-  double dx,dy,dz;
-  double dist=0.0,dist2=0.0,dist4=0.0;
-  double *re=NULL, tmp;
-  *_re = re = (double*)Utils::realloc(re,4*sizeof(double));
+  std::vector<double> params = {double(molecules), double(chain_start),
+                                double(chain_n_chains), double(chain_length)};
+  params.insert(params.end(), extra.begin(), extra.end());
+  return params;
+}
 
-  for (i=0; i<chain_n_chains; i++) {
-    dx = partCfg[chain_start+i*chain_length + chain_length-1].r.p[0]
-      - partCfg[chain_start+i*chain_length].r.p[0];
-    dy = partCfg[chain_start+i*chain_length + chain_length-1].r.p[1]
-      - partCfg[chain_start+i*chain_length].r.p[1];
-    dz = partCfg[chain_start+i*chain_length + chain_length-1].r.p[2]
-      - partCfg[chain_start+i*chain_length].r.p[2];
-    tmp = (SQR(dx) + SQR(dy) + SQR(dz));
-    dist  += sqrt(tmp);
-    dist2 += tmp;
-    dist4 += tmp*tmp;
-  }
-  tmp = (double)chain_n_chains;
-  re[0] = dist/tmp;
-  re[2] = dist2/tmp;
+/** The chain of a particle, or -1 if it is in none. */
+static int chain_of(const Particle &p, const std::vector<double> &params)
+{
+  if (params[0])
+    return p.p.mol_id;
+  int first = params[1], n_chains = params[2], length = params[3];
+  int i = p.p.identity - first;
+  if (length <= 0 || i < 0 || i >= n_chains*length)
+    return -1;
+  return i/length;
+}
+
+/** Move the beads of every chain to the node evaluating it. Molecules
+    of a single particle are no chains. Collective. */
+static void collect_chains(const std::vector<double> &params,
+                           LocalChains &chains)
+{
+  const int stride = 6;
+  std::vector<double> beads;
+  std::vector<int> nodes;
+  for_each_local_particle([&](const Particle &p) {
+      int c = chain_of(p, params);
+      if (c < 0)
+        return;
+      double pos[3];
+      get_unfolded_position(p, pos);
+      beads.push_back(c);
+      beads.push_back(p.p.identity);
+      beads.insert(beads.end(), pos, pos + 3);
+      beads.push_back(p.p.mass);
+      nodes.push_back(c % n_nodes);
+    });
+  distribute_points(beads, stride, nodes);
+
+  int n = beads.size()/stride;
+  std::vector<int> order(n);
+  for (int i = 0; i < n; i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+      const double *pa = &beads[stride*a], *pb = &beads[stride*b];
+      return pa[0] < pb[0] || (pa[0] == pb[0] && pa[1] < pb[1]);
+    });
+
+  chains = LocalChains();
+  for (int i = 0; i < n; ) {
+    int key = beads[stride*order[i]], end = i;
+    while (end < n && beads[stride*order[end]] == key)
+      end++;
+    if (!params[0] || end - i >= 2) {
+      chains.key.push_back(key);
+      chains.start.push_back(chains.id.size());
+      for (; i < end; i++) {
+        const double *b = &beads[stride*order[i]];
+        chains.id.push_back(b[1]);
+        chains.x.push_back(b[2]);
+        chains.y.push_back(b[3]);
+        chains.z.push_back(b[4]);
+        chains.mass.push_back(b[5]);
+      }
+    }
+    i = end;
+  }
+  chains.start.push_back(chains.id.size());
+}
+
+/** Start the result of a map step with the number of chains and the
+    number of chains that do not match the chain structure. */
+static void count_chains(const std::vector<double> &params,
+                         const LocalChains &chains, int size,
+                         std::vector<double> &result)
+{
+  result.assign(size, 0.0);
+  result[0] = chains.size();
+  if (!params[0])
+    for (int c = 0; c < chains.size(); c++)
+      if (chains.length(c) != params[3])
+        result[1] += 1.0;
+}
+
+/** Run a distributed chain analysis and check the chains found.
+    \return false with a runtime error if there are no chains, or they
+    do not match the chain structure */
+static bool run_chain_job(const ParallelAnalysis &job,
+                          const std::vector<double> &params,
+                          std::vector<double> &result)
+{
+  result = job(params);
+  if (result[0] == 0) {
+    runtimeErrorMsg() << "chain analysis: no chains found";
+    return false;
+  }
+  if (!params[0] && (result[0] != chain_n_chains || result[1] != 0)) {
+    runtimeErrorMsg() << "chain analysis: the particles do not match the "
+                      << "chain structure";
+    return false;
+  }
+  return true;
+}
+
+/** The mass weighted center of chain c. */
+static void chain_center(const LocalChains &chains, int c, double cm[3])
+{
+  double M = 0.0;
+  cm[0] = cm[1] = cm[2] = 0.0;
+  for (int i = chains.start[c]; i < chains.start[c + 1]; i++) {
+    cm[0] += chains.x[i]*chains.mass[i];
+    cm[1] += chains.y[i]*chains.mass[i];
+    cm[2] += chains.z[i]*chains.mass[i];
+    M += chains.mass[i];
+  }
+  cm[0] /= M; cm[1] /= M; cm[2] /= M;
+}
+
+/** The distances of all pairs of beads of chain c, row by row. */
+static void chain_pair_distances(const LocalChains &chains, int c,
+                                 std::vector<double> &r)
+{
+  const double *x = chains.x.data(), *y = chains.y.data(),
+    *z = chains.z.data();
+  int first = chains.start[c], last = chains.start[c + 1];
+  r.resize((size_t)(last - first)*(last - first - 1)/2);
+  double *out = r.data();
+  for (int i = first; i < last; i++) {
+    double xi = x[i], yi = y[i], zi = z[i];
+    int n = last - i - 1;
+    for (int k = 0; k < n; k++) {
+      double dx = x[i + 1 + k] - xi, dy = y[i + 1 + k] - yi,
+        dz = z[i + 1 + k] - zi;
+      out[k] = dx*dx + dy*dy + dz*dz;
+    }
+    for (int k = 0; k < n; k++)
+      out[k] = std::sqrt(out[k]);
+    out += n;
+  }
+}
+
+static void local_re(const std::vector<double> &params,
+                     std::vector<double> &result)
+{
+  LocalChains chains;
+  collect_chains(params, chains);
+  count_chains(params, chains, 5, result);
+  for (int c = 0; c < chains.size(); c++) {
+    int f = chains.start[c], l = chains.start[c + 1] - 1;
+    double d2 = SQR(chains.x[l] - chains.x[f]) + SQR(chains.y[l] - chains.y[f])
+      + SQR(chains.z[l] - chains.z[f]);
+    result[2] += sqrt(d2);
+    result[3] += d2;
+    result[4] += d2*d2;
+  }
+}
+
+static ParallelAnalysis re_job(local_re, ANALYSIS_SUM);
+
+int calc_re(double **_re, bool molecules)
+{
+  double *re = *_re = (double*)Utils::malloc(4*sizeof(double));
+  std::vector<double> sums;
+  if (!run_chain_job(re_job, chain_params(molecules), sums)) {
+    re[0] = re[1] = re[2] = re[3] = 0.0;
+    return ES_ERROR;
+  }
+  double n = sums[0];
+  re[0] = sums[2]/n;
+  re[2] = sums[3]/n;
   re[1] = sqrt(re[2] - re[0]*re[0]);
-  re[3] = sqrt(dist4/tmp - re[2]*re[2]);
+  re[3] = sqrt(sums[4]/n - re[2]*re[2]);
+  return ES_OK;
+}
+
+static void local_rg(const std::vector<double> &params,
+                     std::vector<double> &result)
+{
+  LocalChains chains;
+  collect_chains(params, chains);
+  count_chains(params, chains, 5, result);
+  for (int c = 0; c < chains.size(); c++) {
+    double cm[3], tmp = 0.0;
+    chain_center(chains, c, cm);
+    for (int i = chains.start[c]; i < chains.start[c + 1]; i++)
+      tmp += SQR(chains.x[i] - cm[0]) + SQR(chains.y[i] - cm[1])
+        + SQR(chains.z[i] - cm[2]);
+    tmp /= chains.length(c);
+    result[2] += sqrt(tmp);
+    result[3] += tmp;
+    result[4] += tmp*tmp;
+  }
+}
+
+static ParallelAnalysis rg_job(local_rg, ANALYSIS_SUM);
+
+int calc_rg(double **_rg, bool molecules)
+{
+  double *rg = *_rg = (double*)Utils::malloc(4*sizeof(double));
+  std::vector<double> sums;
+  if (!run_chain_job(rg_job, chain_params(molecules), sums)) {
+    rg[0] = rg[1] = rg[2] = rg[3] = 0.0;
+    return ES_ERROR;
+  }
+  double n = sums[0];
+  rg[0] = sums[2]/n;
+  rg[2] = sums[3]/n;
+  rg[1] = sqrt(rg[2] - rg[0]*rg[0]);
+  rg[3] = sqrt(sums[4]/n - rg[2]*rg[2]);
+  return ES_OK;
+}
+
+static void local_rh(const std::vector<double> &params,
+                     std::vector<double> &result)
+{
+  LocalChains chains;
+  collect_chains(params, chains);
+  count_chains(params, chains, 4, result);
+  const double *x = chains.x.data(), *y = chains.y.data(),
+    *z = chains.z.data();
+  for (int c = 0; c < chains.size(); c++) {
+    int last = chains.start[c + 1];
+    double ri = 0.0;
+    for (int i = chains.start[c]; i < last; i++) {
+      double xi = x[i], yi = y[i], zi = z[i], row = 0.0;
+      for (int j = i + 1; j < last; j++) {
+        double dx = x[j] - xi, dy = y[j] - yi, dz = z[j] - zi;
+        row += 1.0/std::sqrt(dx*dx + dy*dy + dz*dz);
+      }
+      ri += row;
+    }
+    /* 1/N^2 is not a normalization factor */
+    double tmp = 0.5*SQR(chains.length(c))/ri;
+    result[2] += tmp;
+    result[3] += tmp*tmp;
+  }
+}
+
+static ParallelAnalysis rh_job(local_rh, ANALYSIS_SUM);
+
+int calc_rh(double **_rh, bool molecules)
+{
+  double *rh = *_rh = (double*)Utils::malloc(2*sizeof(double));
+  std::vector<double> sums;
+  if (!run_chain_job(rh_job, chain_params(molecules), sums)) {
+    rh[0] = rh[1] = 0.0;
+    return ES_ERROR;
+  }
+  double n = sums[0];
+  rh[0] = sums[2]/n;
+  rh[1] = sqrt(sums[3]/n - rh[0]*rh[0]);
+  return ES_OK;
+}
+
+static void local_internal_dist(const std::vector<double> &params,
+                                std::vector<double> &result)
+{
+  LocalChains chains;
+  collect_chains(params, chains);
+
+  /* the sums of the square distances and their numbers for all index
+     distances up to the longest chain */
+  int length = params[3];
+  if (params[0]) {
+    int mine = 0;
+    for (int c = 0; c < chains.size(); c++)
+      mine = std::max(mine, chains.length(c));
+    MPI_Allreduce(&mine, &length, 1, MPI_INT, MPI_MAX, comm_cart);
+  }
+  count_chains(params, chains, 2 + 2*length, result);
+  double *sums = &result[2], *counts = &result[2 + length];
+
+  const double *x = chains.x.data(), *y = chains.y.data(),
+    *z = chains.z.data();
+  for (int c = 0; c < chains.size(); c++) {
+    int first = chains.start[c], n = chains.length(c);
+    if (n > length)
+      continue;
+    for (int k = 1; k < n; k++) {
+      double s = 0.0;
+      for (int j = first; j < first + n - k; j++) {
+        double dx = x[j + k] - x[j], dy = y[j + k] - y[j],
+          dz = z[j + k] - z[j];
+        s += dx*dx + dy*dy + dz*dz;
+      }
+      sums[k] += s;
+      counts[k] += n - k;
+    }
+  }
+}
+
+static ParallelAnalysis internal_dist_job(local_internal_dist, ANALYSIS_SUM);
+
+int calc_internal_dist(double **_idf, int *length, bool molecules)
+{
+  std::vector<double> sums;
+  bool ok = run_chain_job(internal_dist_job, chain_params(molecules), sums);
+  int n = *length = (sums.size() - 2)/2;
+  double *idf = *_idf = (double*)Utils::malloc(std::max(n, 1)*sizeof(double));
+  for (int k = 0; k < n; k++)
+    idf[k] = (ok && sums[2 + n + k] > 0) ?
+      sqrt(sums[2 + k]/sums[2 + n + k]) : 0.0;
+  return ok ? ES_OK : ES_ERROR;
+}
+
+/** The initial positions of the beads of the chains of this node and the
+    initial centers of the chains, for \ref calc_g123. */
+static std::map<int, std::array<double, 3> > g123_initial_pos, g123_initial_cm;
+/** whether \ref init_g123 used the molecules as chains */
+static bool g123_molecules = false;
+
+static void local_init_g123(const std::vector<double> &params,
+                            std::vector<double> &result)
+{
+  LocalChains chains;
+  collect_chains(params, chains);
+  count_chains(params, chains, 3, result);
+  g123_initial_pos.clear();
+  g123_initial_cm.clear();
+  for (int c = 0; c < chains.size(); c++) {
+    double cm[3];
+    chain_center(chains, c, cm);
+    g123_initial_cm[chains.key[c]] = {{cm[0], cm[1], cm[2]}};
+    for (int i = chains.start[c]; i < chains.start[c + 1]; i++)
+      g123_initial_pos[chains.id[i]] = {{chains.x[i], chains.y[i], chains.z[i]}};
+  }
+  result[2] = chains.id.size();
+}
+
+static ParallelAnalysis init_g123_job(local_init_g123, ANALYSIS_SUM);
+
+int init_g123(bool molecules)
+{
+  std::vector<double> res;
+  n_chains_g = n_part_g = 0;
+  if (!run_chain_job(init_g123_job, chain_params(molecules), res))
+    return ES_ERROR;
+  g123_molecules = molecules;
+  n_chains_g = res[0];
+  n_part_g = res[2];
+  return ES_OK;
+}
+
+static void local_g123(const std::vector<double> &params,
+                       std::vector<double> &result)
+{
+  LocalChains chains;
+  collect_chains(params, chains);
+  /* after the chain counts: the number of beads, g1, g2 and g3, and the
+     number of beads and chains without initial position */
+  count_chains(params, chains, 7, result);
+  result[2] = chains.id.size();
+  for (int c = 0; c < chains.size(); c++) {
+    auto cm0 = g123_initial_cm.find(chains.key[c]);
+    if (cm0 == g123_initial_cm.end()) {
+      result[6] += 1.0;
+      continue;
+    }
+    double cm[3];
+    chain_center(chains, c, cm);
+    double dcm[3] = {cm[0] - cm0->second[0], cm[1] - cm0->second[1],
+                     cm[2] - cm0->second[2]};
+    for (int i = chains.start[c]; i < chains.start[c + 1]; i++) {
+      auto r0 = g123_initial_pos.find(chains.id[i]);
+      if (r0 == g123_initial_pos.end()) {
+        result[6] += 1.0;
+        continue;
+      }
+      double d[3] = {chains.x[i] - r0->second[0], chains.y[i] - r0->second[1],
+                     chains.z[i] - r0->second[2]};
+      result[3] += SQR(d[0]) + SQR(d[1]) + SQR(d[2]);
+      result[4] += SQR(d[0] - dcm[0]) + SQR(d[1] - dcm[1]) + SQR(d[2] - dcm[2]);
+    }
+    result[5] += SQR(dcm[0]) + SQR(dcm[1]) + SQR(dcm[2]);
+  }
+}
+
+static ParallelAnalysis g123_job(local_g123, ANALYSIS_SUM);
+
+int calc_g123(double *g1, double *g2, double *g3)
+{
+  /* - Mean square displacement of a monomer
+     - Mean square displacement in the center of gravity of the chain itself
+     - Motion of the center of mass */
+  std::vector<double> res;
+  *g1 = *g2 = *g3 = 0.0;
+  if (!run_chain_job(g123_job, chain_params(g123_molecules), res))
+    return ES_ERROR;
+  if (res[0] != n_chains_g || res[2] != n_part_g || res[6] != 0) {
+    runtimeErrorMsg() << "g123: initial config has different topology";
+    return ES_ERROR;
+  }
+  *g1 = res[3]/res[2];
+  *g2 = res[4]/res[2];
+  *g3 = res[5]/res[0];
+  return ES_OK;
+}
+
+static void local_formfactor(const std::vector<double> &params,
+                             std::vector<double> &result)
+{
+  LocalChains chains;
+  collect_chains(params, chains);
+  double qmin = params[4], qmax = params[5];
+  int qbins = params[6];
+  count_chains(params, chains, 2 + qbins + 1, result);
+  double *ff = &result[2];
+
+  double qfak = pow((qmax/qmin),(1.0/qbins));
+  std::vector<double> r_ij;
+  for (int c = 0; c < chains.size(); c++) {
+    int n = chains.length(c);
+    chain_pair_distances(chains, c, r_ij);
+    /* Derive spherically averaged S(q) = 1/n * Sum(i,j=1..n)[sin(q*r_ij)/q*r_ij] for chain c */
+    double q = qmin;
+    for (int qi = 0; qi <= qbins; qi++) {
+      double s = 0.0;
+      for (double r : r_ij)
+        s += sin(q*r)/r;
+      ff[qi] += (n + 2*s/q)/n;
+      q *= qfak;
+    }
+  }
+}
+
+static ParallelAnalysis formfactor_job(local_formfactor, ANALYSIS_SUM);
+
+int analyze_formfactor(double qmin, double qmax, int qbins, double **_ff,
+                       bool molecules)
+{
+  double *ff = *_ff = (double*)Utils::malloc((qbins+1)*sizeof(double));
+  std::vector<double> sums;
+  bool ok = run_chain_job(formfactor_job,
+                          chain_params(molecules, {qmin, qmax, double(qbins)}),
+                          sums);
+  for (int qi = 0; qi <= qbins; qi++)
+    ff[qi] = ok ? sums[2 + qi]/sums[0] : 0.0;
+  return ok ? ES_OK : ES_ERROR;
 }
 
 void calc_re_av(double **_re)
@@ -95,12 +543,12 @@ void calc_re_av(double **_re)
 
   for (j=0; j<n_configs; j++) {
     for (i=0; i<chain_n_chains; i++) {
-      dx = configs[j][3*(chain_start+i*chain_length + chain_length-1)]     
-	- configs[j][3*(chain_start+i*chain_length)];
-      dy = configs[j][3*(chain_start+i*chain_length + chain_length-1) + 1] 
-	- configs[j][3*(chain_start+i*chain_length) + 1];
-      dz = configs[j][3*(chain_start+i*chain_length + chain_length-1) + 2] 
-	- configs[j][3*(chain_start+i*chain_length) + 2];
+      dx = get_config(j)[3*(chain_start+i*chain_length + chain_length-1)]     
+	- get_config(j)[3*(chain_start+i*chain_length)];
+      dy = get_config(j)[3*(chain_start+i*chain_length + chain_length-1) + 1] 
+	- get_config(j)[3*(chain_start+i*chain_length) + 1];
+      dz = get_config(j)[3*(chain_start+i*chain_length + chain_length-1) + 2] 
+	- get_config(j)[3*(chain_start+i*chain_length) + 2];
       tmp = (SQR(dx) + SQR(dy) + SQR(dz));
       dist  += sqrt(tmp);
       dist2 += tmp;
@@ -114,50 +562,6 @@ void calc_re_av(double **_re)
   re[3] = sqrt(dist4/tmp - re[2]*re[2]);
 }
 
-void calc_rg(double **_rg)
-{
-  int i, j, p;
-  double dx,dy,dz, r_CM_x,r_CM_y,r_CM_z;
-  double r_G=0.0,r_G2=0.0,r_G4=0.0;
-  double *rg=NULL,IdoubMPC, tmp;
-  double M;
-  *_rg = rg = (double*)Utils::realloc(rg,4*sizeof(double));
-
-
-  for (i=0; i<chain_n_chains; i++) {
-    M=0.0;
-    r_CM_x = r_CM_y = r_CM_z = 0.0;
-    IdoubMPC = 1./(double)chain_length;
-    for (j=0; j<chain_length; j++) {
-        p = chain_start+i*chain_length + j;
-      r_CM_x += partCfg[p].r.p[0]*(partCfg[p]).p.mass;
-      r_CM_y += partCfg[p].r.p[1]*(partCfg[p]).p.mass;
-      r_CM_z += partCfg[p].r.p[2]*(partCfg[p]).p.mass;
-      M += (partCfg[p]).p.mass;
-    }
-    r_CM_x /= M;
-    r_CM_y /= M;
-    r_CM_z /= M;
-    tmp = 0.0;
-    for (j=0; j<chain_length; ++j) {
-      p = chain_start+i*chain_length + j;
-      dx = partCfg[p].r.p[0] - r_CM_x;
-      dy = partCfg[p].r.p[1] - r_CM_y;
-      dz = partCfg[p].r.p[2] - r_CM_z;
-      tmp += (SQR(dx) + SQR(dy) + SQR(dz));
-    }
-    tmp *= IdoubMPC;
-    r_G  += sqrt(tmp);
-    r_G2 += tmp;
-    r_G4 += tmp*tmp;
-  }
-  tmp = (double)chain_n_chains;
-  rg[0] = r_G/tmp;
-  rg[2] = r_G2/tmp;
-  rg[1] = sqrt(rg[2] - rg[0]*rg[0]);
-  rg[3] = sqrt(r_G4/tmp - rg[2]*rg[2]);
-}
-
 void calc_rg_av(double **_rg)
 {
   int i, j, k, p;
@@ -174,18 +578,18 @@ void calc_rg_av(double **_rg)
       r_CM_x = r_CM_y = r_CM_z = 0.0;
       for (j=0; j<chain_length; j++) {
         p = chain_start+i*chain_length + j;
-	r_CM_x += configs[k][3*p]*(partCfg[p]).p.mass;
-	r_CM_y += configs[k][3*p + 1]*(partCfg[p]).p.mass;
-	r_CM_z += configs[k][3*p + 2]*(partCfg[p]).p.mass;
+	r_CM_x += get_config(k)[3*p]*(partCfg[p]).p.mass;
+	r_CM_y += get_config(k)[3*p + 1]*(partCfg[p]).p.mass;
+	r_CM_z += get_config(k)[3*p + 2]*(partCfg[p]).p.mass;
         M += (partCfg[p]).p.mass;
       }
       r_CM_x /= M; r_CM_y /= M; r_CM_z /= M;
       tmp = 0.0;
       for (j=0; j<chain_length; ++j) {
         p = chain_start+i*chain_length + j;
-	dx = configs[k][3*p]     - r_CM_x;
-	dy = configs[k][3*p + 1] - r_CM_y;
-	dz = configs[k][3*p + 2] - r_CM_z;
+	dx = get_config(k)[3*p]     - r_CM_x;
+	dy = get_config(k)[3*p + 1] - r_CM_y;
+	dz = get_config(k)[3*p + 2] - r_CM_z;
 	tmp += (SQR(dx) + SQR(dy) + SQR(dz));
       }
       tmp *= IdoubMPC;
@@ -201,32 +605,6 @@ void calc_rg_av(double **_rg)
   rg[3] = sqrt(r_G4/tmp - rg[2]*rg[2]);
 }
 
-void calc_rh(double **_rh)
-{
-  int i, j, p;
-  double dx,dy,dz, r_H=0.0,r_H2=0.0, *rh=NULL, ri=0.0, prefac, tmp;
-  *_rh = rh = (double*)Utils::realloc(rh,2*sizeof(double));
-
-  prefac = 0.5*chain_length*chain_length; /* 1/N^2 is not a normalization factor */
-  for(p=0;p<chain_n_chains;p++) {
-    ri=0.0;
-    for(i=chain_start+chain_length*p;i<chain_start+chain_length*(p+1);i++) {
-      for(j=i+1;j<chain_start+chain_length*(p+1);j++) {
-	dx = partCfg[i].r.p[0]-partCfg[j].r.p[0]; dx*=dx;
-	dy = partCfg[i].r.p[1]-partCfg[j].r.p[1]; dy*=dy;
-	dz = partCfg[i].r.p[2]-partCfg[j].r.p[2]; dz*=dz;
-	ri += 1.0/sqrt(dx+dy+dz);
-      }
-    }
-    tmp = prefac/ri;
-    r_H  += tmp;
-    r_H2 += tmp*tmp;
-  }
-  tmp = (double)chain_n_chains;
-  rh[0] = r_H/tmp;
-  rh[1] = sqrt(r_H2/tmp - rh[0]*rh[0]);
-}
-
 void calc_rh_av(double **_rh)
 {
   int i, j, p, k;
@@ -239,9 +617,9 @@ void calc_rh_av(double **_rh)
       ri=0.0;
       for(i=chain_start+chain_length*p;i<chain_start+chain_length*(p+1);i++) {
 	for(j=i+1;j<chain_start+chain_length*(p+1);j++) {
-	  dx = configs[k][3*i]  -configs[k][3*j];
-	  dy = configs[k][3*i+1]-configs[k][3*j+1];
-	  dz = configs[k][3*i+2]-configs[k][3*j+2];
+	  dx = get_config(k)[3*i]  -get_config(k)[3*j];
+	  dy = get_config(k)[3*i+1]-get_config(k)[3*j+1];
+	  dz = get_config(k)[3*i+2]-get_config(k)[3*j+2];
 	  ri += 1.0/sqrt(dx*dx + dy*dy + dz*dz);
 	}
       }
@@ -255,52 +633,30 @@ void calc_rh_av(double **_rh)
   rh[1] = sqrt(r_H2/tmp - rh[0]*rh[0]);
 }
 
-void calc_internal_dist(double **_idf) {
-  int i,j,k;
-  double dx,dy,dz;
-  double *idf=NULL;
-  *_idf = idf = (double*)Utils::realloc(idf,chain_length*sizeof(double));
-
-  idf[0] = 0.0;
-  for (k=1; k < chain_length; k++) {
-    idf[k] = 0.0;
-    for (i=0; i<chain_n_chains; i++) {
-      for (j=0; j < chain_length-k; j++) {
-	dx = partCfg[chain_start+i*chain_length + j+k].r.p[0]
-	  - partCfg[chain_start+i*chain_length + j].r.p[0];
-	dy = partCfg[chain_start+i*chain_length + j+k].r.p[1]
-	  - partCfg[chain_start+i*chain_length + j].r.p[1];
-	dz = partCfg[chain_start+i*chain_length + j+k].r.p[2]
-	  - partCfg[chain_start+i*chain_length +j].r.p[2];
-	idf[k] += (SQR(dx) + SQR(dy) + SQR(dz));
-      }
-    }
-    idf[k] = sqrt(idf[k] / (1.0*(chain_length-k)*chain_n_chains));
-  }
-}
-
 void calc_internal_dist_av(double **_idf) {
   int i,j,k,n, i1,i2;
   double dx,dy,dz;
   double *idf=NULL;
   *_idf = idf = (double*)Utils::realloc(idf,chain_length*sizeof(double));
 
-  idf[0] = 0.0;
-  for (k=1; k < chain_length; k++) {
-    idf[k] = 0.0;
-    for (n=0; n<n_configs; n++) {
+  /* the configurations are the outer loop, so that mapped ones are
+     decoded once */
+  for (k=0; k < chain_length; k++) idf[k] = 0.0;
+  for (n=0; n<n_configs; n++) {
+    for (k=1; k < chain_length; k++) {
       for (i=0; i<chain_n_chains; i++) {
 	for (j=0; j < chain_length-k; j++) {
 	  i2 = chain_start+i*chain_length + j; i1 = i2 + k;
-	  dx = configs[n][3*i1]   - configs[n][3*i2];
-	  dy = configs[n][3*i1+1] - configs[n][3*i2+1];
-	  dz = configs[n][3*i1+2] - configs[n][3*i2+2];
+	  dx = get_config(n)[3*i1]   - get_config(n)[3*i2];
+	  dy = get_config(n)[3*i1+1] - get_config(n)[3*i2+1];
+	  dz = get_config(n)[3*i1+2] - get_config(n)[3*i2+2];
 	  idf[k] += (SQR(dx) + SQR(dy) + SQR(dz));
 	}
       }
     }
-    idf[k] = sqrt(idf[k] / (1.0*(chain_length-k)*chain_n_chains*n_configs));
   }
+  for (k=1; k < chain_length; k++)
+    idf[k] = sqrt(idf[k] / (1.0*(chain_length-k)*chain_n_chains*n_configs));
 }
 
 void calc_bond_l(double **_bond_l) {
@@ -343,9 +699,9 @@ void calc_bond_l_av(double **_bond_l) {
     for (i=0; i<chain_n_chains; i++) {
       for (j=0; j < chain_length-1; j++) {
 	i2 = chain_start+i*chain_length + j; i1 = i2 + 1;
-	dx = configs[n][3*i1]   - configs[n][3*i2];
-	dy = configs[n][3*i1+1] - configs[n][3*i2+1];
-	dz = configs[n][3*i1+2] - configs[n][3*i2+2];
+	dx = get_config(n)[3*i1]   - get_config(n)[3*i2];
+	dy = get_config(n)[3*i1+1] - get_config(n)[3*i2+1];
+	dz = get_config(n)[3*i1+2] - get_config(n)[3*i2+2];
 	tmp = SQR(dx) + SQR(dy) + SQR(dz);
 	bond_l[0] += sqrt(tmp);
 	bond_l[1] += tmp;
@@ -391,92 +747,22 @@ void calc_bond_dist_av(double **_bdf, int ind_n) {
   double *bdf=NULL;
   *_bdf = bdf = (double*)Utils::realloc(bdf,chain_length*sizeof(double));
 
-  bdf[0] = 0.0;
-  for (k=1; k < chain_length; k++) {
-    bdf[k] = 0.0;
-    for (n=0; n<n_configs; n++) {
+  for (k=0; k < chain_length; k++) bdf[k] = 0.0;
+  for (n=0; n<n_configs; n++) {
+    for (k=1; k < chain_length; k++) {
       for (i=0; i<chain_n_chains; i++) {
 	if (j < chain_length-k) {
 	  i2 = chain_start+i*chain_length + j; i1 = i2 + k;
-	  dx = configs[n][3*i1]   - configs[n][3*i2];
-	  dy = configs[n][3*i1+1] - configs[n][3*i2+1];
-	  dz = configs[n][3*i1+2] - configs[n][3*i2+2];
+	  dx = get_config(n)[3*i1]   - get_config(n)[3*i2];
+	  dy = get_config(n)[3*i1+1] - get_config(n)[3*i2+1];
+	  dz = get_config(n)[3*i1+2] - get_config(n)[3*i2+2];
 	  bdf[k] += (SQR(dx) + SQR(dy) + SQR(dz));
 	}
       }
     }
-    bdf[k] = sqrt(bdf[k] / (1.0*chain_n_chains*n_configs));
   }
-}
-
-void init_g123()
-{
-  int i, j, p;
-  double cm_tmp[3], M;
-
-  /* Save particles' current positions 
-     (which'll be used as initial position later on) */
-  partCoord_g = (float *) Utils::realloc(partCoord_g, 3*n_part*sizeof(float));
-  partCM_g = (float *) Utils::realloc(partCM_g, 3*chain_n_chains*sizeof(float));
-  n_part_g = n_part;
-  n_chains_g = chain_n_chains;
-  for(j=0; j<chain_n_chains; j++) {
-    cm_tmp[0] = cm_tmp[1] = cm_tmp[2] = 0.0;
-    M=0.0;
-    for(i=0; i<chain_length; i++) {
-      p = chain_start+j*chain_length + i;
-      partCoord_g[3*p]   = partCfg[p].r.p[0]; cm_tmp[0]+=partCfg[p].r.p[0]*(partCfg[p]).p.mass;
-      partCoord_g[3*p+1] = partCfg[p].r.p[1]; cm_tmp[1]+=partCfg[p].r.p[1]*(partCfg[p]).p.mass;
-      partCoord_g[3*p+2] = partCfg[p].r.p[2]; cm_tmp[2]+=partCfg[p].r.p[2]*(partCfg[p]).p.mass;
-      M += (partCfg[p]).p.mass;
-    }
-    partCM_g[3*j]   = cm_tmp[0]/M;
-    partCM_g[3*j+1] = cm_tmp[1]/M;
-    partCM_g[3*j+2] = cm_tmp[2]/M;
-  }
-}
-
-void calc_g123(double *_g1, double *_g2, double *_g3)
-{
-  /* - Mean square displacement of a monomer
-     - Mean square displacement in the center of gravity of the chain itself
-     - Motion of the center of mass */
-  int i, j, p;
-  double g1=0.0, g2=0.0, g3=0.0, cm_tmp[3];
-  double M;
-
-  for(j=0; j<chain_n_chains; j++) {
-    cm_tmp[0] = cm_tmp[1] = cm_tmp[2] = 0.0;
-    M=0.0;
-    for(i=0; i<chain_length; i++) {
-      p = chain_start+j*chain_length + i;
-      cm_tmp[0]+=partCfg[p].r.p[0]*(partCfg[p]).p.mass;
-      cm_tmp[1]+=partCfg[p].r.p[1]*(partCfg[p]).p.mass;
-      cm_tmp[2]+=partCfg[p].r.p[2]*(partCfg[p]).p.mass;
-      M += (partCfg[p]).p.mass;
-    }
-    cm_tmp[0] /= M;
-    cm_tmp[1] /= M;
-    cm_tmp[2] /= M;
-    for(i=0; i<chain_length; i++) {
-      p = chain_start+j*chain_length + i;
-      g1 += SQR(partCfg[p].r.p[0]-partCoord_g[3*p])
-	+ SQR(partCfg[p].r.p[1]-partCoord_g[3*p+1])
-	+ SQR(partCfg[p].r.p[2]-partCoord_g[3*p+2]);
-      g2 += SQR( (partCfg[p].r.p[0]-partCoord_g[3*p])
-		 - (cm_tmp[0]-partCM_g[3*j]  ) ) 
-	+ SQR( (partCfg[p].r.p[1]-partCoord_g[3*p+1])
-	       - (cm_tmp[1]-partCM_g[3*j+1]) ) 
-	+ SQR( (partCfg[p].r.p[2]-partCoord_g[3*p+2])
-	       - (cm_tmp[2]-partCM_g[3*j+2]) );
-    }
-    g3 += SQR(cm_tmp[0]-partCM_g[3*j])
-      + SQR(cm_tmp[1]-partCM_g[3*j+1])
-      + SQR(cm_tmp[2]-partCM_g[3*j+2]);
-  }
-  *_g1 = g1 / (1.*chain_n_chains*chain_length);
-  *_g2 = g2 / (1.*chain_n_chains*chain_length);
-  *_g3 = g3 / (1.*chain_n_chains);
+  for (k=1; k < chain_length; k++)
+    bdf[k] = sqrt(bdf[k] / (1.0*chain_n_chains*n_configs));
 }
 
 void calc_g1_av(double **_g1, int window, double weights[3]) {
@@ -491,9 +777,9 @@ void calc_g1_av(double **_g1, int window, double weights[3]) {
       for(j=0; j<chain_n_chains; j++) {
 	for(i=0; i<chain_length; i++) {
 	  p = chain_start+j*chain_length + i;
-	  g1[k] += weights[0]*SQR(configs[t+k][3*p]-configs[t][3*p])
-	    + weights[1]*SQR(configs[t+k][3*p+1]-configs[t][3*p+1])
-	    + weights[2]*SQR(configs[t+k][3*p+2]-configs[t][3*p+2]);
+	  g1[k] += weights[0]*SQR(get_config(t+k)[3*p]-get_config(t)[3*p])
+	    + weights[1]*SQR(get_config(t+k)[3*p+1]-get_config(t)[3*p+1])
+	    + weights[2]*SQR(get_config(t+k)[3*p+2]-get_config(t)[3*p+2]);
 	}
       }
     }
@@ -516,17 +802,17 @@ void calc_g2_av(double **_g2, int window, double weights[3]) {
         M=0.0;
 	for(i=0; i<chain_length; i++) {
 	  p = chain_start+j*chain_length + i;
-	  cm_tmp[0] += (configs[t+k][3*p]   - configs[t][3*p])*(partCfg[p]).p.mass;
-	  cm_tmp[1] += (configs[t+k][3*p+1] - configs[t][3*p+1])*(partCfg[p]).p.mass;
-	  cm_tmp[2] += (configs[t+k][3*p+2] - configs[t][3*p+2])*(partCfg[p]).p.mass;
+	  cm_tmp[0] += (get_config(t+k)[3*p]   - get_config(t)[3*p])*(partCfg[p]).p.mass;
+	  cm_tmp[1] += (get_config(t+k)[3*p+1] - get_config(t)[3*p+1])*(partCfg[p]).p.mass;
+	  cm_tmp[2] += (get_config(t+k)[3*p+2] - get_config(t)[3*p+2])*(partCfg[p]).p.mass;
           M += (partCfg[p]).p.mass;
 	}
 	cm_tmp[0] /= M;	cm_tmp[1] /= M;	cm_tmp[2] /= M;
 	for(i=0; i<chain_length; i++) {
 	  p = chain_start+j*chain_length + i;
-	  g2[k] += weights[0]*SQR( (configs[t+k][3*p]-configs[t][3*p]) - cm_tmp[0] )
-	    + weights[1]*SQR( (configs[t+k][3*p+1]-configs[t][3*p+1])  - cm_tmp[1] ) 
-	    + weights[2]*SQR( (configs[t+k][3*p+2]-configs[t][3*p+2])  - cm_tmp[2] );
+	  g2[k] += weights[0]*SQR( (get_config(t+k)[3*p]-get_config(t)[3*p]) - cm_tmp[0] )
+	    + weights[1]*SQR( (get_config(t+k)[3*p+1]-get_config(t)[3*p+1])  - cm_tmp[1] ) 
+	    + weights[2]*SQR( (get_config(t+k)[3*p+2]-get_config(t)[3*p+2])  - cm_tmp[2] );
 	}
       }
     }
@@ -549,9 +835,9 @@ void calc_g3_av(double **_g3, int window, double weights[3]) {
         M=0.0;
 	for(i=0; i<chain_length; i++) {
 	  p = chain_start+j*chain_length + i;
-	  cm_tmp[0] += (configs[t+k][3*p]   - configs[t][3*p])*(partCfg[p]).p.mass;
-	  cm_tmp[1] += (configs[t+k][3*p+1] - configs[t][3*p+1])*(partCfg[p]).p.mass;
-	  cm_tmp[2] += (configs[t+k][3*p+2] - configs[t][3*p+2])*(partCfg[p]).p.mass;
+	  cm_tmp[0] += (get_config(t+k)[3*p]   - get_config(t)[3*p])*(partCfg[p]).p.mass;
+	  cm_tmp[1] += (get_config(t+k)[3*p+1] - get_config(t)[3*p+1])*(partCfg[p]).p.mass;
+	  cm_tmp[2] += (get_config(t+k)[3*p+2] - get_config(t)[3*p+2])*(partCfg[p]).p.mass;
           M += (partCfg[p]).p.mass;
 	}
 	g3[k] += (weights[0]*SQR(cm_tmp[0]) + weights[1]*SQR(cm_tmp[1]) + weights[2]*SQR(cm_tmp[2]))/SQR(M);
@@ -562,41 +848,6 @@ void calc_g3_av(double **_g3, int window, double weights[3]) {
 }
 
 
-void analyze_formfactor(double qmin, double qmax, int qbins, double **_ff) {
-  int i,j,k,qi, cnt,cnt_max;
-  double q,qfak, qr, dx,dy,dz, *r_ij=NULL, *ff=NULL;
-  *_ff = ff = (double*)Utils::realloc(ff,(qbins+1)*sizeof(double));
-  r_ij = (double*)Utils::realloc(r_ij,chain_length*(chain_length-1)/2*sizeof(double));
-
-  qfak = pow((qmax/qmin),(1.0/qbins));
-  for(qi=0; qi<=qbins; qi++) ff[qi] = 0.0;
-  for(k=0; k < chain_n_chains; k++) {
-    cnt = 0;
-    /* Prepare distance matrice r_ij for current chain k */
-    for(i=chain_start+k*chain_length; i<chain_start+(k+1)*chain_length; i++) {
-      for(j=i+1; j<chain_start+(k+1)*chain_length;j++) {
-	dx = partCfg[i].r.p[0]-partCfg[j].r.p[0]; dx*=dx;
-	dy = partCfg[i].r.p[1]-partCfg[j].r.p[1]; dy*=dy;
-	dz = partCfg[i].r.p[2]-partCfg[j].r.p[2]; dz*=dz;
-	r_ij[cnt++] = sqrt(dx + dy + dz);
-      }
-    }
-    q = qmin; cnt_max = cnt;
-    /* Derive spherically averaged S(q) = 1/chain_length * Sum(i,j=1..chain_length)[sin(q*r_ij)/q*r_ij] for current chain k */
-    for(qi=0; qi<=qbins; qi++) {
-      ff[qi] += chain_length;
-      for(cnt=0; cnt<cnt_max; cnt++) {
-	qr = q*r_ij[cnt];
-	ff[qi] += 2*sin(qr)/qr;
-      }
-      q *= qfak;
-    }
-  }
-  for(qi=0; qi<=qbins; qi++) ff[qi] /= ((double)chain_length*chain_n_chains);
-  free(r_ij);
-}
-
-
 void analyze_formfactor_av(double qmin, double qmax, int qbins, double **_ff) {
   int i,j,k,n,qi, cnt,cnt_max;
   double q,qfak, qr, dx,dy,dz, *r_ij=NULL, *ff=NULL;
@@ -611,9 +862,9 @@ void analyze_formfactor_av(double qmin, double qmax, int qbins, double **_ff) {
       /* Prepare distance matrice r_ij for current chain k of configuration n */
       for(i=chain_start+k*chain_length; i<chain_start+(k+1)*chain_length; i++) {
 	for(j=i+1; j<chain_start+(k+1)*chain_length;j++) {
-	  dx = configs[n][3*i]  -configs[n][3*j];   dx*=dx;
-	  dy = configs[n][3*i+1]-configs[n][3*j+1]; dy*=dy;
-	  dz = configs[n][3*i+2]-configs[n][3*j+2]; dz*=dz;
+	  dx = get_config(n)[3*i]  -get_config(n)[3*j];   dx*=dx;
+	  dy = get_config(n)[3*i+1]-get_config(n)[3*j+1]; dy*=dy;
+	  dz = get_config(n)[3*i+2]-get_config(n)[3*j+2]; dz*=dz;
 	  r_ij[cnt++] = sqrt(dx + dy + dz);
 	}
       }
@@ -727,7 +978,7 @@ void analyze_cwvac(int maxtau, int interval, double **_avac, double **_evac) {
     for(k=0;k<n_configs-1;k++) {
       for(i=0;i<n_part;i++) {
     	for(j=0;j<3;j++) {
-          varr[k*3*n_part+i*3+j]=configs[k+1][3*i+j]-configs[k][3*i+j];	
+          varr[k*3*n_part+i*3+j]=get_config(k+1)[3*i+j]-get_config(k)[3*i+j];	
     	}
       }
     } 
@@ -24,14 +24,22 @@
 
     This file contains the code for statistics on the data using the
     molecule information set with analyse set chains.
+
+    The analyses of the current configuration run on the nodes: the
+    particles of every chain are moved to one node, which evaluates the
+    chain with the unfolded positions, and the results of the chains are
+    summed over the nodes. Instead of the chain structure, the chains can
+    be the molecules with at least two particles, with the particles of
+    a molecule ordered by identity. These analyses return ES_OK, or
+    ES_ERROR with a runtime error if no chains are found or the particles
+    do not match the chain structure.
 */
 
 /** \name Exported Variables */
 /************************************************************/
-/** Particles' initial positions (needed for g1(t), g2(t), g3(t) in \ref tclcommand_analyze) */
+/** Number of chain particles and chains at the initial configuration of
+    g1(t), g2(t), g3(t) in \ref tclcommand_analyze, 0 before \ref init_g123 */
 /*@{*/
-extern float *partCoord_g;
-extern float *partCM_g;
 extern int n_part_g;
 extern int n_chains_g;
 /*@}*/
@@ -49,8 +57,9 @@ extern int chain_length;
 /*@{*/
 
 /** calculate the end-to-end-distance. chain information \ref chain_start etc. must be set!
-    @return the end-to-end-distance */
-void calc_re(double **re);
+    @param re        returns the mean, its standard deviation, the mean square and its standard deviation
+    @param molecules use the molecules as chains instead of the chain structure */
+int calc_re(double **re, bool molecules = false);
 
 /** calculate the end-to-end-distance averaged over all configurations stored in \ref #configs. 
     Chain information \ref chain_start etc. must be set!
@@ -58,8 +67,9 @@ void calc_re(double **re);
 void calc_re_av(double **re);
 
 /** calculate the radius of gyration. chain information \ref chain_start etc. must be set!
-    @return the radius of gyration */
-void calc_rg(double **rg);
+    @param rg        returns the mean, its standard deviation, the mean square and its standard deviation
+    @param molecules use the molecules as chains instead of the chain structure */
+int calc_rg(double **rg, bool molecules = false);
 
 /** calculate the radius of gyration averaged over all configurations stored in \ref #configs. 
     Chain information \ref chain_start etc. must be set!
@@ -67,8 +77,9 @@ void calc_rg(double **rg);
 void calc_rg_av(double **rg);
 
 /** calculate the hydrodynamic radius (ref. Kirkwood-Zimm theory). chain information \ref chain_start etc. must be set!
-    @return the hydrodynamic radius */
-void calc_rh(double **rh);
+    @param rh        returns the mean and its standard deviation
+    @param molecules use the molecules as chains instead of the chain structure */
+int calc_rh(double **rh, bool molecules = false);
 
 /** calculate the hydrodynamic radius averaged over all configurations stored in \ref #configs. 
     Chain information \ref chain_start etc. must be set!
@@ -76,8 +87,10 @@ void calc_rh(double **rh);
 void calc_rh_av(double **rh);
 
 /** calculates the internal distances within a chain. Chain information \ref chain_start etc. must be set!
-    @param idf contains <tt>idf[0],...,idf[chain_length-1]</tt> */
-void calc_internal_dist(double **idf);
+    @param idf       contains <tt>idf[0],...,idf[length-1]</tt>
+    @param length    returns the length of the longest chain
+    @param molecules use the molecules as chains instead of the chain structure */
+int calc_internal_dist(double **idf, int *length, bool molecules = false);
 
 /** calculates the internal distances within a chain averaged over all configurations stored in \ref #configs.
     Chain information \ref chain_start etc. must be set!
@@ -106,12 +119,12 @@ void calc_bond_dist(double **bdf, int ind_n);
     @param ind_n the index of the monomer from where all distances are taken */
 void calc_bond_dist_av(double **bdf, int ind_n);
 
-/** calculate g123. chain information \ref chain_start etc. must be set!
+/** calculate g123 for the chains of \ref init_g123.
     @param g1 contains g1
     @param g2 contains g2
     @param g3 contains g3
 */
-void calc_g123(double *g1, double *g2, double *g3);
+int calc_g123(double *g1, double *g2, double *g3);
 
 /** calculate \<g1\> averaged over all configurations stored in \ref #configs. 
     Chain information \ref chain_start etc. must be set!
@@ -138,18 +151,22 @@ void calc_g2_av(double **_g2, int window, double weights[3]);
 void calc_g3_av(double **_g3, int window, double weights[3]);
 //void calc_g3_av(double **g3);
 
-/** set the start configuration for g123.
+/** set the start configuration for g123. The initial positions are kept
+    on the nodes evaluating the chains.
     chain information \ref chain_start etc. must be set!
+    @param molecules use the molecules as chains instead of the chain structure
 */
-void init_g123();
+int init_g123(bool molecules = false);
 
 /** Derives the spherically averaged formfactor S(q) = 1/chain_length * Sum(i,j=1..chain_length)[sin(q*r_ij)/q*r_ij] of a single chain,
     averaged over all \ref chain_n_chains currently allocated (-\> chain information must be set!).
     @param qmin  smallest q-vector to look at (qmin \> 0)
     @param qmax  biggest q-vector to look at (qmax \> qmin)
     @param qbins decides how many S(q) are derived (note that the qbins+1 values will be logarithmically spaced)
-    @param _ff   contains S(q) as an array of size qbins */
-void analyze_formfactor(double qmin, double qmax, int qbins, double **_ff);
+    @param _ff   contains S(q) as an array of size qbins
+    @param molecules use the molecules as chains instead of the chain structure */
+int analyze_formfactor(double qmin, double qmax, int qbins, double **_ff,
+                       bool molecules = false);
 
 /** Derives the spherically averaged formfactor S(q) = 1/chain_length * Sum(i,j=1..chain_length)[sin(q*r_ij)/q*r_ij] of a single chain,
     averaged over all \ref chain_n_chains of all \ref n_configs stored configurations in \ref #configs.
@@ -28,7 +28,11 @@
 
 
 #include "statistics_cluster.hpp"
+#include "communication.hpp"
 #include "grid.hpp"
+#include "statistics_parallel.hpp"
+#include <algorithm>
+#include <cmath>
 
 /** NULL terminated linked list of elements of a cluster (indices in particle list) */
 ClusterElement *element;
@@ -409,3 +413,573 @@ void cluster_free_volume_surface(IntList mesh, int dim[3], int nholes, int **hol
 }
 
 /*@}*/
+
+/* The cluster analysis by distance runs in two stages. Every node moves
+   the selected particles into its domain, adds the ones within r_cut of
+   it as a halo and joins the pairs of its own particles in a union-find.
+   It then reports its local clusters, the connections of its particles
+   with the halo and the local cluster of each of its particles near the
+   domain boundary, from which the master joins the local clusters of
+   all nodes in a second union-find. Both union-finds keep the
+   displacement of every element from the root of its tree, which unfolds
+   the clusters across the periodic boundaries. */
+
+/** Doubles per point of the cluster analysis: the folded position, the
+    identity, the molecule and the charge of the particle. */
+static const int CLUSTER_POINT = 6;
+
+/** Union-find that stores for every element its displacement from its
+    parent, and after \ref ClusterForest::find from its root. */
+class ClusterForest {
+public:
+  explicit ClusterForest(int n)
+      : m_parent(n), m_size(n, 1), m_percolating(n, false),
+        m_offset(3 * n, 0.0) {
+    for (int i = 0; i < n; i++)
+      m_parent[i] = i;
+  }
+
+  /** The root of the tree of i, and in offset the position of i relative
+      to the root. */
+  int find(int i, double offset[3]) {
+    int root = i;
+    double total[3] = {0.0, 0.0, 0.0};
+    while (m_parent[root] != root) {
+      for (int d = 0; d < 3; d++)
+        total[d] += m_offset[3 * root + d];
+      root = m_parent[root];
+    }
+    for (int d = 0; d < 3; d++)
+      offset[d] = total[d];
+    /* compress the path, the remaining displacement to the root shrinks
+       by the old offset of every element on the way */
+    while (m_parent[i] != root && i != root) {
+      int next = m_parent[i];
+      for (int d = 0; d < 3; d++) {
+        double old = m_offset[3 * i + d];
+        m_offset[3 * i + d] = total[d];
+        total[d] -= old;
+      }
+      m_parent[i] = root;
+      i = next;
+    }
+    return root;
+  }
+
+  /** Join the trees of i and j. d is the position of j relative to i. If
+      they are joined already along a path with another displacement, the
+      cluster is connected to its own periodic image. */
+  void join(int i, int j, const double d[3]) {
+    double oi[3], oj[3], dr[3];
+    int ri = find(i, oi), rj = find(j, oj);
+    /* the position of the root of j relative to the root of i */
+    for (int k = 0; k < 3; k++)
+      dr[k] = d[k] + oi[k] - oj[k];
+    if (ri == rj) {
+      for (int k = 0; k < 3; k++)
+        if (std::fabs(dr[k]) > 0.5 * box_l[k])
+          m_percolating[ri] = true;
+      return;
+    }
+    if (m_size[ri] < m_size[rj]) {
+      std::swap(ri, rj);
+      for (int k = 0; k < 3; k++)
+        dr[k] = -dr[k];
+    }
+    m_parent[rj] = ri;
+    m_size[ri] += m_size[rj];
+    m_percolating[ri] = m_percolating[ri] || m_percolating[rj];
+    for (int k = 0; k < 3; k++)
+      m_offset[3 * rj + k] = dr[k];
+  }
+
+  /** Mark the tree of i as connected to its own periodic image. */
+  void set_percolating(int i) {
+    double offset[3];
+    m_percolating[find(i, offset)] = true;
+  }
+
+  /** Whether the tree of root is connected to its own periodic image. */
+  bool percolating(int root) const { return m_percolating[root]; }
+
+private:
+  std::vector<int> m_parent, m_size;
+  std::vector<bool> m_percolating;
+  std::vector<double> m_offset;
+};
+
+/** Encode the parameters of the cluster analysis: r_cut, molecules,
+    opposite_charges, the molecule range, the type list and whether only
+    the statistics of the complete local clusters are needed. */
+static std::vector<double> encode_cluster_params(const ClusterCriterion &c,
+                                                 bool statistics)
+{
+  std::vector<double> params{c.r_cut, double(c.molecules),
+                             double(c.opposite_charges), double(c.first_mol),
+                             double(c.last_mol), double(c.types.size())};
+  params.insert(params.end(), c.types.begin(), c.types.end());
+  params.push_back(statistics);
+  return params;
+}
+
+static bool cluster_selects(const std::vector<double> &params,
+                            const Particle &p)
+{
+  bool molecules = params[1];
+  int first_mol = params[3], last_mol = params[4], n_types = params[5];
+  if (molecules && p.p.mol_id < 0)
+    return false;
+  if (first_mol != -1 && (p.p.mol_id < first_mol || p.p.mol_id > last_mol))
+    return false;
+  if (n_types == 0)
+    return true;
+  for (int i = 0; i < n_types; i++)
+    if (params[6 + i] == p.p.type)
+      return true;
+  return false;
+}
+
+namespace {
+
+/** Accumulates \ref ClusterStatistics. The smallest particle id of the
+    largest cluster is kept to choose among clusters of the same size
+    independently of the order in which they are added. */
+class ClusterSums {
+public:
+  ClusterSums() : m_largest_min_id(-1.0) {
+    stats.n_clusters = stats.n_percolating = 0;
+    stats.sum_size = stats.sum_size2 = 0.0;
+    stats.largest.size = stats.largest.n_particles = 0;
+    stats.largest.rg = 0.0;
+    stats.largest.percolating = false;
+  }
+
+  void add(int size, int n_particles, double rg, bool percolating,
+           double min_id) {
+    stats.n_clusters++;
+    stats.n_percolating += percolating;
+    stats.sum_size += size;
+    stats.sum_size2 += double(size) * size;
+    stats.distribution[size].first++;
+    stats.distribution[size].second += rg;
+    set_largest(size, n_particles, rg, percolating, min_id);
+  }
+
+  /** Append the sums to v, for \ref merge. */
+  void encode(std::vector<double> &v) const {
+    const DistanceCluster &l = stats.largest;
+    v.insert(v.end(), {double(stats.n_clusters), double(stats.n_percolating),
+                       stats.sum_size, stats.sum_size2, double(l.size),
+                       double(l.n_particles), l.rg, double(l.percolating),
+                       m_largest_min_id, double(stats.distribution.size())});
+    for (auto const &d : stats.distribution)
+      v.insert(v.end(), {double(d.first), double(d.second.first),
+                         d.second.second});
+  }
+
+  /** Add the sums encoded by \ref encode. */
+  void merge(const double *v) {
+    stats.n_clusters += v[0];
+    stats.n_percolating += v[1];
+    stats.sum_size += v[2];
+    stats.sum_size2 += v[3];
+    if (v[8] >= 0.0)
+      set_largest(v[4], v[5], v[6], v[7], v[8]);
+    for (int k = 0; k < v[9]; k++) {
+      const double *d = &v[10 + 3 * k];
+      stats.distribution[d[0]].first += d[1];
+      stats.distribution[d[0]].second += d[2];
+    }
+  }
+
+  ClusterStatistics stats;
+
+private:
+  void set_largest(int size, int n_particles, double rg, bool percolating,
+                   double min_id) {
+    DistanceCluster &l = stats.largest;
+    if (m_largest_min_id >= 0.0 &&
+        std::make_pair(-l.size, m_largest_min_id) <=
+            std::make_pair(-size, min_id))
+      return;
+    l.size = size;
+    l.n_particles = n_particles;
+    l.rg = rg;
+    l.percolating = percolating;
+    m_largest_min_id = min_id;
+  }
+
+  double m_largest_min_id;
+};
+
+}
+
+/** The sizes of the records of the nodes, see \ref local_clusters. */
+static const int CLUSTER_RECORD = 8, BOUNDARY_RECORD = 5, LINK_RECORD = 5,
+                 MOLECULE_RECORD = 8;
+
+static void local_clusters(const std::vector<double> &params,
+                           std::vector<double> &result)
+{
+  double r_cut = params[0];
+  bool molecules = params[1], opposite_charges = params[2];
+  bool statistics = params.back();
+
+  std::vector<double> points;
+  for_each_local_particle([&](const Particle &p) {
+      if (!cluster_selects(params, p))
+        return;
+      double pos[3];
+      int image[3] = {0, 0, 0};
+      get_unfolded_position(p, pos);
+      fold_position(pos, image);
+      points.insert(points.end(), pos, pos + 3);
+      points.push_back(p.p.identity);
+      points.push_back(p.p.mol_id);
+#ifdef ELECTROSTATICS
+      points.push_back(p.p.q);
+#else
+      points.push_back(0.0);
+#endif
+    });
+  distribute_points(points, CLUSTER_POINT);
+  int n_local = points.size() / CLUSTER_POINT;
+  double halo[3] = {r_cut, r_cut, r_cut};
+  add_point_halo(points, CLUSTER_POINT, halo);
+  auto point = [&](int i) { return &points[CLUSTER_POINT * i]; };
+
+  /* join the pairs of local particles, and keep the ones with the halo */
+  ClusterForest forest(n_local);
+  struct Link {
+    int i, j;
+    double d[3];
+  };
+  std::vector<Link> links;
+  PointGrid grid(points, CLUSTER_POINT, halo, r_cut);
+  grid.for_each_pair(n_local, [&](int i, int j, const double *dx, double) {
+      if (opposite_charges && point(i)[5] * point(j)[5] >= 0.0)
+        return;
+      if (j >= n_local)
+        links.push_back({i, j, {dx[0], dx[1], dx[2]}});
+      else if (i < j)
+        forest.join(i, j, dx);
+    });
+
+  /* join the local particles of each molecule */
+  std::vector<int> mol_first;
+  if (molecules) {
+    Utils::IdIndex<int> first(-1);
+    for (int i = 0; i < n_local; i++) {
+      int mol = point(i)[4], f = first[mol];
+      if (f == -1) {
+        first[mol] = i;
+        mol_first.push_back(i);
+      } else {
+        double d[3], pos_i[3], pos_f[3];
+        std::copy(point(i), point(i) + 3, pos_i);
+        std::copy(point(f), point(f) + 3, pos_f);
+        get_mi_vector(d, pos_i, pos_f);
+        forest.join(f, i, d);
+      }
+    }
+  }
+
+  /* the local clusters, labeled by the identity of their root: label,
+     smallest identity, particles, percolating, sum of the positions and
+     of their squares relative to the root */
+  std::vector<int> root(n_local);
+  std::vector<double> offset(3 * n_local);
+  Utils::IdIndex<int> cluster_of_root(-1);
+  std::vector<double> clusters;
+  for (int i = 0; i < n_local; i++) {
+    root[i] = forest.find(i, &offset[3 * i]);
+    int c = cluster_of_root[root[i]];
+    if (c == -1) {
+      c = clusters.size() / CLUSTER_RECORD;
+      cluster_of_root[root[i]] = c;
+      clusters.insert(clusters.end(),
+                      {point(root[i])[3], point(i)[3], 0.0,
+                       double(forest.percolating(root[i])), 0.0, 0.0, 0.0,
+                       0.0});
+    }
+    double *rec = &clusters[CLUSTER_RECORD * c];
+    const double *o = &offset[3 * i];
+    rec[1] = std::min(rec[1], point(i)[3]);
+    rec[2] += 1.0;
+    for (int d = 0; d < 3; d++)
+      rec[4 + d] += o[d];
+    rec[7] += o[0] * o[0] + o[1] * o[1] + o[2] * o[2];
+  }
+  int n_clusters = clusters.size() / CLUSTER_RECORD;
+  auto cluster_of = [&](int i) { return cluster_of_root[root[i]]; };
+
+  /* the clusters that can be connected to the particles of other nodes,
+     which are sent to the master. Without statistics, all are sent. */
+  std::vector<bool> sent(n_clusters, !statistics);
+
+  /* the particles near the domain boundary, which can be in the halo of
+     other nodes: identity, label, position relative to the root */
+  std::vector<double> boundary;
+  for (int i = 0; i < n_local; i++) {
+    bool near = false;
+    for (int d = 0; d < 3; d++)
+      if (point(i)[d] - my_left[d] <= r_cut || my_right[d] - point(i)[d] <= r_cut)
+        near = true;
+    if (near) {
+      const double *o = &offset[3 * i];
+      boundary.insert(boundary.end(),
+                      {point(i)[3], point(root[i])[3], o[0], o[1], o[2]});
+      sent[cluster_of(i)] = true;
+    }
+  }
+
+  /* the molecules with particles on several nodes, from the number of
+     nodes of every molecule */
+  if (statistics && molecules) {
+    int max_mol = -1;
+    for (int i : mol_first)
+      max_mol = std::max(max_mol, int(point(i)[4]));
+    MPI_Allreduce(MPI_IN_PLACE, &max_mol, 1, MPI_INT, MPI_MAX, comm_cart);
+    std::vector<int> mol_nodes(max_mol + 1, 0);
+    for (int i : mol_first)
+      mol_nodes[int(point(i)[4])] = 1;
+    MPI_Allreduce(MPI_IN_PLACE, mol_nodes.data(), max_mol + 1, MPI_INT,
+                  MPI_SUM, comm_cart);
+    for (int i : mol_first)
+      if (mol_nodes[int(point(i)[4])] > 1)
+        sent[cluster_of(i)] = true;
+  }
+
+  /* the connections of the local clusters with the halo particles, once
+     per cluster and periodic image of the particle: label, identity of
+     the halo particle, its position relative to the root */
+  for (Link &l : links) {
+    for (int d = 0; d < 3; d++)
+      l.d[d] += offset[3 * l.i + d];
+    sent[cluster_of(l.i)] = true;
+  }
+  std::sort(links.begin(), links.end(), [&](const Link &a, const Link &b) {
+      return std::make_pair(root[a.i], point(a.j)[3]) <
+             std::make_pair(root[b.i], point(b.j)[3]);
+    });
+  std::vector<double> halo_links;
+  for (size_t k = 0; k < links.size(); k++) {
+    const Link &l = links[k], *prev = k > 0 ? &links[k - 1] : nullptr;
+    if (prev && root[prev->i] == root[l.i] &&
+        point(prev->j)[3] == point(l.j)[3] &&
+        std::fabs(prev->d[0] - l.d[0]) < 0.5 * box_l[0] &&
+        std::fabs(prev->d[1] - l.d[1]) < 0.5 * box_l[1] &&
+        std::fabs(prev->d[2] - l.d[2]) < 0.5 * box_l[2])
+      continue;
+    halo_links.insert(halo_links.end(), {point(root[l.i])[3], point(l.j)[3],
+                                         l.d[0], l.d[1], l.d[2]});
+  }
+
+  /* one particle of every local molecule of the sent clusters: label,
+     molecule, position relative to the root and folded position */
+  std::vector<double> mols;
+  std::vector<int> n_mols(n_clusters, 0);
+  for (int i : mol_first) {
+    n_mols[cluster_of(i)]++;
+    if (!sent[cluster_of(i)])
+      continue;
+    const double *o = &offset[3 * i];
+    mols.insert(mols.end(), {point(root[i])[3], point(i)[4], o[0], o[1], o[2],
+                             point(i)[0], point(i)[1], point(i)[2]});
+  }
+
+  /* the sent clusters, and the statistics of the others */
+  std::vector<double> sent_clusters, summary;
+  ClusterSums sums;
+  for (int c = 0; c < n_clusters; c++) {
+    const double *rec = &clusters[CLUSTER_RECORD * c];
+    if (sent[c]) {
+      sent_clusters.insert(sent_clusters.end(), rec, rec + CLUSTER_RECORD);
+      continue;
+    }
+    double n = rec[2], rg2 = rec[7] / n;
+    for (int d = 0; d < 3; d++)
+      rg2 -= (rec[4 + d] / n) * (rec[4 + d] / n);
+    sums.add(molecules ? n_mols[c] : n, n, std::sqrt(std::max(rg2, 0.0)),
+             rec[3] != 0.0, rec[1]);
+  }
+  if (statistics)
+    sums.encode(summary);
+
+  for (auto *records : {&sent_clusters, &boundary, &halo_links, &mols,
+                        &summary}) {
+    result.push_back(records->size());
+    result.insert(result.end(), records->begin(), records->end());
+  }
+}
+
+static ParallelAnalysis clusters_job(local_clusters, ANALYSIS_CONCAT);
+
+static int check_cluster_criterion(const ClusterCriterion &criterion)
+{
+  for (int d = 0; d < 3; d++)
+    if (PERIODIC(d) && 2.0 * criterion.r_cut >= box_l[d]) {
+      runtimeErrorMsg() << "the cluster distance has to be less than half the box length";
+      return ES_ERROR;
+    }
+  return ES_OK;
+}
+
+/** Run \ref local_clusters on the nodes and merge the clusters that are
+    connected over the domain boundaries.
+    \param sums     if not NULL, the nodes only send the clusters that can
+                    be connected to other nodes, and the statistics of the
+                    others are added to sums
+    \param clusters receives the merged clusters
+    \param min_ids  receives the smallest particle id of every cluster */
+static void merge_clusters(const ClusterCriterion &criterion,
+                           ClusterSums *sums,
+                           std::vector<DistanceCluster> &clusters,
+                           std::vector<double> &min_ids)
+{
+  std::vector<double> data =
+      clusters_job(encode_cluster_params(criterion, sums != NULL));
+
+  /* split the records of the nodes */
+  std::vector<double> local, boundary, halo_links, mols, summary;
+  for (size_t pos = 0; pos < data.size();) {
+    for (auto *records : {&local, &boundary, &halo_links, &mols, &summary}) {
+      int n = data[pos++];
+      records->insert(records->end(), &data[pos], &data[pos] + n);
+      pos += n;
+    }
+    if (!summary.empty())
+      sums->merge(summary.data());
+    summary.clear();
+  }
+
+  int n_local = local.size() / CLUSTER_RECORD;
+  Utils::IdIndex<int> local_of_label(-1), boundary_of_id(-1);
+  for (int c = 0; c < n_local; c++)
+    local_of_label[int(local[CLUSTER_RECORD * c])] = c;
+  for (size_t k = 0; k < boundary.size(); k += BOUNDARY_RECORD)
+    boundary_of_id[int(boundary[k])] = k;
+
+  /* join the local clusters, the displacements are between their roots */
+  ClusterForest forest(n_local);
+  for (int c = 0; c < n_local; c++)
+    if (local[CLUSTER_RECORD * c + 3] != 0.0)
+      forest.set_percolating(c);
+  for (size_t k = 0; k < halo_links.size(); k += LINK_RECORD) {
+    const double *l = &halo_links[k];
+    int b = boundary_of_id[int(l[1])];
+    if (b == -1)
+      continue;
+    const double *o = &boundary[b + 2];
+    double d[3] = {l[2] - o[0], l[3] - o[1], l[4] - o[2]};
+    forest.join(local_of_label[int(l[0])],
+                local_of_label[int(boundary[b + 1])], d);
+  }
+  Utils::IdIndex<int> mol_first(-1);
+  for (size_t k = 0; k < mols.size(); k += MOLECULE_RECORD) {
+    const double *m = &mols[k];
+    int f = mol_first[int(m[1])];
+    if (f == -1) {
+      mol_first[int(m[1])] = k;
+      continue;
+    }
+    const double *mf = &mols[f];
+    double d[3], pos_m[3] = {m[5], m[6], m[7]}, pos_f[3] = {mf[5], mf[6], mf[7]};
+    get_mi_vector(d, pos_m, pos_f);
+    for (int j = 0; j < 3; j++)
+      d[j] += mf[2 + j] - m[2 + j];
+    forest.join(local_of_label[int(mf[0])], local_of_label[int(m[0])], d);
+  }
+
+  /* sum up the local clusters, shifted by the positions of their roots */
+  struct Sums {
+    double n, min_id, s1[3], s2;
+    bool percolating;
+    std::vector<int> molecules;
+  };
+  std::vector<Sums> sums_of;
+  std::vector<int> cluster_of_root(n_local, -1);
+  std::vector<int> cluster_of_local(n_local);
+  for (int c = 0; c < n_local; c++) {
+    const double *rec = &local[CLUSTER_RECORD * c];
+    double o[3];
+    int r = forest.find(c, o);
+    if (cluster_of_root[r] == -1) {
+      cluster_of_root[r] = sums_of.size();
+      sums_of.push_back({0.0, rec[1], {0.0, 0.0, 0.0}, 0.0,
+                         forest.percolating(r), {}});
+    }
+    Sums &s = sums_of[cluster_of_root[r]];
+    cluster_of_local[c] = cluster_of_root[r];
+    double n = rec[2];
+    s.n += n;
+    s.min_id = std::min(s.min_id, rec[1]);
+    s.s2 += rec[7] + n * (o[0] * o[0] + o[1] * o[1] + o[2] * o[2]);
+    for (int d = 0; d < 3; d++) {
+      s.s1[d] += rec[4 + d] + n * o[d];
+      s.s2 += 2.0 * o[d] * rec[4 + d];
+    }
+  }
+  for (size_t k = 0; k < mols.size(); k += MOLECULE_RECORD)
+    if (mol_first[int(mols[k + 1])] == int(k))
+      sums_of[cluster_of_local[local_of_label[int(mols[k])]]].molecules.push_back(
+          mols[k + 1]);
+
+  clusters.resize(sums_of.size());
+  min_ids.resize(sums_of.size());
+  for (size_t c = 0; c < sums_of.size(); c++) {
+    Sums &s = sums_of[c];
+    DistanceCluster &cl = clusters[c];
+    std::sort(s.molecules.begin(), s.molecules.end());
+    cl.n_particles = s.n;
+    cl.size = criterion.molecules ? s.molecules.size() : cl.n_particles;
+    double rg2 = s.s2 / s.n;
+    for (int d = 0; d < 3; d++)
+      rg2 -= (s.s1[d] / s.n) * (s.s1[d] / s.n);
+    cl.rg = std::sqrt(std::max(rg2, 0.0));
+    cl.percolating = s.percolating;
+    cl.molecules.swap(s.molecules);
+    min_ids[c] = s.min_id;
+  }
+}
+
+int analyze_clusters(const ClusterCriterion &criterion,
+                     std::vector<DistanceCluster> &clusters)
+{
+  if (check_cluster_criterion(criterion) != ES_OK)
+    return ES_ERROR;
+
+  std::vector<DistanceCluster> unsorted;
+  std::vector<double> min_ids;
+  merge_clusters(criterion, NULL, unsorted, min_ids);
+
+  std::vector<int> index(unsorted.size());
+  for (size_t c = 0; c < index.size(); c++)
+    index[c] = c;
+  std::sort(index.begin(), index.end(), [&](int a, int b) {
+      return std::make_pair(-unsorted[a].size, min_ids[a]) <
+             std::make_pair(-unsorted[b].size, min_ids[b]);
+    });
+  clusters.resize(index.size());
+  for (size_t c = 0; c < index.size(); c++)
+    std::swap(clusters[c], unsorted[index[c]]);
+  return ES_OK;
+}
+
+int analyze_cluster_statistics(const ClusterCriterion &criterion,
+                               ClusterStatistics &stats)
+{
+  if (check_cluster_criterion(criterion) != ES_OK)
+    return ES_ERROR;
+
+  ClusterSums sums;
+  std::vector<DistanceCluster> clusters;
+  std::vector<double> min_ids;
+  merge_clusters(criterion, &sums, clusters, min_ids);
+  for (size_t c = 0; c < clusters.size(); c++) {
+    const DistanceCluster &cl = clusters[c];
+    sums.add(cl.size, cl.n_particles, cl.rg, cl.percolating, min_ids[c]);
+  }
+  stats = sums.stats;
+  return ES_OK;
+}
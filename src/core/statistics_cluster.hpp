@@ -28,10 +28,15 @@
  *
  *  2: mesh based cluster algorithm to identify hole spaces 
  *  (see thesis chapter 3 of H. Schmitz for details) 
+ *
+ *  3: distributed cluster analysis by a distance criterion, see \ref
+ *  analyze_clusters.
  */
 
 #include "interaction_data.hpp"
 #include "particle_data.hpp"
+#include <map>
+#include <vector>
 
 /** \name Data structures */
 /************************************************************/
@@ -95,4 +100,86 @@ int analyze_necklace(Particle *part, int np);
 int cluster_free_volume_grid(IntList mesh, int dim[3], int ***holes);
 void cluster_free_volume_surface(IntList mesh, int dim[3], int nholes, int **holes, int *surface);
 
+/** \name Cluster analysis by distance */
+/************************************************************/
+/*@{*/
+
+/** Which particles form the clusters of \ref analyze_clusters. */
+struct ClusterCriterion {
+  /** particles closer than this are in the same cluster. Has to be less
+      than half the box length in the periodic directions. */
+  double r_cut;
+  /** the types of the particles, all types if empty */
+  std::vector<int> types;
+  /** the range of molecule ids of the particles, all molecules if
+      first_mol is -1 */
+  int first_mol, last_mol;
+  /** if true, all particles of a molecule are in the same cluster, and
+      the size of a cluster is its number of molecules. Particles without
+      a molecule are ignored then. */
+  bool molecules;
+  /** if true, only particles with charges of opposite sign are connected */
+  bool opposite_charges;
+};
+
+/** A cluster found by \ref analyze_clusters. */
+struct DistanceCluster {
+  /** the number of particles, or of molecules if they are joined */
+  int size;
+  /** the number of particles */
+  int n_particles;
+  /** the radius of gyration of the particles, with equal weights */
+  double rg;
+  /** whether the cluster is connected to its own periodic image. Its
+      radius of gyration is then meaningless. */
+  bool percolating;
+  /** the sorted ids of the molecules, only if the molecules are joined */
+  std::vector<int> molecules;
+};
+
+/** Find the clusters of particles connected by the distance criterion.
+    The pairs are found in parallel with a cell grid on each node, the
+    nodes label the connected clusters of their particles with a
+    union-find and the master merges the clusters that are connected over
+    the domain boundaries, so that the particles are never collected.
+    The positions of a cluster are unfolded along its connections.
+    Call only on the master.
+    \param criterion which particles are connected
+    \param clusters receives the clusters, ordered by decreasing size and
+                    increasing smallest particle id
+    \return ES_OK, or ES_ERROR with a runtime error if r_cut is too large
+*/
+int analyze_clusters(const ClusterCriterion &criterion,
+                     std::vector<DistanceCluster> &clusters);
+
+/** Statistics of the clusters found by \ref analyze_cluster_statistics. */
+struct ClusterStatistics {
+  int n_clusters;
+  /** the number of clusters connected to their own periodic image */
+  int n_percolating;
+  /** the sums of the sizes and of their squares */
+  double sum_size, sum_size2;
+  /** the largest cluster, the one with the smallest particle id among
+      those of the same size, without its molecules. Only valid if there
+      are clusters. */
+  DistanceCluster largest;
+  /** for every size, the number of clusters and the sum of their radii
+      of gyration */
+  std::map<int, std::pair<int, double>> distribution;
+};
+
+/** The statistics of the clusters of \ref analyze_clusters. The nodes
+    evaluate the clusters that are complete on them, that is, which have
+    no particles near their domain boundaries and no molecules with
+    particles on other nodes, and only send their reduced statistics and
+    the other clusters to the master. Call only on the master.
+    \param criterion which particles are connected
+    \param stats     receives the statistics
+    \return ES_OK, or ES_ERROR with a runtime error if r_cut is too large
+*/
+int analyze_cluster_statistics(const ClusterCriterion &criterion,
+                               ClusterStatistics &stats);
+
+/*@}*/
+
 #endif
@@ -20,6 +20,8 @@
 #include "particle_data.hpp"
 #include "integrate.hpp"
 #include <cstring>
+#include <algorithm>
+#include <vector>
 
 /* global variables */
 double_correlation* correlations=0;
@@ -388,6 +390,16 @@ int double_correlation_init(double_correlation* self, double dt, unsigned int ta
 }
 
 int double_correlation_get_data( double_correlation* self ) {
+  if ( observable_calculate(self->A_obs) != 0 )
+    return 1;
+  if (!self->autocorrelation) {
+    if ( observable_calculate(self->B_obs) != 0 )
+      return 2;
+  }
+  return double_correlation_add_data(self);
+}
+
+int double_correlation_add_data( double_correlation* self ) {
   // We must now go through the hierarchy and make sure there is space for the new 
   // datapoint. For every hierarchy level we have to decide if it necessary to move 
   // something
@@ -433,14 +445,10 @@ int double_correlation_get_data( double_correlation* self ) {
   self->newest[0] = ( self->newest[0] + 1 ) % (self->tau_lin +1); 
   self->n_vals[0]++;
 
-  if ( observable_calculate(self->A_obs) != 0 )
-    return 1;
-  // copy the result:
+  // copy the current values of the observables:
   memmove(self->A[0][self->newest[0]], self->A_obs->last_value, self->dim_A*sizeof(double));
 
   if (!self->autocorrelation) {
-    if ( observable_calculate(self->B_obs) != 0 )
-      return 2;
     memmove(self->B[0][self->newest[0]], self->B_obs->last_value, self->dim_B*sizeof(double));
   }
 
@@ -458,21 +466,16 @@ int double_correlation_get_data( double_correlation* self ) {
     }
   } 
 
-  double* temp = (double*)Utils::malloc(self->dim_corr*sizeof(double));
-  if (!temp)
-    return 4;
-// Now update the lowest level correlation estimates
+// Now update the lowest level correlation estimates, the operation adds
+// directly to the result
   for ( j = 0; j < int(MIN(self->tau_lin+1, self->n_vals[0]) ); j++) {
     index_new = self->newest[0];
     index_old =  (self->newest[0] - j + self->tau_lin + 1) % (self->tau_lin + 1);
 //    printf("old %d new %d\n", index_old, index_new);
-    error = (self->corr_operation)(self->A[0][index_old], self->dim_A, self->B[0][index_new], self->dim_B, temp, self->dim_corr, self->args);
+    error = (self->corr_operation)(self->A[0][index_old], self->dim_A, self->B[0][index_new], self->dim_B, self->result[j], self->dim_corr, self->args);
     if ( error != 0)
       return error;
     self->n_sweeps[j]++;
-    for (unsigned k = 0; k < self->dim_corr; k++) {
-      self->result[j][k] += temp[k];
-    }
   }
 // Now for the higher ones
   for ( int i = 1; i < highest_level_to_compress+2; i++) {
@@ -480,16 +483,12 @@ int double_correlation_get_data( double_correlation* self ) {
       index_new = self->newest[i];
       index_old = (self->newest[i] - j + self->tau_lin + 1) % (self->tau_lin + 1);
       index_res = self->tau_lin + (i-1)*self->tau_lin/2 + (j - self->tau_lin/2+1) -1;
-      error=(self->corr_operation)(self->A[i][index_old], self->dim_A, self->B[i][index_new], self->dim_B, temp, self->dim_corr, self->args);
+      error=(self->corr_operation)(self->A[i][index_old], self->dim_A, self->B[i][index_new], self->dim_B, self->result[index_res], self->dim_corr, self->args);
       if ( error != 0)
         return error;
       self->n_sweeps[index_res]++;
-      for (unsigned k = 0; k < self->dim_corr; k++) {
-        self->result[index_res][k] += temp[k];
-      }
     }
   }
-  free(temp);
   return 0;
 }
 
@@ -631,13 +630,9 @@ int double_correlation_finalize( double_correlation* self ) {
   unsigned tau_lin=self->tau_lin;
   int hierarchy_depth=self->hierarchy_depth;
 
-  double* temp = (double*)Utils::malloc(self->dim_corr*sizeof(double));
-
   // make a flag that the correlation is finalized
   self->finalized=1;
 
-  if (!temp)
-    return 4;
   //printf ("tau_lin:%d, hierarchy_depth: %d\n",tau_lin,hierarchy_depth); 
   //for(ll=0;ll<hierarchy_depth;ll++) printf("n_vals[l=%d]=%d\n",ll, self->n_vals[ll]);
   for(ll=0;ll<hierarchy_depth-1;ll++) {
@@ -701,13 +696,10 @@ int double_correlation_finalize( double_correlation* self ) {
           index_new = self->newest[i];
           index_old = (self->newest[i] - j + tau_lin + 1) % (tau_lin + 1);
           index_res = tau_lin + (i-1)*tau_lin/2 + (j - tau_lin/2+1) -1;
-          error=(self->corr_operation)(self->A[i][index_old], self->dim_A, self->B[i][index_new], self->dim_B, temp, self->dim_corr, self->args);
+          error=(self->corr_operation)(self->A[i][index_old], self->dim_A, self->B[i][index_new], self->dim_B, self->result[index_res], self->dim_corr, self->args);
           if ( error != 0)
             return error;
           self->n_sweeps[index_res]++;
-          for (unsigned k = 0; k < self->dim_corr; k++) {
-            self->result[index_res][k] += temp[k];
-          }
         }
       }
       // lowest level exploited, go upwards
@@ -717,7 +709,6 @@ int double_correlation_finalize( double_correlation* self ) {
       }
     }
   }
-  free(temp);
   return 0;
 }
 
@@ -771,7 +762,7 @@ int scalar_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_
   for ( i = 0; i < dim_A; i++ ) {
     temp += A[i]*B[i];
   }
-  C[0] = temp; 
+  C[0] += temp; 
   return 0;
 }
 
@@ -786,7 +777,7 @@ int componentwise_product ( double* A, unsigned int dim_A, double* B, unsigned i
     return 5;
   }
   for ( i = 0; i < dim_A; i++ ) {
-    C[i] = A[i]*B[i];
+    C[i] += A[i]*B[i];
   }
   return 0;
 }
@@ -799,8 +790,8 @@ int complex_conjugate_product ( double* A, unsigned int dim_A, double* B, unsign
   }
   j=0;
   for ( i = 0; i < dim_A/2; i++ ) {
-    C[j] = A[j]*B[j] + A[j+1]*B[j+1];
-    C[j+1] = A[j+1]*B[j] - A[j]*B[j+1];
+    C[j] += A[j]*B[j] + A[j+1]*B[j+1];
+    C[j+1] += A[j+1]*B[j] - A[j]*B[j+1];
     j=j+2;
   }
   return 0;
@@ -812,7 +803,7 @@ int tensor_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_
   {
     for ( j = 0; j < dim_B; j++ )
     {
-      C[i*dim_B + j] = A[i]*B[j];
+      C[i*dim_B + j] += A[i]*B[j];
     }
   }
   return 0;
@@ -825,7 +816,7 @@ int square_distance_componentwise ( double* A, unsigned int dim_A, double* B, un
     return 5;
   }
   for ( i = 0; i < dim_A; i++ ) {
-    C[i] = (A[i]-B[i])*(A[i]-B[i]);
+    C[i] += (A[i]-B[i])*(A[i]-B[i]);
   }
   return 0;
 }
@@ -840,22 +831,39 @@ int fcs_acf ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, doub
   if ( dim_A / dim_corr != 3) {
     return 6; 
   }
-  for (unsigned i = 0; i < dim_corr; i++ ) 
-    C[i] = 0;
-  for (unsigned i = 0; i < dim_A; i++ ) {
-    C [i/3] -= ( (A[i]-B[i])*(A[i]-B[i]) ) / wsquare->e[i%3];
+  for (unsigned i = 0; i < dim_corr; i++ ) {
+    double C_i = 0;
+    for (unsigned j = 3*i; j < 3*i + 3; j++ )
+      C_i -= ( (A[j]-B[j])*(A[j]-B[j]) ) / wsquare->e[j%3];
+    C[i] += exp(C_i);
   }
-  for (unsigned i = 0; i < dim_corr; i++ ) 
-    C[i] = exp(C[i]);
   return 0;
 }
 
 
+/** Calculate an observable, unless it is in the list of the observables
+    that were already calculated for this update.
+    @return the error of the calculation, or 0 */
+static int calculate_observable_once(observable* obs, std::vector<observable*> &calculated) {
+  if (std::find(calculated.begin(), calculated.end(), obs) != calculated.end())
+    return 0;
+  calculated.push_back(obs);
+  return observable_calculate(obs);
+}
+
 void autoupdate_correlations() {
+  // correlations that are due at the same time often share observables,
+  // e.g. per-particle positions, which are calculated only once
+  std::vector<observable*> calculated;
   for (unsigned i=0; i<n_correlations; i++) {
     if (correlations[i].autoupdate && sim_time-correlations[i].last_update>correlations[i].dt*0.99999) {
       correlations[i].last_update=sim_time;
-      double_correlation_get_data(&correlations[i]);
+      if (calculate_observable_once(correlations[i].A_obs, calculated) != 0)
+        continue;
+      if (!correlations[i].autocorrelation &&
+          calculate_observable_once(correlations[i].B_obs, calculated) != 0)
+        continue;
+      double_correlation_add_data(&correlations[i]);
     }
   }
 }
@@ -179,7 +179,7 @@ typedef struct {
   char *compressA_name;
   char *compressB_name;
 
-  // correlation function
+  // correlation function, adds the correlation of A and B to C
   int (*corr_operation)  ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
   char *corr_operation_name;
 
@@ -280,6 +280,12 @@ int double_correlation_write_data_to_file(const double_correlation* self, const
  */
 int double_correlation_get_data(  double_correlation* self );
 
+/** Process the current values of the observables A and B as a new datapoint,
+ *  like \ref double_correlation_get_data, but without calculating them, so
+ *  that an observable shared by several correlations is calculated only once.
+ */
+int double_correlation_add_data(  double_correlation* self );
+
 /** At the end of data collection, go through the whole hierarchy and correlate data left there
  *  
  * This works pretty much the same as get_data, but does not feed on new data, just uses what
@@ -322,6 +328,9 @@ int compress_discard2( double* A1, double*A2, double* A_compressed, unsigned int
 *
 * Functions for correlation operations
 *
+* They add the correlation of A and B to C, so that the correlation
+* estimates are accumulated without a temporary buffer.
+*
 **************************/
 int scalar_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
 
@@ -0,0 +1,307 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file statistics_msd.cpp
+    Implementation of \ref statistics_msd.hpp "statistics_msd.hpp".
+
+    For a series x_k, the autocorrelation sum_k x_k x_{k+m} is the
+    inverse transform of the power spectrum of x, zero padded to twice
+    its length to avoid the periodic wrap around. The mean square
+    displacement follows from
+
+    sum_k |r_{k+m} - r_k|^2 = sum_k (r_k^2 + r_{k+m}^2) - 2 sum_k r_k r_{k+m},
+
+    where the first sum is updated recursively for increasing m.
+*/
+#include "statistics_msd.hpp"
+#include "communication.hpp"
+#include "errorhandling.hpp"
+#include "particle_data.hpp"
+#include "statistics.hpp"
+#include "statistics_parallel.hpp"
+#include <algorithm>
+#include <map>
+#include <mpi.h>
+
+TimeCorrelation::TimeCorrelation(int n, int tmax)
+    : m_n(n), m_tmax(std::min(tmax, n - 1)), m_x(n), m_d(n) {
+#ifdef FFTW
+  m_n_fft = 2 * n;
+  m_in = (double *)fftw_malloc(m_n_fft * sizeof(double));
+  m_out = (fftw_complex *)fftw_malloc((m_n_fft / 2 + 1) * sizeof(fftw_complex));
+  m_forward = fftw_plan_dft_r2c_1d(m_n_fft, m_in, m_out, FFTW_ESTIMATE);
+  m_backward = fftw_plan_dft_c2r_1d(m_n_fft, m_out, m_in, FFTW_ESTIMATE);
+#endif
+}
+
+TimeCorrelation::~TimeCorrelation() {
+#ifdef FFTW
+  fftw_destroy_plan(m_forward);
+  fftw_destroy_plan(m_backward);
+  fftw_free(m_in);
+  fftw_free(m_out);
+#endif
+}
+
+void TimeCorrelation::add_autocorrelation(const double *x, int stride,
+                                          double *acf) {
+#ifdef FFTW
+  for (int k = 0; k < m_n; k++)
+    m_in[k] = x[k * stride];
+  std::fill(m_in + m_n, m_in + m_n_fft, 0.0);
+  fftw_execute(m_forward);
+  for (int j = 0; j <= m_n_fft / 2; j++) {
+    m_out[j][0] = m_out[j][0] * m_out[j][0] + m_out[j][1] * m_out[j][1];
+    m_out[j][1] = 0.0;
+  }
+  fftw_execute(m_backward);
+  /* FFTW does not normalize the backward transform */
+  for (int m = 0; m <= m_tmax; m++)
+    acf[m] += m_in[m] / m_n_fft;
+#else
+  for (int m = 0; m <= m_tmax; m++) {
+    double s = 0.0;
+    for (int k = 0; k < m_n - m; k++)
+      s += x[k * stride] * x[(k + m) * stride];
+    acf[m] += s;
+  }
+#endif
+}
+
+void TimeCorrelation::add_square_displacement(const double *r, double *sums) {
+  /* the displacements do not depend on the origin, so use the mean
+     position to keep the products small */
+  double mean[3] = {0.0, 0.0, 0.0};
+  for (int k = 0; k < m_n; k++)
+    for (int d = 0; d < 3; d++)
+      mean[d] += r[3 * k + d] / m_n;
+
+  std::vector<double> products(m_tmax + 1, 0.0);
+  std::fill(m_d.begin(), m_d.end(), 0.0);
+  for (int d = 0; d < 3; d++) {
+    for (int k = 0; k < m_n; k++) {
+      m_x[k] = r[3 * k + d] - mean[d];
+      m_d[k] += m_x[k] * m_x[k];
+    }
+    add_autocorrelation(m_x.data(), 1, products.data());
+  }
+
+  /* sum_k (r_k^2 + r_{k+m}^2) over the n-m origins */
+  double squares = 0.0;
+  for (int k = 0; k < m_n; k++)
+    squares += 2.0 * m_d[k];
+  for (int m = 0; m <= m_tmax; m++) {
+    if (m > 0)
+      squares -= m_d[m - 1] + m_d[m_n - m];
+    sums[m] += squares - 2.0 * products[m];
+  }
+}
+
+/** The trajectories of a block of the selection, 3*n_frames per
+    trajectory. Only used on the master, see \ref correlation_job. */
+static std::vector<double> trajectories;
+
+/** The upper limit of the size of \ref trajectories. The selection is
+    evaluated in blocks of trajectories of this size. */
+static const size_t trajectories_bytes = 256 << 20;
+
+/** Evaluate the share of this node of the block of trajectories. The
+    parameters are the number of trajectories and frames, tmax, and
+    whether to compute the velocity autocorrelation instead of the
+    square displacements. */
+static void local_correlation(const std::vector<double> &params,
+                              std::vector<double> &result) {
+  int n_traj = params[0], n_frames = params[1], tmax = params[2];
+  bool vacf = params[3];
+  size_t len = 3 * (size_t)n_frames;
+
+  /* count in whole trajectories, so that the counts do not overflow */
+  MPI_Datatype trajectory_type;
+  MPI_Type_contiguous(len, MPI_DOUBLE, &trajectory_type);
+  MPI_Type_commit(&trajectory_type);
+  std::vector<int> counts(n_nodes), displs(n_nodes);
+  for (int node = 0; node < n_nodes; node++) {
+    int first = (long)n_traj * node / n_nodes;
+    int last = (long)n_traj * (node + 1) / n_nodes;
+    counts[node] = last - first;
+    displs[node] = first;
+  }
+  std::vector<double> local(counts[this_node] * len);
+  MPI_Scatterv(trajectories.data(), counts.data(), displs.data(),
+               trajectory_type, local.data(), counts[this_node],
+               trajectory_type, 0, comm_cart);
+  MPI_Type_free(&trajectory_type);
+
+  result.assign(tmax + 1, 0.0);
+  int n = vacf ? n_frames - 1 : n_frames;
+  TimeCorrelation corr(n, tmax);
+  std::vector<double> v(3 * n);
+  for (size_t t = 0; t < local.size(); t += len) {
+    const double *r = &local[t];
+    if (vacf) {
+      for (int k = 0; k < 3 * n; k++)
+        v[k] = r[k + 3] - r[k];
+      for (int d = 0; d < 3; d++)
+        corr.add_autocorrelation(&v[d], 3, result.data());
+    } else
+      corr.add_square_displacement(r, result.data());
+  }
+}
+
+static ParallelAnalysis correlation_job(local_correlation, ANALYSIS_SUM);
+
+namespace {
+
+/** The particles of the selected trajectories: trajectory k consists of
+    the particles index[first[k]] to index[first[k+1]-1] with their
+    weights. */
+struct TrajectorySelection {
+  std::vector<int> index, first;
+  std::vector<double> weight;
+};
+
+}
+
+/** Select the trajectories. Positions of molecules are their centers of
+    mass.
+    \return the number of trajectories, or -1 on error */
+static int select_trajectories(const MSDSelection &sel,
+                               TrajectorySelection &traj) {
+  std::vector<int> index, target;
+  std::vector<double> weight;
+  int n_traj = 0;
+
+  if (sel.types.empty() && !sel.molecules) {
+    for (int i = 0; i < n_part_conf; i++) {
+      index.push_back(i);
+      target.push_back(i);
+      weight.push_back(1.0);
+    }
+    n_traj = n_part_conf;
+  } else {
+    if (!sortPartCfg() || n_part != n_part_conf) {
+      runtimeErrorMsg() << "msd: the stored configurations do not match the particles";
+      return -1;
+    }
+    std::map<int, int> traj_of_mol;
+    std::vector<double> mass;
+    for (int i = 0; i < n_part; i++) {
+      const Particle &p = partCfg[i];
+      if (!sel.types.empty() &&
+          std::find(sel.types.begin(), sel.types.end(), p.p.type) ==
+              sel.types.end())
+        continue;
+      if (sel.molecules) {
+        if (p.p.mol_id < 0)
+          continue;
+        auto it = traj_of_mol.find(p.p.mol_id);
+        if (it == traj_of_mol.end()) {
+          it = traj_of_mol.insert({p.p.mol_id, n_traj++}).first;
+          mass.push_back(0.0);
+        }
+        mass[it->second] += p.p.mass;
+        target.push_back(it->second);
+        weight.push_back(p.p.mass);
+      } else {
+        target.push_back(n_traj++);
+        weight.push_back(1.0);
+      }
+      index.push_back(i);
+    }
+    if (sel.molecules)
+      for (size_t j = 0; j < weight.size(); j++)
+        weight[j] /= mass[target[j]];
+  }
+
+  /* sort the particles by their trajectories */
+  traj.first.assign(n_traj + 1, 0);
+  for (int k : target)
+    traj.first[k + 1]++;
+  for (int k = 0; k < n_traj; k++)
+    traj.first[k + 1] += traj.first[k];
+  traj.index.resize(index.size());
+  traj.weight.resize(index.size());
+  std::vector<int> next(traj.first.begin(), traj.first.end() - 1);
+  for (size_t j = 0; j < index.size(); j++) {
+    int pos = next[target[j]]++;
+    traj.index[pos] = index[j];
+    traj.weight[pos] = weight[j];
+  }
+  return n_traj;
+}
+
+/** Fill \ref trajectories with the trajectories first to last-1 from
+    \ref configs. */
+static void collect_trajectories(const TrajectorySelection &traj, int first,
+                                 int last) {
+  trajectories.assign((size_t)(last - first) * 3 * n_configs, 0.0);
+  for (int c = 0; c < n_configs; c++) {
+    const double *config = get_config(c);
+    for (int k = first; k < last; k++) {
+      double *r = &trajectories[((size_t)(k - first) * n_configs + c) * 3];
+      for (int j = traj.first[k]; j < traj.first[k + 1]; j++)
+        for (int d = 0; d < 3; d++)
+          r[d] += traj.weight[j] * config[3 * (size_t)traj.index[j] + d];
+    }
+  }
+}
+
+/** Common part of \ref calc_msd and \ref calc_vacf. */
+static int calc_correlation(const MSDSelection &sel, int tmax, bool vacf,
+                            std::vector<double> &result) {
+  int n = vacf ? n_configs - 1 : n_configs;
+  if (n < 1 || tmax < 0 || tmax >= n) {
+    runtimeErrorMsg() << "msd: tmax has to be smaller than the number of "
+                      << (vacf ? "velocities" : "stored configurations");
+    return ES_ERROR;
+  }
+  TrajectorySelection traj;
+  int n_traj = select_trajectories(sel, traj);
+  if (n_traj < 0)
+    return ES_ERROR;
+  if (n_traj == 0) {
+    runtimeErrorMsg() << "msd: no particles selected";
+    return ES_ERROR;
+  }
+
+  /* only one block of trajectories is held on the master at a time */
+  int block = std::max<size_t>(
+      1, trajectories_bytes / (3 * sizeof(double) * n_configs));
+  result.assign(tmax + 1, 0.0);
+  for (int first = 0; first < n_traj; first += block) {
+    int last = std::min(n_traj, first + block);
+    collect_trajectories(traj, first, last);
+    std::vector<double> sums = correlation_job(
+        {double(last - first), double(n_configs), double(tmax), double(vacf)});
+    for (int m = 0; m <= tmax; m++)
+      result[m] += sums[m];
+  }
+  std::vector<double>().swap(trajectories);
+
+  for (int m = 0; m <= tmax; m++)
+    result[m] /= double(n_traj) * (n - m);
+  return ES_OK;
+}
+
+int calc_msd(const MSDSelection &sel, int tmax, std::vector<double> &msd) {
+  return calc_correlation(sel, tmax, false, msd);
+}
+
+int calc_vacf(const MSDSelection &sel, int tmax, std::vector<double> &vacf) {
+  return calc_correlation(sel, tmax, true, vacf);
+}
@@ -0,0 +1,108 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _STATISTICS_MSD_H
+#define _STATISTICS_MSD_H
+/** \file statistics_msd.hpp
+    Mean square displacement and velocity autocorrelation function of
+    the trajectories stored in \ref configs.
+
+    The sums over all time origins are computed from the autocorrelation
+    of each trajectory, which takes O(T log T) operations for T frames
+    with FFTW instead of O(T^2) for the direct sum over all pairs of
+    frames. Without FFTW, the direct sum is used, limited to the
+    requested lag times. The trajectories are collected in blocks of a
+    bounded size on the master, and each block is distributed over the
+    nodes.
+*/
+
+#include "config.hpp"
+#include <vector>
+
+#ifdef FFTW
+#include <fftw3.h>
+#endif
+
+/** Sums over all time origins of one component of a series x_k,
+    k = 0..n-1, for lag times m = 0..tmax. */
+class TimeCorrelation {
+public:
+  TimeCorrelation(int n, int tmax);
+  ~TimeCorrelation();
+  TimeCorrelation(const TimeCorrelation &) = delete;
+  TimeCorrelation &operator=(const TimeCorrelation &) = delete;
+
+  /** Add sum_k x_k x_{k+m} to acf[m].
+      \param x      the series, with elements stride apart
+      \param stride distance between consecutive elements of x
+      \param acf    the sums, of size tmax+1
+  */
+  void add_autocorrelation(const double *x, int stride, double *acf);
+
+  /** Add sum_k |r_{k+m} - r_k|^2 to sums[m].
+      \param r    the positions, 3 per element
+      \param sums the sums, of size tmax+1
+  */
+  void add_square_displacement(const double *r, double *sums);
+
+  /** Number of time origins for lag time m. */
+  int n_origins(int m) const { return m_n - m; }
+
+private:
+  int m_n, m_tmax;
+  std::vector<double> m_x, m_d;
+#ifdef FFTW
+  int m_n_fft;
+  double *m_in;
+  fftw_complex *m_out;
+  fftw_plan m_forward, m_backward;
+#endif
+};
+
+/** Selection of the trajectories, either of single particles or of the
+    centers of mass of molecules. */
+struct MSDSelection {
+  /** the particle types to use, all if empty */
+  std::vector<int> types;
+  /** use the centers of mass of the molecules (mol_id >= 0) */
+  bool molecules;
+};
+
+/** Mean square displacement of the selected particles or molecules over
+    the stored configurations, averaged over all time origins. The
+    positions have to be unfolded, as stored by \ref analyze_append.
+    @param sel   the selection of the trajectories
+    @param tmax  the maximal lag time in configurations
+    @param msd   the result for lag times 0..tmax
+    @return ES_OK, or ES_ERROR with a runtime error
+*/
+int calc_msd(const MSDSelection &sel, int tmax, std::vector<double> &msd);
+
+/** Velocity autocorrelation function of the selected particles or
+    molecules over the stored configurations, averaged over all time
+    origins. The velocities are the displacements between consecutive
+    configurations, that is, in units of length per configuration
+    interval.
+    @param sel   the selection of the trajectories
+    @param tmax  the maximal lag time in configurations
+    @param vacf  the result for lag times 0..tmax
+    @return ES_OK, or ES_ERROR with a runtime error
+*/
+int calc_vacf(const MSDSelection &sel, int tmax, std::vector<double> &vacf);
+
+#endif
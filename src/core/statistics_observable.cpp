@@ -23,6 +23,9 @@
 #include "lb.hpp"
 #include "pressure.hpp"
 #include "rotation.hpp"
+#include "statistics_parallel.hpp"
+#include <algorithm>
+#include <vector>
 
 using std::ostringstream;
 
@@ -102,468 +105,376 @@ int observable_read(char *filename, observable *self, bool binary) {
   return ES_ERROR;
 }
 
-int observable_calc_particle_velocities(observable* self) {
-  double* A = self->last_value;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    A[3*i + 0] = partCfg[ids->e[i]].m.v[0]/time_step;
-    A[3*i + 1] = partCfg[ids->e[i]].m.v[1]/time_step;
-    A[3*i + 2] = partCfg[ids->e[i]].m.v[2]/time_step;
-  }
-  return 0;
-}
-
-int observable_calc_particle_body_velocities(observable* self) {
-  double* A = self->last_value;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-
+/****************************************************************************************
+ *                 evaluation on the nodes that store the particles
+ ****************************************************************************************/
+
+/* The particle based observables are computed by the nodes from their
+   local particles. The sums and histograms are reduced over the nodes,
+   the per particle values are gathered on the master, so that the
+   particles are never collected in partCfg. */
+
+/** The per particle quantities of the observables. */
+enum ObservableQuantity {
+  /** the velocity */
+  OBS_VELOCITY,
+  /** the velocity in the body frame */
+  OBS_BODY_VELOCITY,
+  /** the angular velocity in the lab frame */
+  OBS_ANGULAR_MOMENTUM,
+  /** the angular velocity in the body frame */
+  OBS_BODY_ANGULAR_MOMENTUM,
+  /** the charge times the velocity */
+  OBS_CURRENT,
+  /** the charge times the unfolded position */
+  OBS_CHARGE_POSITION,
+  /** the dipole moment */
+  OBS_DIPOLE,
+  /** the unfolded position, as in \ref partCfg */
+  OBS_POSITION,
+  /** the force */
+  OBS_FORCE,
+  /** the force in internal units, as used by the force density profile */
+  OBS_RAW_FORCE,
+  /** one per particle, for the density profiles */
+  OBS_DENSITY
+};
+
+/** The value of a per particle quantity of a local particle. */
+static void particle_quantity(int quantity, const Particle &p, double x[3])
+{
+  switch (quantity) {
+  case OBS_VELOCITY:
+    for (int j = 0; j < 3; j++)
+      x[j] = p.m.v[j]/time_step;
+    break;
 #ifdef ROTATION
-
+  case OBS_BODY_VELOCITY: {
     double RMat[9];
-    double vel_lab[3];
-    double vel_body[3];
-
-    vel_lab[0] = partCfg[ids->e[i]].m.v[0]/time_step;
-    vel_lab[1] = partCfg[ids->e[i]].m.v[1]/time_step;
-    vel_lab[2] = partCfg[ids->e[i]].m.v[2]/time_step;
-    define_rotation_matrix(&partCfg[ids->e[i]], RMat);
-
-    vel_body[0] = RMat[0 + 3*0]*vel_lab[0] + RMat[0 + 3*1]*vel_lab[1] + RMat[0 + 3*2]*vel_lab[2];
-    vel_body[1] = RMat[1 + 3*0]*vel_lab[0] + RMat[1 + 3*1]*vel_lab[1] + RMat[1 + 3*2]*vel_lab[2];
-    vel_body[2] = RMat[2 + 3*0]*vel_lab[0] + RMat[2 + 3*1]*vel_lab[1] + RMat[2 + 3*2]*vel_lab[2];
-
-    A[3*i + 0] = vel_body[0];
-    A[3*i + 1] = vel_body[1];
-    A[3*i + 2] = vel_body[2];
-
-#else
-
-    A[3*i + 0] = 0.0;
-    A[3*i + 1] = 0.0;
-    A[3*i + 2] = 0.0;
-
+    define_rotation_matrix(const_cast<Particle *>(&p), RMat);
+    for (int j = 0; j < 3; j++)
+      x[j] = (RMat[j + 3*0]*p.m.v[0] + RMat[j + 3*1]*p.m.v[1] +
+              RMat[j + 3*2]*p.m.v[2])/time_step;
+    break;
+  }
+  case OBS_ANGULAR_MOMENTUM: {
+    double RMat[9];
+    define_rotation_matrix(const_cast<Particle *>(&p), RMat);
+    for (int j = 0; j < 3; j++)
+      x[j] = RMat[0 + 3*j]*p.m.omega[0] + RMat[1 + 3*j]*p.m.omega[1] +
+             RMat[2 + 3*j]*p.m.omega[2];
+    break;
+  }
+  case OBS_BODY_ANGULAR_MOMENTUM:
+    for (int j = 0; j < 3; j++)
+      x[j] = p.m.omega[j];
+    break;
 #endif
-
+#ifdef ELECTROSTATICS
+  case OBS_CURRENT:
+    for (int j = 0; j < 3; j++)
+      x[j] = p.p.q*p.m.v[j]/time_step;
+    break;
+  case OBS_CHARGE_POSITION:
+    get_unfolded_position(p, x);
+    for (int j = 0; j < 3; j++)
+      x[j] *= p.p.q;
+    break;
+#endif
+#ifdef DIPOLES
+  case OBS_DIPOLE:
+    for (int j = 0; j < 3; j++)
+      x[j] = p.r.dip[j];
+    break;
+#endif
+  case OBS_POSITION:
+    get_unfolded_position(p, x);
+    break;
+  case OBS_FORCE:
+    for (int j = 0; j < 3; j++)
+      x[j] = p.f.f[j]/time_step/time_step*2;
+    break;
+  case OBS_RAW_FORCE:
+    for (int j = 0; j < 3; j++)
+      x[j] = p.f.f[j];
+    break;
+  case OBS_DENSITY:
+    x[0] = 1.0;
+    x[1] = x[2] = 0.0;
+    break;
+  default:
+    /* quantities of features that are not compiled in */
+    x[0] = x[1] = x[2] = 0.0;
   }
-  return 0;
 }
 
-int observable_calc_particle_angular_momentum(observable* self) {
-  double* A = self->last_value;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for ( int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-
-#ifdef ROTATION
-
-    double RMat[9];
-    double omega[3];
-    define_rotation_matrix(&partCfg[ids->e[i]], RMat);
-    omega[0] = RMat[0 + 3*0]*partCfg[ids->e[i]].m.omega[0] + RMat[1 + 3*0]*partCfg[ids->e[i]].m.omega[1] + RMat[2 + 3*0]*partCfg[ids->e[i]].m.omega[2];
-    omega[1] = RMat[0 + 3*1]*partCfg[ids->e[i]].m.omega[0] + RMat[1 + 3*1]*partCfg[ids->e[i]].m.omega[1] + RMat[2 + 3*1]*partCfg[ids->e[i]].m.omega[2];
-    omega[2] = RMat[0 + 3*2]*partCfg[ids->e[i]].m.omega[0] + RMat[1 + 3*2]*partCfg[ids->e[i]].m.omega[1] + RMat[2 + 3*2]*partCfg[ids->e[i]].m.omega[2];
+/** The folded position of a local particle. In contrast to its stored
+    position, it is always inside the box, also between two resorts. */
+static void folded_position(const Particle &p, double pos[3])
+{
+  int img[3] = {0, 0, 0};
+  get_unfolded_position(p, pos);
+  fold_position(pos, img);
+}
 
-    A[3*i + 0] = omega[0];
-    A[3*i + 1] = omega[1];
-    A[3*i + 2] = omega[2];
+/** Append an id list to the parameters of an analysis, as its length
+    followed by the ids. */
+static void encode_id_list(const IntList *ids, std::vector<double> &params)
+{
+  params.push_back(ids->n);
+  params.insert(params.end(), ids->e, ids->e + ids->n);
+}
 
-#else
+/** Call f(i, p) for every entry i of the id list encoded at params[pos]
+    whose particle p is stored on this node. An id can occur several
+    times in the list. */
+template <typename F>
+static void for_each_listed_particle(const std::vector<double> &params,
+                                     size_t pos, F f)
+{
+  int n = params[pos];
+  const double *ids = params.data() + pos + 1;
+  /* the first entry of every id, and the next entry with the same id */
+  Utils::IdIndex<int> first(-1);
+  std::vector<int> next(n);
+  for (int i = n - 1; i >= 0; i--) {
+    next[i] = first[int(ids[i])];
+    first[int(ids[i])] = i;
+  }
+  for_each_local_particle([&](const Particle &p) {
+      for (int i = first[p.p.identity]; i != -1; i = next[i])
+        f(i, p);
+    });
+}
 
-    A[3*i + 0] = 0.0;
-    A[3*i + 1] = 0.0;
-    A[3*i + 2] = 0.0;
+static void local_particle_values(const std::vector<double> &params,
+                                  std::vector<double> &result)
+{
+  /* the list entry followed by the value */
+  int quantity = params[0];
+  for_each_listed_particle(params, 1, [&](int i, const Particle &p) {
+      double x[3];
+      particle_quantity(quantity, p, x);
+      result.push_back(i);
+      result.insert(result.end(), x, x + 3);
+    });
+}
 
-#endif
+static ParallelAnalysis particle_values_job(local_particle_values,
+                                            ANALYSIS_CONCAT);
 
+/** Gather a per particle quantity of the particles in an id list.
+    \param quantity an \ref ObservableQuantity
+    \param ids the particles
+    \param A receives the three components of the quantity for every
+             entry of the list
+    \return 0, or 1 if a particle does not exist
+*/
+static int gather_particle_values(int quantity, const IntList *ids, double *A)
+{
+  std::vector<double> params(1, quantity);
+  encode_id_list(ids, params);
+  std::vector<double> values = particle_values_job(params);
+  if ((int)values.size() != 4*ids->n)
+    return 1;
+  for (size_t k = 0; k < values.size(); k += 4) {
+    int i = values[k];
+    for (int j = 0; j < 3; j++)
+      A[3*i + j] = values[k + 1 + j];
   }
   return 0;
 }
 
-int observable_calc_particle_body_angular_momentum(observable* self) {
-  double* A = self->last_value;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for ( int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
+static void local_block_sums(const std::vector<double> &params,
+                             std::vector<double> &result)
+{
+  /* for every block the sum of the quantity, weighted with the mass if
+     requested, the total mass and the number of particles */
+  int quantity = params[0], weighted = params[1], blocksize = params[2];
+  int n = params[3];
+  result.assign(5*(n/blocksize), 0.0);
+  for_each_listed_particle(params, 3, [&](int i, const Particle &p) {
+      double x[3];
+      double *sum = &result[5*(i/blocksize)];
+      double w = weighted ? p.p.mass : 1.0;
+      particle_quantity(quantity, p, x);
+      for (int j = 0; j < 3; j++)
+        sum[j] += w*x[j];
+      sum[3] += p.p.mass;
+      sum[4] += 1.0;
+    });
+}
 
-#ifdef ROTATION
+static ParallelAnalysis block_sums_job(local_block_sums, ANALYSIS_SUM);
 
-    A[3*i + 0] = partCfg[ids->e[i]].m.omega[0];
-    A[3*i + 1] = partCfg[ids->e[i]].m.omega[1];
-    A[3*i + 2] = partCfg[ids->e[i]].m.omega[2];
+/** Sum a per particle quantity over consecutive blocks of an id list.
+    \param quantity an \ref ObservableQuantity
+    \param ids the particles
+    \param blocksize the number of particles per block
+    \param com if true, the center of mass of the quantity is calculated
+               instead of the sum
+    \param A receives the three components for every block
+    \return 0, or 1 if a particle does not exist
+*/
+static int sum_particle_values(int quantity, const IntList *ids, int blocksize,
+                               bool com, double *A)
+{
+  std::vector<double> params = {double(quantity), double(com),
+                                double(std::max(blocksize, 1))};
+  encode_id_list(ids, params);
+  std::vector<double> sums = block_sums_job(params);
+  int n_blocks = sums.size()/5, n_found = 0;
+  for (int block = 0; block < n_blocks; block++) {
+    const double *sum = &sums[5*block];
+    for (int j = 0; j < 3; j++)
+      A[3*block + j] = com ? sum[j]/sum[3] : sum[j];
+    n_found += sum[4];
+  }
+  return (n_found == ids->n) ? 0 : 1;
+}
 
-#else
+int observable_calc_particle_velocities(observable* self) {
+  return gather_particle_values(OBS_VELOCITY, (IntList*) self->container,
+                                self->last_value);
+}
 
-    A[3*i + 0] = 0.0;
-    A[3*i + 1] = 0.0;
-    A[3*i + 2] = 0.0;
+int observable_calc_particle_body_velocities(observable* self) {
+  return gather_particle_values(OBS_BODY_VELOCITY, (IntList*) self->container,
+                                self->last_value);
+}
 
-#endif
+int observable_calc_particle_angular_momentum(observable* self) {
+  return gather_particle_values(OBS_ANGULAR_MOMENTUM,
+                                (IntList*) self->container, self->last_value);
+}
 
-  }
-  return 0;
+int observable_calc_particle_body_angular_momentum(observable* self) {
+  return gather_particle_values(OBS_BODY_ANGULAR_MOMENTUM,
+                                (IntList*) self->container, self->last_value);
 }
 
 #ifdef ELECTROSTATICS
 int observable_calc_particle_currents(observable* self) {
-  double* A = self->last_value;
-  double charge;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    charge = partCfg[ids->e[i]].p.q;
-    A[3*i + 0] = charge * partCfg[ids->e[i]].m.v[0]/time_step;
-    A[3*i + 1] = charge * partCfg[ids->e[i]].m.v[1]/time_step;
-    A[3*i + 2] = charge * partCfg[ids->e[i]].m.v[2]/time_step;
-  }
-  return 0;
+  return gather_particle_values(OBS_CURRENT, (IntList*) self->container,
+                                self->last_value);
 }
 
 int observable_calc_currents(observable* self) {
-  double* A = self->last_value;
-  double charge;
-  double j[3] = {0. , 0., 0. } ;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] > n_part)
-      return 1;
-    charge = partCfg[ids->e[i]].p.q;
-    j[0] += charge * partCfg[ids->e[i]].m.v[0]/time_step;
-    j[1] += charge * partCfg[ids->e[i]].m.v[1]/time_step;
-    j[2] += charge * partCfg[ids->e[i]].m.v[2]/time_step;
-  }
-  A[0]=j[0];
-  A[1]=j[1];
-  A[2]=j[2];
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  return sum_particle_values(OBS_CURRENT, ids, ids->n, false,
+                             self->last_value);
 }
 
 int observable_calc_dipole_moment(observable* self) {
-  double* A = self->last_value;
-  double charge;
-  double j[3] = {0. , 0., 0. } ;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] > n_part)
-      return 1;
-    charge = partCfg[ids->e[i]].p.q;
-    j[0] += charge * partCfg[ids->e[i]].r.p[0];
-    j[1] += charge * partCfg[ids->e[i]].r.p[1];
-    j[2] += charge * partCfg[ids->e[i]].r.p[2];
-  }
-  A[0]=j[0];
-  A[1]=j[1];
-  A[2]=j[2];
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  return sum_particle_values(OBS_CHARGE_POSITION, ids, ids->n, false,
+                             self->last_value);
 }
 #endif
 
 #ifdef DIPOLES
 int observable_calc_com_dipole_moment(observable* self) {
-  double* A = self->last_value;
-  double d[3] = {0. , 0., 0. } ;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] > n_part)
-      return 1;
-    d[0] += partCfg[ids->e[i]].r.dip[0];
-    d[1] += partCfg[ids->e[i]].r.dip[1];
-    d[2] += partCfg[ids->e[i]].r.dip[2];
-  }
-  A[0]=d[0];
-  A[1]=d[1];
-  A[2]=d[2];
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  return sum_particle_values(OBS_DIPOLE, ids, ids->n, false,
+                             self->last_value);
 }
 #endif
 
 int observable_calc_com_velocity(observable* self) {
-  double* A = self->last_value;
-  double v_com[3] = { 0. , 0., 0. } ;
-  double total_mass = 0;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    v_com[0] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].m.v[0]/time_step;
-    v_com[1] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].m.v[1]/time_step;
-    v_com[2] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].m.v[2]/time_step;
-    total_mass += (partCfg[ids->e[i]]).p.mass;
-  }
-  A[0]=v_com[0]/total_mass;
-  A[1]=v_com[1]/total_mass;
-  A[2]=v_com[2]/total_mass;
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  return sum_particle_values(OBS_VELOCITY, ids, ids->n, true,
+                             self->last_value);
 }
 
 int observable_calc_blocked_com_velocity(observable* self) {
-  double* A = self->last_value;
-  unsigned int i;
-  unsigned int block;
-  unsigned int n_blocks;
-  unsigned int blocksize;
-  unsigned int id;
-  double total_mass = 0;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  n_blocks=self->n/3; 
-  blocksize=ids->n/n_blocks;
-  for ( block = 0; block < n_blocks; block++ ) {
-    total_mass = 0;
-    for ( i = 0; i < blocksize; i++ ) {
-      id = ids->e[block*blocksize+i];
-      if (ids->e[i] >= n_part)
-        return 1;
-      A[3*block+0] +=  (partCfg[id]).p.mass*partCfg[id].m.v[0]/time_step;
-      A[3*block+1] +=  (partCfg[id]).p.mass*partCfg[id].m.v[1]/time_step;
-      A[3*block+2] +=  (partCfg[id]).p.mass*partCfg[id].m.v[2]/time_step;
-      total_mass += (partCfg[ids->e[i]]).p.mass;
-    }
-    A[3*block+0] /=  total_mass;
-    A[3*block+1] /=  total_mass;
-    A[3*block+2] /=  total_mass;
-  }
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  return sum_particle_values(OBS_VELOCITY, ids, 3*ids->n/self->n, true,
+                             self->last_value);
 }
 
 int observable_calc_blocked_com_position(observable* self) {
-  double* A = self->last_value;
-  unsigned int i;
-  unsigned int block;
-  unsigned int n_blocks;
-  unsigned int blocksize;
-  unsigned int id;
-  double total_mass = 0;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  n_blocks=self->n/3; 
-  blocksize=ids->n/n_blocks;
-  for ( block = 0; block < n_blocks; block++ ) {
-    total_mass = 0;
-    for ( i = 0; i < blocksize; i++ ) {
-      id = ids->e[block*blocksize+i];
-      if (ids->e[i] >= n_part)
-        return 1;
-      A[3*block+0] +=  (partCfg[id]).p.mass*partCfg[id].r.p[0];
-      A[3*block+1] +=  (partCfg[id]).p.mass*partCfg[id].r.p[1];
-      A[3*block+2] +=  (partCfg[id]).p.mass*partCfg[id].r.p[2];
-      total_mass += (partCfg[ids->e[i]]).p.mass;
-    }
-    A[3*block+0] /=  total_mass;
-    A[3*block+1] /=  total_mass;
-    A[3*block+2] /=  total_mass;
-  }
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  return sum_particle_values(OBS_POSITION, ids, 3*ids->n/self->n, true,
+                             self->last_value);
 }
 
 int observable_calc_com_position(observable* self) {
-  double* A = self->last_value;
-  double p_com[3] = { 0. , 0., 0. } ;
-  double total_mass = 0;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    p_com[0] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].r.p[0];
-    p_com[1] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].r.p[1];
-    p_com[2] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].r.p[2];
-    total_mass += (partCfg[ids->e[i]]).p.mass;
-  }
-  A[0]=p_com[0]/total_mass;
-  A[1]=p_com[1]/total_mass;
-  A[2]=p_com[2]/total_mass;
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  return sum_particle_values(OBS_POSITION, ids, ids->n, true,
+                             self->last_value);
 }
 
-
 int observable_calc_com_force(observable* self) {
-  double* A = self->last_value;
-  double f_com[3] = { 0. , 0., 0. } ;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    f_com[0] += partCfg[ids->e[i]].f.f[0]/time_step/time_step*2;
-    f_com[1] += partCfg[ids->e[i]].f.f[1]/time_step/time_step*2;
-    f_com[2] += partCfg[ids->e[i]].f.f[2]/time_step/time_step*2;
-  }
-  A[0]=f_com[0];
-  A[1]=f_com[1];
-  A[2]=f_com[2];
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  return sum_particle_values(OBS_FORCE, ids, ids->n, false,
+                             self->last_value);
 }
 
-
 int observable_calc_blocked_com_force(observable* self) {
-  double* A = self->last_value;
-  unsigned int i;
-  unsigned int block;
-  unsigned int n_blocks;
-  unsigned int blocksize;
-  unsigned int id;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  n_blocks=self->n/3; 
-  blocksize=ids->n/n_blocks;
-  for ( block = 0; block < n_blocks; block++ ) {
-    for ( i = 0; i < blocksize; i++ ) {
-      id = ids->e[block*blocksize+i];
-      if (ids->e[i] >= n_part)
-        return 1;
-      A[3*block+0] +=  partCfg[id].f.f[0]/time_step/time_step*2;
-      A[3*block+1] +=  partCfg[id].f.f[1]/time_step/time_step*2;
-      A[3*block+2] +=  partCfg[id].f.f[2]/time_step/time_step*2;
-    }
-  }
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  return sum_particle_values(OBS_FORCE, ids, 3*ids->n/self->n, false,
+                             self->last_value);
 }
 
+static void local_profile(const std::vector<double> &params,
+                          std::vector<double> &result)
+{
+  /* the histogram of the quantity, followed by the number of particles */
+  int quantity = params[0];
+  const double *min = &params[1], *max = &params[4];
+  int bins[3] = {int(params[7]), int(params[8]), int(params[9])};
+  int dim = (quantity == OBS_DENSITY) ? 1 : 3;
+  int n_bins = bins[0]*bins[1]*bins[2];
+  result.assign(dim*n_bins + 1, 0.0);
+  for_each_listed_particle(params, 10, [&](int, const Particle &p) {
+      double ppos[3], x[3];
+      int bin[3];
+      result[dim*n_bins] += 1.0;
+      folded_position(p, ppos);
+      for (int j = 0; j < 3; j++) {
+        bin[j] = (int) floor(bins[j]*(ppos[j] - min[j])/(max[j] - min[j]));
+        if (bin[j] < 0 || bin[j] >= bins[j])
+          return;
+      }
+      particle_quantity(quantity, p, x);
+      int b = bin[0]*bins[1]*bins[2] + bin[1]*bins[2] + bin[2];
+      for (int j = 0; j < dim; j++)
+        result[dim*b + j] += x[j];
+    });
+}
 
-int observable_calc_density_profile(observable* self) {
-  double* A = self->last_value;
-  int binx, biny, binz;
-  double ppos[3];
-  int img[3];
-  IntList* ids;
-  profile_data* pdata;
+static ParallelAnalysis profile_job(local_profile, ANALYSIS_SUM);
 
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  pdata=(profile_data*) self->container;
-  ids=pdata->id_list;
+/** The density profile of a per particle quantity on a cartesian grid.
+    \param quantity an \ref ObservableQuantity
+    \param pdata the grid and the particles
+    \param A receives the density, one value per bin for \ref OBS_DENSITY,
+             otherwise three
+    \return 0, or 1 if a particle does not exist
+*/
+static int calc_profile(int quantity, const profile_data *pdata, double *A)
+{
+  std::vector<double> params = {
+    double(quantity), pdata->minx, pdata->miny, pdata->minz,
+    pdata->maxx, pdata->maxy, pdata->maxz,
+    double(pdata->xbins), double(pdata->ybins), double(pdata->zbins)};
+  encode_id_list(pdata->id_list, params);
+  std::vector<double> hist = profile_job(params);
   double bin_volume=(pdata->maxx-pdata->minx)*(pdata->maxy-pdata->miny)*(pdata->maxz-pdata->minz)/pdata->xbins/pdata->ybins/pdata->zbins;
-    
-  for ( int i = 0; i<self->n; i++ ) {
-    A[i]=0;
-  }
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-/* We use folded coordinates here */
-    memmove(ppos, partCfg[ids->e[i]].r.p, 3*sizeof(double));
-    memmove(img, partCfg[ids->e[i]].l.i, 3*sizeof(int));
-    fold_position(ppos, img);
-    binx= (int) floor( pdata->xbins*  (ppos[0]-pdata->minx)/(pdata->maxx-pdata->minx));
-    biny= (int) floor( pdata->ybins*  (ppos[1]-pdata->miny)/(pdata->maxy-pdata->miny));
-    binz= (int) floor( pdata->zbins*  (ppos[2]-pdata->minz)/(pdata->maxz-pdata->minz));
-    if (binx>=0 && binx < pdata->xbins && biny>=0 && biny < pdata->ybins && binz>=0 && binz < pdata->zbins) {
-      A[binx*pdata->ybins*pdata->zbins + biny*pdata->zbins + binz] += 1./bin_volume;
-    } 
-  }
-  return 0;
+  int n = hist.size() - 1;
+  for (int i = 0; i < n; i++)
+    A[i] = hist[i]/bin_volume;
+  return (hist[n] == pdata->id_list->n) ? 0 : 1;
 }
 
-int observable_calc_force_density_profile(observable* self) {
-  double* A = self->last_value;
-  int binx, biny, binz;
-  double ppos[3];
-  int img[3];
-  IntList* ids;
-  profile_data* pdata;
+int observable_calc_density_profile(observable* self) {
+  return calc_profile(OBS_DENSITY, (profile_data*) self->container,
+                      self->last_value);
+}
 
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  pdata=(profile_data*) self->container;
-  ids=pdata->id_list;
-  double bin_volume=(pdata->maxx-pdata->minx)*(pdata->maxy-pdata->miny)*(pdata->maxz-pdata->minz)/pdata->xbins/pdata->ybins/pdata->zbins;
-    
-  for ( int i = 0; i<self->n; i++ ) {
-    A[i]=0;
-  }
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-/* We use folded coordinates here */
-    memmove(ppos, partCfg[ids->e[i]].r.p, 3*sizeof(double));
-    memmove(img, partCfg[ids->e[i]].l.i, 3*sizeof(int));
-    fold_position(ppos, img);
-    binx= (int) floor( pdata->xbins*  (ppos[0]-pdata->minx)/(pdata->maxx-pdata->minx));
-    biny= (int) floor( pdata->ybins*  (ppos[1]-pdata->miny)/(pdata->maxy-pdata->miny));
-    binz= (int) floor( pdata->zbins*  (ppos[2]-pdata->minz)/(pdata->maxz-pdata->minz));
-    if (binx>=0 && binx < pdata->xbins && biny>=0 && biny < pdata->ybins && binz>=0 && binz < pdata->zbins) {
-      for(int dim = 0; dim < 3; dim++)
-        A[3*(binx*pdata->ybins*pdata->zbins + biny*pdata->zbins + binz) + dim] += partCfg[ids->e[i]].f.f[dim]/bin_volume;
-    } 
-  }
-  return 0;
+int observable_calc_force_density_profile(observable* self) {
+  return calc_profile(OBS_RAW_FORCE, (profile_data*) self->container,
+                      self->last_value);
 }
 
 #ifdef LB
@@ -791,64 +702,64 @@ void transform_to_cylinder_coordinates(double x, double y, double z_, double* r,
   *phi = atan2(y,x);
 }
 
+static void local_radial_profile(const std::vector<double> &params,
+                                 std::vector<double> &result)
+{
+  /* the histogram, followed by the number of particles */
+  const double *center = &params[0];
+  double minr = params[3], minphi = params[4], minz = params[5];
+  double rbinsize = params[6], phibinsize = params[7], zbinsize = params[8];
+  int rbins = params[9], phibins = params[10], zbins = params[11];
+  result.assign(rbins*phibins*zbins + 1, 0.0);
+  for_each_listed_particle(params, 12, [&](int, const Particle &p) {
+      double ppos[3], r, phi, z;
+      result[rbins*phibins*zbins] += 1.0;
+      folded_position(p, ppos);
+      transform_to_cylinder_coordinates(ppos[0]-center[0], ppos[1]-center[1], ppos[2]-center[2], &r, &phi, &z);
+      int binr  =(int)floor((r-minr)/rbinsize);
+      int binphi=(int)floor((phi-minphi)/phibinsize);
+      int binz  =(int)floor((z-minz)/zbinsize);
+      if (binr>=0 && binr < rbins && binphi>=0 && binphi < phibins && binz>=0 && binz < zbins)
+        result[binr*phibins*zbins + binphi*zbins + binz] += 1.0;
+    });
+}
+
+static ParallelAnalysis radial_profile_job(local_radial_profile, ANALYSIS_SUM);
+
 int observable_calc_radial_density_profile(observable* self) {
   double* A = self->last_value;
-  int binr, binphi, binz;
-  double ppos[3];
-  double r, phi, z;
-  int img[3];
-  double bin_volume;
-  IntList* ids;
-  
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
   radial_profile_data* pdata;
   pdata=(radial_profile_data*) self->container;
-  ids=pdata->id_list;
   double rbinsize=(pdata->maxr - pdata->minr)/pdata->rbins;
   double phibinsize=(pdata->maxphi - pdata->minphi)/pdata->phibins;
   double zbinsize=(pdata->maxz - pdata->minz)/pdata->zbins;
-    
-  for (int i = 0; i< self->n; i++ ) {
-    A[i]=0;
-  }
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-/* We use folded coordinates here */
-    memmove(ppos, partCfg[ids->e[i]].r.p, 3*sizeof(double));
-    memmove(img, partCfg[ids->e[i]].l.i, 3*sizeof(int));
-    fold_position(ppos, img);
-    transform_to_cylinder_coordinates(ppos[0]-pdata->center[0], ppos[1]-pdata->center[1], ppos[2]-pdata->center[2], &r, &phi, &z);
-    //printf("%f %f %f %f %f %f\n", ppos[0], ppos[1], ppos[2], r*cos(phi)+pdata->center[0], r*sin(phi)+pdata->center[1], z+pdata->center[2]);
-    binr  =(int)floor((r-pdata->minr)/rbinsize);
-    binphi=(int)floor((phi-pdata->minphi)/phibinsize);
-    binz  =(int)floor((z-pdata->minz)/zbinsize);
 
-    if (binr>=0 && binr < pdata->rbins && binphi>=0 && binphi < pdata->phibins && binz>=0 && binz < pdata->zbins) {
-      bin_volume=PI*((pdata->minr+(binr+1)*rbinsize)*(pdata->minr+(binr+1)*rbinsize) - (pdata->minr+(binr)*rbinsize)*(pdata->minr+(binr)*rbinsize)) *zbinsize * phibinsize/2/PI;
-      A[binr*pdata->phibins*pdata->zbins + binphi*pdata->zbins + binz] += 1./bin_volume;
-    } 
+  std::vector<double> params = {
+    pdata->center[0], pdata->center[1], pdata->center[2],
+    pdata->minr, pdata->minphi, pdata->minz, rbinsize, phibinsize, zbinsize,
+    double(pdata->rbins), double(pdata->phibins), double(pdata->zbins)};
+  encode_id_list(pdata->id_list, params);
+  std::vector<double> hist = radial_profile_job(params);
+
+  for (int binr = 0; binr < pdata->rbins; binr++) {
+    double bin_volume=PI*((pdata->minr+(binr+1)*rbinsize)*(pdata->minr+(binr+1)*rbinsize) - (pdata->minr+(binr)*rbinsize)*(pdata->minr+(binr)*rbinsize)) *zbinsize * phibinsize/2/PI;
+    for (int i = 0; i < pdata->phibins*pdata->zbins; i++) {
+      int b = binr*pdata->phibins*pdata->zbins + i;
+      A[b] = hist[b]/bin_volume;
+    }
   }
-  return 0;
+  return (hist.back() == pdata->id_list->n) ? 0 : 1;
 }
 
 int observable_calc_radial_flux_density_profile(observable* self) {
   double* A = self->last_value;
   int binr, binphi, binz;
   double ppos[3];
-  double unfolded_ppos[3];
   double r, phi, z;
   int img[3];
   double bin_volume;
   IntList* ids;
 
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
   radial_profile_data* pdata;
   pdata=(radial_profile_data*) self->container;
   ids=pdata->id_list;
@@ -861,34 +772,26 @@ int observable_calc_radial_flux_density_profile(observable* self) {
   if (self->last_update==sim_time) {
     return ES_ERROR;
   }
-    
+
   for (int i = 0; i< self->n; i++ ) {
     A[i]=0;
   }
+  /* the flux is calculated from the displacements since the last update,
+     so only the positions of the listed particles are needed */
+  std::vector<double> unfolded_ppos(3*ids->n);
+  if (gather_particle_values(OBS_POSITION, ids, unfolded_ppos.data()))
+    return 1;
   double* old_positions=(double*) pdata->container;
   if (old_positions[0] == CONST_UNITITIALIZED) {
-    for (int i = 0; i<ids->n; i++ ) {
-      memmove(unfolded_ppos, partCfg[ids->e[i]].r.p, 3*sizeof(double));
-      memmove(img, partCfg[ids->e[i]].l.i, 3*sizeof(int));
-      unfold_position(unfolded_ppos, img);
-      old_positions[3*i+0]=unfolded_ppos[0];
-      old_positions[3*i+1]=unfolded_ppos[1];
-      old_positions[3*i+2]=unfolded_ppos[2];
-    }
+    memmove(old_positions, unfolded_ppos.data(), 3*ids->n*sizeof(double));
     return 0;
   }
   for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-/* We use folded coordinates here */
-    memmove(unfolded_ppos, partCfg[ids->e[i]].r.p, 3*sizeof(double));
-    memmove(img, partCfg[ids->e[i]].l.i, 3*sizeof(int));
-    unfold_position(unfolded_ppos, img);
-    v[0]=(unfolded_ppos[0] - old_positions[3*i+0]);
-    v[1]=(unfolded_ppos[1] - old_positions[3*i+1]);
-    v[2]=(unfolded_ppos[2] - old_positions[3*i+2]);
-    memmove(ppos, partCfg[ids->e[i]].r.p, 3*sizeof(double));
-    memmove(img, partCfg[ids->e[i]].l.i, 3*sizeof(int));
+    v[0]=(unfolded_ppos[3*i+0] - old_positions[3*i+0]);
+    v[1]=(unfolded_ppos[3*i+1] - old_positions[3*i+1]);
+    v[2]=(unfolded_ppos[3*i+2] - old_positions[3*i+2]);
+    memmove(ppos, &unfolded_ppos[3*i], 3*sizeof(double));
+    img[0] = img[1] = img[2] = 0;
     fold_position(ppos, img);
     // The position of the particle is by definition the middle of old and new position
     ppos[0]+=0.5*v[0]; ppos[1]+=0.5*v[1]; ppos[2]+=0.5*v[2];
@@ -896,13 +799,9 @@ int observable_calc_radial_flux_density_profile(observable* self) {
     v[0]/=(sim_time - self->last_update);
     v[1]/=(sim_time - self->last_update);
     v[2]/=(sim_time - self->last_update);
-    if (i==0) {
-//      printf("(%3.4f) %f %f %f\n", sim_time-self->last_update, v[2], partCfg[ids->e[i]].m.v[2]/time_step,v[2]* partCfg[ids->e[i]].m.v[2]/time_step/time_step);
-//      printf("(%3.3f) %f %f", sim_time, old_positions[3*i+2], unfolded_ppos[2]);
-    }
-    old_positions[3*i+0]=unfolded_ppos[0];
-    old_positions[3*i+1]=unfolded_ppos[1];
-    old_positions[3*i+2]=unfolded_ppos[2];
+    old_positions[3*i+0]=unfolded_ppos[3*i+0];
+    old_positions[3*i+1]=unfolded_ppos[3*i+1];
+    old_positions[3*i+2]=unfolded_ppos[3*i+2];
     transform_to_cylinder_coordinates(ppos[0]-pdata->center[0], ppos[1]-pdata->center[1], ppos[2]-pdata->center[2], &r, &phi, &z);
     binr  =(int)floor((r-pdata->minr)/rbinsize);
     binphi=(int)floor((phi-pdata->minphi)/phibinsize);
@@ -910,114 +809,32 @@ int observable_calc_radial_flux_density_profile(observable* self) {
 
     if (binr>=0 && binr < pdata->rbins && binphi>=0 && binphi < pdata->phibins && binz>=0 && binz < pdata->zbins) {
       bin_volume=PI*((pdata->minr+(binr+1)*rbinsize)*(pdata->minr+(binr+1)*rbinsize) - (pdata->minr+(binr)*rbinsize)*(pdata->minr+(binr)*rbinsize)) *zbinsize * phibinsize/2/PI;
-      v_r = 1/r*((ppos[0]-pdata->center[0])*v[0] + (ppos[1]-pdata->center[1])*v[1]); 
+      v_r = 1/r*((ppos[0]-pdata->center[0])*v[0] + (ppos[1]-pdata->center[1])*v[1]);
       v_phi = 1/r/r*((ppos[0]-pdata->center[0])*v[1]-(ppos[1]-pdata->center[1])*v[0]);
       v_z = v[2];
       A[3*(binr*pdata->phibins*pdata->zbins + binphi*pdata->zbins + binz) + 0] += v_r/bin_volume;
       A[3*(binr*pdata->phibins*pdata->zbins + binphi*pdata->zbins + binz) + 1] += v_phi/bin_volume;
       A[3*(binr*pdata->phibins*pdata->zbins + binphi*pdata->zbins + binz) + 2] += v_z/bin_volume;
-    } 
+    }
   }
   return 0;
 }
 
 int observable_calc_flux_density_profile(observable* self) {
-  double* A = self->last_value;
-  int binx, biny, binz;
-  double ppos[3];
-  double x, y, z;
-  int img[3];
-  double bin_volume;
-  IntList* ids;
-
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  profile_data* pdata;
-  pdata=(profile_data*) self->container;
-  ids=pdata->id_list;
-  double xbinsize=(pdata->maxx - pdata->minx)/pdata->xbins;
-  double ybinsize=(pdata->maxy - pdata->miny)/pdata->ybins;
-  double zbinsize=(pdata->maxz - pdata->minz)/pdata->zbins;
-  double v[3];
-  double v_x, v_y, v_z;
-    
-  for (int i = 0; i< self->n; i++ ) {
-    A[i]=0;
-  }
-
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    /* We use folded coordinates here */
-    v[0]=partCfg[ids->e[i]].m.v[0]/time_step;
-    v[1]=partCfg[ids->e[i]].m.v[1]/time_step;
-    v[2]=partCfg[ids->e[i]].m.v[2]/time_step;
-    memmove(ppos, partCfg[ids->e[i]].r.p, 3*sizeof(double));
-    memmove(img, partCfg[ids->e[i]].l.i, 3*sizeof(int));
-    fold_position(ppos, img);
-    // The position of the particle is by definition the middle of old and new position
-  
-    x=ppos[0];
-    y=ppos[1];
-    z=ppos[2];
-
-    binx  =(int)floor((x-pdata->minx)/xbinsize);
-    biny  =(int)floor((y-pdata->miny)/ybinsize);
-    binz  =(int)floor((z-pdata->minz)/zbinsize);
-
-
-    if (binx>=0 && binx < pdata->xbins && biny>=0 && biny < pdata->ybins && binz>=0 && binz < pdata->zbins) {
-      bin_volume=xbinsize*ybinsize*zbinsize;
-      v_x=v[0];
-      v_y=v[1];
-      v_z=v[2];
-      A[3*(binx*pdata->ybins*pdata->zbins + biny*pdata->zbins + binz) + 0] += v_x/bin_volume;
-      A[3*(binx*pdata->ybins*pdata->zbins + biny*pdata->zbins + binz) + 1] += v_y/bin_volume;
-      A[3*(binx*pdata->ybins*pdata->zbins + biny*pdata->zbins + binz) + 2] += v_z/bin_volume;
-    } 
-  }
-  return 0;
+  return calc_profile(OBS_VELOCITY, (profile_data*) self->container,
+                      self->last_value);
 }
 
 int observable_calc_particle_positions(observable* self) {
-  double* A = self->last_value;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-      A[3*i + 0] = partCfg[ids->e[i]].r.p[0];
-      A[3*i + 1] = partCfg[ids->e[i]].r.p[1];
-      A[3*i + 2] = partCfg[ids->e[i]].r.p[2];
-  }
-  return 0;
+  return gather_particle_values(OBS_POSITION, (IntList*) self->container,
+                                self->last_value);
 }
 
 int observable_calc_particle_forces(observable* self) {
-  double* A = self->last_value;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-      A[3*i + 0] = partCfg[ids->e[i]].f.f[0]/time_step/time_step*2;
-      A[3*i + 1] = partCfg[ids->e[i]].f.f[1]/time_step/time_step*2;
-      A[3*i + 2] = partCfg[ids->e[i]].f.f[2]/time_step/time_step*2;
-  }
-  return 0;
+  return gather_particle_values(OBS_FORCE, (IntList*) self->container,
+                                self->last_value);
 }
 
-
 int observable_stress_tensor(observable* self) {
   if (!sortPartCfg()) {
       runtimeErrorMsg() <<"could not sort partCfg";
@@ -1091,7 +908,7 @@ int observable_calc_structure_factor(observable* self) {
 
   
   l=0;
-  float partCache[n_part*3];
+  std::vector<double> partCache(3*n_part);
   for(int p=0; p<n_part; p++) {
     for (int i=0;i<3;i++){
       partCache[3*p+i]=partCfg[p].r.p[i];
@@ -1146,7 +963,7 @@ int observable_calc_structure_factor_fast(observable* self) {
     A[p]   = 0.0;
   }
   
-  float partCache[n_part*3];
+  std::vector<double> partCache(3*n_part);
   for(int p=0; p<n_part; p++) {
     for (int i=0;i<3;i++){
       partCache[3*p+i]=partCfg[p].r.p[i];
@@ -1277,32 +1094,21 @@ int observable_calc_interacts_with (observable* self) {
   IntList* ids1;
   IntList* ids2;
   int i,j;
-//  double dx,dy,dz;
   double dist2;
   double cutoff2=params->cutoff*params->cutoff;
-  double pos1[3], pos2[3], dist[3];
+  double dist[3];
   ids1=params->ids1;
   ids2=params->ids2;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
+  std::vector<double> pos1(3*ids1->n), pos2(3*ids2->n);
+  if (gather_particle_values(OBS_POSITION, ids1, pos1.data()) ||
+      gather_particle_values(OBS_POSITION, ids2, pos2.data()))
+    return 1;
   for ( i = 0; i<ids1->n; i++ ) {
-    if (ids1->e[i] >= n_part)
-      return 1;
-    pos1[0]=partCfg[ids1->e[i]].r.p[0];
-    pos1[1]=partCfg[ids1->e[i]].r.p[1];
-    pos1[2]=partCfg[ids1->e[i]].r.p[2];
+    A[i] = 0;
     for ( j = 0; j<ids2->n; j++ ) {
-      if (ids2->e[j] >= n_part)
-        return 1;
       if (ids2->e[j] == ids1->e[i]) // do not count self-interaction :-)
         continue;
-      A[i] = 0;
-      pos2[0]=partCfg[ids2->e[j]].r.p[0];
-      pos2[1]=partCfg[ids2->e[j]].r.p[1];
-      pos2[2]=partCfg[ids2->e[j]].r.p[2];
-      get_mi_vector(dist,pos1,pos2);
+      get_mi_vector(dist,&pos1[3*i],&pos2[3*j]);
       dist2= dist[0]*dist[0] + dist[1]*dist[1] + dist[2]*dist[2];
       if(dist2<cutoff2) {
         A[i] = 1;
@@ -1315,9 +1121,6 @@ int observable_calc_interacts_with (observable* self) {
 }
 
 int observable_calc_rdf(observable* self){
-  if (!sortPartCfg()) {
-    return 1;
-  }
   double * last = self->last_value;
   rdf_profile_data * rdf_data = (rdf_profile_data *) self->container;
   calc_rdf(rdf_data->p1_types, rdf_data->n_p1,
@@ -1338,14 +1141,15 @@ int observable_radial_density_distribution(observable* self){
 
   radial_density_data *r_data = (radial_density_data *) self->container;
   IntList *ids;  
-  if ( GC_init && Type_array_init ) {
-	  ids = (IntList *) Utils::malloc(sizeof(IntList));
-
+  IntList type_ids;
+  std::vector<int> type_id_vec;
+  if ( GC_init && Type_array_init &&
+       get_particles_of_type(r_data->type, type_id_vec) == ES_OK ) {
 	  //using the grandcanonical scheme, always update the particle id list
-	  ids->e = (int *) Utils::malloc(sizeof(int)*type_array[Index.type[r_data->type]].max_entry);
-	  memmove(ids->e, type_array[Index.type[r_data->type]].id_list, type_array[Index.type[r_data->type]].max_entry*sizeof(int));
-	  ids->n = type_array[Index.type[r_data->type]].max_entry;
-	  ids->max = type_array[Index.type[r_data->type]].cur_size;
+	  type_ids.e = type_id_vec.data();
+	  type_ids.n = type_id_vec.size();
+	  type_ids.max = type_id_vec.size();
+	  ids = &type_ids;
   } else { 
 	  ids = r_data->id_list;
   }
@@ -1471,10 +1275,6 @@ int observable_radial_density_distribution(observable* self){
   }
 //  printf("fraction of parts: %d %d\n", frac, ids->n);
   free(bin_volume);
-  if ( GC_init && Type_array_init ) {
-	  free(ids->e);
-	  free(ids);
-	}
   return 0;
 }
 
@@ -0,0 +1,273 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file statistics_parallel.cpp
+    Implementation of \ref statistics_parallel.hpp "statistics_parallel.hpp".
+*/
+#include "statistics_parallel.hpp"
+#include "communication.hpp"
+#include <cmath>
+#include <limits>
+#include <mpi.h>
+
+/** All analyses, in the order of their construction. A function-local
+    static, so that it exists before the first analysis is constructed. */
+static std::vector<const ParallelAnalysis *> &analyses() {
+  static std::vector<const ParallelAnalysis *> list;
+  return list;
+}
+
+ParallelAnalysis::ParallelAnalysis(AnalysisMap map,
+                                   AnalysisReduction reduction)
+    : m_map(map), m_reduction(reduction), m_id(analyses().size()) {
+  analyses().push_back(this);
+}
+
+const ParallelAnalysis &ParallelAnalysis::get(int id) {
+  return *analyses()[id];
+}
+
+std::vector<double> ParallelAnalysis::
+operator()(const std::vector<double> &params) const {
+  return mpi_parallel_analysis(m_id, params);
+}
+
+std::vector<double>
+ParallelAnalysis::collective(const std::vector<double> &params) const {
+  return run(params, false);
+}
+
+std::vector<double>
+ParallelAnalysis::collective_to_master(const std::vector<double> &params) const {
+  return run(params, true);
+}
+
+std::vector<double> ParallelAnalysis::run(const std::vector<double> &params,
+                                          bool to_master) const {
+  std::vector<double> local;
+  m_map(params, local);
+
+  if (m_reduction == ANALYSIS_CONCAT) {
+    int n = local.size();
+    std::vector<int> counts(n_nodes), displs(n_nodes);
+    MPI_Gather(&n, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm_cart);
+    int total = 0;
+    for (int i = 0; i < n_nodes; i++) {
+      displs[i] = total;
+      total += counts[i];
+    }
+    std::vector<double> result(this_node == 0 ? total : 0);
+    MPI_Gatherv(local.data(), n, MPI_DOUBLE, result.data(), counts.data(),
+                displs.data(), MPI_DOUBLE, 0, comm_cart);
+    return result;
+  }
+
+  /* nodes without particles may leave their partial result empty, so
+     pad it with the neutral element of the reduction */
+  int n = local.size();
+  MPI_Allreduce(MPI_IN_PLACE, &n, 1, MPI_INT, MPI_MAX, comm_cart);
+  double neutral = 0.0;
+  MPI_Op op = MPI_SUM;
+  if (m_reduction == ANALYSIS_MIN) {
+    neutral = std::numeric_limits<double>::max();
+    op = MPI_MIN;
+  } else if (m_reduction == ANALYSIS_MAX) {
+    neutral = -std::numeric_limits<double>::max();
+    op = MPI_MAX;
+  }
+  local.resize(n, neutral);
+
+  std::vector<double> result(n);
+  if (to_master)
+    MPI_Reduce(local.data(), this_node == 0 ? result.data() : NULL, n,
+               MPI_DOUBLE, op, 0, comm_cart);
+  else
+    MPI_Allreduce(local.data(), result.data(), n, MPI_DOUBLE, op, comm_cart);
+  return result;
+}
+
+std::vector<double> allgather_analysis_data(const std::vector<double> &local,
+                                            int *offset) {
+  int n = local.size();
+  std::vector<int> counts(n_nodes), displs(n_nodes);
+  MPI_Allgather(&n, 1, MPI_INT, counts.data(), 1, MPI_INT, comm_cart);
+  int total = 0;
+  for (int i = 0; i < n_nodes; i++) {
+    displs[i] = total;
+    total += counts[i];
+  }
+  if (offset)
+    *offset = displs[this_node];
+  std::vector<double> all(total);
+  MPI_Allgatherv(const_cast<double *>(local.data()), n, MPI_DOUBLE,
+                 all.data(), counts.data(), displs.data(), MPI_DOUBLE,
+                 comm_cart);
+  return all;
+}
+
+void distribute_points(std::vector<double> &points, int stride) {
+  std::vector<int> nodes;
+  nodes.reserve(points.size() / stride);
+  for (size_t i = 0; i < points.size(); i += stride)
+    nodes.push_back(map_position_node_array(&points[i]));
+  distribute_points(points, stride, nodes);
+}
+
+void distribute_points(std::vector<double> &points, int stride,
+                       const std::vector<int> &nodes) {
+  std::vector<std::vector<double>> buckets(n_nodes);
+  for (size_t i = 0; i < points.size(); i += stride) {
+    std::vector<double> &bucket = buckets[nodes[i / stride]];
+    bucket.insert(bucket.end(), &points[i], &points[i] + stride);
+  }
+
+  std::vector<int> send_counts(n_nodes), send_displs(n_nodes);
+  std::vector<int> recv_counts(n_nodes), recv_displs(n_nodes);
+  std::vector<double> send;
+  send.reserve(points.size());
+  for (int node = 0; node < n_nodes; node++) {
+    send_displs[node] = send.size();
+    send_counts[node] = buckets[node].size();
+    send.insert(send.end(), buckets[node].begin(), buckets[node].end());
+  }
+  MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT,
+               comm_cart);
+  int total = 0;
+  for (int node = 0; node < n_nodes; node++) {
+    recv_displs[node] = total;
+    total += recv_counts[node];
+  }
+  points.resize(total);
+  MPI_Alltoallv(send.data(), send_counts.data(), send_displs.data(),
+                MPI_DOUBLE, points.data(), recv_counts.data(),
+                recv_displs.data(), MPI_DOUBLE, comm_cart);
+}
+
+/** Append the points within halo of the left (to_left = true) or right
+    domain boundary of this node in direction d to out. */
+static void select_halo_points(const std::vector<double> &points, int stride,
+                               int d, double halo, bool to_left,
+                               std::vector<double> &out) {
+  for (size_t i = 0; i < points.size(); i += stride) {
+    double dist = to_left ? points[i + d] - my_left[d]
+                          : my_right[d] - points[i + d];
+    if (dist <= halo)
+      out.insert(out.end(), &points[i], &points[i] + stride);
+  }
+}
+
+/** Send points to the left (to_left = true) or right neighbor in
+    direction d and receive the ones of the other neighbor. Points that
+    cross the box boundary are shifted to the periodic image, or dropped
+    if the direction is not periodic. Collective. */
+static std::vector<double> shift_points(std::vector<double> send, int stride,
+                                        int d, bool to_left) {
+  int left, right;
+  MPI_Cart_shift(comm_cart, d, 1, &left, &right);
+
+  if (to_left ? node_pos[d] == 0 : node_pos[d] == node_grid[d] - 1) {
+    if (PERIODIC(d)) {
+      for (size_t i = 0; i < send.size(); i += stride)
+        send[i + d] += to_left ? box_l[d] : -box_l[d];
+    } else
+      send.clear();
+  }
+
+  int to = to_left ? left : right, from = to_left ? right : left;
+  int n_send = send.size(), n_recv = 0;
+  MPI_Sendrecv(&n_send, 1, MPI_INT, to, 0, &n_recv, 1, MPI_INT, from, 0,
+               comm_cart, MPI_STATUS_IGNORE);
+  std::vector<double> recv(n_recv);
+  MPI_Sendrecv(send.data(), n_send, MPI_DOUBLE, to, 0, recv.data(), n_recv,
+               MPI_DOUBLE, from, 0, comm_cart, MPI_STATUS_IGNORE);
+  return recv;
+}
+
+void add_point_halo(std::vector<double> &points, int stride,
+                    const double halo[3]) {
+  for (int d = 0; d < 3; d++) {
+    std::vector<double> to_left, to_right;
+    select_halo_points(points, stride, d, halo[d], true, to_left);
+    select_halo_points(points, stride, d, halo[d], false, to_right);
+
+    int hops = std::ceil(halo[d] / local_box_l[d]);
+    for (int hop = 0; hop < hops; hop++) {
+      std::vector<double> from_right = shift_points(to_left, stride, d, true);
+      std::vector<double> from_left = shift_points(to_right, stride, d, false);
+      points.insert(points.end(), from_right.begin(), from_right.end());
+      points.insert(points.end(), from_left.begin(), from_left.end());
+
+      to_left.clear();
+      to_right.clear();
+      select_halo_points(from_right, stride, d, halo[d], true, to_left);
+      select_halo_points(from_left, stride, d, halo[d], false, to_right);
+    }
+  }
+}
+
+PointGrid::PointGrid(const std::vector<double> &points, int stride,
+                     const double halo[3], double r_max) {
+  int n = points.size() / stride;
+
+  /* cells of at least r_max over the domain and the halo, with not much
+     more cells than points */
+  for (int d = 0; d < 3; d++) {
+    m_lo[d] = my_left[d] - halo[d];
+    double extent = local_box_l[d] + 2.0 * halo[d];
+    m_n_cells[d] = std::max(1, (int)std::min(extent / r_max, 1e3));
+  }
+  while ((double)m_n_cells[0] * m_n_cells[1] * m_n_cells[2] > 2.0 * n + 27) {
+    int d = std::max_element(m_n_cells, m_n_cells + 3) - m_n_cells;
+    m_n_cells[d] = (m_n_cells[d] + 1) / 2;
+  }
+  for (int d = 0; d < 3; d++) {
+    m_cell_size[d] = (local_box_l[d] + 2.0 * halo[d]) / m_n_cells[d];
+    m_half_box[d] = PERIODIC(d) ? 0.5 * box_l[d] : HUGE_VAL;
+  }
+  m_r_max2 = r_max * r_max;
+
+  /* sort the points by cell, so that the points of a cell are contiguous */
+  std::vector<int> cell(n);
+  m_cell_start.assign(m_n_cells[0] * m_n_cells[1] * m_n_cells[2] + 1, 0);
+  for (int j = 0; j < n; j++) {
+    int c[3];
+    cell_of(&points[stride * j], c);
+    cell[j] = (c[2] * m_n_cells[1] + c[1]) * m_n_cells[0] + c[0];
+    m_cell_start[cell[j] + 1]++;
+  }
+  for (size_t c = 1; c < m_cell_start.size(); c++)
+    m_cell_start[c] += m_cell_start[c - 1];
+  std::vector<int> fill(m_cell_start.begin(), m_cell_start.end() - 1);
+  m_order.resize(n);
+  m_slot.resize(n);
+  for (int j = 0; j < n; j++) {
+    m_slot[j] = fill[cell[j]]++;
+    m_order[m_slot[j]] = j;
+  }
+  m_pos.resize(3 * n);
+  for (int k = 0; k < n; k++)
+    std::copy(&points[stride * m_order[k]], &points[stride * m_order[k]] + 3,
+              &m_pos[3 * k]);
+}
+
+void PointGrid::cell_of(const double *pos, int c[3]) const {
+  for (int d = 0; d < 3; d++) {
+    c[d] = std::floor((pos[d] - m_lo[d]) / m_cell_size[d]);
+    c[d] = std::min(std::max(c[d], 0), m_n_cells[d] - 1);
+  }
+}
@@ -0,0 +1,245 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _STATISTICS_PARALLEL_H
+#define _STATISTICS_PARALLEL_H
+/** \file statistics_parallel.hpp
+    Distributed analysis of the particle data.
+
+    An analysis is split into a map step, which every node runs on its
+    local particles, and a reduction of the partial results over all
+    nodes. In contrast to the analyses based on \ref partCfg, the
+    particles are never collected on the master, only the partial
+    results are communicated.
+
+    An analysis is defined once as an object with static storage
+    duration, so that it exists on all nodes:
+
+    \code
+    static void local_count(const std::vector<double> &params,
+                            std::vector<double> &result) {
+      result.assign(1, 0.0);
+      for_each_local_particle([&](const Particle &p) {
+        if (p.p.type == params[0])
+          result[0] += 1.0;
+      });
+    }
+    static ParallelAnalysis count_job(local_count, ANALYSIS_SUM);
+
+    double n = count_job({double(type)})[0];
+    \endcode
+*/
+
+#include "cells.hpp"
+#include "grid.hpp"
+#include "particle_data.hpp"
+#include <algorithm>
+#include <vector>
+
+/** How the partial results of the nodes are combined. */
+enum AnalysisReduction {
+  /** element-wise sum */
+  ANALYSIS_SUM,
+  /** element-wise minimum */
+  ANALYSIS_MIN,
+  /** element-wise maximum */
+  ANALYSIS_MAX,
+  /** the partial results one after the other, ordered by node */
+  ANALYSIS_CONCAT
+};
+
+/** Map step of a distributed analysis. Computes the partial result of
+    this node from its local particles. The map step may use collective
+    communication itself, e.g. \ref allgather_analysis_data.
+    \param params the parameters passed to the analysis on the master
+    \param result the partial result of this node
+*/
+typedef void (*AnalysisMap)(const std::vector<double> &params,
+                            std::vector<double> &result);
+
+/** A distributed analysis, see \ref statistics_parallel.hpp. */
+class ParallelAnalysis {
+public:
+  /** Define an analysis. The analyses are numbered in the order of their
+      construction, which therefore has to be the same on all nodes, so
+      only create them as objects with static storage duration. */
+  ParallelAnalysis(AnalysisMap map, AnalysisReduction reduction);
+
+  /** Run the analysis on all nodes. Call only on the master, outside of
+      the integration.
+      \return the reduced result
+  */
+  std::vector<double> operator()(const std::vector<double> &params) const;
+
+  /** Run the analysis on the nodes calling this simultaneously, e.g. from
+      the force calculation. All nodes have to pass the same parameters.
+      \return the reduced result. For \ref ANALYSIS_CONCAT, it is only
+      available on the master, otherwise on all nodes.
+  */
+  std::vector<double> collective(const std::vector<double> &params) const;
+
+  /** Like \ref collective, but the result is only reduced to the master,
+      which is all that the analyses started by the master need. On the
+      other nodes, the result has the right size, but no content. */
+  std::vector<double>
+  collective_to_master(const std::vector<double> &params) const;
+
+  /** The analysis with the given number. */
+  static const ParallelAnalysis &get(int id);
+
+private:
+  std::vector<double> run(const std::vector<double> &params,
+                          bool to_master) const;
+
+  AnalysisMap m_map;
+  AnalysisReduction m_reduction;
+  int m_id;
+};
+
+/** Call f for all particles stored on this node, not including ghosts. */
+template <typename F> void for_each_local_particle(F f) {
+  for (int c = 0; c < local_cells.n; c++) {
+    Cell *cell = local_cells.cell[c];
+    for (int i = 0; i < cell->n; i++)
+      f(cell->part[i]);
+  }
+}
+
+/** The unfolded position of a particle, as in \ref partCfg. */
+inline void get_unfolded_position(const Particle &p, double pos[3]) {
+  double v[3] = {p.m.v[0], p.m.v[1], p.m.v[2]};
+  int image[3] = {p.l.i[0], p.l.i[1], p.l.i[2]};
+  pos[0] = p.r.p[0];
+  pos[1] = p.r.p[1];
+  pos[2] = p.r.p[2];
+  unfold_position(pos, v, image);
+}
+
+/** Collect data from all nodes on all nodes. Collective.
+    \param local the data of this node
+    \param offset if not NULL, receives the position of the data of this
+                  node in the result
+    \return the data of all nodes, ordered by node
+*/
+std::vector<double> allgather_analysis_data(const std::vector<double> &local,
+                                            int *offset = NULL);
+
+/** \name Distributed points
+    Analyses of pairs of particles collect the data of their particles as
+    points, a fixed number of doubles per point of which the first three
+    are the folded position. The points are moved to the nodes whose
+    domains contain them, and every node adds the points within a given
+    distance of its domain as a halo, independent of the cell system and
+    its interaction range. */
+/*@{*/
+
+/** Move points to the nodes whose domains contain them. Collective.
+    \param points the points of this node, replaced by the ones in its
+                  domain
+    \param stride the number of doubles per point
+*/
+void distribute_points(std::vector<double> &points, int stride);
+
+/** Move points to the given nodes. Collective.
+    \param points the points of this node, replaced by the ones sent to it
+    \param stride the number of doubles per point
+    \param nodes  the node of every point
+*/
+void distribute_points(std::vector<double> &points, int stride,
+                       const std::vector<int> &nodes);
+
+/** Append the points within halo[d] of the domain of this node in
+    direction d, including periodic images. The points are passed on one
+    direction after the other, so that the halos of the edges and corners
+    are filled, and over several nodes if the halo is wider than the
+    domain. Collective.
+    \param points the points in the domain of this node, the halo is
+                  appended
+    \param stride the number of doubles per point
+    \param halo the width of the halo in each direction
+*/
+void add_point_halo(std::vector<double> &points, int stride,
+                    const double halo[3]);
+
+/** A cell grid over the domain of this node and its halo, with cells of
+    at least the maximal pair distance, to find the pairs of points. */
+class PointGrid {
+public:
+  /** Sort the points into the grid.
+      \param points the points in the domain of this node followed by the
+                    halo, see \ref add_point_halo
+      \param stride the number of doubles per point
+      \param halo the width of the halo
+      \param r_max the maximal distance of the pairs
+  */
+  PointGrid(const std::vector<double> &points, int stride,
+            const double halo[3], double r_max);
+
+  /** Call f(i, j, dx, dist2) for all pairs of one of the first n_local
+      points i and another point j with a distance below r_max. dx is the
+      vector from i to j and dist2 its square. Only the pairs of the
+      minimum image count, as in \ref get_mi_vector. The pairs of two of
+      the first n_local points are passed twice, as (i, j) and (j, i). */
+  template <typename F> void for_each_pair(int n_local, F f) const {
+    for (int i = 0; i < n_local; i++) {
+      const double *pi = &m_pos[3 * m_slot[i]];
+      int c[3];
+      cell_of(pi, c);
+      for (int z = std::max(c[2] - 1, 0);
+           z <= std::min(c[2] + 1, m_n_cells[2] - 1); z++)
+        for (int y = std::max(c[1] - 1, 0);
+             y <= std::min(c[1] + 1, m_n_cells[1] - 1); y++) {
+          /* the neighbor cells in x are contiguous */
+          int row = (z * m_n_cells[1] + y) * m_n_cells[0];
+          int first = m_cell_start[row + std::max(c[0] - 1, 0)];
+          int last =
+              m_cell_start[row + std::min(c[0] + 1, m_n_cells[0] - 1) + 1];
+          for (int k = first; k < last; k++) {
+            const double *pj = &m_pos[3 * k];
+            double dx[3] = {pj[0] - pi[0], pj[1] - pi[1], pj[2] - pi[2]};
+            double dist2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+            if (dist2 >= m_r_max2 || m_order[k] == i)
+              continue;
+            bool min_image = true;
+            for (int d = 0; d < 3; d++)
+              if (dx[d] <= -m_half_box[d] || dx[d] > m_half_box[d])
+                min_image = false;
+            if (min_image)
+              f(i, m_order[k], dx, dist2);
+          }
+        }
+    }
+  }
+
+private:
+  void cell_of(const double *pos, int c[3]) const;
+
+  /** the positions of the points, sorted by cell */
+  std::vector<double> m_pos;
+  /** the point at each sorted position and the sorted position of each
+      point */
+  std::vector<int> m_order, m_slot;
+  /** the first sorted position of every cell, and the end */
+  std::vector<int> m_cell_start;
+  double m_lo[3], m_cell_size[3], m_half_box[3], m_r_max2;
+  int m_n_cells[3];
+};
+
+/*@}*/
+
+#endif
@@ -0,0 +1,358 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file statistics_profiles.cpp
+    Implementation of \ref statistics_profiles.hpp "statistics_profiles.hpp".
+
+    The profiles and their parameters are the same on all nodes, only the
+    histograms differ. All nodes sample the profiles in the order of
+    their identities, which the diffusion profile relies on for its
+    collective exchange.
+*/
+#include "statistics_profiles.hpp"
+#include "errorhandling.hpp"
+#include "grid.hpp"
+#include "integrate.hpp"
+#include "statistics_parallel.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <map>
+
+namespace {
+
+struct Profile {
+  ProfileParams params;
+  /** the histogram of this node, \ref profile_values_per_bin per bin */
+  std::vector<double> bins;
+  /** the integration steps and the samples since the last reset */
+  int steps, n_samples;
+  /** diffusion: the sorted identities of the particles in the window at
+      the last samples, the oldest first */
+  std::deque<std::vector<int>> started;
+};
+
+enum ProfileOperation { PROFILE_OP_ADD, PROFILE_OP_REMOVE, PROFILE_OP_RESET };
+
+}
+
+static std::map<int, Profile> profiles;
+/** the identity of the next profile, only used on the master */
+static int next_profile_id = 0;
+
+static int n_bins(const ProfileParams &params) {
+  return params.kind == PROFILE_CYLINDRICAL ? params.bins[0] * params.bins[1]
+                                            : params.bins[0];
+}
+
+/** The number of groups of types of the cylindrical profile. */
+static int n_groups(const ProfileParams &params) {
+  return params.types.empty() ? 1 : params.types.size();
+}
+
+int profile_values_per_bin(const ProfileParams &params) {
+  switch (params.kind) {
+  case PROFILE_DENSITY:
+    return 4;
+  case PROFILE_CYLINDRICAL:
+    return 3 * n_groups(params);
+  default:
+    return 1;
+  }
+}
+
+double profile_ring_volume(const ProfileParams &params, int radial_bin) {
+  double w = params.radius / params.bins[1];
+  return M_PI * (2 * radial_bin + 1) * w * w * params.length / params.bins[0];
+}
+
+/** The group of a particle type, or -1 if the type is not sampled. */
+static int type_group(const ProfileParams &params, int type) {
+  if (params.types.empty())
+    return 0;
+  auto it = std::find(params.types.begin(), params.types.end(), type);
+  return it == params.types.end() ? -1 : it - params.types.begin();
+}
+
+/** A coordinate of a particle, folded in the periodic directions. */
+static double folded_coordinate(const Particle &p, int d) {
+  double x = p.r.p[d];
+  return PERIODIC(d) ? x - std::floor(x * box_l_i[d]) * box_l[d] : x;
+}
+
+/** The bin of a particle along a direction of the box, or -1. */
+static int slab_of(const Particle &p, int dir, int bins) {
+  int b = std::floor(folded_coordinate(p, dir) * box_l_i[dir] * bins);
+  return b >= 0 && b < bins ? b : -1;
+}
+
+static void sample_density(Profile &prof) {
+  const ProfileParams &par = prof.params;
+  for_each_local_particle([&](const Particle &p) {
+    int b = slab_of(p, par.dir, par.bins[0]);
+    if (b < 0 || type_group(par, p.p.type) < 0)
+      return;
+    double *bin = &prof.bins[4 * b];
+    bin[0] += 1.0;
+    for (int d = 0; d < 3; d++)
+      bin[1 + d] += p.m.v[d] / time_step;
+  });
+}
+
+static void sample_cylindrical(Profile &prof) {
+  const ProfileParams &par = prof.params;
+  int groups = n_groups(par);
+  double axial_scale = par.bins[0] / par.length,
+         radial_scale = par.bins[1] / par.radius;
+  for_each_local_particle([&](const Particle &p) {
+    int g = type_group(par, p.p.type);
+    if (g < 0)
+      return;
+    double rel[3], axial = 0.0, radial = 0.0;
+    for (int d = 0; d < 3; d++) {
+      rel[d] = folded_coordinate(p, d) - par.center[d];
+      axial += rel[d] * par.axis[d];
+    }
+    for (int d = 0; d < 3; d++) {
+      rel[d] -= axial * par.axis[d];
+      radial += rel[d] * rel[d];
+    }
+    radial = std::sqrt(radial);
+    int a = std::floor((axial + 0.5 * par.length) * axial_scale),
+        r = std::floor(radial * radial_scale);
+    if (a < 0 || a >= par.bins[0] || r >= par.bins[1])
+      return;
+    double v_radial = 0.0, v_axial = 0.0;
+    for (int d = 0; d < 3; d++) {
+      if (radial > 0.0)
+        v_radial += p.m.v[d] * rel[d] / radial;
+      v_axial += p.m.v[d] * par.axis[d];
+    }
+    double *bin = &prof.bins[3 * ((r * par.bins[0] + a) * groups + g)];
+    bin[0] += 1.0;
+    bin[1] += v_radial / time_step;
+    bin[2] += v_axial / time_step;
+  });
+}
+
+/** \return whether a sample was taken, that is, whether the window was
+    sampled lag samples before */
+static bool sample_diffusion(Profile &prof) {
+  const ProfileParams &par = prof.params;
+  std::vector<double> local;
+  for_each_local_particle([&](const Particle &p) {
+    double x = folded_coordinate(p, par.dir);
+    if (x > par.xmin && x < par.xmax && type_group(par, p.p.type) >= 0)
+      local.push_back(p.p.identity);
+  });
+  std::vector<double> all = allgather_analysis_data(local);
+  prof.started.emplace_back(all.begin(), all.end());
+  std::sort(prof.started.back().begin(), prof.started.back().end());
+  if ((int)prof.started.size() <= par.lag)
+    return false;
+
+  const std::vector<int> &start = prof.started.front();
+  for_each_local_particle([&](const Particle &p) {
+    int b = slab_of(p, par.dir, par.bins[0]);
+    if (b >= 0 && std::binary_search(start.begin(), start.end(), p.p.identity))
+      prof.bins[b] += 1.0;
+  });
+  prof.started.pop_front();
+  return true;
+}
+
+void profiles_end_step() {
+  for (auto &entry : profiles) {
+    Profile &prof = entry.second;
+    if (++prof.steps % prof.params.every != 0)
+      continue;
+    switch (prof.params.kind) {
+    case PROFILE_DENSITY:
+      sample_density(prof);
+      break;
+    case PROFILE_CYLINDRICAL:
+      sample_cylindrical(prof);
+      break;
+    case PROFILE_DIFFUSION:
+      if (!sample_diffusion(prof))
+        continue;
+    }
+    prof.n_samples++;
+  }
+}
+
+/************************************************************/
+
+static void pack_params(const ProfileParams &par, std::vector<double> &v) {
+  v.insert(v.end(), {double(par.kind), double(par.every), double(par.bins[0]),
+                     double(par.bins[1]), double(par.dir)});
+  v.insert(v.end(), par.center, par.center + 3);
+  v.insert(v.end(), par.axis, par.axis + 3);
+  v.insert(v.end(), {par.length, par.radius, par.xmin, par.xmax,
+                     double(par.lag), double(par.types.size())});
+  v.insert(v.end(), par.types.begin(), par.types.end());
+}
+
+static ProfileParams unpack_params(const double *v) {
+  ProfileParams par;
+  par.kind = ProfileKind(int(v[0]));
+  par.every = v[1];
+  par.bins[0] = v[2];
+  par.bins[1] = v[3];
+  par.dir = v[4];
+  std::copy(v + 5, v + 8, par.center);
+  std::copy(v + 8, v + 11, par.axis);
+  par.length = v[11];
+  par.radius = v[12];
+  par.xmin = v[13];
+  par.xmax = v[14];
+  par.lag = v[15];
+  par.types.assign(v + 17, v + 17 + int(v[16]));
+  return par;
+}
+
+static void reset(Profile &prof) {
+  prof.bins.assign(n_bins(prof.params) * profile_values_per_bin(prof.params),
+                   0.0);
+  prof.steps = prof.n_samples = 0;
+  prof.started.clear();
+}
+
+/* the parameters are the operation, the profile and for adding the
+   packed parameters of the profile */
+static void local_operation(const std::vector<double> &params,
+                            std::vector<double> &) {
+  int id = params[1];
+  switch (int(params[0])) {
+  case PROFILE_OP_ADD:
+    profiles[id].params = unpack_params(&params[2]);
+    reset(profiles[id]);
+    break;
+  case PROFILE_OP_REMOVE:
+    profiles.erase(id);
+    break;
+  case PROFILE_OP_RESET:
+    reset(profiles[id]);
+  }
+}
+
+static ParallelAnalysis operation_job(local_operation, ANALYSIS_SUM);
+
+/* the histogram of this node, followed by the number of samples on the
+   master */
+static void local_histogram(const std::vector<double> &params,
+                            std::vector<double> &result) {
+  const Profile &prof = profiles[int(params[0])];
+  result = prof.bins;
+  result.push_back(this_node == 0 ? prof.n_samples : 0);
+}
+
+static ParallelAnalysis histogram_job(local_histogram, ANALYSIS_SUM);
+
+int profile_add(const ProfileParams &params) {
+  ProfileParams par = params;
+  bool valid = par.every >= 1 && par.bins[0] >= 1;
+  if (par.kind == PROFILE_CYLINDRICAL) {
+    double norm = std::sqrt(par.axis[0] * par.axis[0] +
+                            par.axis[1] * par.axis[1] +
+                            par.axis[2] * par.axis[2]);
+    valid = valid && par.bins[1] >= 1 && par.length > 0.0 &&
+            par.radius > 0.0 && norm > 0.0;
+    for (int d = 0; valid && d < 3; d++)
+      par.axis[d] /= norm;
+  } else {
+    valid = valid && par.dir >= 0 && par.dir < 3;
+    if (par.kind == PROFILE_DIFFUSION)
+      valid = valid && par.lag >= 0 && par.xmin < par.xmax;
+  }
+  if (!valid) {
+    runtimeErrorMsg() << "profile: invalid parameters, the bins, the sampling interval and the extents have to be positive";
+    return -1;
+  }
+  int id = next_profile_id++;
+  std::vector<double> job_params = {double(PROFILE_OP_ADD), double(id)};
+  pack_params(par, job_params);
+  operation_job(job_params);
+  return id;
+}
+
+static int check_profile(int id) {
+  if (profiles.find(id) == profiles.end()) {
+    runtimeErrorMsg() << "profile: there is no profile " << id;
+    return ES_ERROR;
+  }
+  return ES_OK;
+}
+
+int profile_remove(int id) {
+  if (check_profile(id) != ES_OK)
+    return ES_ERROR;
+  operation_job({double(PROFILE_OP_REMOVE), double(id)});
+  return ES_OK;
+}
+
+int profile_reset(int id) {
+  if (check_profile(id) != ES_OK)
+    return ES_ERROR;
+  operation_job({double(PROFILE_OP_RESET), double(id)});
+  return ES_OK;
+}
+
+const ProfileParams *profile_params(int id) {
+  auto it = profiles.find(id);
+  return it == profiles.end() ? NULL : &it->second.params;
+}
+
+int profile_get(int id, std::vector<double> &values, int *n_samples) {
+  if (check_profile(id) != ES_OK)
+    return ES_ERROR;
+  const ProfileParams &par = profiles[id].params;
+  values = histogram_job({double(id)});
+  *n_samples = values.back();
+  values.pop_back();
+  double n = std::max(*n_samples, 1);
+
+  switch (par.kind) {
+  case PROFILE_DENSITY: {
+    double volume = box_l[0] * box_l[1] * box_l[2] / par.bins[0];
+    for (double &v : values)
+      v /= volume * n;
+    break;
+  }
+  case PROFILE_CYLINDRICAL: {
+    int groups = n_groups(par);
+    for (int r = 0; r < par.bins[1]; r++) {
+      double volume = profile_ring_volume(par, r);
+      for (int k = 0; k < par.bins[0] * groups; k++) {
+        double *bin = &values[3 * (r * par.bins[0] * groups + k)];
+        if (bin[0] > 0.0) {
+          bin[1] /= bin[0];
+          bin[2] /= bin[0];
+        }
+        bin[0] /= volume * n;
+      }
+    }
+    break;
+  }
+  case PROFILE_DIFFUSION:
+    for (double &v : values)
+      v /= n;
+  }
+  return ES_OK;
+}
@@ -0,0 +1,107 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _STATISTICS_PROFILES_H
+#define _STATISTICS_PROFILES_H
+/** \file statistics_profiles.hpp
+    Profiles accumulated during the integration.
+
+    A profile is registered once and then sampled by the integrator every
+    few steps, with every node binning its local particles into its own
+    histogram. The histograms are only reduced when the profile is read,
+    so that sampling costs no communication, except for the diffusion
+    profile, which shares the identities of the particles in its window.
+    The profiles correspond to the analyses of single configurations
+    \ref density_profile_av, \ref calc_cylindrical_average, \ref
+    calc_radial_density_map and \ref calc_diffusion_profile.
+*/
+
+#include <vector>
+
+enum ProfileKind {
+  /** number density and flux density in slabs along a direction */
+  PROFILE_DENSITY,
+  /** number density and the mean radial and axial velocities in rings
+      around an axis */
+  PROFILE_CYLINDRICAL,
+  /** positions along a direction of the particles that were inside a
+      window lag samples before */
+  PROFILE_DIFFUSION
+};
+
+/** The parameters of a profile. */
+struct ProfileParams {
+  ProfileKind kind;
+  /** the particle types to sample, all if empty. The cylindrical profile
+      is resolved by type. */
+  std::vector<int> types;
+  /** sample every that many integration steps */
+  int every;
+  /** the number of bins, along dir, or the axial and radial bins */
+  int bins[2];
+  /** density and diffusion: the direction */
+  int dir;
+  /** cylindrical: the centre and the axis of the cylinder, its length
+      along the axis and its radius */
+  double center[3], axis[3], length, radius;
+  /** diffusion: the window along dir and the lag in samples */
+  double xmin, xmax;
+  int lag;
+};
+
+/** Called by the integrator on all nodes after the velocity update of a
+    step. Samples the profiles that are due. */
+void profiles_end_step();
+
+/** Register a profile. Call only on the master.
+    \return the identity of the profile, or -1 with a runtime error for
+            invalid parameters */
+int profile_add(const ProfileParams &params);
+
+/** Remove a profile. Call only on the master.
+    \return ES_OK, or ES_ERROR if there is no such profile */
+int profile_remove(int id);
+
+/** Discard the samples of a profile. Call only on the master.
+    \return ES_OK, or ES_ERROR if there is no such profile */
+int profile_reset(int id);
+
+/** The parameters of a profile, or NULL if there is no such profile. */
+const ProfileParams *profile_params(int id);
+
+/** The number of values per bin of a profile, see \ref profile_get. */
+int profile_values_per_bin(const ProfileParams &params);
+
+/** The profile averaged over the samples. Call only on the master.
+    @param id        the profile
+    @param values    per bin along dir, the density and the three
+                     components of the flux density for \ref
+                     PROFILE_DENSITY, the mean number of particles for
+                     \ref PROFILE_DIFFUSION, and for \ref
+                     PROFILE_CYLINDRICAL per radial bin and axial bin the
+                     density, mean radial and mean axial velocity of each
+                     type
+    @param n_samples the number of samples
+    @return ES_OK, or ES_ERROR if there is no such profile
+*/
+int profile_get(int id, std::vector<double> &values, int *n_samples);
+
+/** The volume of a bin of the cylindrical profile. */
+double profile_ring_volume(const ProfileParams &params, int radial_bin);
+
+#endif
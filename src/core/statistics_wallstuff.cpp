@@ -75,8 +75,8 @@ void calc_wallmsdyz(double *g, int bin)
     for (int i = 0; i < wallstuff_part_in_bin[bin].n; ++i) {
       int p = wallstuff_part_in_bin[bin].e[i];
       g[k] +=
-	+ SQR(configs[n_configs-1][3*p + 1]-configs[n_configs-1-k][3*p + 1])
-	+ SQR(configs[n_configs-1][3*p + 2]-configs[n_configs-1-k][3*p + 2]);
+	+ SQR(get_config(n_configs-1)[3*p + 1]-get_config(n_configs-1-k)[3*p + 1])
+	+ SQR(get_config(n_configs-1)[3*p + 2]-get_config(n_configs-1-k)[3*p + 2]);
     }
     // normalize
     g[k] /= wallstuff_part_in_bin[bin].n;
@@ -91,7 +91,7 @@ void calc_wallmsdx(double *g, int bin)
     g[k] = 0.0;
     for (int i = 0; i < wallstuff_part_in_bin[bin].n; ++i) {
       int p = wallstuff_part_in_bin[bin].e[i];
-      g[k] += SQR(configs[n_configs-1][3*p]-configs[n_configs-1-k][3*p]);
+      g[k] += SQR(get_config(n_configs-1)[3*p]-get_config(n_configs-1-k)[3*p]);
     }
     g[k] /= wallstuff_part_in_bin[bin].n;
   }
@@ -0,0 +1,665 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file system_state.cpp
+    Implementation of \ref system_state.hpp "system_state.hpp".
+
+    Layout of the blob: the header (magic, version, feature sections and
+    structure sizes), the global parameters by name, the remaining
+    integrator and thermostat state, the non-bonded interactions with
+    the tabulated tables, the bonded interactions with their tables, the
+    constraints, the electrostatics and magnetostatics parameters and the
+    lattice Boltzmann parameters. Counts are stored as int in front of
+    the data.
+*/
+#include "system_state.hpp"
+#include "actor/EwaldGPU.hpp"
+#include "communication.hpp"
+#include "constraint.hpp"
+#include "debye_hueckel.hpp"
+#include "elc.hpp"
+#include "errorhandling.hpp"
+#include "global.hpp"
+#include "initialize.hpp"
+#include "integrate.hpp"
+#include "interaction_data.hpp"
+#include "lb.hpp"
+#include "maggs.hpp"
+#include "mdlc_correction.hpp"
+#include "mmm1d.hpp"
+#include "mmm2d.hpp"
+#include "npt.hpp"
+#include "p3m-dipolar.hpp"
+#include "p3m.hpp"
+#include "reaction_field.hpp"
+#include "thermostat.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace {
+
+/** Global parameters that are part of the state. The node and cell
+    grids and the derived quantities are set up by the new run itself. */
+const int state_fields[] = {
+    FIELD_BOXL,          FIELD_PERIODIC,       FIELD_SKIN,
+    FIELD_MIN_GLOBAL_CUT, FIELD_TIMESTEP,      FIELD_SMALLERTIMESTEP,
+    FIELD_SIMTIME,       FIELD_INTEG_SWITCH,   FIELD_LATTICE_SWITCH,
+    FIELD_TEMPERATURE,   FIELD_THERMO_SWITCH,  FIELD_LANGEVIN_GAMMA,
+    FIELD_LANGEVIN_GAMMA_ROTATION,             FIELD_NPTISO_G0,
+    FIELD_NPTISO_GV,     FIELD_LEES_EDWARDS_OFFSET,
+    FIELD_DPD_GAMMA,     FIELD_DPD_RCUT,       FIELD_DPD_TGAMMA,
+    FIELD_DPD_TRCUT,     FIELD_DPD_WF,         FIELD_DPD_TWF,
+    FIELD_DPD_IGNORE_FIXED_PARTICLES,          FIELD_GHMC_NMD,
+    FIELD_GHMC_PHI,      FIELD_GHMC_RES,       FIELD_GHMC_FLIP,
+    FIELD_GHMC_SCALE};
+
+const char state_magic[8] = {'E', 'S', 'P', 'S', 'T', 'A', 'T', 'E'};
+const int state_version = 1;
+
+/** The optional sections of the blob, which depend on the features. */
+enum StateSection {
+  STATE_TABULATED = 1,
+  STATE_OVERLAPPED = 2,
+  STATE_CONSTRAINTS = 4,
+  STATE_COULOMB = 8,
+  STATE_LB = 16
+};
+
+int state_sections() {
+  int sections = 0;
+#ifdef TABULATED
+  sections |= STATE_TABULATED;
+#endif
+#ifdef OVERLAPPED
+  sections |= STATE_OVERLAPPED;
+#endif
+#ifdef CONSTRAINTS
+  sections |= STATE_CONSTRAINTS;
+#endif
+#if defined(ELECTROSTATICS) || defined(DIPOLES)
+  sections |= STATE_COULOMB;
+#endif
+#ifdef LB
+  sections |= STATE_LB;
+#endif
+  return sections;
+}
+
+/** Sizes of the structures stored as memory images. */
+std::vector<int> state_layout() {
+  std::vector<int> layout = {int(sizeof(int)), int(sizeof(double)),
+                             int(sizeof(IA_parameters)),
+                             int(sizeof(Bonded_ia_parameters)),
+                             int(sizeof(nptiso_struct))};
+#ifdef CONSTRAINTS
+  layout.push_back(sizeof(Constraint));
+#endif
+#if defined(ELECTROSTATICS) || defined(DIPOLES)
+  layout.push_back(sizeof(Coulomb_parameters));
+#endif
+#ifdef LB
+  layout.push_back(sizeof(LB_Parameters));
+#endif
+  return layout;
+}
+
+/** Number of values of a global parameter. */
+int field_length(const Datafield &d) {
+  return (d.type == TYPE_BOOL) ? 1 : d.dimension;
+}
+
+/** Size in bytes of a global parameter. */
+size_t field_size(const Datafield &d) {
+  return field_length(d) *
+         ((d.type == TYPE_DOUBLE) ? sizeof(double) : sizeof(int));
+}
+
+#if defined(ELECTROSTATICS) || defined(DIPOLES)
+typedef std::vector<std::pair<void *, size_t>> MethodData;
+
+/** The parameter structures of the long range methods selected in c,
+    the same as broadcast by \ref mpi_bcast_coulomb_params.
+    \return false if the parameters of a method cannot be stored
+*/
+bool coulomb_method_data(const Coulomb_parameters &c, MethodData &data) {
+  data.clear();
+#ifdef ELECTROSTATICS
+  switch (c.method) {
+  case COULOMB_NONE:
+    break;
+#ifdef P3M
+  case COULOMB_ELC_P3M:
+    data.push_back({&elc_params, sizeof(ELC_struct)});
+  // fall through
+  case COULOMB_P3M_GPU:
+  case COULOMB_P3M:
+    data.push_back({&p3m.params, sizeof(p3m_parameter_struct)});
+    break;
+#endif
+  case COULOMB_DH:
+    data.push_back({&dh_params, sizeof(Debye_hueckel_params)});
+    break;
+  case COULOMB_MMM1D:
+  case COULOMB_MMM1D_GPU:
+    data.push_back({&mmm1d_params, sizeof(MMM1D_struct)});
+    break;
+  case COULOMB_MMM2D:
+    data.push_back({&mmm2d_params, sizeof(MMM2D_struct)});
+    break;
+  case COULOMB_MAGGS:
+    data.push_back({&maggs, sizeof(MAGGS_struct)});
+    break;
+#ifdef EWALD_GPU
+  case COULOMB_EWALD_GPU:
+    data.push_back({&ewaldgpu_params, sizeof(Ewaldgpu_params)});
+    break;
+#endif
+  case COULOMB_RF:
+  case COULOMB_INTER_RF:
+    data.push_back({&rf_params, sizeof(Reaction_field_params)});
+    break;
+  default:
+    /* ScaFaCoS and electrokinetics keep their own parameters */
+    return false;
+  }
+#endif
+
+#ifdef DIPOLES
+  switch (c.Dmethod) {
+  case DIPOLAR_NONE:
+    break;
+#ifdef DP3M
+  case DIPOLAR_MDLC_P3M:
+    data.push_back({&dlc_params, sizeof(DLC_struct)});
+  // fall through
+  case DIPOLAR_P3M:
+    data.push_back({&dp3m.params, sizeof(p3m_parameter_struct)});
+    break;
+#endif
+  case DIPOLAR_ALL_WITH_ALL_AND_NO_REPLICA:
+  case DIPOLAR_MDLC_DS:
+  case DIPOLAR_DS:
+  case DIPOLAR_DS_GPU:
+    break;
+  default:
+    return false;
+  }
+#endif
+  return true;
+}
+#endif
+
+/** Appends raw data to a blob. */
+class StateWriter {
+public:
+  explicit StateWriter(std::vector<char> &blob) : m_blob(blob) {}
+
+  void put(const void *data, size_t size) {
+    const char *c = static_cast<const char *>(data);
+    m_blob.insert(m_blob.end(), c, c + size);
+  }
+  template <typename T> void put(const T &value) { put(&value, sizeof(T)); }
+  void put_string(const char *s) {
+    int len = s ? strlen(s) : 0;
+    put(len);
+    put(s, len);
+  }
+
+private:
+  std::vector<char> &m_blob;
+};
+
+/** Reads raw data from a blob with bounds checking. After the first
+    failed read, all further reads fail as well. */
+class StateReader {
+public:
+  explicit StateReader(const std::vector<char> &blob)
+      : m_pos(blob.data()), m_end(blob.data() + blob.size()), m_ok(true) {}
+
+  bool get(void *data, size_t size) {
+    if (!m_ok || size > remaining())
+      return m_ok = false;
+    memcpy(data, m_pos, size);
+    m_pos += size;
+    return true;
+  }
+  template <typename T> bool get(T &value) { return get(&value, sizeof(T)); }
+  /** Read n values, which have to be present in the blob. */
+  template <typename T> bool get_array(std::vector<T> &v, int n) {
+    if (!m_ok || n < 0 || n * sizeof(T) > remaining())
+      return m_ok = false;
+    v.resize(n);
+    return get(v.data(), n * sizeof(T));
+  }
+  bool get_string(std::string &s) {
+    std::vector<char> c;
+    int len;
+    if (!get(len) || !get_array(c, len))
+      return false;
+    s.assign(c.begin(), c.end());
+    return true;
+  }
+
+  bool ok() const { return m_ok; }
+  bool at_end() const { return m_pos == m_end; }
+
+private:
+  size_t remaining() const { return m_end - m_pos; }
+
+  const char *m_pos, *m_end;
+  bool m_ok;
+};
+
+/** The unpacked content of a blob, before it replaces the state. */
+struct SystemState {
+  std::vector<std::pair<int, std::vector<char>>> fields;
+  int skin_set, langevin_trans, langevin_rotate;
+  nptiso_struct nptiso;
+  int n_particle_types;
+  std::vector<IA_parameters> ia_params;
+  std::vector<double> tabulated_forces, tabulated_energies;
+  std::vector<Bonded_ia_parameters> bonds;
+  /** file names and concatenated tables of the tabulated and overlapped
+      bonds */
+  std::vector<std::string> bond_files;
+  std::vector<std::vector<double>> bond_tables;
+#ifdef CONSTRAINTS
+  std::vector<Constraint> constraints;
+#endif
+#if defined(ELECTROSTATICS) || defined(DIPOLES)
+  Coulomb_parameters coulomb;
+  std::vector<std::vector<char>> coulomb_data;
+#endif
+#ifdef LB
+  LB_Parameters lbpar;
+#endif
+};
+
+bool parse_header(StateReader &in) {
+  char magic[sizeof(state_magic)];
+  int version, sections;
+  std::vector<int> layout;
+  int n;
+  if (!in.get(magic) || memcmp(magic, state_magic, sizeof(magic))) {
+    runtimeErrorMsg() << "system state: not a system state file";
+    return false;
+  }
+  if (!in.get(version) || version != state_version || !in.get(sections) ||
+      !in.get(n) || !in.get_array(layout, n)) {
+    runtimeErrorMsg() << "system state: unsupported version";
+    return false;
+  }
+  if (sections != state_sections() || layout != state_layout()) {
+    runtimeErrorMsg() << "system state: written by a build with different "
+                         "features or on a different architecture";
+    return false;
+  }
+  return true;
+}
+
+bool parse_fields(StateReader &in, SystemState &s) {
+  int n, type, dim;
+  std::string name;
+  if (!in.get(n))
+    return false;
+  s.fields.resize(n < 0 ? 0 : n);
+  for (auto &f : s.fields) {
+    if (!in.get_string(name) || !in.get(type) || !in.get(dim))
+      return false;
+    int j;
+    for (j = 0; fields[j].name; ++j)
+      if (name == fields[j].name)
+        break;
+    if (!fields[j].name || fields[j].type != type ||
+        fields[j].dimension != dim) {
+      runtimeErrorMsg() << "system state: unknown global parameter " << name;
+      return false;
+    }
+    f.first = j;
+    if (!in.get_array(f.second, field_size(fields[j])))
+      return false;
+  }
+  return true;
+}
+
+bool parse_bonds(StateReader &in, SystemState &s) {
+  int n;
+  if (!in.get(n) || n < 0)
+    return false;
+  s.bonds.resize(n);
+  s.bond_files.resize(n);
+  s.bond_tables.resize(n);
+  for (int i = 0; i < n; i++) {
+    Bonded_ia_parameters &b = s.bonds[i];
+    if (!in.get(b))
+      return false;
+#ifdef TABULATED
+    if (b.type == BONDED_IA_TABULATED &&
+        (!in.get_string(s.bond_files[i]) ||
+         !in.get_array(s.bond_tables[i], 2 * b.p.tab.npoints)))
+      return false;
+#endif
+#ifdef OVERLAPPED
+    if (b.type == BONDED_IA_OVERLAPPED &&
+        (!in.get_string(s.bond_files[i]) ||
+         !in.get_array(s.bond_tables[i], 3 * b.p.overlap.noverlaps)))
+      return false;
+#endif
+  }
+  return true;
+}
+
+bool parse(const std::vector<char> &blob, SystemState &s) {
+  StateReader in(blob);
+  int n;
+
+  if (!parse_header(in))
+    return false;
+
+  if (!parse_fields(in, s) || !in.get(s.skin_set) ||
+      !in.get(s.langevin_trans) || !in.get(s.langevin_rotate) ||
+      !in.get(s.nptiso))
+    return false;
+
+  if (!in.get(s.n_particle_types) || s.n_particle_types < 0 ||
+      !in.get_array(s.ia_params, s.n_particle_types * s.n_particle_types))
+    return false;
+#ifdef TABULATED
+  if (!in.get(n) || !in.get_array(s.tabulated_forces, n) || !in.get(n) ||
+      !in.get_array(s.tabulated_energies, n))
+    return false;
+#endif
+
+  if (!parse_bonds(in, s))
+    return false;
+
+#ifdef CONSTRAINTS
+  if (!in.get(n) || !in.get_array(s.constraints, n))
+    return false;
+#endif
+
+#if defined(ELECTROSTATICS) || defined(DIPOLES)
+  MethodData data;
+  if (!in.get(s.coulomb))
+    return false;
+  if (!coulomb_method_data(s.coulomb, data)) {
+    runtimeErrorMsg() << "system state: unsupported electrostatics method";
+    return false;
+  }
+  s.coulomb_data.resize(data.size());
+  for (size_t i = 0; i < data.size(); i++)
+    if (!in.get_array(s.coulomb_data[i], data[i].second))
+      return false;
+#endif
+
+#ifdef LB
+  if (!in.get(s.lbpar))
+    return false;
+#endif
+
+  return in.ok() && in.at_end();
+}
+
+/** Copy n doubles into newly allocated memory. */
+double *copy_table(const double *src, int n) {
+  double *dst = (double *)Utils::malloc(n * sizeof(double));
+  memcpy(dst, src, n * sizeof(double));
+  return dst;
+}
+
+/** Replace the state of this node by s, without reinitialization. */
+void apply(SystemState &s) {
+  for (auto const &f : s.fields)
+    memcpy(fields[f.first].data, f.second.data(), f.second.size());
+  skin_set = s.skin_set;
+  langevin_trans = s.langevin_trans;
+  langevin_rotate = s.langevin_rotate;
+  nptiso = s.nptiso;
+
+  /* types beyond the stored ones may be in use by particles, so they
+     are kept */
+  realloc_ia_params(s.n_particle_types);
+  for (int i = 0; i < s.n_particle_types; i++)
+    for (int j = 0; j < s.n_particle_types; j++)
+      copy_ia_params(get_ia_param(i, j),
+                     &s.ia_params[i * s.n_particle_types + j]);
+#ifdef TABULATED
+  realloc_doublelist(&tabulated_forces, s.tabulated_forces.size());
+  realloc_doublelist(&tabulated_energies, s.tabulated_energies.size());
+  std::copy(s.tabulated_forces.begin(), s.tabulated_forces.end(),
+            tabulated_forces.e);
+  std::copy(s.tabulated_energies.begin(), s.tabulated_energies.end(),
+            tabulated_energies.e);
+#endif
+
+  for (int i = 0; i < (int)s.bonds.size(); i++) {
+    /* releases the tables of a previous bond of this type */
+    make_bond_type_exist(i);
+    Bonded_ia_parameters &b = bonded_ia_params[i];
+    b = s.bonds[i];
+#ifdef TABULATED
+    if (b.type == BONDED_IA_TABULATED) {
+      const double *table = s.bond_tables[i].data();
+      int n = b.p.tab.npoints;
+      b.p.tab.filename = strdup(s.bond_files[i].c_str());
+      b.p.tab.f = copy_table(table, n);
+      b.p.tab.e = copy_table(table + n, n);
+    }
+#endif
+#ifdef OVERLAPPED
+    if (b.type == BONDED_IA_OVERLAPPED) {
+      const double *table = s.bond_tables[i].data();
+      int n = b.p.overlap.noverlaps;
+      b.p.overlap.filename = strdup(s.bond_files[i].c_str());
+      b.p.overlap.para_a = copy_table(table, n);
+      b.p.overlap.para_b = copy_table(table + n, n);
+      b.p.overlap.para_c = copy_table(table + 2 * n, n);
+    }
+#endif
+  }
+
+#ifdef CONSTRAINTS
+  n_constraints = s.constraints.size();
+  constraints = (Constraint *)Utils::realloc(
+      constraints, n_constraints * sizeof(Constraint));
+  if (n_constraints > 0)
+    memcpy(constraints, s.constraints.data(),
+           n_constraints * sizeof(Constraint));
+#endif
+
+#if defined(ELECTROSTATICS) || defined(DIPOLES)
+#ifdef DIPOLES
+  set_dipolar_method_local(s.coulomb.Dmethod);
+#endif
+  coulomb = s.coulomb;
+  MethodData data;
+  coulomb_method_data(coulomb, data);
+  for (size_t i = 0; i < data.size(); i++)
+    memcpy(data[i].first, s.coulomb_data[i].data(), data[i].second);
+#endif
+
+#ifdef LB
+  lbpar = s.lbpar;
+#endif
+}
+
+} /* namespace */
+
+int system_state_pack(std::vector<char> &blob) {
+  StateWriter out(blob);
+  blob.clear();
+
+  std::vector<int> layout = state_layout();
+  out.put(state_magic, sizeof(state_magic));
+  out.put(state_version);
+  out.put(state_sections());
+  out.put(int(layout.size()));
+  out.put(layout.data(), layout.size() * sizeof(int));
+
+  int nfields = sizeof(state_fields) / sizeof(*state_fields);
+  out.put(nfields);
+  for (int i = 0; i < nfields; i++) {
+    const Datafield &d = fields[state_fields[i]];
+    out.put_string(d.name);
+    out.put(d.type);
+    out.put(d.dimension);
+    out.put(d.data, field_size(d));
+  }
+  out.put(int(skin_set));
+  out.put(int(langevin_trans));
+  out.put(int(langevin_rotate));
+  out.put(nptiso);
+
+  out.put(n_particle_types);
+  if (n_particle_types > 0)
+    out.put(get_ia_param(0, 0),
+            n_particle_types * n_particle_types * sizeof(IA_parameters));
+#ifdef TABULATED
+  out.put(tabulated_forces.max);
+  out.put(tabulated_forces.e, tabulated_forces.max * sizeof(double));
+  out.put(tabulated_energies.max);
+  out.put(tabulated_energies.e, tabulated_energies.max * sizeof(double));
+#endif
+
+  out.put(n_bonded_ia);
+  for (int i = 0; i < n_bonded_ia; i++) {
+    const Bonded_ia_parameters &b = bonded_ia_params[i];
+    out.put(b);
+#ifdef TABULATED
+    if (b.type == BONDED_IA_TABULATED) {
+      out.put_string(b.p.tab.filename);
+      out.put(b.p.tab.f, b.p.tab.npoints * sizeof(double));
+      out.put(b.p.tab.e, b.p.tab.npoints * sizeof(double));
+    }
+#endif
+#ifdef OVERLAPPED
+    if (b.type == BONDED_IA_OVERLAPPED) {
+      size_t size = b.p.overlap.noverlaps * sizeof(double);
+      out.put_string(b.p.overlap.filename);
+      out.put(b.p.overlap.para_a, size);
+      out.put(b.p.overlap.para_b, size);
+      out.put(b.p.overlap.para_c, size);
+    }
+#endif
+  }
+
+#ifdef CONSTRAINTS
+  out.put(n_constraints);
+  out.put(constraints, n_constraints * sizeof(Constraint));
+#endif
+
+#if defined(ELECTROSTATICS) || defined(DIPOLES)
+  MethodData data;
+  if (!coulomb_method_data(coulomb, data)) {
+    runtimeErrorMsg() << "system state: the parameters of the current "
+                         "electrostatics method cannot be stored";
+    return ES_ERROR;
+  }
+  out.put(coulomb);
+  for (auto const &d : data)
+    out.put(d.first, d.second);
+#endif
+
+#ifdef LB
+  out.put(lbpar);
+#endif
+
+  return ES_OK;
+}
+
+int system_state_check(const std::vector<char> &blob) {
+  SystemState s;
+  if (!parse(blob, s)) {
+    runtimeErrorMsg() << "system state: corrupt data";
+    return ES_ERROR;
+  }
+  return ES_OK;
+}
+
+int system_state_unpack(const std::vector<char> &blob) {
+  SystemState s;
+  if (!parse(blob, s)) {
+    runtimeErrorMsg() << "system state: corrupt data";
+    return ES_ERROR;
+  }
+
+  int old_periodic = periodic;
+  double old_time_step = time_step;
+  apply(s);
+
+  time_step_half = time_step / 2.;
+  time_step_squared = time_step * time_step;
+  time_step_squared_half = time_step_squared / 2.;
+  /* the velocities are stored in units of the time step */
+  if (old_time_step > 0.0 && time_step > 0.0 && time_step != old_time_step)
+    rescale_velocities(time_step / old_time_step);
+
+  on_system_state_change(periodic != old_periodic ? CELL_FLAG_GRIDCHANGED
+                                                  : 0);
+  return ES_OK;
+}
+
+int system_state_write(const char *filename) {
+  std::vector<char> blob;
+  if (system_state_pack(blob) != ES_OK)
+    return ES_ERROR;
+
+  FILE *f = fopen(filename, "wb");
+  if (!f) {
+    runtimeErrorMsg() << "system state: could not open " << filename
+                      << " for writing";
+    return ES_ERROR;
+  }
+  bool success = (fwrite(blob.data(), 1, blob.size(), f) == blob.size());
+  success = (fclose(f) == 0) && success;
+  if (!success) {
+    runtimeErrorMsg() << "system state: failed to write " << filename;
+    return ES_ERROR;
+  }
+  return ES_OK;
+}
+
+int system_state_read(const char *filename) {
+  std::vector<char> blob;
+  FILE *f = fopen(filename, "rb");
+  if (!f) {
+    runtimeErrorMsg() << "system state: could not open " << filename;
+    return ES_ERROR;
+  }
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    blob.insert(blob.end(), buf, buf + n);
+  bool success = !ferror(f);
+  fclose(f);
+  if (!success) {
+    runtimeErrorMsg() << "system state: failed to read " << filename;
+    return ES_ERROR;
+  }
+
+  /* only broadcast what all nodes can restore, so that a bad file
+     leaves the state unchanged */
+  if (system_state_check(blob) != ES_OK)
+    return ES_ERROR;
+  mpi_bcast_system_state(blob);
+  return ES_OK;
+}
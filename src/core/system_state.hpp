@@ -0,0 +1,75 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _SYSTEM_STATE_H
+#define _SYSTEM_STATE_H
+/** \file system_state.hpp
+    Binary restart of the interaction and integration setup.
+
+    The system state comprises the non-bonded interactions including the
+    tabulated tables, the bonded interactions, the constraints, the
+    electrostatics and magnetostatics parameters, the CPU lattice
+    Boltzmann parameters and the restorable global parameters of the
+    integrator and the thermostat. It is stored as one binary blob, which
+    on restore is broadcast in a single message, unpacked on all nodes
+    and followed by a single initialization pass, instead of one
+    broadcast and reinitialization per parameter.
+
+    The blob is the raw memory image of the parameter structures, so it
+    can only be read by a build with the same features on the same
+    architecture, which is checked from its header. The particles are
+    not part of the state, see \ref mpiio.hpp for them.
+*/
+
+#include <vector>
+
+/** Store the system state in a binary file. Call only on the master.
+    \param filename the name of the file
+    \return ES_OK on success, otherwise ES_ERROR and a runtime error
+*/
+int system_state_write(const char *filename);
+
+/** Restore the system state from a binary file written by \ref
+    system_state_write. Call only on the master. If the file cannot be
+    read or was written by an incompatible build, the state is left
+    unchanged.
+    \param filename the name of the file
+    \return ES_OK on success, otherwise ES_ERROR and a runtime error
+*/
+int system_state_read(const char *filename);
+
+/** Serialize the system state of this node.
+    \param blob receives the state
+    \return ES_OK on success, otherwise ES_ERROR and a runtime error
+*/
+int system_state_pack(std::vector<char> &blob);
+
+/** Check whether a blob can be restored by this build, without
+    changing the state.
+    \return ES_OK if it can, otherwise ES_ERROR and a runtime error
+*/
+int system_state_check(const std::vector<char> &blob);
+
+/** Replace the system state of this node by the one in the blob and
+    reinitialize. To be called on all nodes with the same blob, see \ref
+    mpi_bcast_system_state.
+    \return ES_OK on success, otherwise ES_ERROR and a runtime error
+*/
+int system_state_unpack(const std::vector<char> &blob);
+
+#endif
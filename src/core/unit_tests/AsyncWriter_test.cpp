@@ -0,0 +1,108 @@
+/*
+  Copyright (C) 2010,2011,2012,2013,2014,2015,2016 The ESPResSo project
+  Copyright (C) 2002,2003,2004,2005,2006,2007,2008,2009,2010
+    Max-Planck-Institute for Polymer Research, Theory Group
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file AsyncWriter_test.cpp Unit tests for the AsyncWriter class.
+ *
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+
+#define BOOST_TEST_MODULE AsyncWriter test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../AsyncWriter.hpp"
+
+static AsyncWriter::Block block(std::string fn, size_t offset,
+                                std::string data) {
+  AsyncWriter::Block b;
+  b.filename = fn;
+  b.offset = offset;
+  b.data.assign(data.begin(), data.end());
+  return b;
+}
+
+/* The writer does not create files. */
+static void create_file(std::string fn) { std::ofstream f(fn.c_str()); }
+
+static std::string read_file(std::string fn) {
+  std::ifstream f(fn.c_str(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(f),
+                     std::istreambuf_iterator<char>());
+}
+
+BOOST_AUTO_TEST_CASE(offsets) {
+  std::string fn = "AsyncWriter_test." + std::to_string(getpid());
+  create_file(fn);
+  {
+    AsyncWriter w(2);
+
+    /* Many frames, more than the queue holds, each writes two
+       records at interleaved offsets. */
+    for (int i = 0; i < 50; ++i) {
+      AsyncWriter::Frame frame;
+      frame.push_back(block(fn, 2 * i, std::string(1, 'a' + i % 26)));
+      frame.push_back(block(fn, 2 * i + 1, std::string(1, 'A' + i % 26)));
+      w.write(std::move(frame));
+    }
+    BOOST_CHECK(!w.pending(fn + ".other"));
+    BOOST_CHECK(w.flush().empty());
+    BOOST_CHECK(!w.pending(fn));
+  }
+
+  std::string content = read_file(fn);
+  BOOST_REQUIRE(content.size() == 100);
+  for (int i = 0; i < 50; ++i) {
+    BOOST_CHECK(content[2 * i] == 'a' + i % 26);
+    BOOST_CHECK(content[2 * i + 1] == 'A' + i % 26);
+  }
+  std::remove(fn.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(destructor_writes_pending) {
+  std::string fn = "AsyncWriter_test_dtor." + std::to_string(getpid());
+  create_file(fn);
+  {
+    AsyncWriter w;
+    AsyncWriter::Frame frame;
+    frame.push_back(block(fn, 0, std::string(1 << 20, 'x')));
+    w.write(std::move(frame));
+  }
+
+  BOOST_CHECK(read_file(fn).size() == (1 << 20));
+  std::remove(fn.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(errors) {
+  AsyncWriter w;
+  AsyncWriter::Frame frame;
+  frame.push_back(block("/nonexistent/AsyncWriter_test", 0, "data"));
+  w.write(std::move(frame));
+
+  BOOST_CHECK(!w.flush().empty());
+  /* The error is reported only once. */
+  BOOST_CHECK(w.error().empty());
+  BOOST_CHECK(w.flush().empty());
+}
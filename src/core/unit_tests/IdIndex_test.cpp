@@ -0,0 +1,132 @@
+/*
+  Copyright (C) 2010,2011,2012,2013,2014,2015,2016 The ESPResSo project
+  Copyright (C) 2002,2003,2004,2005,2006,2007,2008,2009,2010
+    Max-Planck-Institute for Polymer Research, Theory Group
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file IdIndex_test.cpp Unit tests for the Utils::IdIndex class.
+ *
+*/
+
+#define BOOST_TEST_MODULE IdIndex test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include "utils/IdIndex.hpp"
+
+using Utils::IdIndex;
+
+BOOST_AUTO_TEST_CASE(array_like_access) {
+  IdIndex<int> index(-1);
+
+  BOOST_CHECK(index[7] == -1);
+  BOOST_CHECK(index.size() == 0);
+
+  index[7] = 3;
+  index[1000000000] = 5;
+  BOOST_CHECK(index[7] == 3);
+  BOOST_CHECK(index[1000000000] == 5);
+  BOOST_CHECK(index[8] == -1);
+  BOOST_CHECK(index[-1] == -1);
+  BOOST_CHECK(index.size() == 2);
+
+  /* reading does not insert */
+  int x = index[12];
+  BOOST_CHECK(x == -1);
+  BOOST_CHECK(index.size() == 2);
+
+  index[7] = index[1000000000];
+  BOOST_CHECK(index[7] == 5);
+
+  /* storing the empty value removes */
+  index[7] = -1;
+  BOOST_CHECK(index[7] == -1);
+  BOOST_CHECK(index.size() == 1);
+
+  const IdIndex<int> &cindex = index;
+  BOOST_CHECK(cindex[1000000000] == 5);
+
+  index.clear();
+  BOOST_CHECK(index.size() == 0);
+  BOOST_CHECK(index[1000000000] == -1);
+}
+
+BOOST_AUTO_TEST_CASE(pointer_values) {
+  struct Item {
+    int id;
+  } items[3] = {{0}, {1}, {2}};
+  IdIndex<Item *> index(NULL);
+
+  for (int i = 0; i < 3; i++)
+    index[items[i].id] = &items[i];
+
+  BOOST_CHECK(index[1]->id == 1);
+  BOOST_CHECK(index[2] == &items[2]);
+  BOOST_CHECK(!index[3]);
+  index[1] = NULL;
+  BOOST_CHECK(index[1] == NULL);
+  BOOST_CHECK(index.size() == 2);
+}
+
+/** Random insertions and removals against std::map, with dense,
+    strided and sparse ids to exercise collisions, the removal without
+    tombstones and the growing and shrinking of the table. */
+BOOST_AUTO_TEST_CASE(compare_to_map) {
+  const int scales[] = {1000, 16 * 1000, 1 << 30};
+  srand(42);
+
+  for (int scale : scales) {
+    IdIndex<int> index(-1);
+    std::map<int, int> reference;
+
+    for (int step = 0; step < 20000; step++) {
+      int id = (rand() % 1000) * (scale / 1000);
+      if (step < 10000 ? rand() % 3 : rand() % 3 == 0) {
+        index[id] = step;
+        reference[id] = step;
+      } else {
+        index.erase(id);
+        reference.erase(id);
+      }
+    }
+
+    BOOST_CHECK(index.size() == reference.size());
+    for (int id = 0; id < 1000; id++) {
+      int key = id * (scale / 1000);
+      auto it = reference.find(key);
+      BOOST_CHECK(index[key] == (it == reference.end() ? -1 : it->second));
+    }
+
+    std::vector<int> ids = index.ids();
+    BOOST_CHECK(ids.size() == reference.size());
+    auto it = reference.begin();
+    for (int id : ids)
+      BOOST_CHECK(id == (it++)->first);
+
+    int n = 0;
+    index.for_each([&n, &reference](int id, int value) {
+      BOOST_CHECK(reference.at(id) == value);
+      n++;
+    });
+    BOOST_CHECK(n == int(reference.size()));
+  }
+}
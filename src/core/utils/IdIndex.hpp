@@ -0,0 +1,204 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __UTILS_ID_INDEX_HPP
+#define __UTILS_ID_INDEX_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Utils {
+
+/**
+ * \brief Map from non-negative ids to small values, like particle ids to
+ * particle pointers.
+ *
+ * A hash table with open addressing and linear probing, whose memory
+ * scales with the number of stored ids instead of the highest id. Ids
+ * that are not stored map to the empty value given on construction, and
+ * storing the empty value removes an id, so that the index can be used
+ * like a dense array:
+ *
+ * \code
+ * index[id] = p;
+ * if (index[id]) ...
+ * index[id] = NULL;
+ * \endcode
+ *
+ * Blocks of 16 consecutive ids are kept in consecutive slots, so the
+ * lookup of neighbouring ids, e.g. of bond partners, stays cache
+ * friendly, while the blocks are scattered by Fibonacci hashing.
+ */
+template <typename T> class IdIndex {
+  struct Slot {
+    int id;
+    T value;
+  };
+
+public:
+  /** Proxy for the element access of a non-const index. */
+  class Reference {
+  public:
+    operator T() const { return m_index.find(m_id); }
+    T operator->() const { return m_index.find(m_id); }
+    Reference &operator=(T value) {
+      m_index.set(m_id, value);
+      return *this;
+    }
+    Reference &operator=(const Reference &other) { return *this = T(other); }
+
+  private:
+    friend class IdIndex;
+    Reference(IdIndex &index, int id) : m_index(index), m_id(id) {}
+    IdIndex &m_index;
+    int m_id;
+  };
+
+  explicit IdIndex(T empty = T()) : m_empty(empty) { clear(); }
+
+  T operator[](int id) const { return find(id); }
+  Reference operator[](int id) { return Reference(*this, id); }
+
+  /** The value of id, or the empty value if id is not stored. */
+  T find(int id) const {
+    if (id < 0)
+      return m_empty;
+    for (size_t i = home(id);; i = (i + 1) & m_mask) {
+      if (m_slots[i].id == id)
+        return m_slots[i].value;
+      if (m_slots[i].id == -1)
+        return m_empty;
+    }
+  }
+
+  /** Store value for id, or remove id if value is the empty value. */
+  void set(int id, T value) {
+    assert(id >= 0);
+    if (value == m_empty) {
+      erase(id);
+      return;
+    }
+    if (2 * (m_size + 1) > m_slots.size())
+      rehash(2 * m_slots.size());
+    size_t i = home(id);
+    while (m_slots[i].id != -1 && m_slots[i].id != id)
+      i = (i + 1) & m_mask;
+    if (m_slots[i].id == -1)
+      m_size++;
+    m_slots[i].id = id;
+    m_slots[i].value = value;
+  }
+
+  /** Remove id if it is stored. */
+  void erase(int id) {
+    if (id < 0)
+      return;
+    size_t i = home(id);
+    while (m_slots[i].id != id) {
+      if (m_slots[i].id == -1)
+        return;
+      i = (i + 1) & m_mask;
+    }
+    /* move later entries of the probe sequence into the gap, so that no
+       tombstones are needed */
+    for (size_t j = (i + 1) & m_mask; m_slots[j].id != -1;
+         j = (j + 1) & m_mask) {
+      size_t k = home(m_slots[j].id);
+      if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+        m_slots[i] = m_slots[j];
+        i = j;
+      }
+    }
+    m_slots[i].id = -1;
+    m_slots[i].value = m_empty;
+    m_size--;
+    if (8 * m_size < m_slots.size() && m_slots.size() > min_slots)
+      rehash(m_slots.size() / 2);
+  }
+
+  /** Remove all ids and release the memory. */
+  void clear() {
+    m_size = 0;
+    resize(min_slots);
+  }
+
+  /** Number of stored ids. */
+  size_t size() const { return m_size; }
+
+  /** Call f(id, value) for all stored ids in unspecified order. The
+      index must not be modified by f. */
+  template <typename F> void for_each(F f) const {
+    for (auto const &s : m_slots)
+      if (s.id != -1)
+        f(s.id, s.value);
+  }
+
+  /** The stored ids in ascending order. */
+  std::vector<int> ids() const {
+    std::vector<int> ret;
+    ret.reserve(m_size);
+    for_each([&ret](int id, T) { ret.push_back(id); });
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  }
+
+private:
+  static const size_t min_slots = 32;
+
+  size_t home(int id) const {
+    uint32_t block = static_cast<uint32_t>(id) >> 4;
+    return (((block * 2654435769u) >> m_shift) << 4 | (id & 15)) & m_mask;
+  }
+
+  void resize(size_t n_slots) {
+    Slot empty_slot = {-1, m_empty};
+    m_slots.assign(n_slots, empty_slot);
+    m_mask = n_slots - 1;
+    m_shift = 32;
+    for (size_t n = n_slots >> 4; n > 1; n >>= 1)
+      m_shift--;
+  }
+
+  void rehash(size_t n_slots) {
+    std::vector<Slot> old;
+    old.swap(m_slots);
+    resize(n_slots);
+    for (auto const &s : old) {
+      if (s.id == -1)
+        continue;
+      size_t i = home(s.id);
+      while (m_slots[i].id != -1)
+        i = (i + 1) & m_mask;
+      m_slots[i] = s;
+    }
+  }
+
+  T m_empty;
+  std::vector<Slot> m_slots;
+  size_t m_size;
+  size_t m_mask;
+  unsigned m_shift;
+};
+
+} /* namespace Utils */
+
+#endif
@@ -621,8 +621,6 @@ class Analysis:
         cdef double * sf
         p_types = create_int_list_from_python_object(sf_types)
     
-        # Used to take the WITHOUT_BONDS define
-        c_analyze.updatePartCfg(0)
         c_analyze.calc_structurefactor(p_types.e, p_types.n, sf_order, & sf)
     
         return np.transpose(c_analyze.modify_stucturefactor(sf_order, sf))
@@ -658,7 +656,8 @@ class Analysis:
         cdef vector[int] p1_types = type_list_a
         cdef vector[int] p2_types = type_list_b
     
-        c_analyze.updatePartCfg(0)
+        if rdf_type != 'rdf':
+            c_analyze.updatePartCfg(0)
         if rdf_type == 'rdf':
             c_analyze.calc_rdf(p1_types, p2_types, r_min, r_max, r_bins, rdf)
         elif rdf_type == '<rdf>':
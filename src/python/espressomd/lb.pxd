@@ -85,6 +85,8 @@ IF LB_GPU or LB:
         int lb_lbfluid_print_boundary(char * filename)
         int lb_lbfluid_save_checkpoint(char * filename, int binary)
         int lb_lbfluid_load_checkpoint(char * filename, int binary)
+        int lb_lbfluid_save_checkpoint_mpiio(char * filename)
+        int lb_lbfluid_load_checkpoint_mpiio(char * filename)
         int lb_set_lattice_switch(int py_switch)
         int lb_get_lattice_switch(int * py_switch)
         int lb_lbnode_get_u(int * coord, double * double_return)
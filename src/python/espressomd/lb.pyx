@@ -162,6 +162,12 @@ IF LB_GPU or LB:
             lb_lbfluid_save_checkpoint(utils.to_char_pointer(path), binary)
         def load_checkpoint(self, path, binary):
             lb_lbfluid_load_checkpoint(utils.to_char_pointer(path), binary)
+        def save_checkpoint_mpiio(self, path):
+            if lb_lbfluid_save_checkpoint_mpiio(utils.to_char_pointer(path)):
+                raise Exception("Could not write the parallel LB checkpoint")
+        def load_checkpoint_mpiio(self, path):
+            if lb_lbfluid_load_checkpoint_mpiio(utils.to_char_pointer(path)):
+                raise Exception("Could not read the parallel LB checkpoint")
         def lbnode_get_node_velocity(self, coord):
             cdef double[3] double_return
             cdef int[3] c_coord
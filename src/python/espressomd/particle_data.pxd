@@ -84,6 +84,16 @@ cdef extern from "particle_data.hpp":
 
     int place_particle(int part, double p[3])
 
+    int place_particles(int n, const int * ids, const double * pos, const int * type, const double * v, const double * q)
+
+    int PART_BULK_POS
+    int PART_BULK_V
+    int PART_BULK_F
+    int PART_BULK_TYPE
+    int PART_BULK_Q
+    int partCfgVersion
+    void get_particle_arrays(int fields, int * id, double * pos, double * v, double * f, int * type, double * q)
+
     int set_particle_v(int part, double v[3])
 
     int set_particle_f(int part, double F[3])
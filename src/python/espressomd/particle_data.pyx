@@ -910,6 +910,37 @@ cdef class ParticleHandle:
             setattr(self, k, P[k])
 
 
+# Snapshot of the particle configuration in structure-of-arrays layout,
+# sorted by particle id. It is rebuilt with one collective gather when the
+# particles changed or the system was integrated, see _particle_arrays().
+_snapshot = {"version": -1}
+
+
+def _particle_arrays():
+    """Returns the current snapshot of the particle ids, positions,
+    velocities, forces, types and charges as read-only arrays."""
+    global _snapshot
+    if _snapshot["version"] == partCfgVersion:
+        return _snapshot
+
+    cdef int n = n_part
+    cdef np.ndarray[int, ndim = 1] ids = np.empty(n, dtype=np.intc)
+    cdef np.ndarray[double, ndim = 2] pos = np.empty((n, 3))
+    cdef np.ndarray[double, ndim = 2] v = np.empty((n, 3))
+    cdef np.ndarray[double, ndim = 2] f = np.empty((n, 3))
+    cdef np.ndarray[int, ndim = 1] types = np.empty(n, dtype=np.intc)
+    cdef np.ndarray[double, ndim = 1] q = np.empty(n)
+    if n > 0:
+        get_particle_arrays(PART_BULK_POS | PART_BULK_V | PART_BULK_F | PART_BULK_TYPE | PART_BULK_Q,
+                            & ids[0], & pos[0, 0], & v[0, 0], & f[0, 0], & types[0], & q[0])
+
+    _snapshot = {"version": partCfgVersion, "id": ids, "pos": pos,
+                 "v": v, "f": f, "type": types, "q": q}
+    for key in ["id", "pos", "v", "f", "type", "q"]:
+        _snapshot[key].flags.writeable = False
+    return _snapshot
+
+
 cdef class ParticleSlice:
     """Handles slice inputs e.g. part[0:2]. Sets values for selected slices or returns values as a single list."""
 
@@ -1315,15 +1346,43 @@ cdef class ParticleList:
             ids = P["id"]
             del P["id"]
 
-        # Place particles
-        cdef double mypos[3]
-        for j in range(len(P["pos"])):
-            for i in range(3):
-                mypos[i] = P["pos"][j][i]
-            if place_particle(ids[j], mypos) == -1:
-                raise Exception("particle could not be set")
-
+        # Positions and, if given per particle, velocities, types and
+        # charges are sent to the nodes in a single call. All other
+        # properties are set particle by particle via update().
+        cdef np.ndarray[int, ndim = 1] c_ids = np.ascontiguousarray(ids, dtype=np.intc)
+        cdef np.ndarray[double, ndim = 2] c_pos = np.ascontiguousarray(P["pos"], dtype=np.double)
+        cdef np.ndarray[int, ndim = 1] c_type
+        cdef np.ndarray[double, ndim = 2] c_v
+        cdef np.ndarray[double, ndim = 1] c_q
+        cdef int * type_ptr = NULL
+        cdef double * v_ptr = NULL
+        cdef double * q_ptr = NULL
+        cdef int n = len(c_ids)
+
+        if c_pos.shape[0] != n or c_pos.shape[1] != 3:
+            raise ValueError("pos has to be an array of shape (%d, 3)" % n)
         del P["pos"]
+        if n == 0:
+            return self[ids]
+
+        if "type" in P and np.shape(P["type"]) == (n,):
+            c_type = np.ascontiguousarray(P["type"], dtype=np.intc)
+            if np.any(c_type < 0):
+                raise ValueError("type must be an integer >= 0")
+            type_ptr = &c_type[0]
+            del P["type"]
+        if "v" in P and np.shape(P["v"]) == (n, 3):
+            c_v = np.ascontiguousarray(P["v"], dtype=np.double) * time_step
+            v_ptr = &c_v[0, 0]
+            del P["v"]
+        IF ELECTROSTATICS:
+            if "q" in P and np.shape(P["q"]) == (n,):
+                c_q = np.ascontiguousarray(P["q"], dtype=np.double)
+                q_ptr = &c_q[0]
+                del P["q"]
+
+        if place_particles(n, &c_ids[0], &c_pos[0, 0], type_ptr, v_ptr, q_ptr) == -1:
+            raise Exception("particles could not be set, ids must be unique and positive")
 
         if P != {}:
             self[ids].update(P)
@@ -1386,6 +1445,22 @@ cdef class ParticleList:
                     if (p.type == t or t == "all"):
                         vtk.write("{} {} {}\n".format(*p.v))
 
+    def arrays(self, start=None, stop=None):
+        """Returns the ids, positions, velocities, forces, types and
+        charges of all particles with start <= id < stop as a dictionary of
+        arrays sorted by particle id. The arrays are read-only views of a
+        snapshot that is gathered once and reused until the particles
+        change or the system is integrated. The values are the ones
+        reported by part print: positions are unfolded, velocities and
+        forces are in user units. Charges are zero without
+        ELECTROSTATICS."""
+        snapshot = _particle_arrays()
+        lo = 0 if start is None else np.searchsorted(snapshot["id"], start)
+        hi = len(snapshot["id"]) if stop is None else np.searchsorted(
+            snapshot["id"], stop)
+        return {key: snapshot[key][lo:hi]
+                for key in ["id", "pos", "v", "f", "type", "q"]}
+
     property highest_particle_id:
         def __get__(self):
             return max_seen_particle
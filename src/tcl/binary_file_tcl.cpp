@@ -36,7 +36,7 @@ int tclcommand_writemd(ClientData data, Tcl_Interp *interp,
 {
   static int end_num = -1;
   char *row;
-  int p, i;
+  int i;
   struct MDHeader header;
   int tcl_file_mode;
   Tcl_Channel channel;
@@ -137,7 +137,7 @@ int tclcommand_writemd(ClientData data, Tcl_Interp *interp,
     argv++;
   }
 
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   /* write header and row data */
@@ -146,7 +146,7 @@ int tclcommand_writemd(ClientData data, Tcl_Interp *interp,
   Tcl_Write(channel, (char *)&header, sizeof(header));
   Tcl_Write(channel, row, header.n_rows*sizeof(char));
 
-  for (p = 0; p <= max_seen_particle; p++) {
+  for (int p : particle_node.ids()) {
     Particle data;
     if (get_particle_data(p, &data) == ES_OK) {
       unfold_position(data.r.p, data.m.v, data.l.i);
@@ -242,7 +242,7 @@ int tclcommand_readmd(ClientData dummy, Tcl_Interp *interp,
     return (TCL_ERROR);
   }
 
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   /* parse rows */
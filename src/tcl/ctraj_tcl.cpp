@@ -0,0 +1,147 @@
+/*
+  Copyright (C) 2010,2011,2012,2013,2014,2015,2016 The ESPResSo project
+  Copyright (C) 2002,2003,2004,2005,2006,2007,2008,2009,2010 
+    Max-Planck-Institute for Polymer Research, Theory Group
+  
+  This file is part of ESPResSo.
+  
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+#include "ctraj.hpp"
+#include "ctraj_tcl.hpp"
+#include "communication.hpp"
+
+static int ctraj_usage(Tcl_Interp *interp, char *cmd)
+{
+  Tcl_AppendResult(interp, "usage: ", cmd,
+                   " <filename> write ?precision <p>? ?v <vprecision>?"
+                   " | frames | info <frame> | read <frame> ?ids <ids>?",
+                   (char *) NULL);
+  return TCL_ERROR;
+}
+
+static int tclcommand_ctraj_write(Tcl_Interp *interp, char *filename,
+                                  int argc, char **argv)
+{
+  unsigned fields = CTRAJ_POS;
+  double prec = 1e-3, vprec = 1e-3;
+
+  while (argc > 0) {
+    if (argc >= 2 && ARG0_IS_S("precision")) {
+      if (!ARG1_IS_D(prec) || prec <= 0) {
+        Tcl_ResetResult(interp);
+        Tcl_AppendResult(interp, "precision must be a positive number",
+                         (char *) NULL);
+        return TCL_ERROR;
+      }
+    } else if (argc >= 2 && ARG0_IS_S("v")) {
+      if (!ARG1_IS_D(vprec) || vprec <= 0) {
+        Tcl_ResetResult(interp);
+        Tcl_AppendResult(interp, "velocity precision must be a positive number",
+                         (char *) NULL);
+        return TCL_ERROR;
+      }
+      fields |= CTRAJ_VEL;
+    } else {
+      Tcl_AppendResult(interp, "unknown argument \"", argv[0], "\"",
+                       (char *) NULL);
+      return TCL_ERROR;
+    }
+    argc -= 2;
+    argv += 2;
+  }
+
+  mpi_ctraj_write(filename, fields, prec, vprec);
+  return TCL_OK;
+}
+
+int tclcommand_ctraj(ClientData data, Tcl_Interp *interp,
+                     int argc, char *argv[])
+{
+  char buffer[TCL_DOUBLE_SPACE + TCL_INTEGER_SPACE];
+  CtrajReader reader;
+  CtrajFrame frame;
+  int n;
+
+  if (argc < 3)
+    return ctraj_usage(interp, argv[0]);
+
+  if (ARG_IS_S(2, "write"))
+    return tclcommand_ctraj_write(interp, argv[1], argc - 3, argv + 3);
+
+  if (reader.open(argv[1]) == ES_ERROR)
+    return gather_runtime_errors(interp, TCL_ERROR);
+
+  if (ARG_IS_S(2, "frames")) {
+    sprintf(buffer, "%d", reader.n_frames());
+    Tcl_AppendResult(interp, buffer, (char *) NULL);
+    return TCL_OK;
+  }
+
+  if (argc < 4 || !ARG_IS_I(3, n))
+    return ctraj_usage(interp, argv[0]);
+
+  if (ARG_IS_S(2, "info")) {
+    std::vector<int> none;
+    if (reader.read_frame(n, frame, &none) == ES_ERROR)
+      return gather_runtime_errors(interp, TCL_ERROR);
+    Tcl_AppendResult(interp, "{time ", (char *) NULL);
+    Tcl_PrintDouble(interp, frame.time, buffer);
+    Tcl_AppendResult(interp, buffer, "} {box_l", (char *) NULL);
+    for (int k = 0; k < 3; ++k) {
+      Tcl_PrintDouble(interp, frame.box_l[k], buffer);
+      Tcl_AppendResult(interp, " ", buffer, (char *) NULL);
+    }
+    Tcl_AppendResult(interp, "}", (char *) NULL);
+    return TCL_OK;
+  }
+
+  if (!ARG_IS_S(2, "read"))
+    return ctraj_usage(interp, argv[0]);
+
+  std::vector<int> ids;
+  if (argc == 6 && ARG_IS_S(4, "ids")) {
+    IntList il;
+    init_intlist(&il);
+    if (!ARG_IS_INTLIST(5, il)) {
+      realloc_intlist(&il, 0);
+      return TCL_ERROR;
+    }
+    ids.assign(il.e, il.e + il.n);
+    realloc_intlist(&il, 0);
+  } else if (argc != 4) {
+    return ctraj_usage(interp, argv[0]);
+  }
+
+  if (reader.read_frame(n, frame, (argc == 6) ? &ids : NULL) == ES_ERROR)
+    return gather_runtime_errors(interp, TCL_ERROR);
+
+  // One list "id x y z ?vx vy vz?" per particle
+  for (size_t i = 0; i < frame.id.size(); ++i) {
+    sprintf(buffer, "%d", frame.id[i]);
+    Tcl_AppendResult(interp, "{", buffer, (char *) NULL);
+    for (int k = 0; k < 3; ++k) {
+      Tcl_PrintDouble(interp, frame.pos[3 * i + k], buffer);
+      Tcl_AppendResult(interp, " ", buffer, (char *) NULL);
+    }
+    if (frame.fields & CTRAJ_VEL)
+      for (int k = 0; k < 3; ++k) {
+        Tcl_PrintDouble(interp, frame.vel[3 * i + k], buffer);
+        Tcl_AppendResult(interp, " ", buffer, (char *) NULL);
+      }
+    Tcl_AppendResult(interp, "} ", (char *) NULL);
+  }
+  return TCL_OK;
+}
@@ -24,6 +24,7 @@
 
 #include "initialize_interpreter.hpp"
 #include "global.hpp"
+#include "communication.hpp"
 #include "binary_file_tcl.hpp"
 #include "cells_tcl.hpp"
 #include "constraint_tcl.hpp"
@@ -65,6 +66,8 @@
 #include "minimize_energy_tcl.hpp"
 #include "h5mdfile_tcl.hpp"
 #include "mpiio_tcl.hpp"
+#include "ctraj_tcl.hpp"
+#include "system_state_tcl.hpp"
 
 #ifdef TK
 #include <tk.h>
@@ -179,6 +182,10 @@ static void tcl_register_commands(Tcl_Interp* interp) {
   #endif
   /* in mpiio_tcl.cpp */
   REGISTER_COMMAND("mpiio", tclcommand_mpiio);
+  /* in ctraj_tcl.cpp */
+  REGISTER_COMMAND("ctraj", tclcommand_ctraj);
+  /* in system_state_tcl.cpp */
+  REGISTER_COMMAND("system_state", tclcommand_system_state);
   /* in constraint.cpp */
   REGISTER_COMMAND("constraint", tclcommand_constraint);
   /* in external_potential.hpp */
@@ -290,11 +297,21 @@ static void tcl_register_global_variables(Tcl_Interp *interp)
   register_global_callback(FIELD_WARNINGS, tclcallback_warnings);
 }
 
+/** Stop the slaves when the interpreter exits. This runs before the
+    static objects of the communication are destroyed, which the handler
+    installed with atexit in \ref on_program_start comes too late for. */
+static void tcl_exit_handler(ClientData /*data*/)
+{
+  mpi_stop();
+}
+
 int tcl_appinit(Tcl_Interp *interp)
 {
   if (Tcl_Init(interp) == TCL_ERROR)
     return TCL_ERROR;
 
+  Tcl_CreateExitHandler(tcl_exit_handler, NULL);
+
 #ifdef TK
   if (Tk_Init(interp) == TCL_ERROR)
     return TCL_ERROR;
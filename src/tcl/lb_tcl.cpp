@@ -182,6 +182,7 @@ void lbfluid_tcl_print_usage(Tcl_Interp *interp)
 #endif 
   Tcl_AppendResult(interp, "        [ bulk_visc #float ] [ friction #float ] [ gamma_even #float ] [ gamma_odd #float ]\n", (char *)NULL);
   Tcl_AppendResult(interp, "        [ ext_force #float #float #float ]\n", (char *)NULL);
+  Tcl_AppendResult(interp, "        [ coupling_halo populations|velocity ]\n", (char *)NULL);
 #ifdef SHANCHEN
   Tcl_AppendResult(interp, "        [ coupling #float ]\n", (char *)NULL);
 #endif
@@ -584,6 +585,36 @@ int tclcommand_lbfluid(ClientData data, Tcl_Interp *interp, int argc, char **arg
           argc-=2; argv+=2;
         }
       }
+      else if (ARG0_IS_S_EXACT("coupling_halo") ) 
+      {
+        if ( argc < 2 ) 
+        { 
+          Tcl_AppendResult(interp, "coupling_halo requires an argument, either populations or velocity", (char *)NULL);
+          return TCL_ERROR;
+        }
+        else 
+        {
+          if ( ARG1_IS_S_EXACT("populations") ) 
+          {
+            lb_lbfluid_set_velocity_halo(0);
+          }
+          else if ( ARG1_IS_S_EXACT("velocity") ) 
+          {
+            if ( lb_lbfluid_set_velocity_halo(1) != 0 )
+            {
+              Tcl_AppendResult(interp, "coupling_halo velocity is only supported by the CPU LB", (char *)NULL);
+              return TCL_ERROR;
+            }
+          }
+          else
+          {
+            Tcl_AppendResult(interp, "Did not understand argument to coupling_halo, please send populations or velocity.", (char *)NULL);
+            return TCL_ERROR;
+          }
+
+          argc-=2; argv+=2;
+        }
+      }
       else if (ARG0_IS_S_EXACT("gamma_odd") ) 
       {
         if ( argc < (LB_COMPONENTS+1) )
@@ -715,7 +746,58 @@ int tclcommand_lbfluid(ClientData data, Tcl_Interp *interp, int argc, char **arg
           argc--;
           argv++;
 
-          if (ARG0_IS_S_EXACT("vtk")) 
+          if (ARG0_IS_S_EXACT("vtk_parallel")) 
+          {
+            int field, stride = 1, single_precision = 0;
+
+            if (ARG1_IS_S_EXACT("velocity")) 
+              field = LB_FIELD_VELOCITY;
+            else if (ARG1_IS_S_EXACT("density")) 
+              field = LB_FIELD_DENSITY;
+            else 
+            {
+              Tcl_AppendResult(interp, "lbfluid print vtk_parallel can only write velocity or density", (char *)NULL);
+              return TCL_ERROR;
+            }
+
+            argc -= 2;
+            argv += 2;
+
+            while ( argc > 1 ) 
+            {
+              if ( ARG0_IS_S_EXACT("stride") && argc > 2 ) 
+              {
+                if ( !ARG1_IS_I(stride) || stride < 1 ) 
+                {
+                  Tcl_AppendResult(interp, "stride of lbfluid print vtk_parallel has to be a positive integer", (char *)NULL);
+                  return TCL_ERROR;
+                }
+                argc -= 2;
+                argv += 2;
+              }
+              else if ( ARG0_IS_S_EXACT("single") ) 
+              {
+                single_precision = 1;
+                argc--;
+                argv++;
+              }
+              else 
+              {
+                Tcl_AppendResult(interp, "Usage: lbfluid print vtk_parallel velocity|density [stride #int] [single] filename", (char *)NULL);
+                return TCL_ERROR;
+              }
+            }
+
+            if ( argc < 1 || lb_lbfluid_print_vtk_mpiio(argv[0], field, stride, single_precision) != ES_OK ) 
+            {
+              Tcl_AppendResult(interp, "Error at lbfluid print vtk_parallel", (char *)NULL);
+              return TCL_ERROR;
+            }
+
+            argc--;
+            argv++;
+          }
+          else if (ARG0_IS_S_EXACT("vtk")) 
           {
             if (ARG1_IS_S_EXACT("boundary")) 
             {
@@ -877,6 +959,30 @@ int tclcommand_lbfluid(ClientData data, Tcl_Interp *interp, int argc, char **arg
           return lb_lbfluid_load_checkpoint(argv[1], 1);
         }
       }  
+      else if (ARG0_IS_S_EXACT("save_mpiio_checkpoint")) 
+      { 
+        if (argc < 2) 
+        {
+          Tcl_AppendResult(interp, "usage: lbfluid save_mpiio_checkpoint <filename>", (char *)NULL);
+          return TCL_ERROR;
+        } 
+        else 
+        {
+          return lb_lbfluid_save_checkpoint_mpiio(argv[1]);
+        }
+      }  
+      else if (ARG0_IS_S_EXACT("load_mpiio_checkpoint")) 
+      { 
+        if (argc < 2) 
+        {
+          Tcl_AppendResult(interp, "usage: lbfluid load_mpiio_checkpoint <filename>", (char *)NULL);
+          return TCL_ERROR;
+        } 
+        else 
+        {
+          return lb_lbfluid_load_checkpoint_mpiio(argv[1]);
+        }
+      }  
 #if defined(LB) || defined(LB_GPU)
       else if (ARG0_IS_S_EXACT("print_interpolated_velocity")) 
       { 
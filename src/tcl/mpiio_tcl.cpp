@@ -36,6 +36,12 @@ static const struct {
   { "v", MPIIO_OUT_VEL },
   { "type", MPIIO_OUT_TYP },
   { "bond", MPIIO_OUT_BND },
+  { "properties", MPIIO_OUT_PRP },
+  { "state", MPIIO_OUT_STA },
+  { "exclusions", MPIIO_OUT_EXC },
+  { "globals", MPIIO_OUT_GLB },
+  { "all", MPIIO_OUT_ALL },
+  { "async", MPIIO_ASYNC },
 };
 
 
@@ -54,9 +60,15 @@ int tclcommand_mpiio(ClientData data, Tcl_Interp *interp,
   return (TCL_ERROR);
 #endif
   
+  if (argc == 2 && !strcmp(argv[1], "flush")) {
+    mpi_mpiio_flush();
+    return (TCL_OK);
+  }
+
   if (argc < 3) {
     Tcl_AppendResult(interp, "wrong # args:  should be \"",
-                     argv[0], " <filename> read|write ?pos|v|types|bonds?* ...\"",
+                     argv[0], " <filename> read|write ?pos|v|type|bond|properties|state|exclusions|globals|all|async?* ...\" or \"",
+                     argv[0], " flush\"",
                      (char *) NULL);
     return (TCL_ERROR);
   }
@@ -96,7 +108,13 @@ int tclcommand_mpiio(ClientData data, Tcl_Interp *interp,
   }
 
   
+  if (!write && (output_fields & MPIIO_ASYNC)) {
+    Tcl_AppendResult(interp, "only output can be asynchronous",
+                     (char *) NULL);
+    return (TCL_ERROR);
+  }
+
   mpi_mpiio(filename, output_fields, write);
 
-  return (TCL_OK);
+  return gather_runtime_errors(interp, TCL_OK);
 }
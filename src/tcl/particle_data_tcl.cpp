@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <vector>
 #include <mpi.h>
 #include "utils.hpp"
 #include "particle_data.hpp"
@@ -427,16 +428,25 @@ void tclcommand_part_print_bond_partners(Particle *part, char *buffer, Tcl_Inter
   int c, p, i, p1, p2;
   Bonded_ia_parameters *ia_params;
   Particle *part1;
+  IntList *partners1;
   /* partners is a list containing the currently found bond partners and their distance in number of 
-     bonds for each particle */
-  IntList *partners;
+     bonds for each particle. Since the identities may be sparse, the lists are stored in the
+     order of their creation and found via the index. */
+  std::vector<IntList> partners;
+  Utils::IdIndex<int> index(-1);
+  auto partners_of = [&](int id) {
+    int k = index.find(id);
+    if (k == -1) {
+      k = partners.size();
+      index.set(id, k);
+      partners.emplace_back();
+      init_intlist(&partners.back());
+    }
+    return &partners[k];
+  };
   /* link list for all linear connections up to a certain number of bonds for the particle requiested */
   IntList *links;
 
-  /* setup bond partners and distance list. Since we need to identify particles via their identity,
-     we use a full sized array */
-  partners    = (IntList*)Utils::malloc((max_seen_particle + 1)*sizeof(IntList));
-  for (p = 0; p <= max_seen_particle; p++) init_intlist(&partners[p]);
   updatePartCfg(WITH_BONDS);
 
   /* determine initial connectivity */
@@ -447,8 +457,8 @@ void tclcommand_part_print_bond_partners(Particle *part, char *buffer, Tcl_Inter
       ia_params = &bonded_ia_params[part1->bl.e[i++]];
       if (ia_params->num == 1) {
 	p2 = part1->bl.e[i++];
-	add_partner(&partners[p1], p1, p2, 1);
-	add_partner(&partners[p2], p2, p1, 1);
+	add_partner(partners_of(p1), p1, p2, 1);
+	add_partner(partners_of(p2), p2, p1, 1);
       }
       else
 	i += ia_params->num;
@@ -463,16 +473,18 @@ void tclcommand_part_print_bond_partners(Particle *part, char *buffer, Tcl_Inter
   p1 = part->p.identity;
   add_link(&links[0], &links[0],0, p1, 1);
 
-  for (p = 0; p < partners[p1].n; p+=2) {
-     add_link(&links[1], &links[0], 0, partners[p1].e[p], 2);
+  partners1 = partners_of(p1);
+  for (p = 0; p < partners1->n; p+=2) {
+     add_link(&links[1], &links[0], 0, partners1->e[p], 2);
   }
  
   for (c = 2; c <= distance; c++) {
     for (i = 0; i < links[c-1].n; i+=c) {
       p2 = links[c-1].e[c+i-1];
-      for (p = 0; p < partners[p2].n; p+=2) {
-	if( partners[p2].e[p] !=  links[c-1].e[c+i-2]) {
-	  add_link(&links[c], &links[c-1], i, partners[p2].e[p],(c+1));
+      partners1 = partners_of(p2);
+      for (p = 0; p < partners1->n; p+=2) {
+	if( partners1->e[p] !=  links[c-1].e[c+i-2]) {
+	  add_link(&links[c], &links[c-1], i, partners1->e[p],(c+1));
 	}
       }
     }
@@ -494,8 +506,7 @@ void tclcommand_part_print_bond_partners(Particle *part, char *buffer, Tcl_Inter
   }
 
   /* free memory */
-  for (p = 0; p <= max_seen_particle; p++) realloc_intlist(&partners[p], 0);
-  free(partners);
+  for (p = 0; p < (int) partners.size(); p++) realloc_intlist(&partners[p], 0);
   for(i=0;i<distance+1; i++) realloc_intlist(&links[i], 0);
   free(links);
 }
@@ -757,28 +768,26 @@ int tclprint_to_result_Particle(Tcl_Interp *interp, int part_num)
 
 int tclcommand_part_print_all(Tcl_Interp *interp)
 {
-  int i = 0, start = 1;
+  int start = 1;
 
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   PART_TRACE(fprintf(stderr, "max_seen %d\n", max_seen_particle));
 
-  for (i = 0; i <= max_seen_particle ; i++) {
+  for (int i : particle_node.ids()) {
 
     PART_TRACE(fprintf(stderr, "particle %d\n", i));
 
-    if (particle_node[i] != -1) {
-      if (start) {
-	Tcl_AppendResult(interp, "{", (char *)NULL);
-	start = 0;
-      }
-      else
-	Tcl_AppendResult(interp, " {", (char *)NULL);
-
-      tclprint_to_result_Particle(interp, i);
-      Tcl_AppendResult(interp, "}", (char *)NULL);
+    if (start) {
+      Tcl_AppendResult(interp, "{", (char *)NULL);
+      start = 0;
     }
+    else
+      Tcl_AppendResult(interp, " {", (char *)NULL);
+
+    tclprint_to_result_Particle(interp, i);
+    Tcl_AppendResult(interp, "}", (char *)NULL);
   }
 
   return TCL_OK;
@@ -2266,23 +2275,15 @@ int part_parse_gc(Tcl_Interp *interp, int argc, char **argv){
 		  Tcl_AppendResult(interp, "no negative types", (char *) NULL);
 		  return TCL_ERROR;
 		}
-		if ( type_array!=(TypeList *) 0 && type_array[Index.type[type]].max_entry!= 0 ) {
-			int indexed=0;
-			for ( int i=0; i<Type.max_entry; i++) {
-				if (type==Type.index[i]) {
-					indexed=1;
-					break;
-				}
-			}
-			if ( indexed ) {
-				char buffer[32 + TCL_INTEGER_SPACE];
-				Tcl_AppendResult(interp, "{ ", (char *) NULL);
-				for (int i=0; i<type_array[Index.type[type]].max_entry; i++ ) {
-					sprintf(buffer, "%d ", type_array[Index.type[type]].id_list[i]);
-					Tcl_AppendResult(interp, buffer, (char *) NULL);
-				}
-				Tcl_AppendResult(interp, " }", (char *) NULL);
+		std::vector<int> ids;
+		if ( get_particles_of_type(type, ids) == ES_OK && !ids.empty() ) {
+			char buffer[32 + TCL_INTEGER_SPACE];
+			Tcl_AppendResult(interp, "{ ", (char *) NULL);
+			for (int id : ids) {
+				sprintf(buffer, "%d ", id);
+				Tcl_AppendResult(interp, buffer, (char *) NULL);
 			}
+			Tcl_AppendResult(interp, " }", (char *) NULL);
 		}
 		else {
 			Tcl_AppendResult(interp, "no list for particle", (char *) NULL);
@@ -2373,7 +2374,7 @@ int tclcommand_part_parse_bond(Tcl_Interp *interp, int argc, char **argv,
     const char  **tmp_argv;
     bond = NULL;
 
-    if (!particle_node)
+    if (!particle_node_valid)
       build_particle_node();
     
     Tcl_SplitList(interp, argv[0], &tmp_argc, &tmp_argv);
@@ -2470,7 +2471,7 @@ int tclcommand_part_parse_bond(Tcl_Interp *interp, int argc, char **argv,
       return TCL_ERROR;
     }
 
-    if (!particle_node)
+    if (!particle_node_valid)
       build_particle_node();
 
     bond = (int *)Utils::malloc( (n_partners+1)*sizeof(int) );
@@ -2536,7 +2537,7 @@ int tclcommand_part_parse_exclusion(Tcl_Interp *interp, int argc, char **argv,
   }
 
   /* parse partners */
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
 
   while (argc > 0) {
@@ -2574,7 +2575,7 @@ int tclcommand_part_parse_cmd(Tcl_Interp *interp, int argc, char **argv,
 #endif
 
 #ifdef ADDITIONAL_CHECKS
-  if (!particle_node)
+  if (!particle_node_valid)
     build_particle_node();
   mpi_bcast_event(CHECK_PARTICLES);
 #endif
@@ -2806,6 +2807,104 @@ int tclcommand_part_parse_cmd(Tcl_Interp *interp, int argc, char **argv,
 }
 
 
+int tclcommand_part_parse_bulk(Tcl_Interp *interp, int argc, char **argv)
+{
+  IntList ids, types;
+  DoubleList pos, v, q;
+  int i, err = TCL_OK;
+
+  init_intlist(&ids);
+  init_intlist(&types);
+  init_doublelist(&pos);
+  init_doublelist(&v);
+  init_doublelist(&q);
+
+  while (argc > 0 && err == TCL_OK) {
+    if (argc < 2) {
+      Tcl_AppendResult(interp, "usage: part bulk ids <ids> pos <positions> "
+                       "[v <velocities>] [type <types>] [q <charges>]",
+                       (char *) NULL);
+      err = TCL_ERROR;
+    }
+    else if (ARG0_IS_S("ids")) {
+      if (!ARG1_IS_INTLIST(ids))
+        err = TCL_ERROR;
+    }
+    else if (ARG0_IS_S("pos")) {
+      if (!ARG1_IS_DOUBLELIST(pos))
+        err = TCL_ERROR;
+    }
+    else if (ARG0_IS_S("v")) {
+      if (!ARG1_IS_DOUBLELIST(v))
+        err = TCL_ERROR;
+    }
+    else if (ARG0_IS_S("type")) {
+      if (!ARG1_IS_INTLIST(types))
+        err = TCL_ERROR;
+    }
+    else if (ARG0_IS_S("q")) {
+#ifdef ELECTROSTATICS
+      if (!ARG1_IS_DOUBLELIST(q))
+        err = TCL_ERROR;
+#else
+      Tcl_AppendResult(interp, "q requires the feature ELECTROSTATICS", (char *) NULL);
+      err = TCL_ERROR;
+#endif
+    }
+    else {
+      Tcl_AppendResult(interp, "unknown bulk particle parameter \"",
+                       argv[0],"\"", (char *)NULL);
+      err = TCL_ERROR;
+    }
+    argc -= 2; argv += 2;
+  }
+
+  if (err == TCL_OK) {
+    if (pos.n != 3*ids.n) {
+      Tcl_AppendResult(interp, "pos requires 3 coordinates per particle", (char *) NULL);
+      err = TCL_ERROR;
+    }
+    else if (v.n != 0 && v.n != 3*ids.n) {
+      Tcl_AppendResult(interp, "v requires 3 components per particle", (char *) NULL);
+      err = TCL_ERROR;
+    }
+    else if ((types.n != 0 && types.n != ids.n) || (q.n != 0 && q.n != ids.n)) {
+      Tcl_AppendResult(interp, "type and q require one value per particle", (char *) NULL);
+      err = TCL_ERROR;
+    }
+  }
+
+  if (err == TCL_OK) {
+    for (i = 0; i < types.n; i++)
+      if (types.e[i] < 0) {
+        Tcl_AppendResult(interp, "invalid particle type", (char *) NULL);
+        err = TCL_ERROR;
+        break;
+      }
+  }
+
+  if (err == TCL_OK) {
+    /* velocities are stored in internal units */
+    for (i = 0; i < v.n; i++)
+      v.e[i] *= time_step;
+
+    if (place_particles(ids.n, ids.e, pos.e, types.n ? types.e : NULL,
+                        v.n ? v.e : NULL, q.n ? q.e : NULL) == ES_PART_ERROR) {
+      Tcl_AppendResult(interp, "particles could not be set, ids must be unique "
+                       "and positive", (char *) NULL);
+      err = TCL_ERROR;
+    }
+  }
+
+  realloc_intlist(&ids, 0);
+  realloc_intlist(&types, 0);
+  realloc_doublelist(&pos, 0);
+  realloc_doublelist(&v, 0);
+  realloc_doublelist(&q, 0);
+
+  return gather_runtime_errors(interp, err);
+}
+
 int tclcommand_part(ClientData data, Tcl_Interp *interp,
 	 int argc, char **argv)
 {
@@ -2846,6 +2945,9 @@ int tclcommand_part(ClientData data, Tcl_Interp *interp,
   }
 #endif
 
+  else if (ARG1_IS_S("bulk"))
+    return tclcommand_part_parse_bulk(interp, argc - 2, argv + 2);
+
   else if ( ARG1_IS_S("gc")) {
 	 argc-=2;
 	 argv+=2;
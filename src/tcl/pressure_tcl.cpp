@@ -22,7 +22,10 @@
     Implementation of \ref pressure.hpp "pressure.h".
 */
 #include "pressure.hpp"
+#include "local_stress.hpp"
 #include "parser.hpp"
+#include <algorithm>
+#include <vector>
 
 /************************************************************/
 /* callbacks for setmd                                      */
@@ -682,63 +685,106 @@ int tclcommand_analyze_parse_and_print_stress_tensor(Tcl_Interp *interp, int v_c
   return (TCL_OK);
 }
 
+/** parse the grid of the local stress tensor, either
+    <x_periodic> <y_periodic> <z_periodic> <x_range_start> <y_range_start> <z_range_start> <x_range> <y_range> <z_range> <x_bins> <y_bins> <z_bins>
+    or slab <direction> <bins>. Returns the number of arguments used, or 0 */
+static int parse_local_stress_grid(Tcl_Interp *interp, int argc, char **argv,
+                                   int periodic[3], double range_start[3],
+                                   double range[3], int bins[3])
+{
+  int i;
+  if (argc >= 3 && ARG0_IS_S("slab")) {
+    int dir = -1, n_bins;
+    if (ARG1_IS_S("x")) dir = 0;
+    else if (ARG1_IS_S("y")) dir = 1;
+    else if (ARG1_IS_S("z")) dir = 2;
+    if (dir == -1 || !ARG_IS_I(2, n_bins) || n_bins < 1)
+      return 0;
+    for (i=0;i<3;i++) {
+      periodic[i] = 1;
+      range_start[i] = 0.0;
+      range[i] = box_l[i];
+      bins[i] = 1;
+    }
+    bins[dir] = n_bins;
+    return 3;
+  }
+  if (argc < 12)
+    return 0;
+  for (i=0;i<3;i++) {
+    if (!ARG_IS_I(i, periodic[i]) || !ARG_IS_D(3 + i, range_start[i]) ||
+        !ARG_IS_D(6 + i, range[i]) || !ARG_IS_I(9 + i, bins[i]))
+      return 0;
+  }
+  return 12;
+}
+
+/** print the local stress tensors, 9 per bin */
+static void print_local_stress(Tcl_Interp *interp, const int bins[3],
+                               const double *tensors)
+{
+  char buffer[TCL_DOUBLE_SPACE + 3*TCL_INTEGER_SPACE];
+  int i,j,k,l;
+  Tcl_AppendResult(interp, "{ LocalStressTensor } ", (char *)NULL);
+  for ( i = 0 ; i < bins[0] ; i++) {
+    for ( j = 0 ; j < bins[1] ; j++) {
+      for ( k = 0 ; k < bins[2] ; k++) {
+	Tcl_AppendResult(interp, " { ", (char *)NULL);
+	sprintf(buffer," { %d %d %d } ",i,j,k);
+	Tcl_AppendResult(interp,buffer, (char *)NULL);
+	Tcl_AppendResult(interp, " { ", (char *)NULL);
+	for ( l = 0 ; l < 9 ; l++) {
+	  Tcl_PrintDouble(interp,tensors[9*(i*bins[1]*bins[2]+j*bins[2]+k) + l],buffer);
+	  Tcl_AppendResult(interp, buffer, (char *)NULL);
+	  Tcl_AppendResult(interp, " ", (char *)NULL);
+	}
+	Tcl_AppendResult(interp, " } ", (char *)NULL);
+	Tcl_AppendResult(interp, " } ", (char *)NULL);
+      }
+    }
+  }
+}
+
 int tclcommand_analyze_parse_local_stress_tensor(Tcl_Interp *interp, int argc, char **argv)
 {
-  char buffer[TCL_DOUBLE_SPACE];
   int periodic[3];
   double range_start[3];
   double range[3];
   int bins[3];
-  int i,j,k,l;
+  int i,j;
   DoubleList *TensorInBin;
   PTENSOR_TRACE(fprintf(stderr,"%d: Running tclcommand_analyze_parse_local_stress_tensor\n",this_node));
-  /* 'analyze stress profile ' */
-  if (argc != 12) {
-    Tcl_ResetResult(interp);
-    Tcl_AppendResult(interp, "local_stress_tensor requires 12 inputs: x_periodic, y_periodic, z_periodic, x_range_start, y_range_start, z_range_start, x_range, y_range, z_range, x_bins, y_bins, z_bins", (char *)NULL);
-    return(TCL_ERROR);
-  }
-  const char *usage = "usage: analyse local_stress_tensor <x_periodic> <y_periodic> <z_periodic> <x_range_start> <y_range_start> <z_range_start> <x_range> <y_range> <z_range> <x_bins> <y_bins> <z_bins>";
- 
-  for (i=0;i<3;i++) {
-    if ( !ARG0_IS_I(periodic[i]) ) {
-      Tcl_ResetResult(interp);
-      Tcl_AppendResult(interp,usage, (char *)NULL);
-      return (TCL_ERROR);
-    } else {
-      argc -= 1;
-      argv += 1;
-    }
+  const char *usage = "usage: analyse local_stress_tensor [start] { <x_periodic> <y_periodic> <z_periodic> <x_range_start> <y_range_start> <z_range_start> <x_range> <y_range> <z_range> <x_bins> <y_bins> <z_bins> | slab <x|y|z> <bins> } or analyze local_stress_tensor stop|average";
+
+  /* accumulation during the integration */
+  if (argc == 1 && ARG0_IS_S("stop")) {
+    local_stress_stop();
+    return TCL_OK;
   }
-  for (i=0;i<3;i++) {
-    if ( !ARG0_IS_D(range_start[i]) ) {
-      Tcl_ResetResult(interp);
-      Tcl_AppendResult(interp,usage, (char *)NULL);
-      return (TCL_ERROR);
-    } else {
-      argc -= 1;
-      argv += 1;
-    }
+  if (argc == 1 && ARG0_IS_S("average")) {
+    std::vector<double> tensors;
+    int n_samples;
+    if (local_stress_get(tensors, bins, &n_samples) != ES_OK)
+      return gather_runtime_errors(interp, TCL_ERROR);
+    print_local_stress(interp, bins, tensors.data());
+    return TCL_OK;
   }
-  for (i=0;i<3;i++) {
-    if ( !ARG0_IS_D(range[i]) ) {
+  if (argc > 0 && ARG0_IS_S("start")) {
+    if (parse_local_stress_grid(interp, argc - 1, argv + 1, periodic, range_start, range, bins) != argc - 1) {
       Tcl_ResetResult(interp);
       Tcl_AppendResult(interp,usage, (char *)NULL);
       return (TCL_ERROR);
-    } else {
-      argc -= 1;
-      argv += 1;
     }
+    if (local_stress_start(periodic, range_start, range, bins) != ES_OK)
+      return gather_runtime_errors(interp, TCL_ERROR);
+    return TCL_OK;
   }
-  for (i=0;i<3;i++) {
-    if ( !ARG0_IS_I(bins[i]) ) {
-      Tcl_ResetResult(interp);
-      Tcl_AppendResult(interp,usage, (char *)NULL);
-      return (TCL_ERROR);
-    } else {
-      argc -= 1;
-      argv += 1;
-    }
+
+  /* 'analyze stress profile ' */
+  if (argc == 0 || parse_local_stress_grid(interp, argc, argv, periodic, range_start, range, bins) != argc) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp,usage, (char *)NULL);
+    return (TCL_ERROR);
   }
 
   /* Allocate a doublelist of bins to keep track of stress profile */
@@ -761,29 +807,15 @@ int tclcommand_analyze_parse_local_stress_tensor(Tcl_Interp *interp, int argc, c
   PTENSOR_TRACE(fprintf(stderr,"%d: tclcommand_analyze_parse_local_stress_tensor: finished mpi_local_stress_tensor \n",this_node));
 
   /* Write stress profile to Tcl export */
-  Tcl_AppendResult(interp, "{ LocalStressTensor } ", (char *)NULL);
-  for ( i = 0 ; i < bins[0] ; i++) {
-    for ( j = 0 ; j < bins[1] ; j++) {
-      for ( k = 0 ; k < bins[2] ; k++) {
-	Tcl_AppendResult(interp, " { ", (char *)NULL);
-	sprintf(buffer," { %d %d %d } ",i,j,k);
-	Tcl_AppendResult(interp,buffer, (char *)NULL);
-	Tcl_AppendResult(interp, " { ", (char *)NULL);
-	for ( l = 0 ; l < 9 ; l++) {
-	  Tcl_PrintDouble(interp,TensorInBin[i*bins[1]*bins[2]+j*bins[2]+k].e[l],buffer);
-	  Tcl_AppendResult(interp, buffer, (char *)NULL);
-	  Tcl_AppendResult(interp, " ", (char *)NULL);
-	}
-	Tcl_AppendResult(interp, " } ", (char *)NULL);
-	Tcl_AppendResult(interp, " } ", (char *)NULL);
-      }
-    }
-  }
+  std::vector<double> tensors(9*bins[0]*bins[1]*bins[2]);
+  for ( i = 0 ; i < bins[0]*bins[1]*bins[2] ; i++ )
+    std::copy(TensorInBin[i].e, TensorInBin[i].e + 9, &tensors[9*i]);
+  print_local_stress(interp, bins, tensors.data());
   
   /* Free memory */
   for ( i = 0 ; i < bins[0]*bins[1]*bins[2] ; i++ ) {
     realloc_doublelist(&TensorInBin[i],0);
   }
   free(TensorInBin);
-  return TCL_OK;
+  return gather_runtime_errors(interp, TCL_OK);
 }
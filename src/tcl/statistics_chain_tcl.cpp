@@ -79,22 +79,50 @@ static int tclcommand_analyze_set_parse_chain_topology_check(Tcl_Interp *interp,
   return TCL_OK;
 }
 
+/** this function scans the arguments of the analyses of the current
+    configuration, which run on the nodes: either 'molecules' to use the
+    molecules as chains, or an optional description of the chain
+    structure. The particles do not need to be sorted. */
+
+static int tclcommand_analyze_parse_chain_selection(Tcl_Interp *interp, int argc, char **argv, bool &molecules)
+{
+  molecules = false;
+  if (argc == 1 && ARG0_IS_S("molecules")) {
+    molecules = true;
+    return TCL_OK;
+  }
+  if ((argc != 0) && (argc != 3)) {
+    Tcl_AppendResult(interp, "only chain structure info or molecules required", (char *)NULL);
+    return TCL_ERROR;
+  }
+  if (argc > 0)
+    return tclcommand_analyze_set_parse_chain_topology(interp, argc, argv);
+  return TCL_OK;
+}
+
 int tclcommand_analyze_parse_re(Tcl_Interp *interp, int average, int argc, char **argv)
 {
   /* 'analyze { re | <re> } [<chain_start> <n_chains> <chain_length>]' */
+  /* 'analyze re molecules' */
   char buffer[4*TCL_DOUBLE_SPACE+4];
   double *re;
+  bool molecules;
 
-  if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR)
-    return TCL_ERROR;
-  if ((argc != 0) && (argc != 3)) {
-    Tcl_AppendResult(interp, "only chain structure info required", (char *)NULL);
-    return TCL_ERROR;
+  if (!average) {
+    if (tclcommand_analyze_parse_chain_selection(interp, argc, argv, molecules) == TCL_ERROR)
+      return TCL_ERROR;
+    if (calc_re(&re, molecules) == ES_ERROR) {
+      free(re);
+      return gather_runtime_errors(interp, TCL_ERROR);
+    }
   }
-
-  if (!average)
-    calc_re(&re);
   else {
+    if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR)
+      return TCL_ERROR;
+    if ((argc != 0) && (argc != 3)) {
+      Tcl_AppendResult(interp, "only chain structure info required", (char *)NULL);
+      return TCL_ERROR;
+    }
     if (n_configs == 0) {
       Tcl_AppendResult(interp, "no configurations found! ", (char *)NULL);
       Tcl_AppendResult(interp, "Use 'analyze append' to save some, or 'analyze re' to only look at current state!", (char *)NULL);
@@ -114,17 +142,25 @@ int tclcommand_analyze_parse_re(Tcl_Interp *interp, int average, int argc, char
 int tclcommand_analyze_parse_rg(Tcl_Interp *interp, int average, int argc, char **argv)
 {
   /* 'analyze { rg | <rg> } [<chain_start> <n_chains> <chain_length>]' */
+  /* 'analyze rg molecules' */
   char buffer[4*TCL_DOUBLE_SPACE+4];
   double *rg;
-  if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR)
-    return TCL_ERROR;
-  if ((argc != 0) && (argc != 3)) {
-    Tcl_AppendResult(interp, "only chain structure info required", (char *)NULL);
-    return TCL_ERROR;
+  bool molecules;
+  if (!average) {
+    if (tclcommand_analyze_parse_chain_selection(interp, argc, argv, molecules) == TCL_ERROR)
+      return TCL_ERROR;
+    if (calc_rg(&rg, molecules) == ES_ERROR) {
+      free(rg);
+      return gather_runtime_errors(interp, TCL_ERROR);
+    }
   }
-  if (!average)
-    calc_rg(&rg);
   else {
+    if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR)
+      return TCL_ERROR;
+    if ((argc != 0) && (argc != 3)) {
+      Tcl_AppendResult(interp, "only chain structure info required", (char *)NULL);
+      return TCL_ERROR;
+    }
     if (n_configs == 0) {
       Tcl_AppendResult(interp, "no configurations found! ", (char *)NULL);
       Tcl_AppendResult(interp, "Use 'analyze append' to save some, or 'analyze rg' to only look at current state!", (char *)NULL);
@@ -143,17 +179,25 @@ int tclcommand_analyze_parse_rg(Tcl_Interp *interp, int average, int argc, char
 int tclcommand_analyze_parse_rh(Tcl_Interp *interp, int average, int argc, char **argv)
 {
   /* 'analyze { rh | <rh> } [<chain_start> <n_chains> <chain_length>]' */
+  /* 'analyze rh molecules' */
   char buffer[2*TCL_DOUBLE_SPACE+2];
   double *rh;
-  if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR)
-    return TCL_ERROR;
-  if ((argc != 0) && (argc != 3)) {
-    Tcl_AppendResult(interp, "only chain structure info required", (char *)NULL);
-    return TCL_ERROR;
+  bool molecules;
+  if (!average) {
+    if (tclcommand_analyze_parse_chain_selection(interp, argc, argv, molecules) == TCL_ERROR)
+      return TCL_ERROR;
+    if (calc_rh(&rh, molecules) == ES_ERROR) {
+      free(rh);
+      return gather_runtime_errors(interp, TCL_ERROR);
+    }
   }
-  if (!average)
-    calc_rh(&rh);
   else {
+    if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR)
+      return TCL_ERROR;
+    if ((argc != 0) && (argc != 3)) {
+      Tcl_AppendResult(interp, "only chain structure info required", (char *)NULL);
+      return TCL_ERROR;
+    }
     if (n_configs == 0) {
       Tcl_AppendResult(interp, "no configurations found! ", (char *)NULL);
       Tcl_AppendResult(interp, "Use 'analyze append' to save some, or 'analyze rh' to only look at current state!", (char *)NULL);
@@ -173,15 +217,23 @@ int tclcommand_analyze_parse_rh(Tcl_Interp *interp, int average, int argc, char
 int tclcommand_analyze_parse_internal_dist(Tcl_Interp *interp, int average, int argc, char **argv)
 {
   /* 'analyze { internal_dist | <internal_dist> } [<chain_start> <n_chains> <chain_length>]' */
+  /* 'analyze internal_dist molecules' */
   char buffer[TCL_DOUBLE_SPACE+2];
-  int i;
+  int i, length = chain_length;
   double *idf;
+  bool molecules;
 
-  if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR) return TCL_ERROR;
-  if ((argc != 0) && (argc != 3)) { Tcl_AppendResult(interp, "only chain structure info required", (char *)NULL); return TCL_ERROR; }
-  if (!average)
-    calc_internal_dist(&idf); 
+  if (!average) {
+    if (tclcommand_analyze_parse_chain_selection(interp, argc, argv, molecules) == TCL_ERROR)
+      return TCL_ERROR;
+    if (calc_internal_dist(&idf, &length, molecules) == ES_ERROR) {
+      free(idf);
+      return gather_runtime_errors(interp, TCL_ERROR);
+    }
+  }
   else {
+    if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR) return TCL_ERROR;
+    if ((argc != 0) && (argc != 3)) { Tcl_AppendResult(interp, "only chain structure info required", (char *)NULL); return TCL_ERROR; }
     if (n_configs == 0) {
       Tcl_AppendResult(interp, "no configurations found! ", (char *)NULL);
       Tcl_AppendResult(interp, "Use 'analyze append' to save some, or 'analyze internal_dist' to only look at current state!", (char *)NULL);
@@ -191,7 +243,7 @@ int tclcommand_analyze_parse_internal_dist(Tcl_Interp *interp, int average, int
       calc_internal_dist_av(&idf);
   }
 
-  for (i=0; i<chain_length; i++) { 
+  for (i=0; i<length; i++) { 
     sprintf(buffer,"%f ",idf[i]); Tcl_AppendResult(interp, buffer, (char *)NULL); 
   }
 
@@ -260,28 +312,28 @@ int tclcommand_analyze_parse_bond_dist(Tcl_Interp *interp, int average, int argc
 	   
 int tclcommand_analyze_parse_g123(Tcl_Interp *interp, int average, int argc, char **argv)
 {
-  /* 'analyze g123 [-init] [<chain_start> <n_chains> <chain_length>]' */
+  /* 'analyze g123 [-init] [<chain_start> <n_chains> <chain_length> | molecules]' */
   /********************************************************************/
   char buffer[3*TCL_DOUBLE_SPACE+7];
   int init = 0;
   double g1, g2, g3;
+  bool molecules;
 
   if (argc > 0 && ARG0_IS_S("-init")) {
     init = 1; argc--; argv++; 
   }
-  if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR)
+  if (tclcommand_analyze_parse_chain_selection(interp, argc, argv, molecules) == TCL_ERROR)
     return TCL_ERROR;
-  if ((argc != 0) && (argc != 3)) { Tcl_AppendResult(interp, "only chain structure info required", (char *)NULL); return TCL_ERROR; }
   
-  if (init) { init_g123(); return TCL_OK; }
-  if (partCoord_g == NULL || partCM_g == NULL) {
-    Tcl_AppendResult(interp, "please call with -init first", (char *)NULL); return TCL_ERROR; }
-  if (chain_n_chains != n_chains_g || n_part != n_part_g) {
-    fprintf(stderr, "%d %d %d %d\n", chain_n_chains, n_chains_g, n_part, n_part_g);
-    Tcl_AppendResult(interp, "initial config has different topology", (char *)NULL);
-    return TCL_ERROR;      
+  if (init) {
+    if (init_g123(molecules) == ES_ERROR)
+      return gather_runtime_errors(interp, TCL_ERROR);
+    return TCL_OK;
   }
-  calc_g123(&g1, &g2, &g3);
+  if (n_chains_g == 0) {
+    Tcl_AppendResult(interp, "please call with -init first", (char *)NULL); return TCL_ERROR; }
+  if (calc_g123(&g1, &g2, &g3) == ES_ERROR)
+    return gather_runtime_errors(interp, TCL_ERROR);
   sprintf(buffer,"{ %f %f %f }",g1, g2, g3);
   Tcl_AppendResult(interp, buffer, (char *)NULL);
   return (TCL_OK);
@@ -331,10 +383,12 @@ int tclcommand_analyze_parse_g_av(Tcl_Interp *interp, int what, int argc, char *
 int tclcommand_analyze_parse_formfactor(Tcl_Interp *interp, int average, int argc, char **argv)
 {
   /* 'analyze { formfactor | <formfactor> } <qmin> <qmax> <qbins> [<chain_start> <n_chains> <chain_length>]' */
+  /* 'analyze formfactor <qmin> <qmax> <qbins> molecules' */
   /***********************************************************************************************************/
   char buffer[2*TCL_DOUBLE_SPACE+5];
   int i;
   double qmin,qmax, q,qfak, *ff; int qbins;
+  bool molecules = false;
   if (argc < 3) {
     Tcl_AppendResult(interp, "Wrong # of args! Usage: analyze formfactor <qmin> <qmax> <qbins> [<chain_start> <n_chains> <chain_length>]",
 		     (char *)NULL);
@@ -348,9 +402,12 @@ int tclcommand_analyze_parse_formfactor(Tcl_Interp *interp, int average, int arg
       return (TCL_ERROR);
     argc-=3; argv+=3;
   }
-  if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR) return TCL_ERROR;
+  if (!average) {
+    if (tclcommand_analyze_parse_chain_selection(interp, argc, argv, molecules) == TCL_ERROR) return TCL_ERROR;
+  }
+  else if (tclcommand_analyze_set_parse_chain_topology_check(interp, argc, argv) == TCL_ERROR) return TCL_ERROR;
 
-  if ((chain_n_chains == 0) || (chain_length == 0)) {
+  if (!molecules && ((chain_n_chains == 0) || (chain_length == 0))) {
     Tcl_AppendResult(interp, "The chain topology has not been set",(char *)NULL); return TCL_ERROR;
   }
   
@@ -367,7 +424,12 @@ int tclcommand_analyze_parse_formfactor(Tcl_Interp *interp, int average, int arg
     return TCL_ERROR;
   }
 
-  if (!average) analyze_formfactor(qmin, qmax, qbins, &ff);
+  if (!average) {
+    if (analyze_formfactor(qmin, qmax, qbins, &ff, molecules) == ES_ERROR) {
+      free(ff);
+      return gather_runtime_errors(interp, TCL_ERROR);
+    }
+  }
   else if (n_configs == 0) {
     Tcl_AppendResult(interp, "no configurations found! ", (char *)NULL);
     Tcl_AppendResult(interp, "Use 'analyze append' to save some, or 'analyze formfactor ...' to only look at current state!",
@@ -30,6 +30,7 @@
 #include "statistics_cluster.hpp"
 #include "statistics_cluster_tcl.hpp"
 #include "parser.hpp"
+#include <map>
 
 /** \name Routines */
 /************************************************************/
@@ -237,3 +238,75 @@ int tclcommand_analyze_parse_holes(Tcl_Interp *interp, int argc, char **argv)
 }
 
 /*@}*/
+
+/* parser for the cluster analysis by distance:
+   analyze clusters <r_cut> [types <type_list>] [molecules] [opposite_charges]
+ */
+int tclcommand_analyze_parse_clusters(Tcl_Interp *interp, int argc, char **argv)
+{
+  ClusterCriterion criterion;
+  criterion.first_mol = criterion.last_mol = -1;
+  criterion.molecules = criterion.opposite_charges = false;
+  char buffer[3*TCL_DOUBLE_SPACE + 8];
+
+  if (argc < 1 || !ARG0_IS_D(criterion.r_cut) || criterion.r_cut <= 0.0) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, "usage: analyze clusters <r_cut> [types <type_list>] [molecules] [opposite_charges]", (char *)NULL);
+    return TCL_ERROR;
+  }
+  argc--; argv++;
+  while (argc > 0) {
+    if (ARG0_IS_S("types")) {
+      IntList types;
+      init_intlist(&types);
+      if (argc < 2 || !ARG1_IS_INTLIST(types)) {
+        Tcl_ResetResult(interp);
+        Tcl_AppendResult(interp, "analyze clusters: types needs a list of types", (char *)NULL);
+        realloc_intlist(&types, 0);
+        return TCL_ERROR;
+      }
+      criterion.types.assign(types.e, types.e + types.n);
+      realloc_intlist(&types, 0);
+      argc -= 2; argv += 2;
+    } else if (ARG0_IS_S("molecules")) {
+      criterion.molecules = true;
+      argc--; argv++;
+    } else if (ARG0_IS_S("opposite_charges")) {
+      criterion.opposite_charges = true;
+      argc--; argv++;
+    } else {
+      Tcl_AppendResult(interp, "analyze clusters: unknown option ", argv[0], (char *)NULL);
+      return TCL_ERROR;
+    }
+  }
+
+  ClusterStatistics stats;
+  if (analyze_cluster_statistics(criterion, stats) != ES_OK)
+    return gather_runtime_errors(interp, TCL_ERROR);
+
+  /* number and weight average of the size, and the clusters of each size
+     with their mean radius of gyration */
+  sprintf(buffer, "%d", stats.n_clusters);
+  Tcl_AppendResult(interp, "n_clusters ", buffer, (char *)NULL);
+  sprintf(buffer, "%d", stats.n_percolating);
+  Tcl_AppendResult(interp, " percolating ", buffer, " largest {", (char *)NULL);
+  if (stats.n_clusters > 0) {
+    sprintf(buffer, " %d %d ", stats.largest.size, stats.largest.n_particles);
+    Tcl_AppendResult(interp, buffer, (char *)NULL);
+    Tcl_PrintDouble(interp, stats.largest.rg, buffer);
+    Tcl_AppendResult(interp, buffer, " ", (char *)NULL);
+  }
+  Tcl_AppendResult(interp, "} mean_size ", (char *)NULL);
+  Tcl_PrintDouble(interp, stats.n_clusters == 0 ? 0.0 : stats.sum_size/stats.n_clusters, buffer);
+  Tcl_AppendResult(interp, buffer, " ", (char *)NULL);
+  Tcl_PrintDouble(interp, stats.n_clusters == 0 ? 0.0 : stats.sum_size2/stats.sum_size, buffer);
+  Tcl_AppendResult(interp, buffer, " distribution {", (char *)NULL);
+  for (auto const &d : stats.distribution) {
+    sprintf(buffer, " { %d %d ", d.first, d.second.first);
+    Tcl_AppendResult(interp, buffer, (char *)NULL);
+    Tcl_PrintDouble(interp, d.second.second/d.second.first, buffer);
+    Tcl_AppendResult(interp, buffer, " }", (char *)NULL);
+  }
+  Tcl_AppendResult(interp, " }", (char *)NULL);
+  return TCL_OK;
+}
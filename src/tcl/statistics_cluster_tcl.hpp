@@ -54,4 +54,15 @@ int tclcommand_analyze_parse_necklace(Tcl_Interp *interp, int argc, char **argv)
 */
 int tclcommand_analyze_parse_holes(Tcl_Interp *interp, int argc, char **argv);
 
+/** Parser for the cluster analysis by distance, see \ref analyze_clusters
+
+    \verbatim analyze clusters <r_cut> [types <type_list>] [molecules] [opposite_charges] \endverbatim
+
+    Returns the number of clusters, the number of percolating clusters,
+    the size, number of particles and radius of gyration of the largest
+    cluster, the number and weight average of the size and for every size
+    the number of clusters and their mean radius of gyration.
+*/
+int tclcommand_analyze_parse_clusters(Tcl_Interp *interp, int argc, char **argv);
+
 #endif
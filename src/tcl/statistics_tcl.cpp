@@ -29,7 +29,10 @@
 #include "statistics.hpp"
 #include "statistics_chain_tcl.hpp"
 #include "statistics_molecule.hpp"
+#include "statistics_cluster.hpp"
 #include "statistics_cluster_tcl.hpp"
+#include "statistics_msd.hpp"
+#include "statistics_profiles.hpp"
 #include "statistics_fluid_tcl.hpp"
 #include "statistics_wallstuff_tcl.hpp"
 #include "energy.hpp"
@@ -52,6 +55,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <algorithm>
 
 using std::ostringstream;
 
@@ -937,11 +941,6 @@ static int tclcommand_analyze_parse_aggregation(Tcl_Interp *interp, int argc, ch
     float fagg_avg;
     int s_mol_id, f_mol_id;
 
-    agg_id_list = (int *) Utils::malloc(n_molecules * sizeof (int));
-    head_list = (int *) Utils::malloc(n_molecules * sizeof (int));
-    link_list = (int *) Utils::malloc(n_molecules * sizeof (int));
-    agg_size = (int *) Utils::malloc(n_molecules * sizeof (int));
-
     /* parse arguments */
     if (argc < 3) {
         Tcl_AppendResult(interp, "usage: analyze aggregation <dist_criteria> <start mol_id> <finish mol_id> [<min_contact>] [<charge_criteria>]", (char *) NULL);
@@ -966,27 +965,12 @@ static int tclcommand_analyze_parse_aggregation(Tcl_Interp *interp, int argc, ch
         return (TCL_ERROR);
     }
 
-    if (n_nodes > 1) {
-        Tcl_AppendResult(interp, "aggregation can only be calculated on a single processor", (char *) NULL);
-        return TCL_ERROR;
-    }
-
-    if (cell_structure.type != CELL_STRUCTURE_DOMDEC) {
-        Tcl_AppendResult(interp, "aggregation can only be calculated with the domain decomposition cell system", (char *) NULL);
-        return TCL_ERROR;
-    }
-
-    if ((s_mol_id < 0) || (s_mol_id > n_molecules) || (f_mol_id < 0) || (f_mol_id > n_molecules)) {
+    if ((s_mol_id < 0) || (f_mol_id < s_mol_id)) {
         Tcl_AppendResult(interp, "check your start and finish molecule id's", (char *) NULL);
         return TCL_ERROR;
     }
 
-    if (max_cut_nonbonded < dist_criteria) {
-        Tcl_AppendResult(interp, "dist_criteria is larger than max_cut_nonbonded.", (char *) NULL);
-        return TCL_ERROR;
-    }
-
-    if (argc == 4) {
+    if (argc >= 4) {
         if (!ARG_IS_I(3, min_contact)) {
             Tcl_ResetResult(interp);
             Tcl_AppendResult(interp, "usage: analyze aggregation <dist_criteria> <start mol_id> <finish mol_id> [<min_contact>] [<charge_criteria>]", (char *) NULL);
@@ -1006,6 +990,78 @@ static int tclcommand_analyze_parse_aggregation(Tcl_Interp *interp, int argc, ch
         charge_criteria = 0;
     }
 
+    if (min_contact <= 1) {
+        /* a single contact joins the molecules, which are the clusters of
+           the distributed cluster analysis */
+        ClusterCriterion criterion;
+        criterion.r_cut = dist_criteria;
+        criterion.first_mol = s_mol_id;
+        criterion.last_mol = f_mol_id;
+        criterion.molecules = true;
+        criterion.opposite_charges = charge_criteria;
+        std::vector<DistanceCluster> clusters;
+        if (analyze_clusters(criterion, clusters) != ES_OK)
+            return gather_runtime_errors(interp, TCL_ERROR);
+
+        /* molecules without particles are aggregates of their own */
+        std::map<int, std::vector<int>> aggregates;
+        for (i = s_mol_id; i <= f_mol_id; i++)
+            aggregates[i].assign(1, i);
+        for (const DistanceCluster &c : clusters)
+            for (int mol : c.molecules)
+                aggregates.erase(mol);
+        for (const DistanceCluster &c : clusters)
+            aggregates[c.molecules[0]] = c.molecules;
+
+        agg_min = f_mol_id - s_mol_id + 1;
+        for (auto const &a : aggregates) {
+            int size = a.second.size();
+            agg_num++;
+            agg_avg += size;
+            agg_std += size * size;
+            agg_min = std::min(agg_min, size);
+            agg_max = std::max(agg_max, size);
+        }
+        fagg_avg = (float) (agg_avg) / agg_num;
+        sprintf(buffer, " MAX %d MIN %d AVG %f STD %f AGG_NUM %d AGGREGATES",
+                agg_max, agg_min, fagg_avg, sqrt((float) (agg_std / (float) (agg_num) - fagg_avg * fagg_avg)), agg_num);
+        Tcl_AppendResult(interp, buffer, (char *) NULL);
+        for (auto const &a : aggregates) {
+            Tcl_AppendResult(interp, " { ", (char *) NULL);
+            for (int mol : a.second) {
+                sprintf(buffer, "%d ", mol);
+                Tcl_AppendResult(interp, buffer, (char *) NULL);
+            }
+            Tcl_AppendResult(interp, "} ", (char *) NULL);
+        }
+        return TCL_OK;
+    }
+
+    /* counting the contacts needs the Verlet lists of a single node */
+    if (n_nodes > 1) {
+        Tcl_AppendResult(interp, "aggregation can only be calculated on a single processor", (char *) NULL);
+        return TCL_ERROR;
+    }
+
+    if (cell_structure.type != CELL_STRUCTURE_DOMDEC) {
+        Tcl_AppendResult(interp, "aggregation can only be calculated with the domain decomposition cell system", (char *) NULL);
+        return TCL_ERROR;
+    }
+
+    if (max_cut_nonbonded < dist_criteria) {
+        Tcl_AppendResult(interp, "dist_criteria is larger than max_cut_nonbonded.", (char *) NULL);
+        return TCL_ERROR;
+    }
+
+    if (f_mol_id >= n_molecules) {
+        Tcl_AppendResult(interp, "check your start and finish molecule id's", (char *) NULL);
+        return TCL_ERROR;
+    }
+
+    agg_id_list = (int *) Utils::malloc(n_molecules * sizeof (int));
+    head_list = (int *) Utils::malloc(n_molecules * sizeof (int));
+    link_list = (int *) Utils::malloc(n_molecules * sizeof (int));
+    agg_size = (int *) Utils::malloc(n_molecules * sizeof (int));
 
     aggregation(dist_criteria2, min_contact, s_mol_id, f_mol_id, head_list, link_list, agg_id_list,
             &agg_num, agg_size, &agg_max, &agg_min, &agg_avg, &agg_std, charge_criteria);
@@ -1134,9 +1190,6 @@ static int tclcommand_analyze_parse_cluster_size_dist(Tcl_Interp *interp, int ar
     char buffer[3 * TCL_DOUBLE_SPACE + 3];
     int p1;
     double dist;
-    int i, j, max_cluster_number, size;
-    int cluster_number[n_part]; //cluster number of particle number
-    int cluster_size[n_part + 1]; //number of clusters with some size
 
     /* parse arguments */
     if (argc != 2) {
@@ -1156,50 +1209,20 @@ static int tclcommand_analyze_parse_cluster_size_dist(Tcl_Interp *interp, int ar
         return (TCL_ERROR);
     }
 
-    updatePartCfg(WITHOUT_BONDS);
-    for (i = 0; i < n_part; i++) {
-        cluster_number[i] = 0;
-        cluster_size[i] = 0;
-    }
-    cluster_size[n_part] = 0;
-
-    max_cluster_number = 1;
-    for (i = 0; i < n_part - 1; i++) {
-        //if particle was not marked till now
-        if ((partCfg[i].p.type == p1) && (cluster_number[i] == 0)) {
-            //mark current particle with max_cluster_number
-            cluster_number[i] = max_cluster_number;
-            mark_neighbours(p1, i, dist, cluster_number);
-            max_cluster_number++;
-        }
-    }
-
-    for (i = 0; i < n_part; i++) {
-        if ((partCfg[i].p.type == p1) && (cluster_number[i] == 0)) {
-            Tcl_ResetResult(interp);
-            Tcl_AppendResult(interp, "ERROR: at least one particle is not marked !", (char *) NULL);
-            return (TCL_ERROR);
-        }
-    }
-
-    for (i = 1; i < max_cluster_number; i++) {
-        size = 0;
-        for (j = 0; j < n_part; j++) {
-            //Finding particles belonging to cluster i
-            if ((partCfg[j].p.type == p1) && (cluster_number[j] == i)) {
-                size++;
-            }
-        }
-        cluster_size[size]++;
-    }
+    ClusterCriterion criterion;
+    criterion.r_cut = dist;
+    criterion.types.assign(1, p1);
+    criterion.first_mol = criterion.last_mol = -1;
+    criterion.molecules = criterion.opposite_charges = false;
+    ClusterStatistics stats;
+    if (analyze_cluster_statistics(criterion, stats) != ES_OK)
+        return gather_runtime_errors(interp, TCL_ERROR);
 
     sprintf(buffer, "%i %f", p1, dist);
     Tcl_AppendResult(interp, "{ analyze cluster_size_dist ", buffer, "} {\n", (char *) NULL);
-    for (i = 0; i < n_part + 1; i++) {
-        if (cluster_size[i] != 0) {
-            sprintf(buffer, "%i %i", i, cluster_size[i]);
-            Tcl_AppendResult(interp, "{ ", buffer, " }\n", (char *) NULL);
-        }
+    for (auto const &s : stats.distribution) {
+        sprintf(buffer, "%i %i", s.first, s.second.first);
+        Tcl_AppendResult(interp, "{ ", buffer, " }\n", (char *) NULL);
     }
     Tcl_AppendResult(interp, "}", (char *) NULL);
 
@@ -1316,6 +1339,41 @@ static int tclcommand_analyze_parse_find_principal_axis(Tcl_Interp *interp, int
     return TCL_OK;
 }
 
+/** Parse a flat list of positions, or a list of triples, as given to
+    the points option of nbhood and distto. */
+static bool tclcommand_analyze_parse_points(Tcl_Interp *interp, char *list,
+                                            std::vector<double> &points) {
+    int n;
+    char **elems;
+    if (Tcl_SplitList(interp, list, &n, (const char ***) &elems) != TCL_OK)
+        return false;
+    points.clear();
+    bool ok = true;
+    for (int i = 0; ok && i < n; i++) {
+        int m;
+        char **coords;
+        if (Tcl_SplitList(interp, elems[i], &m, (const char ***) &coords) != TCL_OK) {
+            ok = false;
+            break;
+        }
+        for (int j = 0; ok && j < m; j++) {
+            double x;
+            if (Tcl_GetDouble(interp, coords[j], &x) != TCL_OK)
+                ok = false;
+            else
+                points.push_back(x);
+        }
+        Tcl_Free((char *) coords);
+    }
+    Tcl_Free((char *) elems);
+    if (ok && (points.empty() || points.size() % 3 != 0)) {
+        Tcl_AppendResult(interp, "points needs a list of positions with 3 coordinates each",
+                (char *) NULL);
+        ok = false;
+    }
+    return ok;
+}
+
 static int tclcommand_analyze_parse_nbhood(Tcl_Interp *interp, int argc, char **argv) {
     /* 'analyze nbhood [-planar <x> <y> <z>] { <partid> | <posx> <posy> <posz> } <r_catch> ' */
     int p, i;
@@ -1360,17 +1418,38 @@ static int tclcommand_analyze_parse_nbhood(Tcl_Interp *interp, int argc, char **
 
     }
 
+    /* a batch of positions, answered in one pass over the particles */
+    if (argc == 3 && ARG0_IS_S("points")) {
+        std::vector<double> points;
+        std::vector<std::vector<int> > ids;
+        if (!tclcommand_analyze_parse_points(interp, argv[1], points))
+            return TCL_ERROR;
+        if (!ARG_IS_D(2, r_catch))
+            return TCL_ERROR;
+
+        nbhood(points, r_catch, planedims, ids);
+
+        for (size_t k = 0; k < ids.size(); k++) {
+            Tcl_AppendResult(interp, "{", (char *) NULL);
+            for (i = 0; i < (int) ids[k].size(); i++) {
+                sprintf(buffer, i ? " %d" : "%d", ids[k][i]);
+                Tcl_AppendResult(interp, buffer, (char *) NULL);
+            }
+            Tcl_AppendResult(interp, "} ", (char *) NULL);
+        }
+        return (TCL_OK);
+    }
+
     /* Process obligatory arguments */
     tclcommand_analyze_parse_reference_point(interp, &argc, &argv, pos, &p);
     if (!ARG0_IS_D(r_catch)) {
-        Tcl_AppendResult(interp, "usage: nbhood [planar <x> <y> <z>] { <partid> | <posx> <posy> <posz> } <r_catch> ",
+        Tcl_AppendResult(interp, "usage: nbhood [planar <x> <y> <z>] { <partid> | <posx> <posy> <posz> | points <positions> } <r_catch> ",
                 (char *) NULL);
         return (TCL_ERROR);
     }
     argc--;
     argv++;
 
-    updatePartCfg(WITHOUT_BONDS);
     nbhood(pos, r_catch, &il, planedims);
 
 
@@ -1388,7 +1467,7 @@ static int tclcommand_analyze_parse_distto(Tcl_Interp *interp, int argc, char **
     int p;
     double pos[3];
     char buffer[TCL_DOUBLE_SPACE], usage[150];
-    sprintf(usage, "distto { <partid> | <posx> <posy> <posz> }");
+    sprintf(usage, "distto { <partid> | <posx> <posy> <posz> | points <positions> }");
 
     if (n_part == 0) {
         Tcl_AppendResult(interp, "(no particles)",
@@ -1401,6 +1480,22 @@ static int tclcommand_analyze_parse_distto(Tcl_Interp *interp, int argc, char **
         return TCL_ERROR;
     }
 
+    /* a batch of positions, answered in one pass over the particles */
+    if (argc == 2 && ARG0_IS_S("points")) {
+        std::vector<double> points;
+        if (!tclcommand_analyze_parse_points(interp, argv[1], points))
+            return TCL_ERROR;
+
+        std::vector<double> dist =
+            distto(points, std::vector<int>(points.size()/3, -1));
+
+        for (size_t k = 0; k < dist.size(); k++) {
+            Tcl_PrintDouble(interp, dist[k], buffer);
+            Tcl_AppendResult(interp, k ? " " : "", buffer, (char *) NULL);
+        }
+        return (TCL_OK);
+    }
+
     tclcommand_analyze_parse_reference_point(interp, &argc, &argv, pos, &p);
     if (argc != 0) {
         Tcl_AppendResult(interp, "usage: ", usage, (char *) NULL);
@@ -1768,7 +1863,8 @@ static int tclcommand_analyze_parse_rdf(Tcl_Interp *interp, int average, int arg
         Tcl_AppendResult(interp, " }", (char *) NULL);
     rdf = (double*) Utils::malloc(r_bins * sizeof (double));
 
-    if (!sortPartCfg()) {
+    /* the stored configurations are indexed like partCfg */
+    if (average && !sortPartCfg()) {
         Tcl_AppendResult(interp, "for analyze, store particles consecutively starting with 0.", (char *) NULL);
         return (TCL_ERROR);
     }
@@ -1808,21 +1904,37 @@ int tclcommand_analyze_parse_structurefactor(Tcl_Interp *interp, int argc, char
     /***********************************************************************************************************/
     char buffer[2 * TCL_DOUBLE_SPACE + 4];
     IntList p;
-    int i, type, order;
+    int i, type, order, mesh = 0, cao = 5;
     double qfak, *sf;
     
     init_intlist(&p);
     
     if (argc < 2 || (!ARG0_IS_INTLIST(p)) || (!ARG1_IS_I(order))) {
-        Tcl_AppendResult(interp, "Usage: analyze structurefactor <type_list> <order> [<chain_start> <n_chains> <chain_length>]",
+        Tcl_AppendResult(interp, "Usage: analyze structurefactor <type_list> <order> [mesh <mesh> [<cao>]]",
                 (char *) NULL);
         return (TCL_ERROR);
     }
     argc -= 2;
     argv += 2;
-    
-    updatePartCfg(WITHOUT_BONDS);
-    calc_structurefactor(p.e, p.max, order, &sf);
+
+    if (argc > 0 && ARG0_IS_S("mesh")) {
+        if (argc < 2 || !ARG1_IS_I(mesh) || (argc > 2 && !ARG_IS_I(2, cao))) {
+            Tcl_AppendResult(interp, "Usage: analyze structurefactor <type_list> <order> [mesh <mesh> [<cao>]]",
+                    (char *) NULL);
+            return (TCL_ERROR);
+        }
+    }
+
+    if (mesh > 0) {
+#ifdef FFTW
+        if (calc_structurefactor_mesh(p.e, p.max, order, mesh, cao, &sf) != ES_OK)
+            return gather_runtime_errors(interp, TCL_ERROR);
+#else
+        Tcl_AppendResult(interp, "analyze structurefactor mesh requires FFTW", (char *) NULL);
+        return (TCL_ERROR);
+#endif
+    } else
+        calc_structurefactor(p.e, p.max, order, &sf);
 
     qfak = 2.0 * PI / box_l[0];
     for (i = 0; i < order * order; i++) {
@@ -2107,6 +2219,211 @@ static int tclcommand_analyze_parse_vanhove(Tcl_Interp *interp, int argc, char *
 
 }
 
+static int tclcommand_analyze_parse_msd(Tcl_Interp *interp, int vacf, int argc, char **argv) {
+    /* 'analyze mean_square_displacement|velocity_autocorrelation [types <type_list>] [molecules] [tmax <tmax>]' */
+    char buffer[TCL_DOUBLE_SPACE];
+    const char *usage = vacf
+      ? "usage: analyze velocity_autocorrelation [types <type_list>] [molecules] [tmax <tmax>]"
+      : "usage: analyze mean_square_displacement [types <type_list>] [molecules] [tmax <tmax>]";
+    MSDSelection sel;
+    sel.molecules = false;
+    int tmax = vacf ? n_configs - 2 : n_configs - 1;
+
+    while (argc > 0) {
+        if (ARG0_IS_S("types")) {
+            IntList types;
+            init_intlist(&types);
+            if (argc < 2 || !ARG1_IS_INTLIST(types)) {
+                Tcl_ResetResult(interp);
+                Tcl_AppendResult(interp, usage, (char *) NULL);
+                realloc_intlist(&types, 0);
+                return TCL_ERROR;
+            }
+            sel.types.assign(types.e, types.e + types.n);
+            realloc_intlist(&types, 0);
+            argc -= 2;
+            argv += 2;
+        } else if (ARG0_IS_S("molecules")) {
+            sel.molecules = true;
+            argc--;
+            argv++;
+        } else if (ARG0_IS_S("tmax")) {
+            if (argc < 2 || !ARG1_IS_I(tmax)) {
+                Tcl_ResetResult(interp);
+                Tcl_AppendResult(interp, usage, (char *) NULL);
+                return TCL_ERROR;
+            }
+            argc -= 2;
+            argv += 2;
+        } else {
+            Tcl_AppendResult(interp, usage, (char *) NULL);
+            return TCL_ERROR;
+        }
+    }
+
+    std::vector<double> result;
+    if ((vacf ? calc_vacf(sel, tmax, result) : calc_msd(sel, tmax, result)) != ES_OK)
+        return gather_runtime_errors(interp, TCL_ERROR);
+
+    for (size_t m = 0; m < result.size(); m++) {
+        Tcl_PrintDouble(interp, result[m], buffer);
+        Tcl_AppendResult(interp, buffer, " ", (char *) NULL);
+    }
+    return TCL_OK;
+}
+
+static int tclcommand_analyze_parse_profile_direction(char *arg, int *dir) {
+    if (!strcmp(arg, "x") || !strcmp(arg, "0")) *dir = 0;
+    else if (!strcmp(arg, "y") || !strcmp(arg, "1")) *dir = 1;
+    else if (!strcmp(arg, "z") || !strcmp(arg, "2")) *dir = 2;
+    else return 0;
+    return 1;
+}
+
+static void tclcommand_analyze_print_profile(Tcl_Interp *interp, const ProfileParams &par, const std::vector<double> &values) {
+    char buffer[TCL_DOUBLE_SPACE];
+    int per_bin = profile_values_per_bin(par);
+    if (par.kind == PROFILE_CYLINDRICAL) {
+        for (int r = 0; r < par.bins[1]; r++) {
+            for (int a = 0; a < par.bins[0]; a++) {
+                double head[3] = { (r + 0.5) * par.radius / par.bins[1],
+                                   (a + 0.5) * par.length / par.bins[0] - 0.5 * par.length,
+                                   profile_ring_volume(par, r) };
+                sprintf(buffer, "%d %d", r, a);
+                Tcl_AppendResult(interp, " { ", buffer, (char *) NULL);
+                for (int k = 0; k < 3; k++) {
+                    Tcl_PrintDouble(interp, head[k], buffer);
+                    Tcl_AppendResult(interp, " ", buffer, (char *) NULL);
+                }
+                for (int k = 0; k < per_bin; k++) {
+                    Tcl_PrintDouble(interp, values[(r * par.bins[0] + a) * per_bin + k], buffer);
+                    Tcl_AppendResult(interp, " ", buffer, (char *) NULL);
+                }
+                Tcl_AppendResult(interp, " }", (char *) NULL);
+            }
+        }
+    } else {
+        for (int b = 0; b < par.bins[0]; b++) {
+            Tcl_PrintDouble(interp, (b + 0.5) * box_l[par.dir] / par.bins[0], buffer);
+            Tcl_AppendResult(interp, " { ", buffer, (char *) NULL);
+            for (int k = 0; k < per_bin; k++) {
+                Tcl_PrintDouble(interp, values[b * per_bin + k], buffer);
+                Tcl_AppendResult(interp, " ", buffer, (char *) NULL);
+            }
+            Tcl_AppendResult(interp, " }", (char *) NULL);
+        }
+    }
+}
+
+static int tclcommand_analyze_parse_profile(Tcl_Interp *interp, int argc, char **argv) {
+    /* 'analyze profile density|cylindrical|diffusion <parameters> [types <type_list>] [every <steps>]'
+       'analyze profile [reset|remove] <id>' */
+    char buffer[TCL_INTEGER_SPACE];
+    const char *usage = "usage: analyze profile density <dir> <bins> | "
+      "cylindrical <center> <axis> <length> <radius> <bins_axial> <bins_radial> | "
+      "diffusion <dir> <xmin> <xmax> <bins> <lag> [types <type_list>] [every <steps>], "
+      "or analyze profile [reset|remove] <id>";
+    int id;
+
+    if (argc == 1 && ARG0_IS_I(id)) {
+        std::vector<double> values;
+        int n_samples;
+        if (profile_get(id, values, &n_samples) != ES_OK)
+            return gather_runtime_errors(interp, TCL_ERROR);
+        tclcommand_analyze_print_profile(interp, *profile_params(id), values);
+        return TCL_OK;
+    }
+    if (argc == 2 && (ARG0_IS_S("reset") || ARG0_IS_S("remove"))) {
+        if (!ARG1_IS_I(id)) {
+            Tcl_ResetResult(interp);
+            Tcl_AppendResult(interp, usage, (char *) NULL);
+            return TCL_ERROR;
+        }
+        if ((ARG0_IS_S("reset") ? profile_reset(id) : profile_remove(id)) != ES_OK)
+            return gather_runtime_errors(interp, TCL_ERROR);
+        return TCL_OK;
+    }
+
+    ProfileParams par;
+    par.every = 1;
+    par.bins[0] = par.bins[1] = 1;
+    par.dir = 0;
+    par.length = par.radius = par.xmin = par.xmax = 0.0;
+    par.lag = 0;
+    for (int d = 0; d < 3; d++)
+        par.center[d] = par.axis[d] = 0.0;
+
+    int n_args;
+    if (argc >= 3 && ARG0_IS_S("density")) {
+        par.kind = PROFILE_DENSITY;
+        if (!tclcommand_analyze_parse_profile_direction(argv[1], &par.dir) || !ARG_IS_I(2, par.bins[0]))
+            n_args = 0;
+        else
+            n_args = 3;
+    } else if (argc >= 7 && ARG0_IS_S("cylindrical")) {
+        DoubleList center, axis;
+        init_doublelist(&center);
+        init_doublelist(&axis);
+        par.kind = PROFILE_CYLINDRICAL;
+        if (!ARG_IS_DOUBLELIST(1, center) || center.n != 3 ||
+            !ARG_IS_DOUBLELIST(2, axis) || axis.n != 3 ||
+            !ARG_IS_D(3, par.length) || !ARG_IS_D(4, par.radius) ||
+            !ARG_IS_I(5, par.bins[0]) || !ARG_IS_I(6, par.bins[1]))
+            n_args = 0;
+        else {
+            std::copy(center.e, center.e + 3, par.center);
+            std::copy(axis.e, axis.e + 3, par.axis);
+            n_args = 7;
+        }
+        realloc_doublelist(&center, 0);
+        realloc_doublelist(&axis, 0);
+    } else if (argc >= 6 && ARG0_IS_S("diffusion")) {
+        par.kind = PROFILE_DIFFUSION;
+        if (!tclcommand_analyze_parse_profile_direction(argv[1], &par.dir) ||
+            !ARG_IS_D(2, par.xmin) || !ARG_IS_D(3, par.xmax) ||
+            !ARG_IS_I(4, par.bins[0]) || !ARG_IS_I(5, par.lag))
+            n_args = 0;
+        else
+            n_args = 6;
+    } else
+        n_args = 0;
+    if (n_args == 0) {
+        Tcl_ResetResult(interp);
+        Tcl_AppendResult(interp, usage, (char *) NULL);
+        return TCL_ERROR;
+    }
+    argc -= n_args;
+    argv += n_args;
+
+    while (argc > 0) {
+        if (argc >= 2 && ARG0_IS_S("types")) {
+            IntList types;
+            init_intlist(&types);
+            if (!ARG1_IS_INTLIST(types)) {
+                Tcl_ResetResult(interp);
+                Tcl_AppendResult(interp, usage, (char *) NULL);
+                realloc_intlist(&types, 0);
+                return TCL_ERROR;
+            }
+            par.types.assign(types.e, types.e + types.n);
+            realloc_intlist(&types, 0);
+        } else if (argc < 2 || !ARG0_IS_S("every") || !ARG1_IS_I(par.every)) {
+            Tcl_ResetResult(interp);
+            Tcl_AppendResult(interp, usage, (char *) NULL);
+            return TCL_ERROR;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    id = profile_add(par);
+    if (id < 0)
+        return gather_runtime_errors(interp, TCL_ERROR);
+    sprintf(buffer, "%d", id);
+    Tcl_AppendResult(interp, buffer, (char *) NULL);
+    return TCL_OK;
+}
+
 int tclcommand_analyze_current(Tcl_Interp *interp, int argc, char **argv) {
     /* 'analyze current' */
     /***************************************************************************/
@@ -2297,7 +2614,7 @@ static int tclcommand_analyze_parse_configs(Tcl_Interp *interp, int argc, char *
         for (i = 0; i < n_configs; i++) {
             Tcl_AppendResult(interp, "{ ", (char *) NULL);
             for (j = 0; j < n_part_conf; j++) {
-                sprintf(buffer, "%f %f %f ", configs[i][3 * j], configs[i][3 * j + 1], configs[i][3 * j + 2]);
+                sprintf(buffer, "%f %f %f ", get_config(i)[3 * j], get_config(i)[3 * j + 1], get_config(i)[3 * j + 2]);
                 Tcl_AppendResult(interp, buffer, (char *) NULL);
             }
             Tcl_AppendResult(interp, "} ", (char *) NULL);
@@ -2311,7 +2628,7 @@ static int tclcommand_analyze_parse_configs(Tcl_Interp *interp, int argc, char *
             return TCL_ERROR;
         }
         for (j = 0; j < n_part_conf; j++) {
-            sprintf(buffer, "%f %f %f ", configs[i][3 * j], configs[i][3 * j + 1], configs[i][3 * j + 2]);
+            sprintf(buffer, "%f %f %f ", get_config(i)[3 * j], get_config(i)[3 * j + 1], get_config(i)[3 * j + 2]);
             Tcl_AppendResult(interp, buffer, (char *) NULL);
         }
         return (TCL_OK);
@@ -2337,6 +2654,30 @@ static int tclcommand_analyze_parse_configs(Tcl_Interp *interp, int argc, char *
     return TCL_ERROR;
 }
 
+static int tclcommand_analyze_parse_map(Tcl_Interp *interp, int argc, char **argv) {
+    /* 'analyze map <trajectory> [<window>]' */
+    /*******************************************/
+    char buffer[TCL_INTEGER_SPACE];
+    int window = 0;
+
+    if (argc != 1 && argc != 2) {
+        Tcl_AppendResult(interp, "Wrong # of args! Usage: analyze map <trajectory> [<window>]", (char *) NULL);
+        return TCL_ERROR;
+    }
+    if (argc == 2 && (!ARG1_IS_I(window) || window < 0)) {
+        Tcl_ResetResult(interp);
+        Tcl_AppendResult(interp, "the window has to be a non-negative number of frames", (char *) NULL);
+        return TCL_ERROR;
+    }
+    if (analyze_map_configs(argv[0]) == ES_ERROR)
+        return TCL_ERROR;
+    if (argc == 2)
+        set_config_window(window);
+    sprintf(buffer, "%d", n_configs);
+    Tcl_AppendResult(interp, buffer, (char *) NULL);
+    return TCL_OK;
+}
+
 static int tclcommand_analyze_parse_activate(Tcl_Interp *interp, int argc, char **argv) {
     /* 'analyze replace <index>' */
     /*****************************/
@@ -2540,17 +2881,22 @@ double tclcommand_analyze_print_MSD(Tcl_Interp *interp, int type_m, int n_time_s
         p_z[i] = p_com[2];
     }
 
-    for (j = 0; j < n_part; j++) {
-        if ((partCfg[j].p.type == type_m) || (type_m == -1)) {
+    for (j = 0; j < n_part; j++)
+        if ((partCfg[j].p.type == type_m) || (type_m == -1))
             MSD_particles++; //count particles for MSD
-            for (i = start_value; i < n_configs; i++) {
-                p1[0] = configs[i][3 * j ] - p_x[i];
-                p1[1] = configs[i][3 * j + 1] - p_y[i];
-                p1[2] = configs[i][3 * j + 2] - p_z[i];
-                for (k = i; k < n_configs; k++) {
-                    p2[0] = configs[k][3 * j ] - p_x[k];
-                    p2[1] = configs[k][3 * j + 1] - p_y[k];
-                    p2[2] = configs[k][3 * j + 2] - p_z[k];
+
+    /* the particles are the inner loop, so that mapped configurations
+       are decoded once per pair */
+    for (i = start_value; i < n_configs; i++) {
+        for (k = i; k < n_configs; k++) {
+            for (j = 0; j < n_part; j++) {
+                if ((partCfg[j].p.type == type_m) || (type_m == -1)) {
+                    p1[0] = get_config(i)[3 * j ] - p_x[i];
+                    p1[1] = get_config(i)[3 * j + 1] - p_y[i];
+                    p1[2] = get_config(i)[3 * j + 2] - p_z[i];
+                    p2[0] = get_config(k)[3 * j ] - p_x[k];
+                    p2[1] = get_config(k)[3 * j + 1] - p_y[k];
+                    p2[2] = get_config(k)[3 * j + 2] - p_z[k];
                     MSD[k - i] += distance2(p1, p2);
                 }
             }
@@ -2575,27 +2921,10 @@ double tclcommand_analyze_print_MSD(Tcl_Interp *interp, int type_m, int n_time_s
 }
 
 static int tclcommand_analyze_parse_and_print_dipole(Tcl_Interp *interp, int argc, char **argv) {
-    int i, k;
+    int k;
     char buffer[TCL_DOUBLE_SPACE];
-    double dipole[3], total_q = 0.0;
-    updatePartCfg(WITHOUT_BONDS);
-    if (!sortPartCfg()) {
-        ostringstream msg;
-        msg <<"tclcommand_analyze_parse_and_print_dipole: could not sort particle config, particle ids not consecutive?";
-        runtimeError(msg);
-        return TCL_ERROR;
-    }
-    for (i = 0; i < 3; i++) {
-        dipole[i] = 0;
-    }
-    for (i = 0; i < n_part; i++) {
-#ifdef ELECTROSTATICS
-        total_q += partCfg[i].p.q;
-        for (k = 0; k < 3; k++) {
-            dipole[k] += partCfg[i].r.p[k] * partCfg[i].p.q;
-        }
-#endif       
-    }
+    double dipole[3], total_q;
+    calc_dipole_moment(dipole, &total_q);
     Tcl_AppendResult(interp, "{ dipolemoment_normal ", (char *) NULL);
     for (k = 0; k < 3; k++) {
         sprintf(buffer, "%e ", dipole[k]);
@@ -2657,7 +2986,7 @@ static int tclcommand_analyze_parse_MSD(Tcl_Interp *interp, int argc, char **arg
 }
 
 static int tclcommand_analyze_parse_and_print_energy_kinetic(Tcl_Interp *interp, int argc, char **argv) {
-    int i, type;
+    int type;
     char buffer[TCL_DOUBLE_SPACE];
     double E_kin = 0;
 
@@ -2670,18 +2999,7 @@ static int tclcommand_analyze_parse_and_print_energy_kinetic(Tcl_Interp *interp,
         Tcl_AppendResult(interp, "usage: analyze energy_kinetic <type> where type is int", (char *) NULL);
         return (TCL_ERROR);
     }
-    updatePartCfg(WITHOUT_BONDS);
-    for (i = 0; i < n_part; i++) {
-        if (partCfg[i].p.type == type) {
-#ifdef MULTI_TIMESTEP
-            if (smaller_time_step > 0.)
-                E_kin += (partCfg[i]).p.mass * SQR(time_step/smaller_time_step) * sqrlen(partCfg[i].m.v);
-            else
-#endif
-                E_kin += (partCfg[i]).p.mass * sqrlen(partCfg[i].m.v);
-        }
-    }
-    E_kin *= 0.5 / time_step / time_step;
+    E_kin = calc_energy_kinetic(type);
     Tcl_PrintDouble(interp, E_kin, buffer);
     ;
     Tcl_AppendResult(interp, buffer, (char *) NULL);
@@ -2763,9 +3081,9 @@ int tclcommand_analyze(ClientData data, Tcl_Interp *interp, int argc, char **arg
     REGISTER_ANALYSIS_WARN("lipid_orient_order", tclcommand_analyze_parse_lipid_orient_order)
 #endif
     REGISTER_ANALYSIS_WARN("mol", tclcommand_analyze_parse_mol)
-    REGISTER_ANALYSIS_WARN("cluster_size_dist", tclcommand_analyze_parse_cluster_size_dist)
+    REGISTER_ANALYSIS("cluster_size_dist", tclcommand_analyze_parse_cluster_size_dist);
     REGISTER_ANALYSIS("mindist", tclcommand_analyze_parse_mindist);
-    REGISTER_ANALYSIS_WARN("aggregation", tclcommand_analyze_parse_aggregation)
+    REGISTER_ANALYSIS("aggregation", tclcommand_analyze_parse_aggregation);
     REGISTER_ANALYSIS("centermass", tclcommand_analyze_parse_centermass);
     REGISTER_ANALYSIS_WARN("angularmomentum", tclcommand_analyze_parse_angularmomentum)
     REGISTER_ANALYSIS_WARN("MSD", tclcommand_analyze_parse_MSD)
@@ -2816,6 +3134,7 @@ int tclcommand_analyze(ClientData data, Tcl_Interp *interp, int argc, char **arg
     REGISTER_ANALYSIS_W_ARG("<formfactor>", tclcommand_analyze_parse_formfactor, 1);
     REGISTER_ANALYSIS_WARN("necklace", tclcommand_analyze_parse_necklace)
     REGISTER_ANALYSIS_WARN("holes", tclcommand_analyze_parse_holes)
+    REGISTER_ANALYSIS("clusters", tclcommand_analyze_parse_clusters);
     REGISTER_ANALYSIS_WARN("distribution", tclcommand_analyze_parse_distribution)
     REGISTER_ANALYSIS_WARN("vel_distr", tclcommand_analyze_parse_vel_distr)
     REGISTER_ANALYSIS_W_ARG("rdf", tclcommand_analyze_parse_rdf, 0);
@@ -2829,6 +3148,9 @@ int tclcommand_analyze(ClientData data, Tcl_Interp *interp, int argc, char **arg
     REGISTER_ANALYSIS("<density_profile>", tclcommand_analyze_parse_density_profile_av);
     REGISTER_ANALYSIS("<diffusion_profile>", tclcommand_analyze_parse_diffusion_profile);
     REGISTER_ANALYSIS_WARN("vanhove", tclcommand_analyze_parse_vanhove)
+    REGISTER_ANALYSIS_W_ARG("mean_square_displacement", tclcommand_analyze_parse_msd, 0);
+    REGISTER_ANALYSIS_W_ARG("velocity_autocorrelation", tclcommand_analyze_parse_msd, 1);
+    REGISTER_ANALYSIS("profile", tclcommand_analyze_parse_profile);
     REGISTER_ANALYZE_STORAGE("append", tclcommand_analyze_parse_append);
     REGISTER_ANALYZE_STORAGE("push", tclcommand_analyze_parse_push);
     REGISTER_ANALYZE_STORAGE("replace", tclcommand_analyze_parse_replace);
@@ -2836,6 +3158,7 @@ int tclcommand_analyze(ClientData data, Tcl_Interp *interp, int argc, char **arg
     REGISTER_ANALYZE_STORAGE("remove", tclcommand_analyze_parse_remove);
     REGISTER_ANALYZE_STORAGE("stored", tclcommand_analyze_parse_stored);
     REGISTER_ANALYZE_STORAGE("configs", tclcommand_analyze_parse_configs);
+    REGISTER_ANALYZE_STORAGE("map", tclcommand_analyze_parse_map);
 #ifdef CONFIGTEMP
     REGISTER_ANALYSIS("configtemp", tclcommand_analyze_parse_and_print_configtemp);
 #endif
@@ -0,0 +1,47 @@
+/*
+  Copyright (C) 2010,2011,2012,2013,2014,2015,2016 The ESPResSo project
+  Copyright (C) 2002,2003,2004,2005,2006,2007,2008,2009,2010 
+    Max-Planck-Institute for Polymer Research, Theory Group
+  
+  This file is part of ESPResSo.
+  
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+#include "system_state.hpp"
+#include "system_state_tcl.hpp"
+
+int tclcommand_system_state(ClientData data, Tcl_Interp *interp,
+                            int argc, char *argv[])
+{
+  int ret;
+
+  if (argc != 3) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " <filename> write | read",
+                     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (ARG_IS_S(2, "write")) {
+    ret = system_state_write(argv[1]);
+  } else if (ARG_IS_S(2, "read")) {
+    ret = system_state_read(argv[1]);
+  } else {
+    Tcl_AppendResult(interp, "unknown operation \"", argv[2],
+                     "\", should be \"write\" or \"read\"", (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  return gather_runtime_errors(interp, (ret == ES_OK) ? TCL_OK : TCL_ERROR);
+}
@@ -0,0 +1,33 @@
+/*
+  Copyright (C) 2010,2011,2012,2013,2014,2015,2016 The ESPResSo project
+  Copyright (C) 2002,2003,2004,2005,2006,2007,2008,2009,2010 
+    Max-Planck-Institute for Polymer Research, Theory Group
+  
+  This file is part of ESPResSo.
+  
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+/** \file system_state_tcl.hpp
+ *  Tcl interface for the binary system state, see \ref system_state.hpp.
+ */
+#ifndef _SYSTEM_STATE_TCL_H
+#define _SYSTEM_STATE_TCL_H
+
+#include "parser.hpp"
+
+/** System state Tcl command. First argument is a file name, second
+ *  argument the operation: "write" stores the interaction and
+ *  integration setup, "read" restores it on all nodes.
+ */
+int tclcommand_system_state(ClientData data, Tcl_Interp *interp,
+                            int argc, char *argv[]);
+
+#endif
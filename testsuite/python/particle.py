@@ -139,6 +139,30 @@ class ParticleProperties(ut.TestCase):
             "dip", np.array([0.5, -0.5, 3]))
         test_dipm = generateTestForScalarProperty("dipm", -9.7)
 
+    def test_arrays(self):
+        ids = np.arange(100, 110)
+        pos = np.random.random((10, 3))
+        v = np.random.random((10, 3))
+        types = np.arange(10) % 3
+        self.es.part.add(id=ids, pos=pos, v=v, type=types)
+
+        arrays = self.es.part.arrays(100, 110)
+        self.assertTrue(np.all(arrays["id"] == ids))
+        self.assertTrue(np.all(arrays["type"] == types))
+        self.assertTrue(np.allclose(arrays["pos"], pos, atol=self.tol))
+        self.assertTrue(np.allclose(arrays["v"], v, atol=self.tol))
+        for i in ids:
+            self.assertTrue(self.arraysNearlyEqual(
+                arrays["pos"][i - 100], self.es.part[i].pos))
+
+        # the snapshot is refreshed when a particle changes
+        self.es.part[105].v = (1., 2., 3.)
+        arrays = self.es.part.arrays(105, 106)
+        self.assertTrue(self.arraysNearlyEqual(arrays["v"][0], (1., 2., 3.)))
+
+        for i in ids:
+            self.es.part[i].remove()
+
     if "VIRTUAL_SITES" in espressomd.features():
         test_virtual = generateTestForScalarProperty("virtual", 1)
     if "VIRTUAL_SITES_RELATIVE" in espressomd.features():
@@ -0,0 +1,119 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that configurations mapped from a compressed trajectory give
+# the same analysis results as configurations stored in memory.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase analyze_map.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+
+set n 200
+expr srand(42)
+for { set i 0 } { $i < $n } { incr i } {
+  part $i pos [expr $l*rand()] [expr $l*rand()] [expr $l*rand()]
+}
+
+set file "analyze_map.[pid].trj"
+set prec 0.0001
+set nframes 10
+set tmax 3
+
+proc check_configs { reference which } {
+  global prec nframes
+  for { set f 0 } { $f < $nframes } { incr f } {
+    foreach x [analyze configs $f] y [lindex $reference $f] {
+      # the configurations are printed with 6 digits
+      if { abs($x - $y) > 0.5 * $prec + 1e-6 } {
+        error "$which: configuration $f differs: $x vs $y"
+      }
+    }
+  }
+}
+
+proc check_msd { reference which } {
+  global tmax
+  set msd [lindex [analyze vanhove 0 0.0 5.0 50 $tmax] 0 1]
+  foreach x $msd y $reference {
+    if { abs($x - $y) > 1e-4 * $y } {
+      error "$which: msd differs: $msd vs $reference"
+    }
+  }
+}
+
+if { [catch {
+  for { set f 0 } { $f < $nframes } { incr f } {
+    integrate 20
+    analyze append
+    ctraj $file write precision $prec
+  }
+  set reference [analyze configs]
+  set reference_msd [lindex [analyze vanhove 0 0.0 5.0 50 $tmax] 0 1]
+  if { [llength $reference_msd] != $tmax } {
+    error "wrong msd: $reference_msd"
+  }
+  analyze remove
+
+  # a window smaller than the trajectory
+  if { [analyze map $file 4] != $nframes } {
+    error "trajectory was not mapped"
+  }
+  check_configs $reference "mapped"
+  check_msd $reference_msd "mapped"
+  # the frames that left the window are decoded again
+  check_configs $reference "after vanhove"
+
+  # a mapped frame can be replaced
+  analyze remove 0
+  if { [analyze map $file 0] != 2 * $nframes - 1 } {
+    error "trajectory was not mapped again"
+  }
+  analyze replace 0
+  set i 0
+  foreach { x y z } [analyze configs 0] {
+    foreach a [list $x $y $z] b [part $i print pos] {
+      if { abs($a - $b) > 1e-5 } {
+        error "replaced configuration differs for particle $i"
+      }
+    }
+    incr i
+  }
+  for { set f 0 } { $f < $nframes - 1 } { incr f } {
+    analyze remove 0
+  }
+  check_configs $reference "mapped again"
+  analyze remove
+
+  if { ![catch { analyze map "$file.missing" }] } {
+    error "a missing trajectory was mapped"
+  }
+} res ] } {
+  file delete $file
+  error_exit $res
+}
+
+file delete $file
+
+exit 0
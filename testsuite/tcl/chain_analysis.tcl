@@ -0,0 +1,226 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks the distributed chain analyses, for the chain structure and for
+# molecules of different lengths, against the same quantities calculated
+# in Tcl.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase chain_analysis.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 6.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat off
+
+proc check { what res ref } {
+  if { [llength $res] != [llength $ref] } {
+    error "$what: got $res, expected $ref"
+  }
+  foreach x $res y $ref {
+    if { abs($x - $y) > 1e-5 * (1.0 + abs($y)) } {
+      error "$what: got $res, expected $ref"
+    }
+  }
+}
+
+proc dist2 { a b } {
+  set d2 0.0
+  foreach x $a y $b { set d2 [expr $d2 + ($x - $y)*($x - $y)] }
+  return $d2
+}
+
+proc mean_and_dev { values } {
+  set s 0.0; set s2 0.0
+  foreach v $values { set s [expr $s + $v]; set s2 [expr $s2 + $v*$v] }
+  set n [llength $values]
+  set m [expr $s/$n]
+  return [list $m [expr sqrt(abs($s2/$n - $m*$m))]]
+}
+
+proc center { chain } {
+  set cm {0.0 0.0 0.0}
+  set M 0.0
+  foreach i $chain {
+    set m [part $i print mass]
+    set cm [vecadd $cm [vecscale $m [part $i print pos]]]
+    set M [expr $M + $m]
+  }
+  return [vecscale [expr 1.0/$M] $cm]
+}
+
+# the reference values of re, rg, rh, internal_dist and formfactor for
+# chains given as lists of particle ids
+proc reference { chains } {
+  set re {}; set rg {}; set rh {}
+  set max_n 0
+  foreach chain $chains {
+    set n [llength $chain]
+    if { $n > $max_n } { set max_n $n }
+    set d2 [dist2 [part [lindex $chain 0] print pos] [part [lindex $chain end] print pos]]
+    lappend re $d2
+    set cm [center $chain]
+    set s 0.0
+    foreach i $chain { set s [expr $s + [dist2 [part $i print pos] $cm]] }
+    lappend rg [expr $s/$n]
+    set ri 0.0
+    for { set a 0 } { $a < $n } { incr a } {
+      for { set b [expr $a + 1] } { $b < $n } { incr b } {
+        set ri [expr $ri + 1.0/sqrt([dist2 [part [lindex $chain $a] print pos] [part [lindex $chain $b] print pos]])]
+      }
+    }
+    lappend rh [expr 0.5*$n*$n/$ri]
+  }
+  set res(re) {}
+  set res(rg) {}
+  foreach q { re rg } {
+    set sq {}
+    set sq2 {}
+    foreach v [set $q] { lappend sq [expr sqrt($v)]; lappend sq2 [expr $v] }
+    set res($q) [concat [mean_and_dev $sq] [mean_and_dev $sq2]]
+  }
+  set res(rh) [mean_and_dev $rh]
+
+  set res(idf) 0.0
+  for { set k 1 } { $k < $max_n } { incr k } {
+    set s 0.0; set cnt 0
+    foreach chain $chains {
+      for { set j 0 } { $j + $k < [llength $chain] } { incr j } {
+        set s [expr $s + [dist2 [part [lindex $chain $j] print pos] [part [lindex $chain [expr $j + $k]] print pos]]]
+        incr cnt
+      }
+    }
+    lappend res(idf) [expr sqrt($s/$cnt)]
+  }
+
+  set res(ff) {}
+  set q 1.0
+  set qfak [expr pow(10.0, 1.0/4)]
+  for { set qi 0 } { $qi <= 4 } { incr qi } {
+    set ff 0.0
+    foreach chain $chains {
+      set n [llength $chain]
+      set s $n
+      for { set a 0 } { $a < $n } { incr a } {
+        for { set b [expr $a + 1] } { $b < $n } { incr b } {
+          set qr [expr $q*sqrt([dist2 [part [lindex $chain $a] print pos] [part [lindex $chain $b] print pos]])]
+          set s [expr $s + 2*sin($qr)/$qr]
+        }
+      }
+      set ff [expr $ff + $s/$n]
+    }
+    lappend res(ff) $q [expr $ff/[llength $chains]]
+    set q [expr $q*$qfak]
+  }
+  return [array get res]
+}
+
+# random walks, which cross the periodic boundaries
+proc random_walk { first n } {
+  global l
+  set pos [list [expr $l*[t_random]] [expr $l*[t_random]] [expr $l*[t_random]]]
+  set ids {}
+  for { set i $first } { $i < $first + $n } { incr i } {
+    eval part $i pos $pos
+    if { [has_feature MASS] } { part $i mass [expr 0.5 + [t_random]] }
+    lappend ids $i
+    set pos [vecadd $pos [list [expr [t_random] - 0.5] [expr [t_random] - 0.5] [expr 1.5*[t_random]]]]
+  }
+  return $ids
+}
+
+proc check_chains { what args } {
+  upvar chains chains
+  array set ref [reference $chains]
+  check "$what re" [eval analyze re $args] $ref(re)
+  check "$what rg" [eval analyze rg $args] $ref(rg)
+  check "$what rh" [eval analyze rh $args] $ref(rh)
+  check "$what internal_dist" [eval analyze internal_dist $args] $ref(idf)
+  check "$what formfactor" [join [eval analyze formfactor 1.0 10.0 4 $args]] $ref(ff)
+}
+
+if { [catch {
+  ############## chain structure
+  set chains {}
+  for { set c 0 } { $c < 6 } { incr c } {
+    lappend chains [random_walk [expr 8*$c] 8]
+  }
+  # particles after the chains are ignored
+  part 48 pos 1 1 1
+  check_chains "chains" 0 6 8
+  check_chains "set chains"
+
+  if { ![catch { analyze rg 0 7 8 }] } {
+    error "an incomplete chain was accepted"
+  }
+
+  ############## molecules of different lengths
+  part delete
+  set chains {}
+  set first 0
+  set mol 0
+  foreach n { 3 12 5 2 9 } {
+    set ids [random_walk $first $n]
+    foreach i $ids { part $i molecule_id $mol }
+    lappend chains $ids
+    incr first $n
+    incr mol
+  }
+  # a molecule of one particle is no chain
+  part $first pos 2 2 2 molecule_id $mol
+  check_chains "molecules" molecules
+
+  ############## g123
+  analyze g123 -init molecules
+  set initial {}
+  set cms {}
+  foreach chain $chains {
+    foreach i $chain { lappend initial [part $i print pos] }
+    lappend cms [center $chain]
+  }
+  foreach chain $chains {
+    foreach i $chain {
+      eval part $i pos [vecadd [part $i print pos] [list [expr 2*[t_random]] [t_random] -1.0]]
+    }
+  }
+  set g1 0.0; set g2 0.0; set g3 0.0; set k 0; set n 0
+  foreach chain $chains cm0 $cms {
+    set dcm [vecsub [center $chain] $cm0]
+    foreach i $chain {
+      set d [vecsub [part $i print pos] [lindex $initial $k]]
+      set g1 [expr $g1 + [dist2 $d {0 0 0}]]
+      set g2 [expr $g2 + [dist2 $d $dcm]]
+      incr k
+    }
+    set g3 [expr $g3 + [dist2 $dcm {0 0 0}]]
+    incr n
+  }
+  check "g123" [join [analyze g123]] [list [expr $g1/$k] [expr $g2/$k] [expr $g3/$n]]
+
+  part [lindex $chains 0 0] molecule_id 100
+  if { ![catch { analyze g123 }] } {
+    error "a changed topology was accepted by g123"
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
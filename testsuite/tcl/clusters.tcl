@@ -0,0 +1,143 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks the distributed cluster analysis on a small configuration
+# across the periodic boundaries and against a union-find in Tcl.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase clusters.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+
+proc check { what res ref } {
+  if { [llength $res] != [llength $ref] } {
+    error "$what: got $res, expected $ref"
+  }
+  foreach x $res y $ref {
+    if { [llength $y] > 1 } {
+      check $what $x $y
+    } elseif { ![string is double $y] } {
+      if { $x ne $y } { error "$what: got $res, expected $ref" }
+    } elseif { abs($x - $y) > 1e-6 } {
+      error "$what: got $res, expected $ref"
+    }
+  }
+}
+
+# cluster sizes by a union-find over all pairs
+proc size_distribution { ids r_cut } {
+  global l
+  foreach id $ids {
+    set parent($id) $id
+    set pos($id) [part $id print folded_position]
+  }
+  foreach i $ids {
+    foreach j $ids {
+      if { $j <= $i } continue
+      set d2 0.0
+      foreach x $pos($i) y $pos($j) {
+        set d [expr $x - $y]
+        set d [expr $d - $l*round($d/$l)]
+        set d2 [expr $d2 + $d*$d]
+      }
+      if { $d2 < $r_cut*$r_cut } {
+        set a $i
+        while { $parent($a) != $a } { set a $parent($a) }
+        set b $j
+        while { $parent($b) != $b } { set b $parent($b) }
+        set parent($a) $b
+      }
+    }
+  }
+  foreach i $ids {
+    set a $i
+    while { $parent($a) != $a } { set a $parent($a) }
+    if { [info exists size($a)] } { incr size($a) } { set size($a) 1 }
+  }
+  foreach a [array names size] {
+    if { [info exists count($size($a))] } {
+      incr count($size($a))
+    } {
+      set count($size($a)) 1
+    }
+  }
+  set res {}
+  foreach s [lsort -integer [array names count]] {
+    lappend res [list $s $count($s)]
+  }
+  return $res
+}
+
+if { [catch {
+  # a chain along x, connected to itself, in two molecules
+  for { set i 0 } { $i < 5 } { incr i } {
+    part $i pos [expr 2*$i + 0.5] 8 8 type 0 molecule_id [expr $i < 2 ? 0 : 1]
+  }
+  # a cluster across the boundary and a single particle
+  part 5 pos 9.5 2 2 type 1 molecule_id 2
+  part 6 pos 0.5 2 2 type 1 molecule_id 3
+  part 7 pos 1.5 2 2 type 1 molecule_id 3
+  part 8 pos 5 5 5 type 1 molecule_id 4
+
+  set rg [expr sqrt(2.0/3.0)]
+  check "types 1" [analyze clusters 1.5 types 1] \
+    [list n_clusters 2 percolating 0 largest [list 3 3 $rg] \
+       mean_size 2 2.5 distribution [list {1 1 0} [list 3 1 $rg]]]
+  # the radius of gyration of a percolating cluster is not defined
+  set res [analyze clusters 2.1 types 0]
+  check "types 0" [concat [lrange $res 0 3] [lrange [lindex $res 5] 0 1]] \
+    {n_clusters 1 percolating 1 5 5}
+  # the molecules join the chain, which is not connected by the distance
+  check "molecules" [lrange [analyze clusters 1.5 molecules] 0 5] \
+    [list n_clusters 4 percolating 0 largest [list 2 3 $rg]]
+  check "aggregation" [analyze aggregation 1.5 2 4] \
+    [list MAX 2 MIN 1 AVG 1.5 STD 0.5 AGG_NUM 2 AGGREGATES {2 3} {4}]
+  if { [has_feature ELECTROSTATICS] } {
+    part 6 q 1
+    part 7 q -1
+    check "opposite charges" [lrange [analyze clusters 1.5 types 1 opposite_charges] 0 1] \
+      {n_clusters 3}
+  }
+  if { ![catch { analyze clusters 5.0 }] } {
+    error "a distance of half the box is accepted"
+  }
+
+  # random particles, distributed over the nodes by the integration
+  part deleteall
+  expr srand(17)
+  set ids {}
+  for { set i 0 } { $i < 300 } { incr i } {
+    part $i pos [expr $l*rand()] [expr $l*rand()] [expr $l*rand()] type [expr $i % 2]
+    if { $i % 2 == 0 } { lappend ids $i }
+  }
+  integrate 100
+  foreach r_cut { 0.8 1.2 1.6 } {
+    check "cluster_size_dist $r_cut" \
+      [lindex [analyze cluster_size_dist 0 $r_cut] 1] [size_distribution $ids $r_cut]
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
@@ -28,12 +28,18 @@ thermostat off
 part 0 pos 0 0 0 v 1 2 3
 
 observable new particle_positions all
+observable new particle_velocities all
 
 correlation new obs1 0 dt 0.1 tau_max 10 corr_operation square_distance_componentwise compress1 linear
 correlation new obs1 0 dt 0.01 tau_max 10 corr_operation square_distance_componentwise tau_lin 10 
+# several correlations of one observable, which is calculated once per update
+correlation new obs1 1 dt 0.1 tau_max 10 corr_operation componentwise_product
+correlation new obs1 1 dt 0.1 tau_max 10 corr_operation scalar_product
+correlation new obs1 1 dt 0.1 tau_max 10 corr_operation tensor_product
 integrate 1000
-correlation 0 autoupdate start
-correlation 1 autoupdate start
+for { set c 0 } { $c < 5 } { incr c } {
+  correlation $c autoupdate start
+}
 integrate 20000
 
 #set corr [ correlation ]
@@ -54,4 +60,15 @@ for { set i 0 } { $i < [ llength $corr ]} { incr i } {
   }
 }
 
+# the velocity is constant
+foreach c { 2 3 4 } expected { {1 4 9} {14} {1 2 3 2 4 6 3 6 9} } {
+  foreach line [ correlation $c print ] {
+    foreach x [ lrange $line 2 end ] y $expected {
+      if { abs($x - $y) > 1e-6 } {
+        error "test failed for correlation $c: $line, expected $expected"
+      }
+    }
+  }
+}
+
 exit 0
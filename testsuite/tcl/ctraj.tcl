@@ -0,0 +1,122 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that compressed trajectories reproduce the configurations up
+# to the chosen precision, also for single frames and particle subsets.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase ctraj.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+
+# chains with a gap in the ids
+set n 1000
+set ids {}
+expr srand(42)
+for { set i 0 } { $i < $n } { incr i } {
+  set id [expr $i < $n / 2 ? $i : $i + 100]
+  if { $i % 50 == 0 } {
+    set x [expr $l*rand()]
+    set y [expr $l*rand()]
+    set z [expr $l*rand()]
+  } else {
+    set x [expr $x + 0.5]
+  }
+  part $id pos $x $y $z
+  lappend ids $id
+}
+
+set file "ctraj.[pid].trj"
+set prec 0.001
+set vprec 0.01
+set nframes 3
+
+proc check_frame { frame reference which } {
+  global prec vprec
+  foreach p $frame {
+    set id [lindex $p 0]
+    set ref [dict get $reference $id]
+    foreach x [lrange $p 1 3] y [lrange $ref 0 2] {
+      if { abs($x - $y) > 0.5 * $prec + 1e-12 } {
+        error "$which: wrong position of particle $id: $p vs $ref"
+      }
+    }
+    foreach x [lrange $p 4 6] y [lrange $ref 3 5] {
+      if { abs($x - $y) > 0.5 * $vprec + 1e-12 } {
+        error "$which: wrong velocity of particle $id: $p vs $ref"
+      }
+    }
+  }
+}
+
+if { [catch {
+  set references {}
+  for { set f 0 } { $f < $nframes } { incr f } {
+    integrate 50
+    set reference [dict create]
+    foreach id $ids {
+      dict set reference $id [concat [part $id print pos] [part $id print v]]
+    }
+    lappend references $reference
+    ctraj $file write precision $prec v $vprec
+  }
+
+  if { [ctraj $file frames] != $nframes } {
+    error "wrong number of frames [ctraj $file frames]"
+  }
+
+  for { set f 0 } { $f < $nframes } { incr f } {
+    set frame [ctraj $file read $f]
+    if { [llength $frame] != $n } {
+      error "frame $f has [llength $frame] particles"
+    }
+    check_frame $frame [lindex $references $f] "frame $f"
+  }
+
+  # the time of the last frame
+  if { abs([lindex [ctraj $file info 2] 0 1] - [setmd time]) > 1e-12 } {
+    error "wrong time of frame 2: [ctraj $file info 2]"
+  }
+
+  # a subset, including an id which does not exist
+  set subset {3 499 600 1099 1200}
+  set frame [ctraj $file read 1 ids $subset]
+  if { [llength $frame] != 4 || [lindex $frame 2 0] != 600 } {
+    error "wrong subset: $frame"
+  }
+  check_frame $frame [lindex $references 1] "subset"
+
+  # the coordinates are stored with a few bits per component, much
+  # less than the six doubles per particle
+  if { [file size $file] > 0.25 * $nframes * $n * 6 * 8 } {
+    error "trajectory is not compressed: [file size $file] bytes"
+  }
+} res ] } {
+  file delete $file
+  error_exit $res
+}
+
+file delete $file
+
+exit 0
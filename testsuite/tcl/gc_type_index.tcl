@@ -0,0 +1,138 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that the per type particle index of part gc follows particle
+# creation, deletion, type changes and the migration between nodes.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase gc_type_index.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+
+set n 300
+expr srand(42)
+
+# the ids of a type as expected from the particle data
+proc expected_ids { type } {
+  set ids {}
+  for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+    if { [part $i] != "na" && [part $i print type] == $type } {
+      lappend ids $i
+    }
+  }
+  return $ids
+}
+
+proc check_index { what } {
+  foreach type {0 1} {
+    set expected [expected_ids $type]
+    if { [part gc number $type] != [llength $expected] } {
+      error "$what: wrong number [part gc number $type] of type $type,\
+             expected [llength $expected]"
+    }
+    if { [llength $expected] > 0 } {
+      set ids [lsort -integer [lindex [part gc status $type] 0]]
+      if { $ids != $expected } {
+        error "$what: wrong ids $ids of type $type, expected $expected"
+      }
+    }
+  }
+}
+
+if { [catch {
+  for { set i 0 } { $i < $n } { incr i } {
+    part $i pos [expr $l*rand()] [expr $l*rand()] [expr $l*rand()] \
+      type [expr $i % 3]
+  }
+  part gc 0
+  part gc 1
+  check_index "init"
+
+  # new particles and type changes
+  for { set i $n } { $i < [expr $n + 30] } { incr i } {
+    part $i pos [expr $l*rand()] [expr $l*rand()] [expr $l*rand()] type 1
+  }
+  for { set i 0 } { $i < 60 } { incr i } {
+    part [expr 3*$i] type 1
+  }
+  check_index "type change"
+
+  # the particles have to be found after they moved between nodes
+  integrate 500
+  check_index "integration"
+
+  set ids {}
+  set pos {}
+  set types {}
+  for { set i 0 } { $i < $n } { incr i } {
+    lappend ids $i
+    set pos [concat $pos [part $i print pos]]
+    lappend types [expr ($i % 4 == 0) ? 1 : 2]
+  }
+  part bulk ids $ids pos $pos type $types
+  check_index "part bulk"
+
+  # random particles are of the right type and are removed
+  set n_part [setmd n_part]
+  for { set i 0 } { $i < 20 } { incr i } {
+    set id [part gc find 1]
+    if { [part $id print type] != 1 } {
+      error "found particle $id of wrong type"
+    }
+    part gc delete 1
+  }
+  if { [setmd n_part] != [expr $n_part - 20] } {
+    error "wrong number of particles [setmd n_part] after deletion"
+  }
+  check_index "deletion"
+  integrate 100
+  check_index "integration after deletion"
+
+  # the highest id is removed as well
+  part [setmd max_part] type 1
+  while { [part gc number 1] > 0 } {
+    part gc delete 1
+  }
+  check_index "deletion of all"
+  if { [part gc find 1] != -1 } {
+    error "found a particle of a type that is gone"
+  }
+  if { ![catch { part gc delete 1 }] } {
+    error "deleted a particle of a type that is gone"
+  }
+
+  part deleteall
+  if { [part gc number 1] != 0 || [part gc number 0] != 0 } {
+    error "particles left after part deleteall"
+  }
+  for { set i 0 } { $i < 50 } { incr i } {
+    part $i pos [expr $l*rand()] [expr $l*rand()] [expr $l*rand()] \
+      type [expr $i % 2]
+  }
+  check_index "recreation"
+} res ] } {
+  error_exit $res
+}
+
+exit 0
@@ -75,6 +75,11 @@ set skin          0.4
 
 set mom_prec      1.e-5
 set mass_prec     1.e-8
+if { [has_feature "LB_SINGLE_PRECISION"] } {
+    # round-off of the single precision populations
+    set mom_prec  1.e-3
+    set mass_prec 1.e-4
+}
 set temp_confidence 10
 
 # Other parameters
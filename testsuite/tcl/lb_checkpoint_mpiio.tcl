@@ -0,0 +1,78 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that a parallel LB checkpoint restores the fluid exactly.
+
+source "tests_common.tcl"
+
+require_feature "LB"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase lb_checkpoint_mpiio.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 6
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.2
+thermostat lb 0
+
+set agrid 1.0
+lbfluid cpu agrid $agrid visc 1.0 dens 1.0 friction 1.0 tau 0.01
+
+# create some flow
+for { set i 0 } { $i < $l } { incr i } {
+  lbnode $i 2 3 set u 0.01 [ expr 0.002*$i ] 0.0
+}
+integrate 20
+
+set checkpoint "lb_checkpoint_mpiio.[pid].cpt"
+lbfluid save_mpiio_checkpoint $checkpoint
+
+set reference {}
+for { set i 0 } { $i < $l } { incr i } {
+  for { set j 0 } { $j < $l } { incr j } {
+    for { set k 0 } { $k < $l } { incr k } {
+      lappend reference [ lbnode $i $j $k print pop ]
+    }
+  }
+}
+
+# reset the fluid and restore it from the checkpoint
+lbfluid cpu agrid $agrid visc 1.0 dens 1.0 friction 1.0 tau 0.01
+lbfluid load_mpiio_checkpoint $checkpoint
+file delete $checkpoint
+
+if { [catch {
+  set n 0
+  for { set i 0 } { $i < $l } { incr i } {
+    for { set j 0 } { $j < $l } { incr j } {
+      for { set k 0 } { $k < $l } { incr k } {
+        foreach p [ lbnode $i $j $k print pop ] q [ lindex $reference $n ] {
+          if { abs($p - $q) > 1e-12 } {
+            error "population mismatch at node ($i,$j,$k): $p != $q"
+          }
+        }
+        incr n
+      }
+    }
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
@@ -0,0 +1,72 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that the particle coupling with the velocity halo gives the
+# same trajectories as the exchange of the full populations.
+
+source "tests_common.tcl"
+
+require_feature "LB"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase lb_coupling_halo.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 8
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.2
+thermostat lb 0
+
+proc run_coupled { mode } {
+  global l
+  part deleteall
+  lbfluid cpu agrid 1.0 visc 1.0 dens 1.0 friction 5.0 tau 0.1
+  lbfluid coupling_halo $mode
+
+  # particles close to the subdomain boundaries
+  for { set i 0 } { $i < 20 } { incr i } {
+    set x [ expr 0.37*$i*$l/20.0 + 0.01 ]
+    set y [ expr fmod(0.61*$i, $l) ]
+    set z [ expr fmod(0.5*$l + 0.013*$i, $l) ]
+    part $i pos $x $y $z v [ expr 0.1*sin($i) ] [ expr 0.1*cos($i) ] 0.05
+  }
+  integrate 200
+
+  set res {}
+  for { set i 0 } { $i < 20 } { incr i } {
+    lappend res [ part $i print v ]
+  }
+  return $res
+}
+
+if { [catch {
+  set reference [ run_coupled populations ]
+  set result [ run_coupled velocity ]
+
+  foreach v $result w $reference {
+    foreach a $v b $w {
+      if { abs($a - $b) > 1e-10 } {
+        error "velocity halo changes the trajectory: $v != $w"
+      }
+    }
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
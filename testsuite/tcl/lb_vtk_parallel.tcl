@@ -0,0 +1,100 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks the parallel binary VTK output of the LB fields against the
+# values of the individual nodes.
+
+source "tests_common.tcl"
+
+require_feature "LB"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase lb_vtk_parallel.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 8
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.2
+thermostat lb 0
+
+lbfluid cpu agrid 1.0 visc 1.0 dens 1.0 friction 1.0 tau 0.01
+
+# create some flow
+for { set i 0 } { $i < $l } { incr i } {
+  lbnode $i 2 3 set u 0.01 [ expr 0.002*$i ] 0.0
+  lbnode 5 $i 1 set u 0.0 0.003 [ expr 0.001*$i ]
+}
+integrate 10
+
+# reads the appended data of a VTK file written by vtk_parallel,
+# format is q for double and r for single precision values
+proc read_vtk { filename format } {
+  set f [ open $filename r ]
+  fconfigure $f -translation binary
+  set data [ read $f ]
+  close $f
+
+  set start [ expr [ string first "<AppendedData" $data ] ]
+  set start [ expr [ string first "_" $data $start ] + 1 ]
+  binary scan $data @${start}w n_bytes
+  set count [ expr $n_bytes / ($format == "r" ? 4 : 8) ]
+  binary scan $data @[ expr $start + 8 ]$format$count values
+  return $values
+}
+
+# compares the file contents to the node values on a sampled lattice
+proc check_field { field stride format prec } {
+  global l
+  set filename "lb_vtk_parallel.[pid].vtk"
+  if { $format == "r" } {
+    lbfluid print vtk_parallel $field stride $stride single $filename
+  } else {
+    lbfluid print vtk_parallel $field stride $stride $filename
+  }
+  set values [ read_vtk $filename $format ]
+  file delete $filename
+
+  set n 0
+  for { set k 0 } { $k < $l } { incr k $stride } {
+    for { set j 0 } { $j < $l } { incr j $stride } {
+      for { set i 0 } { $i < $l } { incr i $stride } {
+        foreach a [ lbnode $i $j $k print $field ] {
+          set b [ lindex $values $n ]
+          if { abs($a - $b) > $prec } {
+            error "$field at node ($i,$j,$k) differs: $a != $b"
+          }
+          incr n
+        }
+      }
+    }
+  }
+  if { $n != [ llength $values ] } {
+    error "wrong number of values in $field output: [ llength $values ] instead of $n"
+  }
+}
+
+if { [catch {
+  check_field velocity 1 "q" 1e-15
+  check_field velocity 3 "q" 1e-15
+  check_field density 2 "q" 1e-15
+  check_field velocity 2 "r" 1e-7
+} res ] } {
+  error_exit $res
+}
+
+exit 0
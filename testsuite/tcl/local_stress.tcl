@@ -0,0 +1,158 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks the local stress tensor: the splitting of a bond across bins,
+# the sum over the bins against the global stress tensor, and the
+# accumulation during the integration against the instantaneous values.
+
+source "tests_common.tcl"
+
+require_feature LENNARD_JONES
+
+puts "---------------------------------------------------------------"
+puts "- Testcase local_stress.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 6.0
+setmd box_l $l $l $l
+setmd time_step 0.005
+setmd skin 0.3
+thermostat off
+
+proc check { what res ref { eps 1e-8 } } {
+  foreach x $res y $ref {
+    if { abs($x - $y) > $eps } {
+      error "$what: got $res, expected $ref"
+    }
+  }
+}
+
+# the tensors of all bins, without the bin indices
+proc tensors { local } {
+  set res {}
+  foreach bin [lrange $local 1 end] {
+    lappend res [lindex $bin 1]
+  }
+  return $res
+}
+
+# sum over the bins, weighted by the bin volume over the box volume
+proc bin_sum { local n_bins } {
+  set sum {0 0 0 0 0 0 0 0 0}
+  foreach t [tensors $local] {
+    set new {}
+    foreach s $sum x $t { lappend new [expr $s + $x / $n_bins] }
+    set sum $new
+  }
+  return $sum
+}
+
+proc scale { t f } {
+  set res {}
+  foreach x $t { lappend res [expr $x * $f] }
+  return $res
+}
+
+if { [catch {
+  ############## a bond cut by the bin boundaries
+  inter 0 harmonic 10 0.5
+  part 0 pos 2.5 1 1 v 0 0 0
+  part 1 pos 4.0 1.6 1 v 0 0 0
+  part 0 bond 0 1
+  integrate 0
+
+  # the bond tensor of the pair, f_k d_l / V
+  set f [expr -10 * (sqrt(1.5*1.5 + 0.6*0.6) - 0.5) / sqrt(1.5*1.5 + 0.6*0.6)]
+  set pair [list [expr $f*1.5*1.5] [expr $f*1.5*0.6] 0 [expr $f*0.6*1.5] [expr $f*0.6*0.6] 0 0 0 0]
+  set pair [scale $pair [expr 1.0/($l*$l*$l)]]
+
+  set global [lrange [lindex [analyze stress_tensor] 0] 1 end]
+  check "global bond" $global $pair
+
+  # 1/3 of the bond lies in the first slab, 2/3 in the second
+  set slabs [tensors [analyze local_stress_tensor slab x 2]]
+  check "slab 0" [lindex $slabs 0] [scale $pair [expr 2.0 * 1/3.]]
+  check "slab 1" [lindex $slabs 1] [scale $pair [expr 2.0 * 2/3.]]
+
+  # the same cut on an explicit, non-periodic grid
+  set grid [tensors [analyze local_stress_tensor 0 0 0 0 0 0 6 6 6 2 1 1]]
+  check "grid" [join $grid] [join $slabs]
+
+  # across the periodic boundary, half of the bond on either side
+  part 0 pos 5.25 1 1
+  part 1 pos 0.75 1.6 1
+  integrate 0
+  set slabs [tensors [analyze local_stress_tensor slab x 3]]
+  check "periodic slab 0" [lindex $slabs 0] [scale $pair [expr 3.0 * 1/2.]]
+  check "periodic slab 1" [lindex $slabs 1] {0 0 0 0 0 0 0 0 0}
+  check "periodic slab 2" [lindex $slabs 2] [scale $pair [expr 3.0 * 1/2.]]
+
+  part delete
+
+  ############## a Lennard-Jones liquid against the global stress tensor
+  inter 0 0 lennard-jones 1.0 1.0 1.12246 0.25 0
+  expr srand(42)
+  set i 0
+  foreach x {0 1 2 3} {
+    foreach y {0 1 2 3} {
+      foreach z {0 1 2 3} {
+        part $i pos [expr 1.5*$x + 0.2*[t_random]] [expr 1.5*$y + 0.2*[t_random]] [expr 1.5*$z + 0.2*[t_random]] \
+          v [expr [t_random]-0.5] [expr [t_random]-0.5] [expr [t_random]-0.5]
+        incr i
+      }
+    }
+  }
+  integrate 100
+
+  set global [lrange [lindex [analyze stress_tensor] 0] 1 end]
+  check "slab sum" [bin_sum [analyze local_stress_tensor slab z 5] 5] $global 1e-6
+  check "grid sum" [bin_sum [analyze local_stress_tensor 1 1 1 0 0 0 $l $l $l 3 2 2] 12] $global 1e-6
+
+  ############## accumulation during the integration
+  set n_steps 10
+  analyze local_stress_tensor start slab z 4
+  set avg {}
+  for { set i 0 } { $i < $n_steps } { incr i } {
+    integrate 1
+    set now [join [tensors [analyze local_stress_tensor slab z 4]]]
+    if { $avg == {} } {
+      set avg [scale $now [expr 1.0/$n_steps]]
+    } else {
+      set new {}
+      foreach a $avg x $now { lappend new [expr $a + $x/$n_steps] }
+      set avg $new
+    }
+  }
+  analyze local_stress_tensor stop
+  check "average" [join [tensors [analyze local_stress_tensor average]]] $avg 1e-6
+
+  # no more samples after stop
+  integrate 10
+  check "stopped" [join [tensors [analyze local_stress_tensor average]]] $avg 1e-6
+
+  ############## invalid grids
+  if { ![catch { analyze local_stress_tensor 0 0 0 0 0 0 10 6 6 1 1 1 }] } {
+    error "a range larger than the box was accepted"
+  }
+  if { ![catch { analyze local_stress_tensor start slab w 3 }] } {
+    error "an invalid slab direction was accepted"
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
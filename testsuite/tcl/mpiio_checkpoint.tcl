@@ -0,0 +1,130 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that a full MPI-IO checkpoint restores particles, globals and
+# the random number generator states.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase mpiio_checkpoint.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+
+inter 0 harmonic 10.0 1.0
+
+set n 200
+expr srand(42)
+for { set i 0 } { $i < $n } { incr i 2 } {
+  set x [expr $l*rand()]
+  set y [expr $l*rand()]
+  set z [expr $l*rand()]
+  part $i pos $x $y $z type [expr $i % 3]
+  part [expr $i + 1] pos [expr $x + 0.9] $y $z type [expr ($i + 1) % 3]
+  part $i bond 0 [expr $i + 1]
+  if { [has_feature "ELECTROSTATICS"] } {
+    part $i q 1.0
+    part [expr $i + 1] q -1.0
+  }
+  if { [has_feature "MASS"] } {
+    part $i mass [expr 1.0 + rand()]
+  }
+  if { [has_feature "EXCLUSIONS"] } {
+    part $i exclude [expr $i + 1]
+  }
+}
+integrate 20
+
+proc snapshot {} {
+  global n
+  set res [list [setmd box_l] [setmd skin] [setmd time_step] [setmd time] \
+               [setmd temperature] [setmd gamma] [t_random stat]]
+  for { set i 0 } { $i < $n } { incr i } {
+    lappend res [part $i print]
+  }
+  return $res
+}
+
+# compare word by word, numbers up to rounding
+proc compare { a b } {
+  if { [llength $a] != [llength $b] } {
+    error "length mismatch:\n$a\n$b"
+  }
+  foreach x $a y $b {
+    if { [llength $x] > 1 || [llength $y] > 1 } {
+      compare $x $y
+    } elseif { [string is double -strict $x] && [string is double -strict $y] } {
+      if { abs($x - $y) > 1e-10 * (1.0 + abs($x)) } {
+        error "value mismatch: $x != $y"
+      }
+    } elseif { $x != $y } {
+      error "mismatch: $x != $y"
+    }
+  }
+}
+
+set checkpoint "mpiio_checkpoint.[pid]"
+
+if { [catch {
+  set reference [snapshot]
+  mpiio $checkpoint write all
+
+  # destroy the state
+  part deleteall
+  setmd time_step 0.02
+  setmd skin 0.3
+  setmd time 0.0
+  thermostat off
+  set seeds {}
+  for { set i 0 } { $i < [setmd n_nodes] } { incr i } {
+    lappend seeds [expr 17 + $i]
+  }
+  eval t_random seed $seeds
+
+  mpiio $checkpoint read all
+  compare $reference [snapshot]
+
+  # the restored system has to be usable by the integrator
+  integrate 10
+
+  # asynchronous output is staged, integration continues while writing
+  set reference [snapshot]
+  mpiio $checkpoint.async write all async
+  # the files of a pending or a finished output are not overwritten
+  if { ![catch { mpiio $checkpoint.async write all async }] } {
+    error "a pending asynchronous output was overwritten"
+  }
+  integrate 10
+  mpiio flush
+  if { ![catch { mpiio $checkpoint.async write pos async }] } {
+    error "an existing asynchronous output was overwritten"
+  }
+  mpiio $checkpoint.async read all
+  compare $reference [snapshot]
+} res ] } {
+  foreach f [glob -nocomplain $checkpoint.*] { file delete $f }
+  error_exit $res
+}
+
+foreach f [glob -nocomplain $checkpoint.*] { file delete $f }
+
+exit 0
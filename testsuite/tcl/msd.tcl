@@ -0,0 +1,178 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks the mean square displacement and the velocity autocorrelation
+# of stored random walks against the direct sums over all pairs of
+# configurations, for particles, types and molecules.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase msd.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat off
+
+proc check { what res ref } {
+  if { [llength $res] != [llength $ref] } {
+    error "$what: got $res, expected $ref"
+  }
+  foreach x $res y $ref {
+    if { abs($x - $y) > 1e-6 * (1.0 + abs($y)) } {
+      error "$what: got $res, expected $ref"
+    }
+  }
+}
+
+# direct sums over all pairs of configurations. traj is a list of
+# trajectories, each a list of positions.
+proc direct_msd { traj tmax } {
+  set res {}
+  for { set m 0 } { $m <= $tmax } { incr m } {
+    set sum 0.0
+    set n 0
+    foreach t $traj {
+      for { set k 0 } { $k + $m < [llength $t] } { incr k } {
+        foreach x [lindex $t $k] y [lindex $t [expr $k + $m]] {
+          set sum [expr $sum + ($y - $x)*($y - $x)]
+        }
+        incr n
+      }
+    }
+    lappend res [expr $sum / $n]
+  }
+  return $res
+}
+
+proc direct_vacf { traj tmax } {
+  set vel {}
+  foreach t $traj {
+    set v {}
+    for { set k 0 } { $k + 1 < [llength $t] } { incr k } {
+      set d {}
+      foreach x [lindex $t $k] y [lindex $t [expr $k + 1]] { lappend d [expr $y - $x] }
+      lappend v $d
+    }
+    lappend vel $v
+  }
+  set res {}
+  for { set m 0 } { $m <= $tmax } { incr m } {
+    set sum 0.0
+    set n 0
+    foreach v $vel {
+      for { set k 0 } { $k + $m < [llength $v] } { incr k } {
+        foreach x [lindex $v $k] y [lindex $v [expr $k + $m]] {
+          set sum [expr $sum + $x*$y]
+        }
+        incr n
+      }
+    }
+    lappend res [expr $sum / $n]
+  }
+  return $res
+}
+
+if { [catch {
+  ############## ballistic motion
+  part 0 pos 0 0 0
+  for { set k 0 } { $k < 20 } { incr k } {
+    part 0 pos [expr 0.7*$k] [expr -0.4*$k] 0
+    analyze append
+  }
+  set ref {}
+  set vref {}
+  for { set m 0 } { $m < 20 } { incr m } {
+    lappend ref [expr 0.65*$m*$m]
+    lappend vref 0.65
+  }
+  check "ballistic msd" [analyze mean_square_displacement] $ref
+  check "ballistic vacf" [analyze velocity_autocorrelation] [lrange $vref 0 end-1]
+  check "ballistic tmax" [analyze mean_square_displacement tmax 5] [lrange $ref 0 5]
+
+  ############## random walks, across the periodic boundaries
+  analyze remove
+  part delete
+  # two molecules of two particles each, and two free particles
+  set n_part 6
+  set masses {1 2 1 1 1 1}
+  set types {0 1 0 1 0 1}
+  set mols {0 0 1 1 -1 -1}
+  set has_mass [has_feature MASS]
+  for { set i 0 } { $i < $n_part } { incr i } {
+    part $i pos 5 5 5 type [lindex $types $i]
+    if { [lindex $mols $i] >= 0 } { part $i molecule_id [lindex $mols $i] }
+    if { $has_mass } { part $i mass [lindex $masses $i] } else { lset masses $i 1 }
+    set r($i) [list [expr $l*[t_random]] [expr $l*[t_random]] [expr $l*[t_random]]]
+  }
+
+  expr srand(17)
+  set n_frames 31
+  for { set k 0 } { $k < $n_frames } { incr k } {
+    for { set i 0 } { $i < $n_part } { incr i } {
+      set new {}
+      foreach x $r($i) { lappend new [expr $x + 3.0*([t_random] - 0.5)] }
+      set r($i) $new
+      eval part $i pos $new
+      lappend traj($i) $new
+    }
+    analyze append
+  }
+
+  set all {}
+  set type1 {}
+  for { set i 0 } { $i < $n_part } { incr i } {
+    lappend all $traj($i)
+    if { [lindex $types $i] == 1 } { lappend type1 $traj($i) }
+  }
+  set com {}
+  foreach { a b } { 0 1 2 3 } {
+    set ma [lindex $masses $a]
+    set mb [lindex $masses $b]
+    set t {}
+    foreach ra $traj($a) rb $traj($b) {
+      set c {}
+      foreach x $ra y $rb { lappend c [expr ($ma*$x + $mb*$y)/($ma + $mb)] }
+      lappend t $c
+    }
+    lappend com $t
+  }
+
+  set tmax [expr $n_frames - 1]
+  check "msd" [analyze mean_square_displacement] [direct_msd $all $tmax]
+  check "msd types" [analyze mean_square_displacement types 1] [direct_msd $type1 $tmax]
+  check "msd molecules" [analyze mean_square_displacement molecules] [direct_msd $com $tmax]
+  check "msd molecules tmax" [analyze mean_square_displacement molecules tmax 7] [direct_msd $com 7]
+  check "vacf" [analyze velocity_autocorrelation tmax 10] [direct_vacf $all 10]
+  check "vacf types" [analyze velocity_autocorrelation types {1}] [direct_vacf $type1 [expr $tmax - 1]]
+  check "vacf molecules" [analyze velocity_autocorrelation molecules] [direct_vacf $com [expr $tmax - 1]]
+
+  ############## errors
+  if { ![catch { analyze mean_square_displacement tmax $n_frames }] } {
+    error "a tmax beyond the stored configurations was accepted"
+  }
+  if { ![catch { analyze mean_square_displacement types 5 }] } {
+    error "an empty selection was accepted"
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
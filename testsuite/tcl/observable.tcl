@@ -126,6 +126,25 @@ set com_vel2 [ observable new com_velocity type 0 ]
 if { ![ veccompare [ observable $com_vel2 print ] { 4.5 0 0 } ] }  {
   error "com_vel2 is not working"
 }
+set com_vel3 [ observable new com_velocity id { 0 1 2 3 } blocked 2 ]
+if { ![ veccompare [ observable $com_vel3 print ] { 3 0 0 3 2 0 } ] }  {
+  error "com_vel3 is not working"
+}
+
+
+############# Observable profiles ##########
+set density [ observable new density_profile all xbins 4 ]
+if { ![ veccompare [ observable $density print ] { 0.015625 0.0234375 0 0 } ] }  {
+  error "density_profile is not working"
+}
+set flux [ observable new flux_density_profile all xbins 2 ]
+if { ![ veccompare [ observable $flux print ] { 0.0703125 0.015625 0 0 0 0 } ] }  {
+  error "flux_density_profile is not working"
+}
+set radial_density [ observable new radial_density_profile all center 0 0 0 maxr 4 rbins 2 ]
+if { ![ veccompare [ observable $radial_density print ] [ list [ expr 2/(32*[PI]) ] [ expr 3/(96*[PI]) ] ] ] }  {
+  error "radial_density_profile is not working"
+}
 
 
 ############# Observable dipole_moment #####################
@@ -0,0 +1,202 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks the distributed analyses against the same quantities calculated
+# from the particle data in Tcl.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase parallel_analysis.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 8.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+
+set n 150
+expr srand(17)
+
+proc check { what value expected {eps 1e-4} } {
+  foreach x $value y $expected {
+    if { abs($x - $y) > $eps * (1.0 + abs($y)) } {
+      error "$what: got $value, expected $expected"
+    }
+  }
+}
+
+proc mi_dist2 { a b } {
+  global l
+  set d2 0.0
+  foreach x $a y $b {
+    set d [expr $x - $y]
+    set d [expr $d - $l*round($d/$l)]
+    set d2 [expr $d2 + $d*$d]
+  }
+  return $d2
+}
+
+proc check_analyses { what } {
+  global n l
+  set pos {}
+  set vel {}
+  set type {}
+  set mass {}
+  set charge {}
+  for { set i 0 } { $i < $n } { incr i } {
+    lappend pos [part $i print pos]
+    lappend vel [part $i print v]
+    lappend type [part $i print type]
+    if { [has_feature "MASS"] } {
+      lappend mass [part $i print mass]
+    } else {
+      lappend mass 1.0
+    }
+    if { [has_feature "ELECTROSTATICS"] } {
+      lappend charge [part $i print q]
+    }
+  }
+
+  # kinetic energy of type 2
+  set ekin 0.0
+  foreach v $vel t $type w $mass {
+    if { $t == 2 } {
+      foreach x $v {
+        set ekin [expr $ekin + 0.5*$w*$x*$x]
+      }
+    }
+  }
+  check "$what: energy_kinetic" [analyze energy_kinetic 2] $ekin
+
+  if { [has_feature "ELECTROSTATICS"] } {
+    set dip {0.0 0.0 0.0}
+    set q 0.0
+    foreach p $pos c $charge {
+      set dip [vecadd $dip [vecscale $c $p]]
+      set q [expr $q + $c]
+    }
+    check "$what: dipmom_normal" \
+      [lrange [lindex [analyze dipmom_normal] 0] 1 4] [concat $dip $q]
+  }
+
+  # center of mass and moment of inertia of type 1
+  set com {0.0 0.0 0.0}
+  set m 0.0
+  foreach p $pos t $type w $mass {
+    if { $t == 1 } {
+      set com [vecadd $com [vecscale $w $p]]
+      set m [expr $m + $w]
+    }
+  }
+  set com [vecscale [expr 1.0/$m] $com]
+  check "$what: centermass" [analyze centermass 1] $com
+
+  set I {0.0 0.0 0.0 0.0 0.0 0.0 0.0 0.0 0.0}
+  foreach p $pos t $type w $mass {
+    if { $t == 1 } {
+      foreach { x y z } [vecsub $p $com] {}
+      set I [vecadd $I [vecscale $w [list \
+        [expr $y*$y + $z*$z] [expr -$x*$y] [expr -$x*$z] \
+        [expr -$x*$y] [expr $x*$x + $z*$z] [expr -$y*$z] \
+        [expr -$x*$z] [expr -$y*$z] [expr $x*$x + $y*$y]]]]
+    }
+  }
+  check "$what: momentofinertiamatrix" [analyze momentofinertiamatrix 1] $I 1e-3
+
+  # radius of gyration of all particles around their center of mass
+  set com {0.0 0.0 0.0}
+  set m 0.0
+  foreach p $pos w $mass {
+    set com [vecadd $com [vecscale $w $p]]
+    set m [expr $m + $w]
+  }
+  set com [vecscale [expr 1.0/$m] $com]
+  set rg2 0.0
+  foreach p $pos {
+    foreach x [vecsub $p $com] {
+      set rg2 [expr $rg2 + $x*$x]
+    }
+  }
+  set rg2 [expr $rg2/$n]
+  check "$what: gyration_tensor" \
+    [lindex [lindex [analyze gyration_tensor] 0] 1] $rg2
+
+  # minimal distances
+  set mind2 [expr 9*$l*$l]
+  set mind2_01 [expr 9*$l*$l]
+  for { set i 0 } { $i < $n } { incr i } {
+    for { set j [expr $i + 1] } { $j < $n } { incr j } {
+      set d2 [mi_dist2 [lindex $pos $i] [lindex $pos $j]]
+      if { $d2 < $mind2 } { set mind2 $d2 }
+      set ti [lindex $type $i]
+      set tj [lindex $type $j]
+      if { (($ti == 0 && $tj == 1) || ($ti == 1 && $tj == 0)) &&
+           $d2 < $mind2_01 } {
+        set mind2_01 $d2
+      }
+    }
+  }
+  check "$what: mindist" [analyze mindist] [expr sqrt($mind2)]
+  check "$what: mindist 0 1" [analyze mindist 0 1] [expr sqrt($mind2_01)]
+
+  set ref {1.0 2.0 3.0}
+  set mind2 [expr 9*$l*$l]
+  set nb {}
+  set nb_planar {}
+  for { set i 0 } { $i < $n } { incr i } {
+    set d2 [mi_dist2 $ref [lindex $pos $i]]
+    if { $d2 < $mind2 } { set mind2 $d2 }
+    if { $d2 < 2.0*2.0 } { lappend nb $i }
+    set d [vecsub [lindex $pos $i] $ref]
+    if { [lindex $d 0]**2 + [lindex $d 1]**2 < 1.5*1.5 } {
+      lappend nb_planar $i
+    }
+  }
+  check "$what: distto" [analyze distto 1.0 2.0 3.0] [expr sqrt($mind2)]
+  if { [lsort -integer [analyze nbhood 1.0 2.0 3.0 2.0]] != $nb } {
+    error "$what: nbhood [lsort -integer [analyze nbhood 1.0 2.0 3.0 2.0]],\
+           expected $nb"
+  }
+  set res [lsort -integer [analyze nbhood planar 1 1 0 1.0 2.0 3.0 1.5]]
+  if { $res != $nb_planar } {
+    error "$what: planar nbhood $res, expected $nb_planar"
+  }
+}
+
+if { [catch {
+  for { set i 0 } { $i < $n } { incr i } {
+    part $i pos [expr 3*$l*rand() - $l] [expr $l*rand()] [expr $l*rand()] \
+      type [expr $i % 3]
+    if { [has_feature "MASS"] } {
+      part $i mass [expr 0.5 + rand()]
+    }
+    if { [has_feature "ELECTROSTATICS"] } {
+      part $i q [expr ($i % 2) ? 1.0 : -0.5]
+    }
+  }
+  check_analyses "setup"
+
+  # the particles are distributed over the nodes and cross the box
+  integrate 300
+  check_analyses "integration"
+} res ] } {
+  error_exit $res
+}
+
+exit 0
@@ -0,0 +1,113 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that part bulk sets up the same particles as single part calls.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase part_bulk.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat off
+
+set n 500
+expr srand(42)
+
+# leave a gap in the ids
+set ids {}
+set pos {}
+set vel {}
+set types {}
+set charges {}
+for { set i 0 } { $i < $n } { incr i } {
+  lappend ids [expr 2*$i + 3]
+  lappend pos [expr 1.2*$l*rand()] [expr $l*rand()] [expr $l*rand()-0.1*$l]
+  lappend vel [expr rand()-0.5] [expr rand()-0.5] [expr rand()-0.5]
+  lappend types [expr $i % 3]
+  lappend charges [expr ($i % 2) ? 1.0 : -1.0]
+}
+
+proc check_particles { what } {
+  global ids pos vel types charges n
+  for { set i 0 } { $i < $n } { incr i } {
+    set id [lindex $ids $i]
+    foreach x [part $id print pos] y [lrange $pos [expr 3*$i] [expr 3*$i+2]] {
+      if { abs($x - $y) > 1e-10 } {
+        error "$what: wrong position of particle $id: [part $id print pos]"
+      }
+    }
+    foreach x [part $id print v] y [lrange $vel [expr 3*$i] [expr 3*$i+2]] {
+      if { abs($x - $y) > 1e-10 } {
+        error "$what: wrong velocity of particle $id: [part $id print v]"
+      }
+    }
+    if { [part $id print type] != [lindex $types $i] } {
+      error "$what: wrong type of particle $id"
+    }
+    if { [has_feature "ELECTROSTATICS"] &&
+         abs([part $id print q] - [lindex $charges $i]) > 1e-10 } {
+      error "$what: wrong charge of particle $id"
+    }
+  }
+  if { [setmd n_part] != $n || [setmd max_part] != [lindex $ids end] } {
+    error "$what: wrong particle number [setmd n_part] / [setmd max_part]"
+  }
+}
+
+if { [catch {
+  set args [list ids $ids pos $pos v $vel type $types]
+  if { [has_feature "ELECTROSTATICS"] } {
+    lappend args q $charges
+  }
+  eval part bulk $args
+  check_particles "creation"
+
+  # the particles have to be usable by the integrator
+  integrate 0
+  check_particles "integration"
+
+  # move the existing particles and create the ones in the gaps
+  set n [expr 2*$n]
+  set ids {}
+  for { set i 0 } { $i < $n } { incr i } {
+    lappend ids [expr $i + 3]
+  }
+  set pos [concat [lrange $pos 1 end] [lrange $pos 0 0] $pos]
+  set vel [concat $vel $vel]
+  set types [concat $types $types]
+  set charges [concat $charges $charges]
+  part bulk ids $ids pos $pos v $vel type $types
+  if { [has_feature "ELECTROSTATICS"] } {
+    part bulk ids $ids pos $pos q $charges
+  }
+  integrate 0
+  check_particles "update"
+
+  # duplicate ids are rejected
+  if { ![catch { part bulk ids {1 1} pos {0 0 0 1 1 1} }] } {
+    error "duplicate ids were accepted"
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
@@ -0,0 +1,216 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks the profiles accumulated during the integration against
+# histograms of the known ballistic trajectories of free particles.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase profiles.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+set dt 0.01
+setmd box_l $l $l $l
+setmd time_step $dt
+setmd skin 0.4
+thermostat off
+
+proc check { what res ref } {
+  if { [llength $res] != [llength $ref] } {
+    error "$what: got $res, expected $ref"
+  }
+  foreach x $res y $ref {
+    if { [llength $x] > 1 } {
+      check $what $x $y
+    } elseif { abs($x - $y) > 1e-6 * (1.0 + abs($y)) } {
+      error "$what: got $res, expected $ref"
+    }
+  }
+}
+
+proc fold { x } {
+  global l
+  return [expr $x - floor($x/$l)*$l]
+}
+
+# the folded position of particle i after step k
+proc position { i k } {
+  global r v dt
+  set pos {}
+  foreach x [lindex $r $i] u [lindex $v $i] { lappend pos [fold [expr $x + $u*$k*$dt]] }
+  return $pos
+}
+
+# the steps at which a profile sampling every n steps is sampled during
+# the integration of the steps from..to
+proc sampled_steps { from to n } {
+  set steps {}
+  for { set k $from } { $k <= $to } { incr k } {
+    if { $k % $n == 0 } { lappend steps $k }
+  }
+  return $steps
+}
+
+if { [catch {
+  expr srand(13)
+  set n_part 60
+  set r {}
+  set v {}
+  set types {}
+  for { set i 0 } { $i < $n_part } { incr i } {
+    lappend r [list [expr $l*[t_random]] [expr $l*[t_random]] [expr $l*[t_random]]]
+    lappend v [list [expr 4.0*([t_random] - 0.5)] [expr 4.0*([t_random] - 0.5)] [expr 4.0*([t_random] - 0.5)]]
+    lappend types [expr $i % 3]
+    eval part $i pos [lindex $r $i] v [lindex $v $i] type [lindex $types $i]
+  }
+
+  set density [analyze profile density y 10 types {0 2} every 4]
+  set cylinder [analyze profile cylindrical {5 5 5} {0 0 2} 8.0 4.0 4 3 types {1 0} every 3]
+  set diffusion [analyze profile diffusion x 2.0 5.0 8 3 every 2]
+  integrate 30
+  integrate 30
+
+  ############## density and flux
+  set bins 10
+  for { set b 0 } { $b < $bins } { incr b } { set hist($b) {0 0 0 0} }
+  set steps [sampled_steps 1 60 4]
+  foreach k $steps {
+    for { set i 0 } { $i < $n_part } { incr i } {
+      if { [lindex $types $i] == 1 } { continue }
+      set b [expr int(floor([lindex [position $i $k] 1]/$l*$bins))]
+      set new {}
+      foreach h $hist($b) x [concat 1 [lindex $v $i]] { lappend new [expr $h + $x] }
+      set hist($b) $new
+    }
+  }
+  set norm [expr $l*$l*$l/$bins*[llength $steps]]
+  set ref {}
+  for { set b 0 } { $b < $bins } { incr b } {
+    set row [expr ($b + 0.5)*$l/$bins]
+    foreach h $hist($b) { lappend row [expr $h/$norm] }
+    lappend ref $row
+  }
+  check "density profile" [analyze profile $density] $ref
+
+  ############## cylindrical
+  set ba 4
+  set br 3
+  set length 8.0
+  set radius 4.0
+  set group(1) 0
+  set group(0) 1
+  for { set b 0 } { $b < $ba*$br*2 } { incr b } { set hist($b) {0 0 0} }
+  set steps [sampled_steps 1 60 3]
+  foreach k $steps {
+    for { set i 0 } { $i < $n_part } { incr i } {
+      set t [lindex $types $i]
+      if { $t == 2 } { continue }
+      foreach { x y z } [position $i $k] { }
+      foreach { vx vy vz } [lindex $v $i] { }
+      set dx [expr $x - 5]
+      set dy [expr $y - 5]
+      set rad [expr sqrt($dx*$dx + $dy*$dy)]
+      set a [expr int(floor(($z - 5 + 0.5*$length)/$length*$ba))]
+      set rb [expr int(floor($rad/$radius*$br))]
+      if { $a < 0 || $a >= $ba || $rb >= $br } { continue }
+      set b [expr 2*($rb*$ba + $a) + $group($t)]
+      set new {}
+      foreach h $hist($b) x [list 1 [expr ($vx*$dx + $vy*$dy)/$rad] $vz] { lappend new [expr $h + $x] }
+      set hist($b) $new
+    }
+  }
+  set ref {}
+  set pi [expr 4.0*atan(1.0)]
+  for { set rb 0 } { $rb < $br } { incr rb } {
+    set w [expr $radius/$br]
+    set vol [expr $pi*(2*$rb + 1)*$w*$w*$length/$ba]
+    for { set a 0 } { $a < $ba } { incr a } {
+      set row [list $rb $a [expr ($rb + 0.5)*$w] [expr ($a + 0.5)*$length/$ba - 0.5*$length] $vol]
+      foreach g { 0 1 } {
+        foreach { n vr vz } $hist([expr 2*($rb*$ba + $a) + $g]) { }
+        if { $n > 0 } {
+          set vr [expr $vr/$n]
+          set vz [expr $vz/$n]
+        }
+        lappend row [expr $n/($vol*[llength $steps])] $vr $vz
+      }
+      lappend ref $row
+    }
+  }
+  check "cylindrical profile" [analyze profile $cylinder] $ref
+
+  ############## diffusion
+  set bins 8
+  for { set b 0 } { $b < $bins } { incr b } { set hist($b) 0 }
+  set steps [sampled_steps 1 60 2]
+  set n_samples 0
+  for { set s 3 } { $s < [llength $steps] } { incr s } {
+    set k0 [lindex $steps [expr $s - 3]]
+    set k [lindex $steps $s]
+    for { set i 0 } { $i < $n_part } { incr i } {
+      set x0 [lindex [position $i $k0] 0]
+      if { $x0 <= 2.0 || $x0 >= 5.0 } { continue }
+      set b [expr int(floor([lindex [position $i $k] 0]/$l*$bins))]
+      incr hist($b)
+    }
+    incr n_samples
+  }
+  set ref {}
+  for { set b 0 } { $b < $bins } { incr b } {
+    lappend ref [list [expr ($b + 0.5)*$l/$bins] [expr double($hist($b))/$n_samples]]
+  }
+  check "diffusion profile" [analyze profile $diffusion] $ref
+
+  ############## reset and remove
+  analyze profile reset $density
+  analyze profile remove $cylinder
+  integrate 8
+  set ref {}
+  for { set b 0 } { $b < 10 } { incr b } { set hist($b) {0 0 0 0} }
+  foreach k { 64 68 } {
+    for { set i 0 } { $i < $n_part } { incr i } {
+      if { [lindex $types $i] == 1 } { continue }
+      set b [expr int(floor([lindex [position $i $k] 1]/$l*10))]
+      set new {}
+      foreach h $hist($b) x [concat 1 [lindex $v $i]] { lappend new [expr $h + $x] }
+      set hist($b) $new
+    }
+  }
+  for { set b 0 } { $b < 10 } { incr b } {
+    set row [expr ($b + 0.5)*$l/10]
+    foreach h $hist($b) { lappend row [expr $h/($l*$l*$l/10*2)] }
+    lappend ref $row
+  }
+  check "density profile after reset" [analyze profile $density] $ref
+
+  ############## errors
+  if { ![catch { analyze profile $cylinder }] } {
+    error "a removed profile was read"
+  }
+  if { ![catch { analyze profile density x 0 }] } {
+    error "a profile without bins was accepted"
+  }
+  if { ![catch { analyze profile cylindrical {0 0 0} {0 0 0} 1 1 1 1 }] } {
+    error "a cylinder without an axis was accepted"
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
@@ -0,0 +1,160 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# Checks the distributed radial distribution functions against the
+# all-pairs calculation in Tcl.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase rdf.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 8.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+
+set n 200
+expr srand(23)
+
+# all-pairs rdf as it was computed on the master,
+# pos is a list of configurations
+proc rdf_reference { pos types mols t1 t2 r_min r_max r_bins intermol } {
+  global l
+  set mixed [expr {$t1 != $t2}]
+  set bin_width [expr ($r_max - $r_min)/$r_bins]
+  set n [llength $types]
+  set rdf {}
+  for { set b 0 } { $b < $r_bins } { incr b } { lappend rdf 0.0 }
+  foreach conf $pos {
+    set hist {}
+    for { set b 0 } { $b < $r_bins } { incr b } { lappend hist 0 }
+    set cnt 0
+    for { set i 0 } { $i < $n } { incr i } {
+      foreach a $t1 {
+        if { [lindex $types $i] != $a } continue
+        for { set j [expr $mixed ? 0 : $i + 1] } { $j < $n } { incr j } {
+          foreach b $t2 {
+            if { [lindex $types $j] != $b } continue
+            if { $intermol && [lindex $mols $i] == [lindex $mols $j] } continue
+            set d2 0.0
+            foreach x [lindex $conf $i] y [lindex $conf $j] {
+              set d [expr $x - $y]
+              set d [expr $d - $l*round($d/$l)]
+              set d2 [expr $d2 + $d*$d]
+            }
+            set d [expr sqrt($d2)]
+            if { $d > $r_min && $d < $r_max } {
+              set ind [expr int(($d - $r_min)/$bin_width)]
+              lset hist $ind [expr [lindex $hist $ind] + 1]
+            }
+            incr cnt
+          }
+        }
+      }
+    }
+    for { set b 0 } { $b < $r_bins } { incr b } {
+      set r_in [expr $b*$bin_width + $r_min]
+      set r_out [expr $r_in + $bin_width]
+      set bin_volume [expr 4.0/3.0*acos(-1.0)*($r_out**3 - $r_in**3)]
+      lset rdf $b [expr [lindex $rdf $b] + \
+                     [lindex $hist $b]*$l**3/($bin_volume*$cnt)]
+    }
+  }
+  set res {}
+  foreach g $rdf { lappend res [expr $g/[llength $pos]] }
+  return $res
+}
+
+proc check_rdf { what t1 t2 r_min r_max r_bins pos types mols } {
+  if { [llength $pos] == 1 } {
+    set res [analyze rdf $t1 $t2 $r_min $r_max $r_bins]
+    set ref [rdf_reference $pos $types $mols $t1 $t2 $r_min $r_max $r_bins 0]
+    check_result "$what: rdf {$t1} {$t2} $r_max" $res $ref
+  } else {
+    set n_conf [llength $pos]
+    set res [analyze <rdf> $t1 $t2 $r_min $r_max $r_bins $n_conf]
+    set ref [rdf_reference $pos $types $mols $t1 $t2 $r_min $r_max $r_bins 0]
+    check_result "$what: <rdf> {$t1} {$t2} $r_max" $res $ref
+    set res [analyze <rdf-intermol> $t1 $t2 $r_min $r_max $r_bins $n_conf]
+    set ref [rdf_reference $pos $types $mols $t1 $t2 $r_min $r_max $r_bins 1]
+    check_result "$what: <rdf-intermol> {$t1} {$t2} $r_max" $res $ref
+  }
+}
+
+proc check_result { what res ref } {
+  foreach bin [lindex $res 1] g $ref {
+    set x [lindex $bin 1]
+    if { abs($x - $g) > 1e-5*(1.0 + abs($g)) } {
+      error "$what: got [lindex $res 1], expected $ref"
+    }
+  }
+}
+
+proc check_rdfs { what pos types mols } {
+  # identical and mixed lists, a type twice, and a range beyond half the box
+  foreach { t1 t2 r_min r_max r_bins } {
+    {0} {0} 0.0 3.0 30
+    {0 1} {2} 0.5 3.0 25
+    {0 1} {1 0} 0.0 2.0 10
+    {1} {1 1} 0.0 2.0 10
+    {0 1 2} {0 1 2} 0.0 6.0 40
+  } {
+    check_rdf $what $t1 $t2 $r_min $r_max $r_bins $pos $types $mols
+  }
+}
+
+proc positions { } {
+  global n
+  set pos {}
+  for { set i 0 } { $i < $n } { incr i } {
+    lappend pos [part $i print pos]
+  }
+  return $pos
+}
+
+if { [catch {
+  set types {}
+  set mols {}
+  for { set i 0 } { $i < $n } { incr i } {
+    part $i pos [expr 3*$l*rand() - $l] [expr $l*rand()] [expr $l*rand()] \
+      type [expr $i % 3] molecule_id [expr $i / 4]
+    lappend types [expr $i % 3]
+    lappend mols [expr $i / 4]
+  }
+  check_rdfs "setup" [list [positions]] $types $mols
+
+  # the particles are distributed over the nodes and cross the box
+  integrate 200
+  check_rdfs "integration" [list [positions]] $types $mols
+
+  # averages over stored configurations
+  set confs {}
+  for { set c 0 } { $c < 3 } { incr c } {
+    integrate 50
+    analyze append
+    lappend confs [positions]
+  }
+  check_rdfs "configurations" $confs $types $mols
+} res ] } {
+  error_exit $res
+}
+
+exit 0
@@ -0,0 +1,148 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that a system with sparse particle ids up to 10^9 behaves
+# like the same system with consecutive ids.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase sparse_ids.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat off
+inter 0 harmonic 10.0 1.0
+
+set n 100
+expr srand(42)
+set pos {}
+set vel {}
+for { set i 0 } { $i < $n } { incr i } {
+  if { $i % 10 == 0 } {
+    set x [expr $l*rand()]
+    set y [expr $l*rand()]
+    set z [expr $l*rand()]
+  } else {
+    set x [expr $x + 0.9]
+  }
+  lappend pos [list $x $y $z]
+  lappend vel [list [expr rand()-0.5] [expr rand()-0.5] [expr rand()-0.5]]
+}
+
+# chains of 10 bonded particles, set up with the given ids
+proc setup { ids } {
+  global n pos vel
+  part deleteall
+  for { set i 0 } { $i < $n } { incr i } {
+    eval part [lindex $ids $i] pos [lindex $pos $i] v [lindex $vel $i]
+  }
+  for { set i 0 } { $i < $n } { incr i } {
+    if { $i % 10 != 0 } {
+      part [lindex $ids $i] bond 0 [lindex $ids [expr $i - 1]]
+    }
+  }
+}
+
+proc configuration { ids } {
+  set res {}
+  foreach id $ids {
+    lappend res [part $id print pos v f]
+  }
+  return $res
+}
+
+# the ids in a nested list replaced by their positions in ids
+proc to_indices { l ids } {
+  set res {}
+  foreach e $l {
+    if { [string is integer -strict [string trim $e]] } {
+      lappend res [lsearch -exact $ids [string trim $e]]
+    } else {
+      lappend res [to_indices $e $ids]
+    }
+  }
+  return $res
+}
+
+# the bond partners and the automatic exclusions of the particles in
+# the middle and at the end of a chain, in terms of positions in ids
+proc connectivity { ids } {
+  set res {}
+  foreach i { 15 99 } {
+    lappend res [to_indices [part [lindex $ids $i] print connections 3] $ids]
+  }
+  if { [has_feature EXCLUSIONS] } {
+    part auto_exclusions 2
+    foreach i { 15 99 } {
+      lappend res [to_indices [part [lindex $ids $i] print exclusions] $ids]
+    }
+  }
+  return $res
+}
+
+if { [catch {
+  set dense {}
+  set sparse {}
+  for { set i 0 } { $i < $n } { incr i } {
+    lappend dense $i
+    lappend sparse [expr 10000000 * $i + $i % 7]
+  }
+
+  setup $dense
+  integrate 100
+  set reference [configuration $dense]
+  set reference_connectivity [connectivity $dense]
+
+  setup $sparse
+  if { [setmd max_part] != [lindex $sparse end] || [setmd n_part] != $n } {
+    error "wrong particle numbers [setmd max_part] / [setmd n_part]"
+  }
+  integrate 100
+  foreach p [configuration $sparse] q $reference {
+    foreach x $p y $q {
+      if { abs($x - $y) > 1e-8 } {
+        error "sparse ids give a different trajectory: $p vs $q"
+      }
+    }
+  }
+
+  # the bond partners are found without tables over the id range
+  if { [connectivity $sparse] != $reference_connectivity } {
+    error "sparse ids give a different connectivity: [connectivity $sparse] vs $reference_connectivity"
+  }
+
+  # part prints all particles in the order of their ids
+  if { [lindex [part] end 0] != [lindex $sparse end] } {
+    error "wrong last particle [lindex [part] end 0]"
+  }
+
+  # removing the highest id finds the next one
+  part [lindex $sparse end] delete
+  if { [setmd max_part] != [lindex $sparse end-1] } {
+    error "wrong max_part [setmd max_part] after deletion"
+  }
+  part [expr [lindex $sparse end-1] + 1] pos 1 1 1
+  integrate 10
+} res ] } {
+  error_exit $res
+}
+
+exit 0
@@ -0,0 +1,181 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks the batch queries of nbhood and distto against the distances
+# calculated in Tcl, and the self avoiding setup of polymers and
+# counterions.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase spatial_queries.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat off
+
+proc mi_dist2 { a b } {
+  set d2 0.0
+  foreach x $a y $b l [setmd box_l] periodic [setmd periodic] {
+    set d [expr $x - $y]
+    if { $periodic } { set d [expr $d - $l*round($d/$l)] }
+    set d2 [expr $d2 + $d*$d]
+  }
+  return $d2
+}
+
+if { [catch {
+  ############## batch queries
+  expr srand(17)
+  set n 200
+  for { set i 0 } { $i < $n } { incr i } {
+    part $i pos [expr 3*$l*rand() - $l] [expr $l*rand()] [expr $l*rand()]
+  }
+  set points {}
+  for { set k 0 } { $k < 20 } { incr k } {
+    lappend points [list [expr $l*rand()] [expr $l*rand()] [expr 2*$l*rand()]]
+  }
+
+  set dist [analyze distto points $points]
+  set nbs [analyze nbhood points $points 1.5]
+  set flat [analyze distto points [join $points]]
+  if { [llength $dist] != 20 || [llength $nbs] != 20 || $flat != $dist } {
+    error "wrong number of results: $dist / $nbs / $flat"
+  }
+  foreach pt $points d $dist nb $nbs {
+    set mind2 [expr 9*$l*$l]
+    set ref {}
+    for { set i 0 } { $i < $n } { incr i } {
+      set d2 [mi_dist2 $pt [part $i print pos]]
+      if { $d2 < $mind2 } { set mind2 $d2 }
+      if { $d2 < 1.5*1.5 } { lappend ref $i }
+    }
+    if { abs($d - sqrt($mind2)) > 1e-8 } {
+      error "distto $pt: got $d, expected [expr sqrt($mind2)]"
+    }
+    if { [lsort -integer $nb] != $ref } {
+      error "nbhood $pt: got [lsort -integer $nb], expected $ref"
+    }
+    if { [eval analyze distto $pt] != $d } {
+      error "distto $pt differs between the single and the batch query"
+    }
+  }
+  if { ![catch { analyze distto points {1 2} }] } {
+    error "an incomplete position was accepted"
+  }
+
+  ############## self avoiding setup
+  part delete
+  set shield 0.9
+  inter 0 harmonic 1.0 1.0
+  polymer 10 30 1.0 mode PSAW $shield 3000 bond 0
+  counterions 50 start 300 mode SAW $shield 3000
+  salt 20 20 start 350 mode SAW $shield 3000
+  if { [setmd n_part] != 390 } {
+    error "[setmd n_part] particles were created instead of 390"
+  }
+  set mind [analyze mindist]
+  if { $mind < $shield } {
+    error "particles are only $mind apart, closer than the shield $shield"
+  }
+  # every monomer but the first of a chain is bonded to its predecessor
+  for { set i 0 } { $i < 300 } { incr i } {
+    if { $i % 30 != 0 } {
+      set b [lindex [part $i print bond] 0 0]
+      if { $b != [list 0 [expr $i - 1]] } {
+        error "monomer $i has the bonds [part $i print bond]"
+      }
+      set d [expr sqrt([mi_dist2 [part $i print pos] [part [expr $i - 1] print pos]])]
+      if { abs($d - 1.0) > 1e-8 } {
+        error "bond $i has the length $d"
+      }
+    }
+  }
+
+  ############## crosslinking
+  part delete
+  setmd box_l 8.0 8.0 8.0
+  set l 8.0
+  polymer 20 20 1.0 mode RW bond 0
+  set n_links [crosslink 20 20 catch 1.5 distLink 2 distChain 5 FENE 0 trials 30]
+  set n_bonds 0
+  for { set i 0 } { $i < 400 } { incr i } {
+    foreach b [lindex [part $i print bond] 0] {
+      set d2 [mi_dist2 [part $i print pos] [part [lindex $b 1] print pos]]
+      if { $d2 >= 1.5*1.5 } {
+        error "particle $i is linked to [lindex $b 1] at a distance [expr sqrt($d2)]"
+      }
+      incr n_bonds
+    }
+  }
+  if { $n_links <= 0 || $n_bonds != 380 + $n_links } {
+    error "$n_links crosslinks, but $n_bonds bonds"
+  }
+
+  ############## a box that is not periodic in x
+  if { [has_feature PARTIAL_PERIODIC] } {
+    part delete
+    # the chains leave the thin box in x, so that positions outside of
+    # it have to be found
+    setmd box_l 2.0 12.0 12.0
+    setmd periodic 0 1 1
+    polymer 10 30 1.0 mode PSAW $shield 3000 bond 0
+    set n 300
+    for { set i 0 } { $i < $n } { incr i } { set pos($i) [part $i print pos] }
+    set outside 0
+    set mind2 1e10
+    for { set i 0 } { $i < $n } { incr i } {
+      set x [lindex $pos($i) 0]
+      if { $x < 0.0 || $x > 2.0 } { incr outside }
+      for { set j [expr $i + 1] } { $j < $n } { incr j } {
+        set d2 [mi_dist2 $pos($i) $pos($j)]
+        if { $d2 < $mind2 } { set mind2 $d2 }
+      }
+    }
+    if { $outside == 0 } {
+      error "no monomer left the box"
+    }
+    if { $mind2 < $shield*$shield } {
+      error "monomers are only [expr sqrt($mind2)] apart, closer than the shield $shield"
+    }
+
+    set points {{-1.2 3 4} {3.5 6 6} {-4 11 1}}
+    foreach pt $points d [analyze distto points $points] nb [analyze nbhood points $points 1.5] {
+      set ref_d2 1e10
+      set ref {}
+      for { set i 0 } { $i < $n } { incr i } {
+        set d2 [mi_dist2 $pt $pos($i)]
+        if { $d2 < $ref_d2 } { set ref_d2 $d2 }
+        if { $d2 < 1.5*1.5 } { lappend ref $i }
+      }
+      if { abs($d - sqrt($ref_d2)) > 1e-8 } {
+        error "distto $pt: got $d, expected [expr sqrt($ref_d2)]"
+      }
+      if { [lsort -integer $nb] != $ref } {
+        error "nbhood $pt: got [lsort -integer $nb], expected $ref"
+      }
+    }
+    setmd periodic 1 1 1
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
@@ -0,0 +1,132 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# Checks the structure factor against the sum over the particles in
+# Tcl, and the mesh variant against the exact one.
+
+source "tests_common.tcl"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase structurefactor.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 6.0
+setmd box_l $l $l $l
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+
+set n 100
+set order 3
+expr srand(29)
+
+# S(q) of the types in the list, as {q S(q)} pairs
+proc sf_reference { types } {
+  global n l order
+  set pos {}
+  set weight {}
+  for { set p 0 } { $p < $n } { incr p } {
+    lappend pos [part $p print pos]
+    set w 0
+    foreach t $types {
+      if { [part $p print type] == $t } { incr w }
+    }
+    lappend weight $w
+  }
+  set n_w 0
+  foreach w $weight { incr n_w $w }
+
+  for { set i 0 } { $i < $order*$order } { incr i } {
+    set sf($i) 0.0
+    set cnt($i) 0
+  }
+  set k2pi [expr 2*acos(-1.0)/$l]
+  for { set i 0 } { $i <= $order } { incr i } {
+    for { set j -$order } { $j <= $order } { incr j } {
+      for { set k -$order } { $k <= $order } { incr k } {
+        set q2 [expr $i*$i + $j*$j + $k*$k]
+        if { $q2 < 1 || $q2 > $order*$order } continue
+        set c 0.0
+        set s 0.0
+        foreach p $pos w $weight {
+          if { $w == 0 } continue
+          set qr [expr $k2pi*($i*[lindex $p 0] + $j*[lindex $p 1] + \
+                              $k*[lindex $p 2])]
+          set c [expr $c + $w*cos($qr)]
+          set s [expr $s + $w*sin($qr)]
+        }
+        set sf([expr $q2 - 1]) [expr $sf([expr $q2 - 1]) + $c*$c + $s*$s]
+        incr cnt([expr $q2 - 1])
+      }
+    }
+  }
+  set res {}
+  for { set i 0 } { $i < $order*$order } { incr i } {
+    if { $cnt($i) > 0 } {
+      lappend res [list [expr $k2pi*sqrt($i + 1)] \
+                     [expr $sf($i)/($n_w*$cnt($i))]]
+    }
+  }
+  return $res
+}
+
+proc check_sf { what res ref eps } {
+  if { [llength $res] != [llength $ref] } {
+    error "$what: got $res, expected $ref"
+  }
+  foreach a $res b $ref {
+    foreach x $a y $b {
+      if { abs($x - $y) > $eps*(1.0 + abs($y)) } {
+        error "$what: got $res, expected $ref"
+      }
+    }
+  }
+}
+
+proc check_sfs { what } {
+  global order
+  foreach types { {0} {0 1} {1 1} } {
+    set res [analyze structurefactor $types $order]
+    check_sf "$what: structurefactor {$types}" $res [sf_reference $types] 1e-5
+    if { [has_feature "FFTW"] } {
+      set mesh [analyze structurefactor $types $order mesh 24 7]
+      check_sf "$what: structurefactor {$types} mesh" $mesh $res 1e-3
+    }
+  }
+}
+
+if { [catch {
+  for { set i 0 } { $i < $n } { incr i } {
+    part $i pos [expr 3*$l*rand() - $l] [expr $l*rand()] [expr $l*rand()] \
+      type [expr $i % 2]
+  }
+  check_sfs "setup"
+
+  # the particles are distributed over the nodes and cross the box
+  integrate 100
+  check_sfs "integration"
+
+  if { [has_feature "FFTW"] &&
+       ![catch { analyze structurefactor {0} $order mesh 6 }] } {
+    error "a mesh of at most 2*order has to be rejected"
+  }
+} res ] } {
+  error_exit $res
+}
+
+exit 0
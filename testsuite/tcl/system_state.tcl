@@ -0,0 +1,139 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that the binary system state restores the interactions, bonds,
+# constraints and the integrator and thermostat setup.
+
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase system_state.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set l 10.0
+set state "system_state.bin"
+
+proc setup {} {
+  global l
+  setmd box_l $l $l $l
+  setmd skin 0.3
+  setmd time_step 0.005
+  thermostat langevin 1.5 0.7
+  for { set i 0 } { $i < 5 } { incr i } {
+    for { set j $i } { $j < 5 } { incr j } {
+      inter $i $j lennard-jones [expr 1.0 + 0.1*$i] [expr 1.0 + 0.05*$j] \
+        [expr 1.12246 + 0.1*$i] auto 0
+    }
+  }
+  inter 0 harmonic 10.0 1.0
+  inter 1 fene 7.0 2.0
+  if { [has_feature "CONSTRAINTS"] } {
+    constraint wall normal 0 0 1 dist 0.5 type 4
+  }
+  if { [has_feature "ELECTROSTATICS"] } {
+    inter coulomb 1.0 dh 0.5 3.0
+  }
+}
+
+# everything the state covers, as printed by the commands
+proc describe {} {
+  set d [list [setmd box_l] [setmd skin] [setmd time_step] [thermostat] \
+           [inter]]
+  if { [has_feature "CONSTRAINTS"] } {
+    lappend d [constraint]
+  }
+  return $d
+}
+
+if { [catch {
+  setup
+  expr srand(7)
+  for { set i 0 } { $i < 100 } { incr i } {
+    # pairs on a lattice, the odd particles are bonded to their predecessor
+    set k [expr $i / 2]
+    set pos [list [expr 2*($k % 5) + 0.5 + ($i % 2)] \
+               [expr 2*(($k / 5) % 5) + 0.5] [expr 2*($k / 25) + 3.0]]
+    eval part $i pos $pos \
+      v [expr rand()-0.5] [expr rand()-0.5] [expr rand()-0.5] \
+      type [expr $i % 4]
+    if { [has_feature "ELECTROSTATICS"] } {
+      part $i q [expr ($i % 2) ? 1.0 : -1.0]
+    }
+  }
+  for { set i 0 } { $i < 100 } { incr i 2 } {
+    part $i bond [expr $i % 4 == 0 ? 0 : 1] [expr $i + 1]
+  }
+
+  set reference [describe]
+  set energy [analyze energy total]
+  set v [part 17 print v]
+  system_state $state write
+
+  # change everything that is stored
+  setmd time_step 0.01
+  setmd skin 0.5
+  thermostat off
+  for { set i 0 } { $i < 5 } { incr i } {
+    inter $i 3 lennard-jones 2.0 1.0 2.5 auto 0
+  }
+  inter 0 harmonic 1.0 0.5
+  inter 1 harmonic 2.0 0.5
+  if { [has_feature "CONSTRAINTS"] } {
+    constraint delete
+  }
+  if { [has_feature "ELECTROSTATICS"] } {
+    inter coulomb 0.0
+  }
+
+  system_state $state read
+
+  if { [describe] != $reference } {
+    error "state not restored:\n[describe]\ninstead of\n$reference"
+  }
+  set e [analyze energy total]
+  if { abs($e - $energy) > 1e-8 * abs($energy) } {
+    error "energy $e after the restore instead of $energy"
+  }
+  foreach x [part 17 print v] y $v {
+    if { abs($x - $y) > 1e-12 } {
+      error "velocity changed by the restore: [part 17 print v] instead of $v"
+    }
+  }
+  integrate 10
+
+  # a broken file has to leave the state unchanged
+  set f [open $state "r+"]
+  fconfigure $f -translation binary
+  seek $f 8
+  puts -nonewline $f "xxxx"
+  close $f
+  setmd skin 0.2
+  if { ![catch { system_state $state read }] } {
+    error "a broken state file was accepted"
+  }
+  if { [setmd skin] != 0.2 } {
+    error "a broken state file changed the state"
+  }
+
+  file delete $state
+} res ] } {
+  error_exit $res
+}
+
+exit 0